@@ -0,0 +1,153 @@
+#include "bench.h"
+
+#include <algorithm>
+
+BENCH_Runner::BENCH_Runner(const BENCH_Options& options)
+    : m_options(options)
+{
+}
+
+bool BENCH_Runner::IsEnabled(std::string_view name) const
+{
+    return m_options.filter.empty() || name.find(m_options.filter) != std::string_view::npos;
+}
+
+BENCH_Result* BENCH_Runner::Run(std::string_view name, std::string_view unit, const std::function<void(uint64_t)>& op)
+{
+    using Clock = std::chrono::steady_clock;
+
+    if (!IsEnabled(name))
+    {
+        return nullptr;
+    }
+
+    // Grow the iteration count until one batch takes long enough to time reliably. This also warms up caches.
+    uint64_t             iterations = 1;
+    Clock::duration      elapsed{};
+    for (;;)
+    {
+        const auto start = Clock::now();
+        op(iterations);
+        elapsed = Clock::now() - start;
+
+        if (elapsed >= m_options.min_sample_time)
+        {
+            break;
+        }
+
+        const double ratio = elapsed.count() == 0
+                                 ? 100.0
+                                 : (double)m_options.min_sample_time.count() / (double)elapsed.count();
+        iterations = std::max(iterations + 1, (uint64_t)((double)iterations * std::min(ratio * 1.2, 100.0)));
+    }
+
+    std::vector<double> per_op;
+    for (size_t i = 0; i < m_options.samples; ++i)
+    {
+        const auto start = Clock::now();
+        op(iterations);
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start);
+        per_op.push_back((double)ns.count() / (double)iterations);
+    }
+    std::sort(per_op.begin(), per_op.end());
+
+    BENCH_Result result;
+    result.name       = name;
+    result.unit       = unit;
+    result.median     = per_op[per_op.size() / 2];
+    result.min        = per_op.front();
+    result.max        = per_op.back();
+    result.iterations = iterations;
+    result.samples    = per_op.size();
+
+    return &Add(std::move(result));
+}
+
+BENCH_Result& BENCH_Runner::Add(BENCH_Result result)
+{
+    fprintf(stderr, "%-40s %12.2f %s", result.name.c_str(), result.median, result.unit.c_str());
+    if (result.samples > 1)
+    {
+        fprintf(stderr, " (min %.2f, max %.2f)", result.min, result.max);
+    }
+    fprintf(stderr, "\n");
+
+    m_results.push_back(std::move(result));
+    return m_results.back();
+}
+
+static void BENCH_WriteJSONString(FILE* output, std::string_view str)
+{
+    fputc('"', output);
+    for (char ch : str)
+    {
+        switch (ch)
+        {
+        case '"':
+            fputs("\\\"", output);
+            break;
+        case '\\':
+            fputs("\\\\", output);
+            break;
+        case '\n':
+            fputs("\\n", output);
+            break;
+        default:
+            if ((unsigned char)ch < 0x20)
+            {
+                fprintf(output, "\\u%04x", (unsigned)ch);
+            }
+            else
+            {
+                fputc(ch, output);
+            }
+            break;
+        }
+    }
+    fputc('"', output);
+}
+
+void BENCH_Runner::WriteJSON(FILE* output, const std::vector<std::pair<std::string, std::string>>& context) const
+{
+    fprintf(output, "{\n  \"context\": {");
+    for (size_t i = 0; i < context.size(); ++i)
+    {
+        fprintf(output, "%s\n    ", i == 0 ? "" : ",");
+        BENCH_WriteJSONString(output, context[i].first);
+        fprintf(output, ": ");
+        BENCH_WriteJSONString(output, context[i].second);
+    }
+    fprintf(output, "\n  },\n  \"benchmarks\": [");
+
+    for (size_t i = 0; i < m_results.size(); ++i)
+    {
+        const BENCH_Result& result = m_results[i];
+
+        fprintf(output, "%s\n    {\"name\": ", i == 0 ? "" : ",");
+        BENCH_WriteJSONString(output, result.name);
+        fprintf(output, ", \"unit\": ");
+        BENCH_WriteJSONString(output, result.unit);
+        fprintf(output,
+                ", \"median\": %.6g, \"min\": %.6g, \"max\": %.6g, \"iterations\": %llu, \"samples\": %zu",
+                result.median,
+                result.min,
+                result.max,
+                (unsigned long long)result.iterations,
+                result.samples);
+
+        if (!result.params.empty())
+        {
+            fprintf(output, ", \"params\": {");
+            for (size_t j = 0; j < result.params.size(); ++j)
+            {
+                fprintf(output, "%s", j == 0 ? "" : ", ");
+                BENCH_WriteJSONString(output, result.params[j].first);
+                fprintf(output, ": %.6g", result.params[j].second);
+            }
+            fprintf(output, "}");
+        }
+        fprintf(output, "}");
+    }
+
+    fprintf(output, "\n  ]\n}\n");
+}
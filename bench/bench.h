@@ -0,0 +1,76 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+struct BENCH_Options
+{
+    // Only run benchmarks whose name contains this string.
+    std::string_view filter;
+    // Each sample runs for at least this long.
+    std::chrono::nanoseconds min_sample_time = std::chrono::milliseconds(200);
+    // Number of timed samples per benchmark. The median is reported.
+    size_t samples = 5;
+};
+
+struct BENCH_Result
+{
+    std::string name;
+    // Unit for the value fields, e.g. "ns/step".
+    std::string unit;
+    double median = 0;
+    double min    = 0;
+    double max    = 0;
+    // Operations per sample.
+    uint64_t iterations = 0;
+    size_t   samples    = 0;
+    // Extra numbers describing the benchmark setup or outcome, e.g. the number of voices sounding.
+    std::vector<std::pair<std::string, double>> params;
+};
+
+// Runs a benchmark `samples` times and records a result for each.
+class BENCH_Runner
+{
+public:
+    explicit BENCH_Runner(const BENCH_Options& options);
+
+    bool IsEnabled(std::string_view name) const;
+
+    // `op(n)` must perform the operation being measured `n` times. The iteration count is calibrated so each sample
+    // takes at least `min_sample_time`; the result is reported per operation in `unit`, which should be "ns/<op>".
+    // Returns nullptr when the benchmark is filtered out.
+    BENCH_Result* Run(std::string_view name, std::string_view unit, const std::function<void(uint64_t)>& op);
+
+    // Records a result measured by the caller, e.g. a macro benchmark that reports a rate.
+    BENCH_Result& Add(BENCH_Result result);
+
+    const std::vector<BENCH_Result>& GetResults() const
+    {
+        return m_results;
+    }
+
+    // Writes every result as JSON. `context` is a list of string key/values identifying the run.
+    void WriteJSON(FILE* output, const std::vector<std::pair<std::string, std::string>>& context) const;
+
+private:
+    BENCH_Options             m_options;
+    std::vector<BENCH_Result> m_results;
+};
+
+// Keeps the compiler from optimizing away a computation whose result is otherwise unused.
+template <typename T>
+inline void BENCH_DoNotOptimize(const T& value)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const void* sink;
+    sink = &value;
+#endif
+}
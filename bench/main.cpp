@@ -0,0 +1,654 @@
+#include "audio.h"
+#include "bench.h"
+#include "config.h"
+#include "emu.h"
+#include "lcd.h"
+#include "mcu_timer.h"
+#include "player.h"
+#include "smf.h"
+#include "submcu.h"
+#include "wav.h"
+#include <algorithm>
+#include <bit>
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "common/command_line.h"
+#include "common/path_util.h"
+#include "common/rom_loader.h"
+
+struct BENCH_Parameters
+{
+    bool help = false;
+    std::filesystem::path rom_directory = NUKED_BENCH_ROMDIR;
+    std::string_view romset_name;
+    std::filesystem::path midi_directory = NUKED_BENCH_MIDIDIR;
+    std::filesystem::path json_filename;
+    bool no_render = false;
+    BENCH_Options options;
+};
+
+enum class BENCH_ParseError
+{
+    Success,
+    UnexpectedEnd,
+    RomDirectoryNotFound,
+    MidiDirectoryNotFound,
+    SamplesInvalid,
+    MinTimeInvalid,
+    UnknownArgument,
+};
+
+const char* BENCH_ParseErrorStr(BENCH_ParseError err)
+{
+    switch (err)
+    {
+        case BENCH_ParseError::Success:
+            return "Success";
+        case BENCH_ParseError::UnexpectedEnd:
+            return "Expected another argument";
+        case BENCH_ParseError::RomDirectoryNotFound:
+            return "Rom directory doesn't exist";
+        case BENCH_ParseError::MidiDirectoryNotFound:
+            return "MIDI directory doesn't exist";
+        case BENCH_ParseError::SamplesInvalid:
+            return "Samples invalid (should be at least 1)";
+        case BENCH_ParseError::MinTimeInvalid:
+            return "Minimum sample time invalid (should be a number of milliseconds)";
+        case BENCH_ParseError::UnknownArgument:
+            return "Unknown argument";
+    }
+    return "Unknown error";
+}
+
+BENCH_ParseError BENCH_ParseCommandLine(int argc, char* argv[], BENCH_Parameters& result)
+{
+    common::CommandLineReader reader(argc, argv);
+
+    while (reader.Next())
+    {
+        if (reader.Any("-h", "--help", "-?"))
+        {
+            result.help = true;
+            return BENCH_ParseError::Success;
+        }
+        else if (reader.Any("-d", "--rom-directory"))
+        {
+            if (!reader.Next())
+            {
+                return BENCH_ParseError::UnexpectedEnd;
+            }
+
+            result.rom_directory = reader.Arg();
+
+            if (!std::filesystem::exists(result.rom_directory))
+            {
+                return BENCH_ParseError::RomDirectoryNotFound;
+            }
+        }
+        else if (reader.Any("--romset"))
+        {
+            if (!reader.Next())
+            {
+                return BENCH_ParseError::UnexpectedEnd;
+            }
+
+            result.romset_name = reader.Arg();
+        }
+        else if (reader.Any("--midi-directory"))
+        {
+            if (!reader.Next())
+            {
+                return BENCH_ParseError::UnexpectedEnd;
+            }
+
+            result.midi_directory = reader.Arg();
+
+            if (!std::filesystem::exists(result.midi_directory))
+            {
+                return BENCH_ParseError::MidiDirectoryNotFound;
+            }
+        }
+        else if (reader.Any("--json"))
+        {
+            if (!reader.Next())
+            {
+                return BENCH_ParseError::UnexpectedEnd;
+            }
+
+            result.json_filename = reader.Arg();
+        }
+        else if (reader.Any("--filter"))
+        {
+            if (!reader.Next())
+            {
+                return BENCH_ParseError::UnexpectedEnd;
+            }
+
+            result.options.filter = reader.Arg();
+        }
+        else if (reader.Any("--samples"))
+        {
+            if (!reader.Next())
+            {
+                return BENCH_ParseError::UnexpectedEnd;
+            }
+
+            if (!reader.TryParse(result.options.samples) || result.options.samples == 0)
+            {
+                return BENCH_ParseError::SamplesInvalid;
+            }
+        }
+        else if (reader.Any("--min-time"))
+        {
+            if (!reader.Next())
+            {
+                return BENCH_ParseError::UnexpectedEnd;
+            }
+
+            uint32_t ms = 0;
+            if (!reader.TryParse(ms))
+            {
+                return BENCH_ParseError::MinTimeInvalid;
+            }
+            result.options.min_sample_time = std::chrono::milliseconds(ms);
+        }
+        else if (reader.Any("--no-render"))
+        {
+            result.no_render = true;
+        }
+        else
+        {
+            return BENCH_ParseError::UnknownArgument;
+        }
+    }
+
+    return BENCH_ParseError::Success;
+}
+
+void BENCH_Usage()
+{
+    constexpr const char* USAGE_STR = R"(Runs nuked-sc55 microbenchmarks and renders MIDI files to measure emulation speed.
+
+Usage: %s [options]
+
+General options:
+  -? -h, --help                Display this information.
+  --json <filename>            Write results as JSON to filename instead of stdout.
+  --filter <text>              Only run benchmarks whose name contains text.
+  --samples <count>            Number of timed samples per benchmark (default 5).
+  --min-time <ms>              Minimum duration of each sample in milliseconds (default 200).
+
+ROM management options:
+  -d, --rom-directory <dir>    Sets the directory to load roms from. Defaults to NUKED_TEST_ROMDIR.
+  --romset <name>              Sets the romset to load.
+
+Render options:
+  --midi-directory <dir>       Render every .mid file under dir. Defaults to the integration test MIDIs.
+  --no-render                  Skip rendering; only run microbenchmarks.
+
+)";
+
+    std::string name = common::GetProcessPath().stem().generic_string();
+    fprintf(stderr, USAGE_STR, name.c_str());
+
+    common::PrintRomsets(stderr);
+}
+
+uint64_t BENCH_StepsPerSecond(Emulator& emu)
+{
+    return 1'000'000'000 / R_NSPerStep(emu);
+}
+
+size_t BENCH_CountVoices(Emulator& emu)
+{
+    const pcm_t& pcm = emu.GetPCM();
+    return (size_t)std::popcount(pcm.voice_mask & pcm.voice_mask_pending);
+}
+
+void BENCH_CountFrame(void* userdata, const AudioFrame<int32_t>& frame)
+{
+    (void)frame;
+    ++*(uint64_t*)userdata;
+}
+
+// LCD backend that accepts frames and does nothing with them, so LCD_Render rasterizes without presenting.
+class BENCH_NullLCD : public LCD_Backend
+{
+public:
+    bool Start(lcd_t& lcd) override
+    {
+        (void)lcd;
+        return true;
+    }
+
+    void Stop() override
+    {
+    }
+
+    void Render() override
+    {
+    }
+};
+
+struct BENCH_Roms
+{
+    AllRomsetInfo info;
+    Romset        romset;
+};
+
+// Creates an emulator in the state the renderer starts from: roms loaded and a GM reset processed.
+bool BENCH_CreateEmulator(Emulator& emu, const BENCH_Roms& roms, const std::filesystem::path& rom_directory,
+                          LCD_Backend* lcd_backend)
+{
+    EMU_Options options;
+    options.rom_directory = rom_directory;
+    options.lcd_backend   = lcd_backend;
+
+    if (!emu.Init(options))
+    {
+        fprintf(stderr, "FATAL: Failed to initialize emulator\n");
+        return false;
+    }
+
+    if (!emu.LoadRoms(roms.romset, roms.info))
+    {
+        fprintf(stderr, "FATAL: Failed to load roms\n");
+        return false;
+    }
+
+    emu.Reset();
+
+    if (!emu.StartLCD())
+    {
+        fprintf(stderr, "FATAL: Failed to start LCD\n");
+        return false;
+    }
+
+    emu.PostSystemReset(EMU_SystemReset::GM_RESET);
+    for (size_t i = 0; i < 24'000'000; ++i)
+    {
+        emu.Step();
+    }
+
+    return true;
+}
+
+void BENCH_StepFor(Emulator& emu, std::chrono::milliseconds duration)
+{
+    const uint64_t steps = BENCH_StepsPerSecond(emu) * (uint64_t)duration.count() / 1000;
+    for (uint64_t i = 0; i < steps; ++i)
+    {
+        emu.Step();
+    }
+}
+
+// Silences every channel, then holds organ notes (which sustain indefinitely) until at least `voices` PCM voices are
+// sounding. Returns the number of voices actually sounding, which may be lower if the polyphony limit is reached.
+size_t BENCH_HoldVoices(Emulator& emu, size_t voices)
+{
+    for (uint8_t ch = 0; ch < 16; ++ch)
+    {
+        const uint8_t all_sound_off[] = {(uint8_t)(0xb0 | ch), 120, 0};
+        const uint8_t church_organ[]  = {(uint8_t)(0xc0 | ch), 19};
+        emu.PostMIDI(all_sound_off);
+        emu.PostMIDI(church_organ);
+    }
+    BENCH_StepFor(emu, std::chrono::milliseconds(500));
+
+    uint8_t ch  = 0;
+    uint8_t key = 48;
+    for (size_t notes = 0; notes < 64 && BENCH_CountVoices(emu) < voices; ++notes)
+    {
+        const uint8_t note_on[] = {(uint8_t)(0x90 | ch), key, 100};
+        emu.PostMIDI(note_on);
+        BENCH_StepFor(emu, std::chrono::milliseconds(20));
+
+        // Spread notes across melodic channels so per-part voice limits don't kick in.
+        ch = (uint8_t)((ch + 1) % 16);
+        if (ch == 9)
+        {
+            ch = 10;
+        }
+        if (ch == 0)
+        {
+            key += 3;
+        }
+    }
+    BENCH_StepFor(emu, std::chrono::milliseconds(200));
+
+    return BENCH_CountVoices(emu);
+}
+
+void BENCH_RunEmulatorBenchmarks(BENCH_Runner& runner, const BENCH_Roms& roms, const std::filesystem::path& rom_directory)
+{
+    BENCH_NullLCD lcd_backend;
+    Emulator      emu;
+    if (!BENCH_CreateEmulator(emu, roms, rom_directory, &lcd_backend))
+    {
+        exit(1);
+    }
+
+    uint64_t frames = 0;
+    emu.SetSampleCallback(BENCH_CountFrame, &frames);
+
+    mcu_t&       mcu   = emu.GetMCU();
+    pcm_t&       pcm   = emu.GetPCM();
+    mcu_timer_t& timer = *mcu.timer;
+    submcu_t&    sm    = *mcu.sm;
+    lcd_t&       lcd   = emu.GetLCD();
+
+    // The component benchmarks below advance mcu.cycles without running the MCU, as if it were asleep. The other
+    // components catch up on the next Emulator::Step.
+
+    runner.Run("TIMER_Clock", "ns/step", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            mcu.cycles += 12;
+            TIMER_Clock(timer, mcu.cycles);
+        }
+    });
+
+    if (!mcu.is_mk1 && !mcu.is_jv880 && !mcu.is_scb55)
+    {
+        runner.Run("SM_Update", "ns/step", [&](uint64_t n) {
+            for (uint64_t i = 0; i < n; ++i)
+            {
+                mcu.cycles += 12;
+                SM_Update(sm, mcu.cycles);
+            }
+        });
+    }
+
+    runner.Run("LCD_Render", "ns/frame", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            LCD_Render(lcd);
+        }
+    });
+
+    const uint8_t contrast = lcd.contrast;
+    runner.Run("LCD_Render/repaint", "ns/frame", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            // A contrast change recolors every lit pixel.
+            LCD_SetContrast(lcd, (uint8_t)(i % 2 ? contrast : contrast + 1));
+            LCD_Render(lcd);
+        }
+    });
+    LCD_SetContrast(lcd, contrast);
+
+    for (size_t voices : {0, 8, 16, 24})
+    {
+        const std::string mcu_name = "MCU_Step/voices=" + std::to_string(voices);
+        const std::string pcm_name = "PCM_Update/voices=" + std::to_string(voices);
+        if (!runner.IsEnabled(mcu_name) && !runner.IsEnabled(pcm_name))
+        {
+            continue;
+        }
+
+        const double sounding = (double)BENCH_HoldVoices(emu, voices);
+
+        if (BENCH_Result* result = runner.Run(mcu_name, "ns/step", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    emu.Step();
+                }
+            }))
+        {
+            result->params.emplace_back("voices", sounding);
+        }
+
+        const uint64_t cycles_per_tick = (uint64_t)(pcm.config.reg_slots + 1) * 25;
+        if (BENCH_Result* result = runner.Run(pcm_name, "ns/tick", [&](uint64_t n) {
+                for (uint64_t i = 0; i < n; ++i)
+                {
+                    mcu.cycles += cycles_per_tick;
+                    PCM_Update(pcm, mcu.cycles);
+                }
+            }))
+        {
+            result->params.emplace_back("voices", sounding);
+        }
+    }
+}
+
+constexpr size_t BENCH_BUFFER_FRAMES = 4096;
+
+std::vector<AudioFrame<int32_t>> BENCH_MakeRawFrames()
+{
+    std::vector<AudioFrame<int32_t>> frames(BENCH_BUFFER_FRAMES);
+    uint32_t                         x = 12345;
+    for (auto& frame : frames)
+    {
+        x           = x * 1664525 + 1013904223;
+        frame.left  = (int32_t)x >> 4;
+        x           = x * 1664525 + 1013904223;
+        frame.right = (int32_t)x >> 4;
+    }
+    return frames;
+}
+
+template <typename SampleT>
+void BENCH_RunSampleBenchmarks(BENCH_Runner& runner, const char* format_name)
+{
+    const std::vector<AudioFrame<int32_t>> raw = BENCH_MakeRawFrames();
+
+    std::vector<AudioFrame<SampleT>> frames(raw.size());
+    std::vector<AudioFrame<SampleT>> mixed(raw.size());
+    for (size_t i = 0; i < raw.size(); ++i)
+    {
+        Normalize(raw[i], frames[i]);
+    }
+
+    const uint64_t buffer_frames = raw.size();
+
+    runner.Run(std::string("Normalize/") + format_name, "ns/frame", [&](uint64_t n) {
+        const uint64_t buffers = (n + buffer_frames - 1) / buffer_frames;
+        for (uint64_t b = 0; b < buffers; ++b)
+        {
+            for (size_t i = 0; i < raw.size(); ++i)
+            {
+                Normalize(raw[i], mixed[i]);
+            }
+            BENCH_DoNotOptimize(mixed[0]);
+        }
+    });
+
+    runner.Run(std::string("Scale/") + format_name, "ns/frame", [&](uint64_t n) {
+        const uint64_t buffers = (n + buffer_frames - 1) / buffer_frames;
+        for (uint64_t b = 0; b < buffers; ++b)
+        {
+            for (auto& frame : mixed)
+            {
+                Scale(frame, 0.99f);
+            }
+            BENCH_DoNotOptimize(mixed[0]);
+        }
+    });
+
+    // R_Mixer lives in the renderer's main.cpp; its MixFrames hands each instance's chunk to these kernels.
+    runner.Run(std::string("MixFrames/") + format_name, "ns/frame", [&](uint64_t n) {
+        const uint64_t buffers = (n + buffer_frames - 1) / buffer_frames;
+        for (uint64_t b = 0; b < buffers; ++b)
+        {
+            MixFrames(mixed.data(), frames.data(), frames.size());
+            BENCH_DoNotOptimize(mixed[0]);
+        }
+    });
+
+    const std::filesystem::path wav_path =
+        std::filesystem::temp_directory_path() / (std::string("nuked-sc55-bench-") + format_name + ".wav");
+    AudioFormat format = AudioFormat::S16;
+    if constexpr (std::is_same_v<SampleT, int32_t>)
+    {
+        format = AudioFormat::S32;
+    }
+    else if constexpr (std::is_same_v<SampleT, float>)
+    {
+        format = AudioFormat::F32;
+    }
+
+    WAV_Handle wav;
+    wav.SetSampleRate(66207);
+    wav.Open(wav_path, format);
+    runner.Run(std::string("WAV_Write/") + format_name, "ns/frame", [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i)
+        {
+            wav.Write(frames[i % frames.size()]);
+        }
+    });
+    wav.Finish();
+    std::filesystem::remove(wav_path);
+}
+
+// Renders `filename` on a single emulator like `nuked-sc55-render --end cut` and reports how many seconds of audio
+// were produced per second of wall time.
+void BENCH_RenderFile(BENCH_Runner&                runner,
+                      const BENCH_Roms&            roms,
+                      const std::filesystem::path& rom_directory,
+                      const std::filesystem::path& filename,
+                      const std::string&           name)
+{
+    Emulator emu;
+    if (!BENCH_CreateEmulator(emu, roms, rom_directory, nullptr))
+    {
+        exit(1);
+    }
+
+    uint64_t frames = 0;
+    emu.SetSampleCallback(BENCH_CountFrame, &frames);
+
+    const SMF_MappedData data = SMF_MapEvents(filename);
+    R_Player             player(data, emu);
+
+    const auto start = std::chrono::steady_clock::now();
+    while (player.NextBlock())
+    {
+        for (const SMF_ScheduledEvent& scheduled : player.GetSchedule().events)
+        {
+            player.Play(scheduled);
+        }
+    }
+    const double wall_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    const double emulated_seconds = (double)frames / (double)PCM_GetOutputFrequency(emu.GetPCM());
+    const double factor           = wall_seconds == 0 ? 0 : emulated_seconds / wall_seconds;
+
+    BENCH_Result result;
+    result.name       = name;
+    result.unit       = "x realtime";
+    result.median     = factor;
+    result.min        = factor;
+    result.max        = factor;
+    result.iterations = player.GetStepsRun();
+    result.samples    = 1;
+    result.params.emplace_back("emulated_seconds", emulated_seconds);
+    result.params.emplace_back("wall_seconds", wall_seconds);
+    runner.Add(std::move(result));
+}
+
+void BENCH_RunRenderBenchmarks(BENCH_Runner&                runner,
+                               const BENCH_Roms&            roms,
+                               const std::filesystem::path& rom_directory,
+                               const std::filesystem::path& midi_directory)
+{
+    std::vector<std::filesystem::path> files;
+    for (const auto& entry : std::filesystem::recursive_directory_iterator(midi_directory))
+    {
+        if (entry.is_regular_file() && entry.path().extension() == ".mid")
+        {
+            files.push_back(entry.path());
+        }
+    }
+    std::sort(files.begin(), files.end());
+
+    for (const auto& file : files)
+    {
+        const std::string name = "Render/" + file.lexically_relative(midi_directory).generic_string();
+        if (runner.IsEnabled(name))
+        {
+            BENCH_RenderFile(runner, roms, rom_directory, file, name);
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    BENCH_Parameters params;
+    BENCH_ParseError result = BENCH_ParseCommandLine(argc, argv, params);
+
+    if (result != BENCH_ParseError::Success)
+    {
+        fprintf(stderr, "error: %s\n", BENCH_ParseErrorStr(result));
+        BENCH_Usage();
+        return 1;
+    }
+
+    if (params.help)
+    {
+        BENCH_Usage();
+        return 0;
+    }
+
+    BENCH_Roms roms;
+
+    common::LoadRomsetResult load_result;
+    common::LoadRomsetError  err = common::LoadRomset(roms.info,
+                                                     params.rom_directory,
+                                                     params.romset_name,
+                                                     /* legacy_loader */ false,
+                                                     common::RomOverrides{},
+                                                     load_result);
+
+    common::PrintLoadRomsetDiagnostics(stderr, err, load_result, roms.info);
+
+    if (err != common::LoadRomsetError{})
+    {
+        return 1;
+    }
+    roms.romset = load_result.romset;
+
+    BENCH_Runner runner(params.options);
+
+    BENCH_RunSampleBenchmarks<int16_t>(runner, "s16");
+    BENCH_RunSampleBenchmarks<int32_t>(runner, "s32");
+    BENCH_RunSampleBenchmarks<float>(runner, "f32");
+
+    BENCH_RunEmulatorBenchmarks(runner, roms, params.rom_directory);
+
+    if (!params.no_render && !params.midi_directory.empty())
+    {
+        BENCH_RunRenderBenchmarks(runner, roms, params.rom_directory, params.midi_directory);
+    }
+
+    FILE* output = stdout;
+    if (!params.json_filename.empty())
+    {
+        output = fopen(params.json_filename.string().c_str(), "w");
+        if (!output)
+        {
+            fprintf(stderr, "FATAL: Failed to open %s\n", params.json_filename.string().c_str());
+            return 1;
+        }
+    }
+
+    runner.WriteJSON(output,
+                     {
+                         {"version", NUKED_VERSION},
+                         {"romset", RomsetName(roms.romset)},
+#if defined(__VERSION__)
+                         {"compiler", __VERSION__},
+#endif
+                         {"build_type", NUKED_BENCH_BUILD_TYPE},
+                     });
+
+    if (output != stdout)
+    {
+        fclose(output);
+    }
+
+    return 0;
+}
@@ -49,6 +49,47 @@ inline void Normalize(const AudioFrame<int32_t>& in, AudioFrame<float>& out, con
 }
 
 
+// Converts a frame normalized to float back to one of the other formats, at the level Normalize would have produced
+// for that format. Used after processing that has to happen in float, such as resampling.
+inline void ConvertFrame(const AudioFrame<float>& in, AudioFrame<int16_t>& out)
+{
+    constexpr float SCALE = 16384.0f;
+
+    out.left  = (int16_t)Clamp<float>(in.left  * SCALE, INT16_MIN, INT16_MAX);
+    out.right = (int16_t)Clamp<float>(in.right * SCALE, INT16_MIN, INT16_MAX);
+}
+
+inline void ConvertFrame(const AudioFrame<float>& in, AudioFrame<int32_t>& out)
+{
+    // Computed in double because float can't represent INT32_MAX exactly.
+    constexpr double SCALE = 1073741824.0;
+
+    out.left  = (int32_t)Clamp<double>(in.left  * SCALE, INT32_MIN, INT32_MAX);
+    out.right = (int32_t)Clamp<double>(in.right * SCALE, INT32_MIN, INT32_MAX);
+}
+
+inline void ConvertFrame(const AudioFrame<float>& in, AudioFrame<float>& out)
+{
+    out = in;
+}
+
+// The inverse of the above.
+inline void ConvertFrame(const AudioFrame<int16_t>& in, AudioFrame<float>& out)
+{
+    constexpr float SCALE = 1.0f / 16384.0f;
+
+    out.left  = (float)in.left  * SCALE;
+    out.right = (float)in.right * SCALE;
+}
+
+inline void ConvertFrame(const AudioFrame<int32_t>& in, AudioFrame<float>& out)
+{
+    constexpr float SCALE = 1.0f / 1073741824.0f;
+
+    out.left  = (float)in.left  * SCALE;
+    out.right = (float)in.right * SCALE;
+}
+
 inline void MixFrame(AudioFrame<int16_t>& dest, const AudioFrame<int16_t>& src)
 {
     dest.left  = SaturatingAdd(dest.left, src.left);
@@ -67,6 +108,22 @@ inline void MixFrame(AudioFrame<float>& dest, const AudioFrame<float>& src)
     dest.right += src.right;
 }
 
+// Equivalent to calling MixFrame on each of the `count` frames, but vectorized.
+inline void MixFrames(AudioFrame<int16_t>* dest, const AudioFrame<int16_t>* src, size_t count)
+{
+    HorizontalSatAddI16((int16_t*)dest, (const int16_t*)src, (const int16_t*)(src + count));
+}
+
+inline void MixFrames(AudioFrame<int32_t>* dest, const AudioFrame<int32_t>* src, size_t count)
+{
+    HorizontalSatAddI32((int32_t*)dest, (const int32_t*)src, (const int32_t*)(src + count));
+}
+
+inline void MixFrames(AudioFrame<float>* dest, const AudioFrame<float>* src, size_t count)
+{
+    HorizontalAddF32((float*)dest, (const float*)src, (const float*)(src + count));
+}
+
 template <typename SampleT>
 void Scale(AudioFrame<SampleT>& frame, float scalar_gain)
 {
@@ -38,7 +38,9 @@
 #include "lcd.h"
 #include "pcm.h"
 #include "submcu.h"
+#include <algorithm>
 #include <fstream>
+#include <thread>
 #include <string>
 #include <span>
 #include <vector>
@@ -49,6 +51,60 @@ Emulator::~Emulator()
 {
     WriteSRAM();
     WriteNVRAM();
+
+    // These may live in m_arena, which is destroyed first.
+    m_mcu.reset();
+    m_sm.reset();
+    m_timer.reset();
+    m_lcd.reset();
+    m_pcm.reset();
+}
+
+bool Emulator::InitArena(EMU_MemoryMode mode)
+{
+    RomLocation waveroms[ROMLOCATION_COUNT];
+    size_t      waverom_count = 0;
+
+    size_t size = sizeof(mcu_memory_t) + sizeof(mcu_t) + sizeof(submcu_t) + sizeof(mcu_timer_t) + sizeof(lcd_t) +
+                  sizeof(pcm_t);
+    for (size_t i = 0; i < ROMLOCATION_COUNT; ++i)
+    {
+        if (IsWaverom((RomLocation)i))
+        {
+            waveroms[waverom_count++] = (RomLocation)i;
+            size += GetWaveromCapacity((RomLocation)i);
+        }
+    }
+    // Alignment padding between the components.
+    size += 6 * 4096;
+
+    if (!m_arena.Init(size, mode))
+    {
+        return false;
+    }
+
+    // Largest first, so that every waverom starts on a huge page boundary and the small components share the last
+    // huge page. The romset isn't known yet, so there's a slot for every location; unused ones are never touched and
+    // only take up address space, except with explicit huge pages.
+    std::sort(waveroms, waveroms + waverom_count, [](RomLocation a, RomLocation b) {
+        return GetWaveromCapacity(a) > GetWaveromCapacity(b);
+    });
+    for (size_t i = 0; i < waverom_count; ++i)
+    {
+        const size_t capacity = GetWaveromCapacity(waveroms[i]);
+        m_waverom_slots[(size_t)waveroms[i]] = {(uint8_t*)m_arena.Allocate(capacity, 4096), capacity};
+    }
+
+    const EMU_ArenaDeleter in_arena{true};
+
+    mcu_memory_t* memory = m_arena.New<mcu_memory_t>();
+    m_mcu   = EMU_ArenaPtr<mcu_t>(m_arena.New<mcu_t>(*memory), in_arena);
+    m_sm    = EMU_ArenaPtr<submcu_t>(m_arena.New<submcu_t>(), in_arena);
+    m_timer = EMU_ArenaPtr<mcu_timer_t>(m_arena.New<mcu_timer_t>(), in_arena);
+    m_lcd   = EMU_ArenaPtr<lcd_t>(m_arena.New<lcd_t>(), in_arena);
+    m_pcm   = EMU_ArenaPtr<pcm_t>(m_arena.New<pcm_t>(), in_arena);
+
+    return true;
 }
 
 bool Emulator::Init(const EMU_Options& options)
@@ -57,11 +113,24 @@ bool Emulator::Init(const EMU_Options& options)
 
     try
     {
-        m_mcu   = std::make_unique<mcu_t>();
-        m_sm    = std::make_unique<submcu_t>();
-        m_timer = std::make_unique<mcu_timer_t>();
-        m_lcd   = std::make_unique<lcd_t>();
-        m_pcm   = std::make_unique<pcm_t>();
+        bool in_arena = false;
+        if (options.memory_mode != EMU_MemoryMode::Heap)
+        {
+            in_arena = InitArena(options.memory_mode);
+            if (!in_arena)
+            {
+                fprintf(stderr, "WARNING: Couldn't create memory arena; allocating emulator state on the heap\n");
+            }
+        }
+
+        if (!in_arena)
+        {
+            m_mcu   = EMU_ArenaPtr<mcu_t>(new mcu_t());
+            m_sm    = EMU_ArenaPtr<submcu_t>(new submcu_t());
+            m_timer = EMU_ArenaPtr<mcu_timer_t>(new mcu_timer_t());
+            m_lcd   = EMU_ArenaPtr<lcd_t>(new lcd_t());
+            m_pcm   = EMU_ArenaPtr<pcm_t>(new pcm_t());
+        }
     }
     catch (const std::bad_alloc&)
     {
@@ -70,6 +139,9 @@ bool Emulator::Init(const EMU_Options& options)
         m_timer.reset();
         m_lcd.reset();
         m_pcm.reset();
+        m_arena.Free();
+        std::fill(std::begin(m_waverom_slots), std::end(m_waverom_slots), std::span<uint8_t>());
+        std::fill(std::begin(m_waverom_slot_used), std::end(m_waverom_slot_used), 0);
         return false;
     }
 
@@ -106,8 +178,9 @@ void Emulator::SetSampleCallback(mcu_sample_callback callback, void* userdata)
     m_mcu->sample_callback   = callback;
 }
 
-void Emulator::SetMidiOutCallback(mcu_midiout_callback callback)
+void Emulator::SetMidiOutCallback(mcu_midiout_callback callback, void* userdata)
 {
+    m_mcu->midiout_userdata = userdata;
     m_mcu->midiout_callback = callback;
 }
 
@@ -302,9 +375,22 @@ std::span<uint8_t> Emulator::MapBuffer(RomLocation location)
     switch (location)
     {
     case RomLocation::ROM1:
-        return GetMCU().rom1;
+        return std::span<uint8_t>(GetMCU().rom1, ROM1_SIZE);
     case RomLocation::ROM2:
-        return GetMCU().rom2;
+        return std::span<uint8_t>(GetMCU().rom2, ROM2_SIZE);
+    case RomLocation::SMROM:
+        return m_sm->rom;
+    default:
+        break;
+    }
+    fprintf(stderr, "FATAL: MapBuffer called with invalid location %d\n", (int)location);
+    std::abort();
+}
+
+const uint8_t*& Emulator::MapWaverom(RomLocation location)
+{
+    switch (location)
+    {
     case RomLocation::WAVEROM1:
         return GetPCM().waverom1;
     case RomLocation::WAVEROM2:
@@ -315,13 +401,64 @@ std::span<uint8_t> Emulator::MapBuffer(RomLocation location)
         return GetPCM().waverom_card;
     case RomLocation::WAVEROM_EXP:
         return GetPCM().waverom_exp;
-    case RomLocation::SMROM:
-        return m_sm->rom;
+    default:
+        break;
     }
-    fprintf(stderr, "FATAL: MapBuffer called with invalid location %d\n", (int)location);
+    fprintf(stderr, "FATAL: MapWaverom called with invalid location %d\n", (int)location);
     std::abort();
 }
 
+bool Emulator::LoadWaverom(RomLocation location, std::span<const uint8_t> source, std::shared_ptr<const MappedFile> map)
+{
+    const size_t capacity = GetWaveromCapacity(location);
+
+    if (capacity < source.size())
+    {
+        fprintf(stderr,
+                "FATAL: rom for %s is too large; max size is %d bytes\n",
+                ToCString(location),
+                (int)capacity);
+        return false;
+    }
+
+    const size_t index = (size_t)location;
+
+    if (!m_waverom_slots[index].empty())
+    {
+        const std::span<uint8_t> slot = m_waverom_slots[index];
+        std::copy(source.begin(), source.end(), slot.begin());
+        size_t& used = m_waverom_slot_used[index];
+        if (used > source.size())
+        {
+            std::fill(slot.begin() + (ptrdiff_t)source.size(), slot.begin() + (ptrdiff_t)used, 0);
+        }
+        used = source.size();
+
+        MapWaverom(location) = slot.data();
+        m_waverom_maps[index].reset();
+        m_waverom_copies[index] = {};
+        return true;
+    }
+
+    if (map && source.size() == capacity)
+    {
+        // Already padded, so the PCM can read straight from the mapping.
+        MapWaverom(location)    = source.data();
+        m_waverom_maps[index]   = std::move(map);
+        m_waverom_copies[index] = {};
+        return true;
+    }
+
+    auto& copy = m_waverom_copies[index];
+    copy.assign(capacity, 0);
+    std::copy(source.begin(), source.end(), copy.begin());
+
+    MapWaverom(location) = copy.data();
+    m_waverom_maps[index].reset();
+
+    return true;
+}
+
 bool Emulator::LoadRom(RomLocation location, std::span<const uint8_t> source)
 {
     auto buffer = MapBuffer(location);
@@ -365,14 +502,17 @@ bool Emulator::LoadRoms(Romset romset, const AllRomsetInfo& all_info, RomLocatio
     {
         const RomLocation location = (RomLocation)i;
 
-        // rom_data should be populated at this point
+        // rom data should be populated at this point
         // if it isn't, then there isn't a rom for this location
-        if (info.rom_data[i].empty())
+        if (!info.HasRomData(location))
         {
             continue;
         }
 
-        if (!LoadRom(location, info.rom_data[i]))
+        const bool success = IsWaverom(location)
+                                 ? LoadWaverom(location, info.GetRomData(location), info.rom_maps[i])
+                                 : LoadRom(location, info.GetRomData(location));
+        if (!success)
         {
             return false;
         }
@@ -429,10 +569,33 @@ void Emulator::PostMIDI(uint8_t byte)
 
 void Emulator::PostMIDI(std::span<const uint8_t> data)
 {
-    for (uint8_t byte : data)
+    MCU_PostUART(*m_mcu, data);
+}
+
+size_t Emulator::TryPostMIDI(std::span<const uint8_t> data)
+{
+    return MCU_TryPostUART(*m_mcu, data);
+}
+
+size_t Emulator::GetMIDIWritable()
+{
+    return MCU_GetUARTWritable(*m_mcu);
+}
+
+size_t Emulator::PostMIDIWait(std::span<const uint8_t> data, std::chrono::steady_clock::duration timeout)
+{
+    const auto deadline = std::chrono::steady_clock::now() + timeout;
+
+    size_t posted = MCU_TryPostUART(*m_mcu, data);
+    while (posted < data.size() && std::chrono::steady_clock::now() < deadline)
     {
-        PostMIDI(byte);
+        // The firmware reads a byte roughly every 320us, so there's no point waking up much more often than that to
+        // top up the buffer.
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        posted += MCU_TryPostUART(*m_mcu, data.subspan(posted));
     }
+
+    return posted;
 }
 
 void Emulator::PostSerial(uint8_t byte)
@@ -498,6 +661,89 @@ void Emulator::Step()
     MCU_Step(*m_mcu);
 }
 
+void Emulator::EnableStats()
+{
+    m_stats       = std::make_unique<EMU_Counters>();
+    m_stats_start = std::chrono::steady_clock::now();
+    m_mcu->stats  = m_stats.get();
+}
+
+void Emulator::EnableProfiler(uint64_t interval)
+{
+    m_profiler              = std::make_unique<EMU_Profiler>(interval);
+    m_profiler->next_sample = m_mcu->cycles + interval;
+    m_mcu->profiler         = m_profiler.get();
+}
+
+EMU_Stats Emulator::GetStats() const
+{
+    EMU_Stats result;
+    if (!m_stats)
+    {
+        return result;
+    }
+
+    result.memory_mode   = m_options.memory_mode;
+    result.arena_backing = m_arena.GetBacking();
+    if (result.arena_backing != EMU_ArenaBacking::None)
+    {
+        result.arena = m_arena.GetUsage();
+    }
+
+    const EMU_Counters& c = *m_stats;
+
+    result.enabled      = true;
+    result.instructions = c.instructions.Get();
+    result.sleep_steps  = c.sleep_steps.Get();
+    for (size_t i = 0; i < INTERRUPT_SOURCE_MAX; ++i)
+    {
+        result.interrupts[i] = c.interrupts[i].Get();
+    }
+    result.traps           = c.traps.Get();
+    result.pcm_ticks       = c.pcm_ticks.Get();
+    result.voice_ticks     = c.voice_ticks.Get();
+    result.peak_voices     = c.peak_voices.Get();
+    result.submcu_steps    = c.submcu_steps.Get();
+    result.uart_rx_bytes   = c.uart_rx_bytes.Get();
+    result.uart_tx_bytes   = c.uart_tx_bytes.Get();
+    result.uart_rx_dropped = c.uart_rx_dropped.Get();
+    result.lcd_renders     = c.lcd_renders.Get();
+
+    // The PCM chip ticks once per non-oversampled frame.
+    const uint32_t frequency = PCM_GetOutputFrequency(*m_pcm);
+    const uint32_t tick_rate = m_pcm->disable_oversampling ? frequency : frequency / 2;
+    result.emulated_seconds  = (double)result.pcm_ticks / (double)tick_rate;
+    result.wall_seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - m_stats_start).count();
+
+    return result;
+}
+
+std::vector<std::span<uint8_t>> Emulator::GetStateMemory()
+{
+    if (m_arena.GetBacking() != EMU_ArenaBacking::None)
+    {
+        return {m_arena.GetMemory()};
+    }
+
+    std::vector<std::span<uint8_t>> blocks = {
+        {(uint8_t*)m_mcu.get(), sizeof(mcu_t)},
+        {(uint8_t*)m_mcu->memory, sizeof(mcu_memory_t)},
+        {(uint8_t*)m_sm.get(), sizeof(submcu_t)},
+        {(uint8_t*)m_timer.get(), sizeof(mcu_timer_t)},
+        {(uint8_t*)m_lcd.get(), sizeof(lcd_t)},
+        {(uint8_t*)m_pcm.get(), sizeof(pcm_t)},
+    };
+    for (auto& copy : m_waverom_copies)
+    {
+        if (!copy.empty())
+        {
+            blocks.emplace_back(copy);
+        }
+    }
+    return blocks;
+}
+
 void Emulator::ReadSRAM()
 {
     // append instance number so that multiple instances don't clobber each other's sram
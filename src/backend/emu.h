@@ -33,6 +33,9 @@
  */
 #pragma once
 
+#include "emu_arena.h"
+#include "emu_profiler.h"
+#include "emu_stats.h"
 #include "lcd.h"
 #include "mcu.h"
 #include "mcu_timer.h"
@@ -40,10 +43,12 @@
 #include "rom.h"
 #include "rom_io.h"
 #include "submcu.h"
+#include <chrono>
 #include <filesystem>
 #include <memory>
 #include <span>
 #include <string_view>
+#include <vector>
 
 struct EMU_Options
 {
@@ -58,6 +63,9 @@ struct EMU_Options
     Computerswitch serial_type = Computerswitch::MIDI;
     // If not empty, nvram will be saved to and loaded from here. JV-880 only.
     std::filesystem::path nvram_filename;
+    // Heap allocates each component separately. The arena modes place all of the instance's mutable state, including
+    // its waveroms, in one block that is backed by huge pages where possible; see EMU_MemoryMode.
+    EMU_MemoryMode memory_mode = EMU_MemoryMode::Heap;
 };
 
 enum class EMU_SystemReset {
@@ -88,15 +96,16 @@ public:
     void StopLCD();
 
     void SetSampleCallback(mcu_sample_callback callback, void* userdata);
-    void SetMidiOutCallback(mcu_midiout_callback callback);
+    void SetMidiOutCallback(mcu_midiout_callback callback, void* userdata);
 
     void SetSerialPostCallback(sm_serial_post_callback callback);
 
     // Loads roms from buffers referenced by `all_info`. If the slot for a rom in `all_info` has a non-empty `rom_data`,
     // it will be loaded even if the romset doesn't require it.
     //
-    // It is unspecified whether or not the emulator will copy `rom_data`. `all_info` should outlive the emulator
-    // instance.
+    // Padded waveroms in `rom_maps` (see LoadRomset) are read directly from the mapping, which the emulator keeps alive,
+    // unless the emulator was initialized with an arena memory mode. Everything else is copied, so `all_info` may be
+    // purged once this returns.
     //
     // For roms that were successfully loaded, this function will set their corresponding index in `loaded` to true if
     // `loaded` is non-null.
@@ -105,9 +114,22 @@ public:
     // `IsCompleteRomset(all_info, romset)`.
     bool LoadRoms(Romset romset, const AllRomsetInfo& all_info, RomLocationSet* loaded = nullptr, MK1version revision = MK1version::NOT_MK1);
 
+    // Bytes that don't fit in the emulated UART's receive buffer are dropped; see TryPostMIDI.
     void PostMIDI(uint8_t data_byte);
     void PostMIDI(std::span<const uint8_t> data);
 
+    // Posts as much of `data` as fits in the UART receive buffer and returns how many bytes were posted. The firmware
+    // empties the buffer at MIDI speed, so a caller with more data, e.g. a bulk dump, should step the emulator and
+    // post the rest as space frees up.
+    size_t TryPostMIDI(std::span<const uint8_t> data);
+
+    // Returns how many bytes TryPostMIDI would currently accept.
+    size_t GetMIDIWritable();
+
+    // Posts all of `data`, waiting for the firmware to make room when the buffer is full. Only useful while another
+    // thread is stepping the emulator. Gives up after `timeout` and returns the number of bytes posted.
+    size_t PostMIDIWait(std::span<const uint8_t> data, std::chrono::steady_clock::duration timeout);
+
     void PostSerial(uint8_t byte);
     void PostSerial(std::span<const uint8_t> data);
 
@@ -118,6 +140,21 @@ public:
 
     void Step();
 
+    // Starts collecting performance counters, discarding any collected so far. Stats are off by default; when off,
+    // the emulator skips all counting. Call while no other thread is using the emulator.
+    void EnableStats();
+
+    // Returns a snapshot of the counters. Safe to call from any thread while the emulator is running. `enabled` is
+    // false if EnableStats hasn't been called.
+    EMU_Stats GetStats() const;
+
+    // Starts sampling the firmware's call stacks every `interval` MCU cycles, discarding any samples collected so far.
+    // Call while no other thread is using the emulator.
+    void EnableProfiler(uint64_t interval);
+
+    // Returns null if EnableProfiler hasn't been called. Not safe to read while the emulator is running.
+    const EMU_Profiler* GetProfiler() const { return m_profiler.get(); }
+
     bool IsSRAMLoaded()  { return is_sram_loaded;  }
     bool IsNVRAMLoaded() { return is_nvram_loaded; }
 
@@ -125,20 +162,47 @@ public:
     pcm_t& GetPCM() { return *m_pcm; }
     lcd_t& GetLCD() { return *m_lcd; }
 
+    // Returns the blocks of memory holding the emulator's mutable state and loaded waveroms, e.g. to bind them to a
+    // NUMA node. In the arena modes this is the arena itself. Call after LoadRoms.
+    std::vector<std::span<uint8_t>> GetStateMemory();
+
 private:
-    std::unique_ptr<mcu_t>       m_mcu;
-    std::unique_ptr<submcu_t>    m_sm;
-    std::unique_ptr<mcu_timer_t> m_timer;
-    std::unique_ptr<lcd_t>       m_lcd;
-    std::unique_ptr<pcm_t>       m_pcm;
-    EMU_Options                  m_options;
+    EMU_ArenaPtr<mcu_t>       m_mcu;
+    EMU_ArenaPtr<submcu_t>    m_sm;
+    EMU_ArenaPtr<mcu_timer_t> m_timer;
+    EMU_ArenaPtr<lcd_t>       m_lcd;
+    EMU_ArenaPtr<pcm_t>       m_pcm;
+    EMU_Options               m_options;
+
+    std::unique_ptr<EMU_Counters>         m_stats;
+    std::chrono::steady_clock::time_point m_stats_start;
+
+    std::unique_ptr<EMU_Profiler> m_profiler;
 
     bool is_sram_loaded  = false;
     bool is_nvram_loaded = false;
 
+    // Storage for the waveroms m_pcm points to: either a mapping shared with the RomsetInfo they were loaded from or a
+    // zero-padded copy. Indexed by RomLocation.
+    std::shared_ptr<const MappedFile> m_waverom_maps[ROMLOCATION_COUNT];
+    std::vector<uint8_t>              m_waverom_copies[ROMLOCATION_COUNT];
+
+    // In the arena modes, holds the components above and a slot for each waverom, which replaces the copy or mapping.
+    // Declared after the components so that a moved-into Emulator destroys its old components before their arena;
+    // the destructor resets them explicitly for the same reason.
+    EMU_Arena          m_arena;
+    std::span<uint8_t> m_waverom_slots[ROMLOCATION_COUNT];
+    // Bytes of each slot written by earlier loads. The arena starts out zeroed, so a load only has to clear what a
+    // larger previous rom left behind, and the rest of the slot is never touched.
+    size_t             m_waverom_slot_used[ROMLOCATION_COUNT]{};
+
     std::span<uint8_t> MapBuffer(RomLocation location);
+    const uint8_t*&    MapWaverom(RomLocation location);
+
+    bool InitArena(EMU_MemoryMode mode);
 
     bool LoadRom(RomLocation location, std::span<const uint8_t> source);
+    bool LoadWaverom(RomLocation location, std::span<const uint8_t> source, std::shared_ptr<const MappedFile> map);
 
     void ReadNVRAM();
     void WriteNVRAM();
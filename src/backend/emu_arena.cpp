@@ -0,0 +1,300 @@
+#include "emu_arena.h"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static size_t EMU_AlignUp(size_t value, size_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool ParseMemoryMode(std::string_view name, EMU_MemoryMode& mode)
+{
+    if (name == "heap")
+    {
+        mode = EMU_MemoryMode::Heap;
+    }
+    else if (name == "arena")
+    {
+        mode = EMU_MemoryMode::Arena;
+    }
+    else if (name == "hugepages")
+    {
+        mode = EMU_MemoryMode::HugePages;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+const char* ToCString(EMU_MemoryMode mode)
+{
+    switch (mode)
+    {
+    case EMU_MemoryMode::Heap:
+        return "heap";
+    case EMU_MemoryMode::Arena:
+        return "arena";
+    case EMU_MemoryMode::HugePages:
+        return "hugepages";
+    }
+    return "<invalid memory mode>";
+}
+
+const char* ToCString(EMU_ArenaBacking backing)
+{
+    switch (backing)
+    {
+    case EMU_ArenaBacking::None:
+        return "none";
+    case EMU_ArenaBacking::Normal:
+        return "normal pages";
+    case EMU_ArenaBacking::Transparent:
+        return "transparent huge pages";
+    case EMU_ArenaBacking::Explicit:
+        return "explicit huge pages";
+    }
+    return "<invalid arena backing>";
+}
+
+EMU_Arena::~EMU_Arena()
+{
+    Free();
+}
+
+EMU_Arena::EMU_Arena(EMU_Arena&& rhs) noexcept
+    : m_data(std::exchange(rhs.m_data, nullptr)),
+      m_size(std::exchange(rhs.m_size, 0)),
+      m_used(std::exchange(rhs.m_used, 0)),
+      m_backing(std::exchange(rhs.m_backing, EMU_ArenaBacking::None))
+{
+}
+
+EMU_Arena& EMU_Arena::operator=(EMU_Arena&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        Free();
+        m_data    = std::exchange(rhs.m_data, nullptr);
+        m_size    = std::exchange(rhs.m_size, 0);
+        m_used    = std::exchange(rhs.m_used, 0);
+        m_backing = std::exchange(rhs.m_backing, EMU_ArenaBacking::None);
+    }
+    return *this;
+}
+
+bool EMU_Arena::Init(size_t size, EMU_MemoryMode mode)
+{
+    Free();
+
+    size = EMU_AlignUp(size, EMU_HUGE_PAGE_SIZE);
+
+#if defined(_WIN32)
+    if (mode == EMU_MemoryMode::HugePages)
+    {
+        // Requires the "Lock pages in memory" privilege, which accounts don't have by default.
+        const size_t large_page_size = GetLargePageMinimum();
+        if (large_page_size != 0)
+        {
+            const size_t large_size = EMU_AlignUp(size, large_page_size);
+            void* ptr = VirtualAlloc(nullptr, large_size, MEM_RESERVE | MEM_COMMIT | MEM_LARGE_PAGES, PAGE_READWRITE);
+            if (ptr)
+            {
+                m_data    = (uint8_t*)ptr;
+                m_size    = large_size;
+                m_backing = EMU_ArenaBacking::Explicit;
+                return true;
+            }
+        }
+        fprintf(stderr,
+                "WARNING: Large pages unavailable (error %lu); using normal pages\n",
+                (unsigned long)GetLastError());
+    }
+
+    void* ptr = VirtualAlloc(nullptr, size, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+    if (!ptr)
+    {
+        fprintf(stderr, "WARNING: Failed to reserve %zu byte arena: error %lu\n", size, (unsigned long)GetLastError());
+        return false;
+    }
+    m_data    = (uint8_t*)ptr;
+    m_size    = size;
+    m_backing = EMU_ArenaBacking::Normal;
+    return true;
+#else
+    (void)mode;
+
+    // Explicit huge page failure, reported once the fallback's backing is known.
+    int hugetlb_errno = 0;
+
+#if defined(MAP_HUGETLB)
+    if (mode == EMU_MemoryMode::HugePages)
+    {
+        // Huge pages are taken from the pool up front, so this fails cleanly rather than faulting later if the pool
+        // (vm.nr_hugepages) is too small.
+        void* ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr != MAP_FAILED)
+        {
+            m_data    = (uint8_t*)ptr;
+            m_size    = size;
+            m_backing = EMU_ArenaBacking::Explicit;
+            return true;
+        }
+        hugetlb_errno = errno;
+    }
+#endif
+
+    // Over-reserve so that the arena can start on a huge page boundary; otherwise its first and last huge page's worth
+    // of memory could never be backed by a huge page.
+    const size_t reserve_size = size + EMU_HUGE_PAGE_SIZE;
+    void* reserved = mmap(nullptr, reserve_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (reserved == MAP_FAILED)
+    {
+        fprintf(stderr, "WARNING: Failed to reserve %zu byte arena: %s\n", size, strerror(errno));
+        return false;
+    }
+
+    uint8_t* const begin   = (uint8_t*)reserved;
+    uint8_t* const aligned = (uint8_t*)EMU_AlignUp((uintptr_t)begin, EMU_HUGE_PAGE_SIZE);
+    if (aligned != begin)
+    {
+        munmap(begin, (size_t)(aligned - begin));
+    }
+    const size_t tail = reserve_size - (size_t)(aligned - begin) - size;
+    if (tail != 0)
+    {
+        munmap(aligned + size, tail);
+    }
+
+    m_data    = aligned;
+    m_size    = size;
+    m_backing = EMU_ArenaBacking::Normal;
+
+#if defined(MADV_HUGEPAGE)
+    if (madvise(m_data, m_size, MADV_HUGEPAGE) == 0)
+    {
+        m_backing = EMU_ArenaBacking::Transparent;
+    }
+#endif
+
+    if (hugetlb_errno != 0)
+    {
+        fprintf(stderr,
+                "WARNING: Explicit huge pages unavailable (%s); using %s\n",
+                strerror(hugetlb_errno),
+                ToCString(m_backing));
+    }
+
+    return true;
+#endif
+}
+
+void EMU_Arena::Free()
+{
+    if (!m_data)
+    {
+        return;
+    }
+
+#if defined(_WIN32)
+    VirtualFree(m_data, 0, MEM_RELEASE);
+#else
+    munmap(m_data, m_size);
+#endif
+
+    m_data    = nullptr;
+    m_size    = 0;
+    m_used    = 0;
+    m_backing = EMU_ArenaBacking::None;
+}
+
+void* EMU_Arena::Allocate(size_t size, size_t alignment)
+{
+    const size_t offset = EMU_AlignUp(m_used, alignment);
+    if (offset > m_size || m_size - offset < size)
+    {
+        return nullptr;
+    }
+    m_used = offset + size;
+    return m_data + offset;
+}
+
+EMU_ArenaUsage EMU_Arena::GetUsage() const
+{
+    EMU_ArenaUsage usage;
+    usage.size = m_size;
+
+#if defined(__linux__)
+    if (!m_data)
+    {
+        return usage;
+    }
+
+    FILE* smaps = fopen("/proc/self/smaps", "r");
+    if (!smaps)
+    {
+        return usage;
+    }
+
+    const uintptr_t arena_begin = (uintptr_t)m_data;
+    const uintptr_t arena_end   = arena_begin + m_size;
+
+    // smaps lists each mapping as a "begin-end perms ..." header followed by "Field: value kB" lines. The kernel may
+    // have split the arena into several mappings, e.g. after mbind.
+    bool in_arena = false;
+    char line[512];
+    while (fgets(line, sizeof(line), smaps))
+    {
+        unsigned long long begin = 0;
+        unsigned long long end   = 0;
+        if (sscanf(line, "%llx-%llx ", &begin, &end) == 2)
+        {
+            in_arena = begin < arena_end && end > arena_begin;
+            continue;
+        }
+
+        if (!in_arena)
+        {
+            continue;
+        }
+
+        char               field[64];
+        unsigned long long kb = 0;
+        if (sscanf(line, "%63[^:]: %llu kB", field, &kb) != 2)
+        {
+            continue;
+        }
+
+        const size_t bytes = (size_t)kb * 1024;
+        if (strcmp(field, "Rss") == 0)
+        {
+            usage.resident += bytes;
+        }
+        else if (strcmp(field, "AnonHugePages") == 0)
+        {
+            usage.huge += bytes;
+        }
+        else if (strcmp(field, "Private_Hugetlb") == 0 || strcmp(field, "Shared_Hugetlb") == 0)
+        {
+            // Not included in Rss.
+            usage.resident += bytes;
+            usage.huge += bytes;
+        }
+    }
+
+    fclose(smaps);
+    usage.known = true;
+#endif
+
+    return usage;
+}
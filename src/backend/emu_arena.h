@@ -0,0 +1,138 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <span>
+#include <string_view>
+#include <utility>
+
+// How an Emulator allocates its state; see EMU_Options::memory_mode.
+enum class EMU_MemoryMode
+{
+    // Each component is a separate heap allocation, and padded waverom files are read straight from their mapping.
+    Heap,
+    // All of the instance's state, including a private copy of each waverom, is placed in one arena. On Linux the arena
+    // is aligned to huge page boundaries and marked for transparent huge pages.
+    Arena,
+    // Like Arena, but backed by explicit huge pages (MAP_HUGETLB on Linux, large pages on Windows). Falls back to
+    // Arena if the system has none to spare.
+    HugePages,
+};
+
+// Parses `name` as a memory mode: heap, arena, or hugepages.
+bool ParseMemoryMode(std::string_view name, EMU_MemoryMode& mode);
+
+const char* ToCString(EMU_MemoryMode mode);
+
+// Huge page size arenas are aligned to. The default on x86-64 and most arm64 kernels.
+constexpr size_t EMU_HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+// The kind of pages an EMU_Arena ended up with.
+enum class EMU_ArenaBacking
+{
+    // No arena.
+    None,
+    Normal,
+    // Transparent huge pages were requested; the kernel decides which parts actually get them.
+    Transparent,
+    Explicit,
+};
+
+const char* ToCString(EMU_ArenaBacking backing);
+
+// Memory use of an arena as reported by the OS.
+struct EMU_ArenaUsage
+{
+    size_t size = 0;
+    // Whether `resident` and `huge` are known. Only supported on Linux.
+    bool   known = false;
+    // Bytes in physical memory.
+    size_t resident = 0;
+    // Resident bytes that are mapped with huge pages, and so cost one TLB entry per huge page instead of one per 4 KB.
+    size_t huge = 0;
+
+    // Pages, and so TLB entries, it takes to map all of the resident memory, assuming 2 MB huge pages.
+    size_t GetResidentPages() const
+    {
+        return huge / EMU_HUGE_PAGE_SIZE + (resident - huge) / 4096;
+    }
+};
+
+// One block of memory that objects are placed into one after another. Memory is only returned when the arena is
+// destroyed, and objects placed with New must be destroyed by the caller; see EMU_ArenaDeleter.
+class EMU_Arena
+{
+public:
+    EMU_Arena() = default;
+    ~EMU_Arena();
+
+    EMU_Arena(const EMU_Arena&)            = delete;
+    EMU_Arena& operator=(const EMU_Arena&) = delete;
+
+    EMU_Arena(EMU_Arena&& rhs) noexcept;
+    EMU_Arena& operator=(EMU_Arena&& rhs) noexcept;
+
+    // Reserves at least `size` bytes backed as `mode` asks, falling back to normal pages. Memory is zeroed and, except
+    // for explicit huge pages, only committed when first touched. Returns false if nothing could be reserved.
+    bool Init(size_t size, EMU_MemoryMode mode);
+
+    void Free();
+
+    // Returns null if the arena doesn't have room.
+    void* Allocate(size_t size, size_t alignment);
+
+    template <typename T, typename... Args>
+    T* New(Args&&... args)
+    {
+        void* ptr = Allocate(sizeof(T), alignof(T));
+        if (!ptr)
+        {
+            throw std::bad_alloc();
+        }
+        return new (ptr) T(std::forward<Args>(args)...);
+    }
+
+    std::span<uint8_t> GetMemory() const
+    {
+        return {m_data, m_size};
+    }
+
+    EMU_ArenaBacking GetBacking() const
+    {
+        return m_backing;
+    }
+
+    // Reads the arena's residency from the OS. Slow; intended for reports.
+    EMU_ArenaUsage GetUsage() const;
+
+private:
+    uint8_t*         m_data    = nullptr;
+    size_t           m_size    = 0;
+    size_t           m_used    = 0;
+    EMU_ArenaBacking m_backing = EMU_ArenaBacking::None;
+};
+
+// Deleter for EMU_ArenaPtr. Objects placed in an arena are only destroyed since the arena owns their memory; other
+// objects are deleted.
+struct EMU_ArenaDeleter
+{
+    bool in_arena = false;
+
+    template <typename T>
+    void operator()(T* ptr) const
+    {
+        if (in_arena)
+        {
+            ptr->~T();
+        }
+        else
+        {
+            delete ptr;
+        }
+    }
+};
+
+template <typename T>
+using EMU_ArenaPtr = std::unique_ptr<T, EMU_ArenaDeleter>;
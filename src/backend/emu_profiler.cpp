@@ -0,0 +1,138 @@
+#include "emu_profiler.h"
+
+#include "mcu.h"
+#include "submcu.h"
+#include <algorithm>
+
+EMU_Profiler::EMU_Profiler(uint64_t interval)
+    : m_interval(interval)
+{
+}
+
+void EMU_Profiler::Sample(const mcu_t& mcu)
+{
+    next_sample = mcu.cycles + m_interval;
+    ++m_samples;
+
+    // Frames that returned through something other than a return instruction.
+    mcu_stack.Unwind(mcu.r[7]);
+
+    m_scratch.clear();
+    mcu_stack.GetFrames(m_scratch);
+    m_scratch.push_back(mcu.sleep ? SLEEP_PC : ((uint32_t)mcu.cp << 16) | mcu.pc);
+    ++m_mcu_stacks[m_scratch];
+
+    if (!mcu.is_mk1 && !mcu.is_jv880 && !mcu.is_scb55)
+    {
+        const submcu_t& sm = *mcu.sm;
+
+        sm_stack.Unwind(sm.s);
+
+        m_scratch.clear();
+        sm_stack.GetFrames(m_scratch);
+        m_scratch.push_back(sm.sleep ? SLEEP_PC : sm.pc);
+        ++m_sm_stacks[m_scratch];
+    }
+}
+
+static void EMU_WriteFrame(FILE* output, uint32_t address, bool is_mcu)
+{
+    if (address & EMU_CallStack::FRAME_INTERRUPT)
+    {
+        fprintf(output, "int ");
+        address &= ~EMU_CallStack::FRAME_INTERRUPT;
+    }
+
+    if (is_mcu)
+    {
+        fprintf(output, "%02x:%04x", (address >> 16) & 0xff, address & 0xffff);
+    }
+    else
+    {
+        fprintf(output, "%04x", address & 0xffff);
+    }
+}
+
+void EMU_Profiler::WriteFolded(FILE* output, std::string_view root) const
+{
+    const auto write_stacks = [&](const std::map<std::vector<uint32_t>, uint64_t>& stacks, const char* cpu, bool is_mcu) {
+        // The sampled PC is left out so that each function is a single block in the flamegraph; WriteHistogram has
+        // per-address counts. Samples taken at different PCs of the same function merge here.
+        std::map<std::vector<uint32_t>, uint64_t> by_function;
+        for (const auto& [stack, count] : stacks)
+        {
+            std::vector<uint32_t> frames(stack.begin(), stack.end() - 1);
+            if (stack.back() == SLEEP_PC)
+            {
+                frames.push_back(SLEEP_PC);
+            }
+            by_function[frames] += count;
+        }
+
+        for (const auto& [frames, count] : by_function)
+        {
+            if (!root.empty())
+            {
+                fprintf(output, "%.*s;", (int)root.size(), root.data());
+            }
+            fprintf(output, "%s", cpu);
+            for (uint32_t address : frames)
+            {
+                fprintf(output, ";");
+                if (address == SLEEP_PC)
+                {
+                    fprintf(output, "sleep");
+                }
+                else
+                {
+                    EMU_WriteFrame(output, address, is_mcu);
+                }
+            }
+            fprintf(output, " %llu\n", (unsigned long long)count);
+        }
+    };
+
+    write_stacks(m_mcu_stacks, "mcu", true);
+    write_stacks(m_sm_stacks, "submcu", false);
+}
+
+void EMU_Profiler::WriteHistogram(FILE* output, std::string_view root) const
+{
+    const auto write_histogram = [&](const std::map<std::vector<uint32_t>, uint64_t>& stacks, const char* cpu, bool is_mcu) {
+        std::map<uint32_t, uint64_t> by_pc;
+        uint64_t                     total = 0;
+        for (const auto& [stack, count] : stacks)
+        {
+            by_pc[stack.back()] += count;
+            total += count;
+        }
+
+        std::vector<std::pair<uint32_t, uint64_t>> sorted(by_pc.begin(), by_pc.end());
+        std::stable_sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+        for (const auto& [pc, count] : sorted)
+        {
+            if (!root.empty())
+            {
+                fprintf(output, "%.*s ", (int)root.size(), root.data());
+            }
+            fprintf(output, "%-6s ", cpu);
+            if (pc == SLEEP_PC)
+            {
+                fprintf(output, "%-7s", "sleep");
+            }
+            else if (is_mcu)
+            {
+                fprintf(output, "%02x:%04x", (pc >> 16) & 0xff, pc & 0xffff);
+            }
+            else
+            {
+                fprintf(output, "   %04x", pc & 0xffff);
+            }
+            fprintf(output, " %10llu %6.2f%%\n", (unsigned long long)count, 100.0 * (double)count / (double)total);
+        }
+    };
+
+    write_histogram(m_mcu_stacks, "mcu", true);
+    write_histogram(m_sm_stacks, "submcu", false);
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <map>
+#include <string_view>
+#include <vector>
+
+struct mcu_t;
+
+// Call stack reconstructed from the call and return instructions a CPU executes. Frames are matched to returns by
+// stack pointer rather than by counting, so firmware that discards return addresses or unwinds several levels at
+// once (e.g. RTD, or resetting SP) doesn't leave stale frames behind.
+class EMU_CallStack
+{
+public:
+    static constexpr size_t MAX_DEPTH = 64;
+
+    // Marks a frame that was entered by an interrupt or trap rather than a call instruction.
+    static constexpr uint32_t FRAME_INTERRUPT = 0x80000000;
+
+    // Entered the subroutine at `address`. `sp` is the stack pointer after the return address was pushed.
+    void Call(uint32_t address, uint16_t sp)
+    {
+        // Anything at or below the new frame has returned without us seeing it.
+        Unwind((uint16_t)(sp + 1));
+        if (m_depth < MAX_DEPTH)
+        {
+            m_frames[m_depth++] = {address, sp};
+        }
+    }
+
+    // Drops frames whose return address lies below `sp`, i.e. frames that have returned.
+    void Unwind(uint16_t sp)
+    {
+        while (m_depth > 0 && m_frames[m_depth - 1].sp < sp)
+        {
+            --m_depth;
+        }
+    }
+
+    void Clear()
+    {
+        m_depth = 0;
+    }
+
+    // Appends the entry address of every frame, outermost first.
+    void GetFrames(std::vector<uint32_t>& out) const
+    {
+        for (size_t i = 0; i < m_depth; ++i)
+        {
+            out.push_back(m_frames[i].address);
+        }
+    }
+
+private:
+    struct Frame
+    {
+        uint32_t address;
+        uint16_t sp;
+    };
+
+    Frame  m_frames[MAX_DEPTH]{};
+    size_t m_depth = 0;
+};
+
+// Sampling profiler for the emulated firmware, enabled by Emulator::EnableProfiler. Every `interval` MCU cycles it
+// records the MCU and sub-MCU call stacks and program counters.
+//
+// Addresses are written as `cp:pc` for the MCU and `pc` for the sub-MCU, in hex.
+class EMU_Profiler
+{
+public:
+    explicit EMU_Profiler(uint64_t interval);
+
+    // Maintained by the MCU and sub-MCU call/return instructions and interrupt entry.
+    EMU_CallStack mcu_stack;
+    EMU_CallStack sm_stack;
+
+    // mcu.cycles value at which the next sample is due.
+    uint64_t next_sample = 0;
+
+    // Records a sample and schedules the next one.
+    void Sample(const mcu_t& mcu);
+
+    uint64_t GetSampleCount() const
+    {
+        return m_samples;
+    }
+
+    uint64_t GetInterval() const
+    {
+        return m_interval;
+    }
+
+    // Writes one line per distinct stack in the "folded" format read by flamegraph.pl and speedscope:
+    // `root;frame;frame count`. Functions are identified by their entry address. If `root` isn't empty it is prepended
+    // to every stack, which lets the output of several emulators share one file.
+    void WriteFolded(FILE* output, std::string_view root) const;
+
+    // Writes the number of samples per program counter, most frequent first, with each address's share of its CPU's
+    // samples.
+    void WriteHistogram(FILE* output, std::string_view root) const;
+
+private:
+    static constexpr uint32_t SLEEP_PC = 0xffffffff;
+
+    uint64_t m_interval;
+    uint64_t m_samples = 0;
+
+    // Sampled stacks, each ending in the program counter at the time of the sample (or SLEEP_PC).
+    std::map<std::vector<uint32_t>, uint64_t> m_mcu_stacks;
+    std::map<std::vector<uint32_t>, uint64_t> m_sm_stacks;
+
+    std::vector<uint32_t> m_scratch;
+};
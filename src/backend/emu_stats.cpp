@@ -0,0 +1,51 @@
+#include "emu_stats.h"
+
+const char* EMU_InterruptSourceName(uint32_t source)
+{
+    switch (source)
+    {
+    case INTERRUPT_SOURCE_NMI:
+        return "NMI";
+    case INTERRUPT_SOURCE_IRQ0:
+        return "IRQ0";
+    case INTERRUPT_SOURCE_IRQ1:
+        return "IRQ1";
+    case INTERRUPT_SOURCE_FRT0_ICI:
+        return "FRT0_ICI";
+    case INTERRUPT_SOURCE_FRT0_OCIA:
+        return "FRT0_OCIA";
+    case INTERRUPT_SOURCE_FRT0_OCIB:
+        return "FRT0_OCIB";
+    case INTERRUPT_SOURCE_FRT0_FOVI:
+        return "FRT0_FOVI";
+    case INTERRUPT_SOURCE_FRT1_ICI:
+        return "FRT1_ICI";
+    case INTERRUPT_SOURCE_FRT1_OCIA:
+        return "FRT1_OCIA";
+    case INTERRUPT_SOURCE_FRT1_OCIB:
+        return "FRT1_OCIB";
+    case INTERRUPT_SOURCE_FRT1_FOVI:
+        return "FRT1_FOVI";
+    case INTERRUPT_SOURCE_FRT2_ICI:
+        return "FRT2_ICI";
+    case INTERRUPT_SOURCE_FRT2_OCIA:
+        return "FRT2_OCIA";
+    case INTERRUPT_SOURCE_FRT2_OCIB:
+        return "FRT2_OCIB";
+    case INTERRUPT_SOURCE_FRT2_FOVI:
+        return "FRT2_FOVI";
+    case INTERRUPT_SOURCE_TIMER_CMIA:
+        return "TIMER_CMIA";
+    case INTERRUPT_SOURCE_TIMER_CMIB:
+        return "TIMER_CMIB";
+    case INTERRUPT_SOURCE_TIMER_OVI:
+        return "TIMER_OVI";
+    case INTERRUPT_SOURCE_ANALOG:
+        return "ANALOG";
+    case INTERRUPT_SOURCE_UART_RX:
+        return "UART_RX";
+    case INTERRUPT_SOURCE_UART_TX:
+        return "UART_TX";
+    }
+    return "UNKNOWN";
+}
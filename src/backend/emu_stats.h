@@ -0,0 +1,113 @@
+#pragma once
+
+#include "emu_arena.h"
+#include "mcu_interrupt.h"
+#include <atomic>
+#include <cstdint>
+
+// Counter that is written by one thread and may be read by any other. Relaxed load + store instead of fetch_add keeps
+// increments as cheap as on a plain integer.
+class EMU_Counter
+{
+public:
+    void Add(uint64_t amount = 1)
+    {
+        m_value.store(m_value.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+    }
+
+    void Max(uint64_t value)
+    {
+        if (value > m_value.load(std::memory_order_relaxed))
+        {
+            m_value.store(value, std::memory_order_relaxed);
+        }
+    }
+
+    uint64_t Get() const
+    {
+        return m_value.load(std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<uint64_t> m_value = 0;
+};
+
+// Counters the emulator updates while stats are enabled (see Emulator::EnableStats). Components reach these through
+// `mcu_t::stats`, which is null when stats are disabled, so the disabled cost is a single branch.
+struct EMU_Counters
+{
+    // MCU steps that executed an instruction vs. steps spent asleep waiting for an interrupt.
+    EMU_Counter instructions;
+    EMU_Counter sleep_steps;
+    // Interrupts taken by the MCU, by INTERRUPT_SOURCE_*.
+    EMU_Counter interrupts[INTERRUPT_SOURCE_MAX];
+    // TRAPA instructions and exceptions taken by the MCU.
+    EMU_Counter traps;
+    // PCM chip sample periods.
+    EMU_Counter pcm_ticks;
+    // Sum of active voices over all PCM ticks, and the most voices seen in one tick.
+    EMU_Counter voice_ticks;
+    EMU_Counter peak_voices;
+    // Sub-MCU instruction steps, including steps spent asleep.
+    EMU_Counter submcu_steps;
+    // MIDI/serial bytes posted to the emulator (written by the posting thread) and MIDI bytes sent by it.
+    EMU_Counter uart_rx_bytes;
+    EMU_Counter uart_tx_bytes;
+    // MIDI bytes dropped by MCU_PostUART because the UART receive buffer was full.
+    EMU_Counter uart_rx_dropped;
+    // LCD_Render calls with a backend attached. Written by whichever thread renders the LCD.
+    EMU_Counter lcd_renders;
+};
+
+// Snapshot of EMU_Counters returned by Emulator::GetStats.
+struct EMU_Stats
+{
+    bool enabled = false;
+
+    uint64_t instructions = 0;
+    uint64_t sleep_steps  = 0;
+    uint64_t interrupts[INTERRUPT_SOURCE_MAX]{};
+    uint64_t traps           = 0;
+    uint64_t pcm_ticks       = 0;
+    uint64_t voice_ticks     = 0;
+    uint64_t peak_voices     = 0;
+    uint64_t submcu_steps    = 0;
+    uint64_t uart_rx_bytes   = 0;
+    uint64_t uart_tx_bytes   = 0;
+    uint64_t uart_rx_dropped = 0;
+    uint64_t lcd_renders     = 0;
+
+    // Audio time produced since stats were enabled.
+    double emulated_seconds = 0;
+    // Wall clock time since stats were enabled.
+    double wall_seconds = 0;
+
+    // Where the emulator state lives. `arena_backing` is None in heap mode, including when an arena was requested but
+    // couldn't be created; `arena` is read from the OS when the snapshot is taken.
+    EMU_MemoryMode   memory_mode   = EMU_MemoryMode::Heap;
+    EMU_ArenaBacking arena_backing = EMU_ArenaBacking::None;
+    EMU_ArenaUsage   arena;
+
+    double GetAverageVoices() const
+    {
+        return pcm_ticks == 0 ? 0 : (double)voice_ticks / (double)pcm_ticks;
+    }
+
+    // Fraction of MCU steps spent asleep.
+    double GetSleepFraction() const
+    {
+        const uint64_t steps = instructions + sleep_steps;
+        return steps == 0 ? 0 : (double)sleep_steps / (double)steps;
+    }
+
+    // Emulated seconds per wall second over `wall_seconds`, or over `busy_seconds` if given, e.g. when the caller
+    // knows how long the emulator thread actually spent stepping.
+    double GetSpeed(double busy_seconds = 0) const
+    {
+        const double seconds = busy_seconds > 0 ? busy_seconds : wall_seconds;
+        return seconds == 0 ? 0 : emulated_seconds / seconds;
+    }
+};
+
+// Returns a short name like "FRT0_OCIA" for an INTERRUPT_SOURCE_* value.
+const char* EMU_InterruptSourceName(uint32_t source);
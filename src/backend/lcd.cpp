@@ -33,8 +33,10 @@
  */
 #include "lcd.h"
 #include "emu.h"
+#include "emu_stats.h"
 #include "lcd_back.h"
 #include "lcd_font.h"
+#include <algorithm>
 #include <cstring>
 
 uint32_t inline LCD_MixColor(uint32_t color, uint8_t contrast) {
@@ -225,6 +227,55 @@ void LCD_Stop(lcd_t& lcd)
     }
 }
 
+static void LCD_MarkDirty(lcd_t& lcd, int32_t x, int32_t y, int32_t w, int32_t h)
+{
+    // Some glyphs extend past the visible area (e.g. the JV-880 cursor row); clip to what the backend can show.
+    w = std::min(w, (int32_t)lcd.width - x);
+    h = std::min(h, (int32_t)lcd.height - y);
+    if (w <= 0 || h <= 0)
+    {
+        return;
+    }
+
+    // Already redrawing everything.
+    if (lcd.dirty_count == 1 && lcd.dirty_rects[0].w == (int32_t)lcd.width && lcd.dirty_rects[0].h == (int32_t)lcd.height)
+    {
+        return;
+    }
+
+    if (lcd.dirty_count < lcd_dirty_rects_max)
+    {
+        lcd.dirty_rects[lcd.dirty_count++] = LCD_Rect{x, y, w, h};
+        return;
+    }
+
+    // Out of slots; grow the last rect into the bounding box of everything that didn't fit.
+    LCD_Rect& last = lcd.dirty_rects[lcd_dirty_rects_max - 1];
+    const int32_t x1 = std::max(last.x + last.w, x + w);
+    const int32_t y1 = std::max(last.y + last.h, y + h);
+    last.x = std::min(last.x, x);
+    last.y = std::min(last.y, y);
+    last.w = x1 - last.x;
+    last.h = y1 - last.y;
+}
+
+static void LCD_MarkAllDirty(lcd_t& lcd)
+{
+    lcd.dirty_count    = 1;
+    lcd.dirty_rects[0] = LCD_Rect{0, 0, (int32_t)lcd.width, (int32_t)lcd.height};
+}
+
+// Writes `color` to a pixel and reports whether the stored value changed.
+static inline bool LCD_SetPixel(uint32_t& pixel, uint32_t color)
+{
+    if (pixel == color)
+    {
+        return false;
+    }
+    pixel = color;
+    return true;
+}
+
 uint32_t LCD_Fade(lcd_t& lcd, uint32_t color1, uint32_t color2) {
     auto NONZERO = [](uint32_t x, uint32_t y) {
         return x == 0 ? x : y;
@@ -261,9 +312,11 @@ uint32_t LCD_Fade(lcd_t& lcd, uint32_t color1, uint32_t color2) {
     return color;
 }
 
-void LCD_FontRenderStandard(lcd_t& lcd, uint8_t* LCD_CG, int32_t x, int32_t y, uint8_t ch, uint8_t cursor = 0)
+// Returns true if any pixel of the glyph changed.
+bool LCD_FontRenderStandard(lcd_t& lcd, uint8_t* LCD_CG, int32_t x, int32_t y, uint8_t ch, uint8_t cursor = 0)
 {
-    uint8_t* f;
+    bool changed = false;
+    const uint8_t* f;
     if (ch >= 16)
         f = &lcd_font[ch - 16][0];
     else
@@ -302,16 +355,20 @@ void LCD_FontRenderStandard(lcd_t& lcd, uint8_t* LCD_CG, int32_t x, int32_t y, u
             {
                 for (int jj = 0; jj < 5; jj++)
                 {
-                    lcd.buffer[xx+ii][yy+jj] = LCD_Fade(lcd, lcd.buffer[xx+ii][yy+jj], col);
+                    uint32_t& pixel = lcd.buffer[xx+ii][yy+jj];
+                    changed |= LCD_SetPixel(pixel, LCD_Fade(lcd, pixel, col));
                 }
             }
         }
     }
+    return changed;
 }
 
-void LCD_FontRenderLevel(lcd_t& lcd, uint8_t* LCD_CG, int32_t x, int32_t y, uint8_t ch, uint8_t width = 5)
+// Returns true if any pixel of the glyph changed.
+bool LCD_FontRenderLevel(lcd_t& lcd, uint8_t* LCD_CG, int32_t x, int32_t y, uint8_t ch, uint8_t width = 5)
 {
-    uint8_t* f;
+    bool changed = false;
+    const uint8_t* f;
     if (ch >= 16)
         f = &lcd_font[ch - 16][0];
     else
@@ -335,11 +392,13 @@ void LCD_FontRenderLevel(lcd_t& lcd, uint8_t* LCD_CG, int32_t x, int32_t y, uint
             {
                 for (int jj = 0; jj < 24; jj++)
                 {
-                    lcd.buffer[xx+ii][yy+jj] = LCD_Fade(lcd, lcd.buffer[xx+ii][yy+jj], col);
+                    uint32_t& pixel = lcd.buffer[xx+ii][yy+jj];
+                    changed |= LCD_SetPixel(pixel, LCD_Fade(lcd, pixel, col));
                 }
             }
         }
     }
+    return changed;
 }
 
 static const uint8_t LR[2][12][11] =
@@ -382,7 +441,7 @@ static const int LR_xy[2][2] = {
 
 void LCD_FontRenderLR(lcd_t& lcd, uint8_t* LCD_CG, uint8_t ch)
 {
-    uint8_t* f;
+    const uint8_t* f;
     if (ch >= 16)
         f = &lcd_font[ch - 16][0];
     else
@@ -398,14 +457,43 @@ void LCD_FontRenderLR(lcd_t& lcd, uint8_t* LCD_CG, uint8_t ch)
     }
     for (int letter = 0; letter < 2; letter++)
     {
+        bool changed = false;
         for (int i = 0; i < 12; i++)
         {
             for (int j = 0; j < 11; j++)
             {
                 if (LR[letter][i][j])
-                    lcd.buffer[i+LR_xy[letter][0]][j+LR_xy[letter][1]] = LCD_Fade(lcd, lcd.buffer[i+LR_xy[letter][0]][j+LR_xy[letter][1]], col);
+                {
+                    uint32_t& pixel = lcd.buffer[i+LR_xy[letter][0]][j+LR_xy[letter][1]];
+                    changed |= LCD_SetPixel(pixel, LCD_Fade(lcd, pixel, col));
+                }
             }
         }
+        if (changed)
+        {
+            LCD_MarkDirty(lcd, LR_xy[letter][1], LR_xy[letter][0], 11, 12);
+        }
+    }
+}
+
+// Glyph cell sizes in buffer pixels, used for dirty tracking. The standard cell includes the cursor row.
+static const int32_t lcd_glyph_standard_w = 29;
+static const int32_t lcd_glyph_standard_h = 47;
+static const int32_t lcd_glyph_level_h    = 86;
+
+static void LCD_RenderStandardCell(lcd_t& lcd, uint8_t* LCD_CG, int32_t x, int32_t y, uint8_t ch, uint8_t cursor = 0)
+{
+    if (LCD_FontRenderStandard(lcd, LCD_CG, x, y, ch, cursor))
+    {
+        LCD_MarkDirty(lcd, y, x, lcd_glyph_standard_w, lcd_glyph_standard_h);
+    }
+}
+
+static void LCD_RenderLevelCell(lcd_t& lcd, uint8_t* LCD_CG, int32_t x, int32_t y, uint8_t ch, uint8_t width)
+{
+    if (LCD_FontRenderLevel(lcd, LCD_CG, x, y, ch, width))
+    {
+        LCD_MarkDirty(lcd, y, x, (width - 1) * 26 + 24, lcd_glyph_level_h);
     }
 }
 
@@ -416,8 +504,19 @@ void LCD_Render(lcd_t& lcd)
         return;
     }
 
+    if (lcd.mcu->stats)
+    {
+        lcd.mcu->stats->lcd_renders.Add();
+    }
+
     if (!lcd.mcu->is_cm300 && !lcd.mcu->is_st && !lcd.mcu->is_scb55)
     {
+        if (!lcd.backend->WantsPixels())
+        {
+            lcd.backend->Render();
+            return;
+        }
+
         if (!lcd.mutex.try_lock())
         {
             // if the MCU is currently updating something, just drop the frame
@@ -439,17 +538,24 @@ void LCD_Render(lcd_t& lcd)
 
         uint8_t contrast = lcd.contrast;
 
+        lcd.dirty_count = 0;
+
         if (!lcd.enable && !lcd.mcu->is_jv880)
         {
             contrast = 1;
             memset(lcd.LCD_Data, ' ', sizeof(lcd.LCD_Data));
+            bool changed = false;
             for (size_t i = 0; i < lcd.height; i++) 
             {
                 for (size_t j = 0; j < lcd.width; j++) 
                 {
-                    lcd.buffer[i][j] = (back_palette[back_data[i * lcd.width + j]] & 0xFCFC0C) >> 2;
+                    changed |= LCD_SetPixel(lcd.buffer[i][j], (back_palette[back_data[i * lcd.width + j]] & 0xFCFC0C) >> 2);
                 }
             }
+            if (changed)
+            {
+                LCD_MarkAllDirty(lcd);
+            }
         }
         else
         {
@@ -462,6 +568,7 @@ void LCD_Render(lcd_t& lcd)
                             lcd.buffer[i][j] = 0xFF03BE51;
                         }
                     }
+                    LCD_MarkAllDirty(lcd);
                 }
             }
             else
@@ -473,6 +580,7 @@ void LCD_Render(lcd_t& lcd)
                             lcd.buffer[i][j] = back_palette[back_data[i * lcd.width + j]];
                         }
                     }
+                    LCD_MarkAllDirty(lcd);
                 }
             }
 
@@ -506,7 +614,7 @@ void LCD_Render(lcd_t& lcd)
                     for (int j = 0; j < 24; j++)
                     {
                         uint8_t ch = LCD_Data[i * 40 + j];
-                        LCD_FontRenderStandard(lcd, LCD_CG, (4 + i * 50), 4 + j * 34, ch, (i == curY && j == curX && LCD_C) + 1);
+                        LCD_RenderStandardCell(lcd, LCD_CG, (4 + i * 50), 4 + j * 34, ch, (i == curY && j == curX && LCD_C) + 1);
                     }
                 }
 
@@ -516,42 +624,42 @@ void LCD_Render(lcd_t& lcd)
                 for (int i = 0; i < 3; i++)
                 {
                     uint8_t ch = LCD_Data[0 + i];
-                    LCD_FontRenderStandard(lcd, LCD_CG, 11, 34 + i * 35, ch);
+                    LCD_RenderStandardCell(lcd, LCD_CG, 11, 34 + i * 35, ch);
                 }
                 for (int i = 0; i < 16; i++)
                 {
                     uint8_t ch = LCD_Data[3 + i];
-                    LCD_FontRenderStandard(lcd, LCD_CG, 11, 153 + i * 35, ch);
+                    LCD_RenderStandardCell(lcd, LCD_CG, 11, 153 + i * 35, ch);
                 }
                 for (int i = 0; i < 3; i++)
                 {
                     uint8_t ch = LCD_Data[40 + i];
-                    LCD_FontRenderStandard(lcd, LCD_CG, 75, 34 + i * 35, ch);
+                    LCD_RenderStandardCell(lcd, LCD_CG, 75, 34 + i * 35, ch);
                 }
                 for (int i = 0; i < 3; i++)
                 {
                     uint8_t ch = LCD_Data[43 + i];
-                    LCD_FontRenderStandard(lcd, LCD_CG, 75, 153 + i * 35, ch);
+                    LCD_RenderStandardCell(lcd, LCD_CG, 75, 153 + i * 35, ch);
                 }
                 for (int i = 0; i < 3; i++)
                 {
                     uint8_t ch = LCD_Data[49 + i];
-                    LCD_FontRenderStandard(lcd, LCD_CG, 139, 34 + i * 35, ch);
+                    LCD_RenderStandardCell(lcd, LCD_CG, 139, 34 + i * 35, ch);
                 }
                 for (int i = 0; i < 3; i++)
                 {
                     uint8_t ch = LCD_Data[46 + i];
-                    LCD_FontRenderStandard(lcd, LCD_CG, 139, 153 + i * 35, ch);
+                    LCD_RenderStandardCell(lcd, LCD_CG, 139, 153 + i * 35, ch);
                 }
                 for (int i = 0; i < 3; i++)
                 {
                     uint8_t ch = LCD_Data[52 + i];
-                    LCD_FontRenderStandard(lcd, LCD_CG, 203, 34 + i * 35, ch);
+                    LCD_RenderStandardCell(lcd, LCD_CG, 203, 34 + i * 35, ch);
                 }
                 for (int i = 0; i < 3; i++)
                 {
                     uint8_t ch = LCD_Data[55 + i];
-                    LCD_FontRenderStandard(lcd, LCD_CG, 203, 153 + i * 35, ch);
+                    LCD_RenderStandardCell(lcd, LCD_CG, 203, 153 + i * 35, ch);
                 }
 
                 LCD_FontRenderLR(lcd, LCD_CG, LCD_Data[58]);
@@ -561,7 +669,7 @@ void LCD_Render(lcd_t& lcd)
                     for (int j = 0; j < 4; j++)
                     {
                         uint8_t ch = lcd.LCD_Data[20 + j + i * 40];
-                        LCD_FontRenderLevel(lcd, LCD_CG, 71 + i * 88, 293 + j * 130, ch, j == 3 ? 1 : 5);
+                        LCD_RenderLevelCell(lcd, LCD_CG, 71 + i * 88, 293 + j * 130, ch, j == 3 ? 1 : 5);
                     }
                 }
             }
@@ -43,6 +43,16 @@ struct lcd_t;
 static const int lcd_width_max = 1024;
 static const int lcd_height_max = 1024;
 
+// Upper bound on the number of distinct regions LCD_Render reports per frame. If more regions change, they are
+// collapsed into a single bounding rectangle.
+static const int lcd_dirty_rects_max = 64;
+
+// A region of lcd_t::buffer in pixels. `x` and `w` are columns, `y` and `h` are rows.
+struct LCD_Rect
+{
+    int32_t x = 0, y = 0, w = 0, h = 0;
+};
+
 class LCD_Backend
 {
 public:
@@ -55,8 +65,13 @@ public:
     // started again.
     virtual void Stop() = 0;
 
-    // Called on LCD_Render. The backend should display a frame to the user.
+    // Called on LCD_Render. The backend should display a frame to the user. `lcd.dirty_rects` lists the regions of
+    // `lcd.buffer` that changed since the previous call; when `lcd.dirty_count` is zero the LCD contents are unchanged.
     virtual void Render() = 0;
+
+    // If this returns false, LCD_Render skips rasterizing into `lcd.buffer` and calls Render directly. Such backends
+    // are expected to read the LCD state themselves while holding `lcd.mutex`.
+    virtual bool WantsPixels() const { return true; }
 };
 
 struct lcd_t {
@@ -81,6 +96,10 @@ struct lcd_t {
 
     uint32_t buffer[lcd_height_max][lcd_width_max]{};
 
+    // Regions of `buffer` modified by the most recent LCD_Render. Only meaningful during LCD_Backend::Render.
+    LCD_Rect dirty_rects[lcd_dirty_rects_max]{};
+    size_t   dirty_count = 0;
+
     float volume = 0.8f;
 
     std::mutex mutex;
@@ -97,3 +116,6 @@ void LCD_Enable(lcd_t& lcd, uint32_t enable);
 void LCD_ButtonEnable(lcd_t& lcd, uint32_t enable);
 void LCD_SetContrast(lcd_t& lcd, uint8_t contrast);
 void LCD_Render(lcd_t& lcd);
+
+// Font for character codes 16-255, one row of 5 pixels per byte. Defined in lcd_font.h, which only lcd.cpp includes.
+extern const uint8_t lcd_font[240][10];
@@ -1,4 +1,4 @@
-uint8_t lcd_font[240][10] = {
+const uint8_t lcd_font[240][10] = {
     {0x00, 0x1f, 0x00, 0x1f, 0x00, 0x1f, 0x00, 0x00, 0x00, 0x00},
     {0x04, 0x04, 0x1f, 0x04, 0x04, 0x00, 0x1f, 0x00, 0x00, 0x00},
     {0x08, 0x04, 0x02, 0x04, 0x08, 0x00, 0x0e, 0x00, 0x0e, 0x00},
@@ -0,0 +1,209 @@
+#include "lcd_text.h"
+
+#include "lcd.h"
+#include "mcu.h"
+#include <cstring>
+#include <utility>
+
+static const uint8_t* LCD_GlyphRows(const uint8_t (&cg)[64], uint8_t ch)
+{
+    if (ch >= 16)
+        return &lcd_font[ch - 16][0];
+    else
+        return &cg[(ch & 7) * 8];
+}
+
+// Converts a run of display RAM to text. Characters outside printable ASCII (custom CG glyphs, katakana) become '?'.
+// Trailing spaces are dropped.
+static std::string LCD_DecodeString(const uint8_t* data, size_t count)
+{
+    std::string result;
+    result.reserve(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        const uint8_t ch = data[i];
+        result.push_back(ch >= 0x20 && ch < 0x7f ? (char)ch : '?');
+    }
+    while (!result.empty() && result.back() == ' ')
+    {
+        result.pop_back();
+    }
+    return result;
+}
+
+// The SC-55 level meter is drawn from 8 characters: a top and bottom row of four, where each character column is one
+// part (5 + 5 + 5 + 1 columns). A meter's height is the number of lit pixel rows in its column.
+static uint8_t LCD_DecodeMeter(const uint8_t (&data)[80], const uint8_t (&cg)[64], size_t part)
+{
+    const size_t  cell   = part / 5;
+    const uint8_t column = (uint8_t)(part % 5);
+
+    uint8_t height = 0;
+    for (size_t row = 0; row < 2; row++)
+    {
+        const uint8_t* f = LCD_GlyphRows(cg, data[20 + cell + row * 40]);
+        for (size_t i = 0; i < 8; i++)
+        {
+            if (f[i] & (1 << (4 - column)))
+            {
+                height++;
+            }
+        }
+    }
+    return height;
+}
+
+void LCD_DecodeText(const uint8_t (&data)[80], const uint8_t (&cg)[64], bool is_jv880, LCD_TextState& state)
+{
+    state.is_jv880 = is_jv880;
+
+    if (is_jv880)
+    {
+        state.line1 = LCD_DecodeString(&data[0], 24);
+        state.line2 = LCD_DecodeString(&data[40], 24);
+        return;
+    }
+
+    // Offsets match the layout drawn by LCD_Render.
+    state.part       = LCD_DecodeString(&data[0], 3);
+    state.instrument = LCD_DecodeString(&data[3], 16);
+    state.level      = LCD_DecodeString(&data[40], 3);
+    state.pan        = LCD_DecodeString(&data[43], 3);
+    state.reverb     = LCD_DecodeString(&data[49], 3);
+    state.chorus     = LCD_DecodeString(&data[46], 3);
+    state.key_shift  = LCD_DecodeString(&data[52], 3);
+    state.midi_ch    = LCD_DecodeString(&data[55], 3);
+
+    for (size_t part = 0; part < state.meters.size(); part++)
+    {
+        state.meters[part] = LCD_DecodeMeter(data, cg, part);
+    }
+}
+
+static void LCD_AppendQuoted(std::string& out, const char* key, const std::string& value)
+{
+    out += ' ';
+    out += key;
+    out += "=\"";
+    for (char c : value)
+    {
+        if (c == '"' || c == '\\')
+        {
+            out += '\\';
+        }
+        out += c;
+    }
+    out += '"';
+}
+
+std::string LCD_FormatText(const LCD_TextState& state)
+{
+    std::string out = state.power ? "power=on" : "power=off";
+
+    if (state.is_jv880)
+    {
+        LCD_AppendQuoted(out, "line1", state.line1);
+        LCD_AppendQuoted(out, "line2", state.line2);
+        return out;
+    }
+
+    LCD_AppendQuoted(out, "part", state.part);
+    LCD_AppendQuoted(out, "instrument", state.instrument);
+    LCD_AppendQuoted(out, "level", state.level);
+    LCD_AppendQuoted(out, "pan", state.pan);
+    LCD_AppendQuoted(out, "reverb", state.reverb);
+    LCD_AppendQuoted(out, "chorus", state.chorus);
+    LCD_AppendQuoted(out, "key_shift", state.key_shift);
+    LCD_AppendQuoted(out, "midi_ch", state.midi_ch);
+
+    out += " meters=";
+    for (size_t i = 0; i < state.meters.size(); i++)
+    {
+        if (i != 0)
+        {
+            out += ',';
+        }
+        out += std::to_string(state.meters[i]);
+    }
+
+    return out;
+}
+
+LCD_Text_Backend::LCD_Text_Backend(Callback callback)
+    : m_callback(std::move(callback))
+{
+}
+
+bool LCD_Text_Backend::Start(lcd_t& lcd)
+{
+    m_lcd       = &lcd;
+    m_published = false;
+    return true;
+}
+
+void LCD_Text_Backend::Stop()
+{
+    m_lcd = nullptr;
+}
+
+void LCD_Text_Backend::Render()
+{
+    if (!m_lcd)
+    {
+        return;
+    }
+
+    if (!m_lcd->mutex.try_lock())
+    {
+        // if the MCU is currently updating something, check again next frame
+        return;
+    }
+
+    const bool power   = m_lcd->enable || m_lcd->mcu->is_jv880;
+    const bool changed = !m_published || power != m_power || memcmp(m_data, m_lcd->LCD_Data, sizeof(m_data)) != 0 ||
+                         memcmp(m_cg, m_lcd->LCD_CG, sizeof(m_cg)) != 0;
+    if (changed)
+    {
+        memcpy(m_data, m_lcd->LCD_Data, sizeof(m_data));
+        memcpy(m_cg, m_lcd->LCD_CG, sizeof(m_cg));
+    }
+
+    m_lcd->mutex.unlock();
+
+    if (!changed)
+    {
+        return;
+    }
+
+    m_power = power;
+
+    LCD_TextState state;
+    state.power = power;
+    if (power)
+    {
+        LCD_DecodeText(m_data, m_cg, m_lcd->mcu->is_jv880, state);
+    }
+    else
+    {
+        state.is_jv880 = m_lcd->mcu->is_jv880;
+    }
+
+    // Raw RAM can change without affecting what is displayed (e.g. unused CG slots), so compare the decoded state too.
+    if (m_published && state == m_state)
+    {
+        return;
+    }
+
+    m_state     = std::move(state);
+    m_published = true;
+
+    if (m_callback)
+    {
+        m_callback(m_state);
+    }
+}
+
+bool LCD_Text_Backend::WantsPixels() const
+{
+    return false;
+}
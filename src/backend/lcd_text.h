@@ -0,0 +1,71 @@
+#pragma once
+
+#include "lcd.h"
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <string>
+
+// Decoded contents of the LCD. Fields that the current model does not display are left empty.
+struct LCD_TextState
+{
+    // Selects which of the fields below are in use.
+    bool is_jv880 = false;
+
+    // False while the unit is in standby (SC-55 family only).
+    bool power = true;
+
+    // SC-55 family. Each field is the text shown next to the corresponding panel label.
+    std::string part;
+    std::string instrument;
+    std::string level;
+    std::string pan;
+    std::string reverb;
+    std::string chorus;
+    std::string key_shift;
+    std::string midi_ch;
+
+    // SC-55 family. Height of each part's level meter, 0 (silent) through 16 (full scale).
+    std::array<uint8_t, 16> meters{};
+
+    // JV-880. The two text lines of the display.
+    std::string line1;
+    std::string line2;
+
+    bool operator==(const LCD_TextState&) const = default;
+};
+
+// Decodes raw LCD memory into `state`. `data` and `cg` are the display RAM and character generator RAM, laid out like
+// lcd_t::LCD_Data and lcd_t::LCD_CG.
+void LCD_DecodeText(const uint8_t (&data)[80], const uint8_t (&cg)[64], bool is_jv880, LCD_TextState& state);
+
+// Formats `state` as a single line of space-separated key=value pairs, without a trailing newline. Text values are
+// quoted; meters are written as a comma-separated list.
+std::string LCD_FormatText(const LCD_TextState& state);
+
+// An LCD backend that never rasterizes. Instead it decodes the display contents into an LCD_TextState and publishes it
+// through a callback whenever it changes.
+class LCD_Text_Backend : public LCD_Backend
+{
+public:
+    using Callback = std::function<void(const LCD_TextState&)>;
+
+    explicit LCD_Text_Backend(Callback callback);
+
+    bool Start(lcd_t& lcd) override;
+    void Stop() override;
+    void Render() override;
+    bool WantsPixels() const override;
+
+private:
+    lcd_t*   m_lcd = nullptr;
+    Callback m_callback;
+
+    // Raw LCD state as of the last decode. Decoding is skipped entirely while these are unchanged.
+    uint8_t m_data[80]{};
+    uint8_t m_cg[64]{};
+    bool    m_power     = true;
+    bool    m_published = false;
+
+    LCD_TextState m_state;
+};
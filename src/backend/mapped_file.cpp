@@ -0,0 +1,137 @@
+#include "mapped_file.h"
+
+#include <utility>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::~MappedFile()
+{
+    Close();
+}
+
+MappedFile::MappedFile(MappedFile&& rhs) noexcept
+    : m_data(std::exchange(rhs.m_data, nullptr)),
+      m_size(std::exchange(rhs.m_size, 0)),
+      m_is_empty_file(std::exchange(rhs.m_is_empty_file, false))
+{
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& rhs) noexcept
+{
+    if (this != &rhs)
+    {
+        Close();
+        m_data          = std::exchange(rhs.m_data, nullptr);
+        m_size          = std::exchange(rhs.m_size, 0);
+        m_is_empty_file = std::exchange(rhs.m_is_empty_file, false);
+    }
+    return *this;
+}
+
+bool MappedFile::Open(const std::filesystem::path& path)
+{
+    Close();
+
+#if defined(_WIN32)
+    HANDLE file = CreateFileW(path.c_str(),
+                              GENERIC_READ,
+                              FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              nullptr,
+                              OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL,
+                              nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+    {
+        return false;
+    }
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size) || (uint64_t)size.QuadPart > SIZE_MAX)
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    if (size.QuadPart == 0)
+    {
+        // CreateFileMapping rejects empty files
+        CloseHandle(file);
+        m_is_empty_file = true;
+        return true;
+    }
+
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+    {
+        return false;
+    }
+
+    // The view keeps the mapping object alive.
+    void* view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!view)
+    {
+        return false;
+    }
+
+    m_data = (const uint8_t*)view;
+    m_size = (size_t)size.QuadPart;
+    return true;
+#else
+    const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1)
+    {
+        return false;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < 0)
+    {
+        close(fd);
+        return false;
+    }
+
+    if (st.st_size == 0)
+    {
+        // mmap rejects zero-length mappings
+        close(fd);
+        m_is_empty_file = true;
+        return true;
+    }
+
+    void* view = mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // The mapping keeps the file alive.
+    close(fd);
+    if (view == MAP_FAILED)
+    {
+        return false;
+    }
+
+    m_data = (const uint8_t*)view;
+    m_size = (size_t)st.st_size;
+    return true;
+#endif
+}
+
+void MappedFile::Close()
+{
+    if (m_data)
+    {
+#if defined(_WIN32)
+        UnmapViewOfFile(m_data);
+#else
+        munmap((void*)m_data, m_size);
+#endif
+    }
+    m_data          = nullptr;
+    m_size          = 0;
+    m_is_empty_file = false;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <span>
+
+// Read-only memory mapping of an entire file. Pages are read on first access and are shared with every other process
+// that maps the same file.
+//
+// The file must not be truncated while it is mapped. Files that are replaced by renaming a new file over them are fine;
+// the mapping keeps referring to the old contents.
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    MappedFile(const MappedFile&)            = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    MappedFile(MappedFile&& rhs) noexcept;
+    MappedFile& operator=(MappedFile&& rhs) noexcept;
+
+    // Maps the file at `path`, replacing any previous mapping. Returns false if the file can't be opened or mapped, in
+    // which case this object is left empty. Mapping an empty file succeeds and produces an empty span.
+    bool Open(const std::filesystem::path& path);
+
+    void Close();
+
+    std::span<const uint8_t> GetData() const
+    {
+        return {m_data, m_size};
+    }
+
+    bool IsOpen() const
+    {
+        return m_data != nullptr || m_is_empty_file;
+    }
+
+private:
+    const uint8_t* m_data          = nullptr;
+    size_t         m_size          = 0;
+    bool           m_is_empty_file = false;
+};
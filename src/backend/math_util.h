@@ -34,9 +34,18 @@
 #pragma once
 
 #include <cmath>
+#include <cstddef>
 #include <cstdint>
 #include <type_traits>
 
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define NUKED_MATH_SSE2 1
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define NUKED_MATH_NEON 1
+#include <arm_neon.h>
+#endif
+
 template <typename T>
 inline T Min(T a, T b)
 {
@@ -144,9 +153,24 @@ inline int32_t SaturatingMul(int32_t a, float b)
     return (int32_t)Clamp<int64_t>(result, INT32_MIN, INT32_MAX);
 }
 
-// Auto vectorizes in clang at -O2, gcc at -O3
-inline void HorizontalSatAddI16(int16_t* dest, int16_t* src_first, int16_t* src_last)
+// The Horizontal* functions add [src_first, src_last) into dest element-wise. They use SSE2 or NEON when available,
+// processing 16 bytes per iteration, and finish the remainder with scalar code. No alignment is required.
+
+inline void HorizontalSatAddI16(int16_t* dest, const int16_t* src_first, const int16_t* src_last)
 {
+#if NUKED_MATH_SSE2
+    for (; src_last - src_first >= 8; src_first += 8, dest += 8)
+    {
+        const __m128i a = _mm_loadu_si128((const __m128i*)dest);
+        const __m128i b = _mm_loadu_si128((const __m128i*)src_first);
+        _mm_storeu_si128((__m128i*)dest, _mm_adds_epi16(a, b));
+    }
+#elif NUKED_MATH_NEON
+    for (; src_last - src_first >= 8; src_first += 8, dest += 8)
+    {
+        vst1q_s16(dest, vqaddq_s16(vld1q_s16(dest), vld1q_s16(src_first)));
+    }
+#endif
     while (src_first != src_last)
     {
         *dest = SaturatingAdd(*dest, *src_first);
@@ -155,8 +179,28 @@ inline void HorizontalSatAddI16(int16_t* dest, int16_t* src_first, int16_t* src_
     }
 }
 
-inline void HorizontalSatAddI32(int32_t* dest, int32_t* src_first, int32_t* src_last)
+inline void HorizontalSatAddI32(int32_t* dest, const int32_t* src_first, const int32_t* src_last)
 {
+#if NUKED_MATH_SSE2
+    // SSE2 has no saturating 32-bit add. Overflow happened iff both inputs have the same sign and the sum's sign
+    // differs; in that case the result saturates towards the sign of the inputs.
+    const __m128i max = _mm_set1_epi32(INT32_MAX);
+    for (; src_last - src_first >= 4; src_first += 4, dest += 4)
+    {
+        const __m128i a        = _mm_loadu_si128((const __m128i*)dest);
+        const __m128i b        = _mm_loadu_si128((const __m128i*)src_first);
+        const __m128i sum      = _mm_add_epi32(a, b);
+        const __m128i overflow = _mm_srai_epi32(_mm_andnot_si128(_mm_xor_si128(a, b), _mm_xor_si128(a, sum)), 31);
+        const __m128i clamped  = _mm_xor_si128(_mm_srai_epi32(a, 31), max);
+        _mm_storeu_si128((__m128i*)dest,
+                         _mm_or_si128(_mm_and_si128(overflow, clamped), _mm_andnot_si128(overflow, sum)));
+    }
+#elif NUKED_MATH_NEON
+    for (; src_last - src_first >= 4; src_first += 4, dest += 4)
+    {
+        vst1q_s32(dest, vqaddq_s32(vld1q_s32(dest), vld1q_s32(src_first)));
+    }
+#endif
     while (src_first != src_last)
     {
         *dest = SaturatingAdd(*dest, *src_first);
@@ -165,8 +209,19 @@ inline void HorizontalSatAddI32(int32_t* dest, int32_t* src_first, int32_t* src_
     }
 }
 
-inline void HorizontalAddF32(float* dest, float* src_first, float* src_last)
+inline void HorizontalAddF32(float* dest, const float* src_first, const float* src_last)
 {
+#if NUKED_MATH_SSE2
+    for (; src_last - src_first >= 4; src_first += 4, dest += 4)
+    {
+        _mm_storeu_ps(dest, _mm_add_ps(_mm_loadu_ps(dest), _mm_loadu_ps(src_first)));
+    }
+#elif NUKED_MATH_NEON
+    for (; src_last - src_first >= 4; src_first += 4, dest += 4)
+    {
+        vst1q_f32(dest, vaddq_f32(vld1q_f32(dest), vld1q_f32(src_first)));
+    }
+#endif
     while (src_first != src_last)
     {
         *dest = *dest + *src_first;
@@ -174,3 +229,34 @@ inline void HorizontalAddF32(float* dest, float* src_first, float* src_last)
         ++dest;
     }
 }
+
+// Returns the sum of a[i] * b[i] for i in [0, count). The SIMD paths accumulate in four lanes, so the result may differ
+// from a sequential sum by rounding error.
+inline float DotProductF32(const float* a, const float* b, size_t count)
+{
+    size_t i = 0;
+#if NUKED_MATH_SSE2
+    __m128 acc = _mm_setzero_ps();
+    for (; count - i >= 4; i += 4)
+    {
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    }
+    alignas(16) float lanes[4];
+    _mm_store_ps(lanes, acc);
+    float sum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif NUKED_MATH_NEON
+    float32x4_t acc = vdupq_n_f32(0.0f);
+    for (; count - i >= 4; i += 4)
+    {
+        acc = vmlaq_f32(acc, vld1q_f32(a + i), vld1q_f32(b + i));
+    }
+    float sum = (vgetq_lane_f32(acc, 0) + vgetq_lane_f32(acc, 1)) + (vgetq_lane_f32(acc, 2) + vgetq_lane_f32(acc, 3));
+#else
+    float sum = 0.0f;
+#endif
+    for (; i < count; ++i)
+    {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
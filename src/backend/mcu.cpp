@@ -32,12 +32,16 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  */
 #include "mcu.h"
+#include "emu_profiler.h"
+#include "emu_stats.h"
 #include "lcd.h"
 #include "mcu_opcodes.h"
 #include "mcu_timer.h"
 #include "pcm.h"
 #include "submcu.h"
+#include <algorithm>
 #include <cstdio>
+#include <cstring>
 #include <string>
 
 void MCU_ErrorTrap(mcu_t& mcu)
@@ -862,6 +866,7 @@ void MCU_Reset(mcu_t& mcu)
     mcu.pc = 0;
 
     mcu.sr = 0x700;
+    mcu.flags_op = LAZY_FLAGS_NONE;
 
     mcu.cp = 0;
     mcu.dp = 0;
@@ -883,17 +888,51 @@ void MCU_Reset(mcu_t& mcu)
     }
 }
 
+size_t MCU_GetUARTWritable(mcu_t& mcu)
+{
+    const uint32_t read_ptr = std::atomic_ref(mcu.uart_read_ptr).load(std::memory_order_acquire);
+    return (read_ptr + uart_buffer_size - mcu.uart_write_ptr - 1) % uart_buffer_size;
+}
+
+size_t MCU_TryPostUART(mcu_t& mcu, std::span<const uint8_t> data)
+{
+    data = data.first(std::min(data.size(), MCU_GetUARTWritable(mcu)));
+
+    uint32_t write_ptr = mcu.uart_write_ptr;
+    for (std::span<const uint8_t> rest = data; !rest.empty();)
+    {
+        const size_t count = std::min<size_t>(rest.size(), uart_buffer_size - write_ptr);
+        memcpy(&mcu.uart_buffer[write_ptr], rest.data(), count);
+        write_ptr = (write_ptr + (uint32_t)count) % uart_buffer_size;
+        rest = rest.subspan(count);
+    }
+    // Publishes the bytes to the emulator thread.
+    std::atomic_ref(mcu.uart_write_ptr).store(write_ptr, std::memory_order_release);
+
+    if (mcu.stats)
+        mcu.stats->uart_rx_bytes.Add(data.size());
+
+    return data.size();
+}
+
 void MCU_PostUART(mcu_t& mcu, uint8_t data)
 {
-    mcu.uart_buffer[mcu.uart_write_ptr] = data;
-    mcu.uart_write_ptr = (mcu.uart_write_ptr + 1) % uart_buffer_size;
+    MCU_PostUART(mcu, std::span<const uint8_t>(&data, 1));
+}
+
+void MCU_PostUART(mcu_t& mcu, std::span<const uint8_t> data)
+{
+    const size_t posted = MCU_TryPostUART(mcu, data);
+
+    if (mcu.stats && posted != data.size())
+        mcu.stats->uart_rx_dropped.Add(data.size() - posted);
 }
 
 void MCU_UpdateUART_RX(mcu_t& mcu)
 {
     if ((mcu.dev_register[DEV_SCR] & 16) == 0) // RX disabled
         return;
-    if (mcu.uart_write_ptr == mcu.uart_read_ptr) // no byte
+    if (!MCU_UART_HasByte(mcu)) // no byte
         return;
 
     if (mcu.dev_register[DEV_SSR] & 0x40)
@@ -902,8 +941,7 @@ void MCU_UpdateUART_RX(mcu_t& mcu)
     if (mcu.cycles < mcu.uart_rx_delay)
         return;
 
-    mcu.uart_rx_byte = mcu.uart_buffer[mcu.uart_read_ptr];
-    mcu.uart_read_ptr = (mcu.uart_read_ptr + 1) % uart_buffer_size;
+    mcu.uart_rx_byte = MCU_UART_ReadByte(mcu);
     mcu.dev_register[DEV_SSR] |= 0x40;
     MCU_Interrupt_SetRequest(mcu, INTERRUPT_SOURCE_UART_RX, (mcu.dev_register[DEV_SCR] & 0x40) != 0);
 }
@@ -937,19 +975,17 @@ void MCU_UpdateUART_TX(mcu_t& mcu)
         mcu.uart_tx_ptr = mcu.uart_tx_buffer + 1;
 
     *mcu.uart_tx_ptr++ = data;
+    mcu.uart_tx_pending = 1;
 
     // fprintf(stderr, "tx:%x\n", mcu.dev_register[DEV_TDR]);
 }
 
 void MCU_UpdateUART(mcu_t& mcu)
 {
-    if(mcu.uart_tx_ptr == mcu.uart_tx_buffer)
-        return;
-    
-    uint8_t *tx_buffer = mcu.uart_tx_buffer;
+    // Only called when a byte has been added since the last call.
+    mcu.uart_tx_pending = 0;
 
-    if (mcu.uart_tx_ptr == tx_buffer)
-        return;
+    uint8_t *tx_buffer = mcu.uart_tx_buffer;
 
     int len;
     uint8_t status = *tx_buffer;
@@ -957,7 +993,9 @@ void MCU_UpdateUART(mcu_t& mcu)
         if (*(mcu.uart_tx_ptr - 1) == 0xF7) 
         {
             len = mcu.uart_tx_ptr - tx_buffer;
-            mcu.midiout_callback(mcu.callback_userdata, tx_buffer, len);
+            mcu.midiout_callback(mcu.midiout_userdata, tx_buffer, len);
+            if (mcu.stats)
+                mcu.stats->uart_tx_bytes.Add((uint64_t)len);
             mcu.uart_tx_ptr = mcu.uart_tx_buffer;
         }
     } 
@@ -982,7 +1020,9 @@ void MCU_UpdateUART(mcu_t& mcu)
         }
         if (mcu.uart_tx_ptr - tx_buffer >= len) 
         {
-            mcu.midiout_callback(mcu.callback_userdata, tx_buffer, len);
+            mcu.midiout_callback(mcu.midiout_userdata, tx_buffer, len);
+            if (mcu.stats)
+                mcu.stats->uart_tx_bytes.Add((uint64_t)len);
             mcu.uart_tx_ptr = mcu.uart_tx_buffer;
         }
     }
@@ -995,6 +1035,14 @@ void MCU_Step(mcu_t& mcu)
     else
         mcu.ex_ignore = 0;
 
+    if (mcu.stats)
+    {
+        if (mcu.sleep)
+            mcu.stats->sleep_steps.Add();
+        else
+            mcu.stats->instructions.Add();
+    }
+
     if (!mcu.sleep)
         MCU_ReadInstruction(mcu);
 
@@ -1015,7 +1063,8 @@ void MCU_Step(mcu_t& mcu)
         MCU_UpdateUART_TX(mcu);
     }
 
-    MCU_UpdateUART(mcu);
+    if (mcu.uart_tx_pending)
+        MCU_UpdateUART(mcu);
     MCU_UpdateAnalog(mcu, mcu.cycles);
 
     if (mcu.is_mk1)
@@ -1030,6 +1079,9 @@ void MCU_Step(mcu_t& mcu)
             }
         }
     }
+
+    if (mcu.profiler && mcu.cycles >= mcu.profiler->next_sample)
+        mcu.profiler->Sample(mcu);
 }
 
 void MCU_PatchROM(mcu_t& mcu)
@@ -65,6 +65,8 @@
 #include "rom.h"
 #include <atomic>
 #include <cstdint>
+#include <memory>
+#include <span>
 
 struct submcu_t;
 struct pcm_t;
@@ -146,6 +148,20 @@ enum {
     STATUS_INT_MASK = 0x700
 };
 
+// How the N, Z, V and C bits of mcu_t::sr are derived from the mcu_t::flags_* fields. Most instructions that set flags
+// only record their operands; the flags are computed by MCU_SyncFlags when something reads them, which is rare
+// compared to how often they are overwritten.
+enum MCU_LazyFlags : uint8_t {
+    // sr is up to date.
+    LAZY_FLAGS_NONE,
+    // N and Z from flags_t1, V cleared, C unchanged in sr.
+    LAZY_FLAGS_LOGIC,
+    // All four flags from flags_t1 + flags_t2 + flags_c.
+    LAZY_FLAGS_ADD,
+    // All four flags from flags_t1 - flags_t2 - flags_c.
+    LAZY_FLAGS_SUB,
+};
+
 enum {
     VECTOR_RESET = 0,
     VECTOR_RESERVED1, // UNUSED
@@ -232,32 +248,95 @@ enum class Computerswitch {
     MIDI
 };
 
+struct EMU_Counters;
+class EMU_Profiler;
+
+// Rate at which mcu_t::cycles advances relative to real time.
+constexpr uint64_t MCU_CYCLES_PER_SECOND = 24000000;
+
 typedef void(*mcu_sample_callback)(void* userdata, const AudioFrame<int32_t>& frame);
 typedef void (*mcu_midiout_callback)(void* userdata, uint8_t* message, int len);
 
 void MCU_DefaultSampleCallback(void* userdata, const AudioFrame<int32_t>& frame);
 void MCU_DefaultMidiOutCallback(void* userdata, uint8_t* message, int len);
 
-struct mcu_t {
+// Memory too large to share cache lines with the interpreter state. Allocated separately from the mcu_t using it.
+struct mcu_memory_t {
+    uint8_t rom1[ROM1_SIZE]{};
+    uint8_t rom2[ROM2_SIZE]{};
+    uint8_t sram[SRAM_SIZE]{};
+    uint8_t nvram[NVRAM_SIZE]{};
+    uint8_t cardram[CARDRAM_SIZE]{};
+    uint8_t uart_buffer[uart_buffer_size]{};
+    uint8_t uart_tx_buffer[uart_buffer_size]{};
+};
+
+// The fields read on every MCU_Step come first and fill the first two cache lines; bulk memory lives in mcu_memory_t.
+struct alignas(64) mcu_t {
+    // Allocates its own mcu_memory_t.
+    mcu_t() : owned_memory(std::make_unique<mcu_memory_t>()), memory(owned_memory.get()) {}
+    // Uses `external_memory`, which must outlive this mcu_t.
+    explicit mcu_t(mcu_memory_t& external_memory) : memory(&external_memory) {}
+
     uint16_t r[8]{};
     uint16_t pc                 = 0;
+    // N, Z, V and C are only valid after MCU_SyncFlags.
     uint16_t sr                 = 0;
+    uint8_t  flags_op           = LAZY_FLAGS_NONE;
+    uint8_t  flags_siz          = 0;
+    uint8_t  flags_c            = 0;
     uint8_t  cp = 0, dp = 0, ep = 0, tp = 0, br = 0;
     uint8_t  sleep              = 0;
     uint8_t  ex_ignore          = 0;
+    // Set whenever a byte is added to uart_tx_buffer so the message is only parsed when it may have completed.
+    uint8_t  uart_tx_pending    = 0;
+    int32_t  flags_t1           = 0;
+    int32_t  flags_t2           = 0;
     int32_t  exception_pending  = 0;
-    uint8_t  interrupt_pending[INTERRUPT_SOURCE_MAX]{};
+
+    uint32_t operand_type   = 0;
+    uint16_t operand_ea     = 0;
+    uint16_t operand_data   = 0;
+    uint8_t operand_ep      = 0;
+    uint8_t operand_size    = 0;
+    uint8_t operand_reg     = 0;
+    uint8_t operand_status  = 0;
+    uint8_t opcode_extended = 0;
+
+    uint64_t cycles = 0;
+
     uint8_t  trapa_pending[16]{};
-    uint64_t cycles             = 0;
+    uint8_t  interrupt_pending[INTERRUPT_SOURCE_MAX]{};
 
-    uint8_t rom1[ROM1_SIZE]{};
-    uint8_t rom2[ROM2_SIZE]{};
-    uint8_t ram[RAM_SIZE]{};
-    uint8_t sram[SRAM_SIZE]{};
-    uint8_t nvram[NVRAM_SIZE]{};
-    uint8_t cardram[CARDRAM_SIZE]{};
+    bool is_mk1   = false; // false - SC-55mkII, SC-55ST.     true - SC-55, CM-300/SCC-1
+    bool is_cm300 = false; // false - SC-55,                  true - CM-300/SCC-1
+    bool is_st    = false; // false - SC-55mk2,               true - SC-55ST
+    bool is_jv880 = false; // false - SC-55,                  true - JV880
+    bool is_scb55 = false; // false - sub mcu (e.g SC-55mk2), true - no sub mcu (e.g SCB-55)
+    bool is_sc155 = false; // false - SC-55(MK2),             true - SC-155(MK2)
+
+    submcu_t* sm       = nullptr;
+    pcm_t* pcm         = nullptr;
+    mcu_timer_t* timer = nullptr;
+    lcd_t* lcd         = nullptr;
+
+    // Owned by the Emulator. Null unless stats are enabled.
+    EMU_Counters* stats = nullptr;
+    // Owned by the Emulator. Null unless the profiler is enabled.
+    EMU_Profiler* profiler = nullptr;
+
+    int rom2_mask = ROM2_SIZE - 1;
+
+    std::unique_ptr<mcu_memory_t> owned_memory;
+    mcu_memory_t* const memory;
+    uint8_t* const rom1    = memory->rom1;
+    uint8_t* const rom2    = memory->rom2;
+    uint8_t* const sram    = memory->sram;
+    uint8_t* const nvram   = memory->nvram;
+    uint8_t* const cardram = memory->cardram;
 
     uint8_t dev_register[0x80]{};
+    uint8_t ram[RAM_SIZE]{};
 
     uint16_t ad_val[4]{};
     uint8_t ad_nibble     = 0;
@@ -265,16 +344,14 @@ struct mcu_t {
     uint8_t io_sd         = 0;
     uint8_t rcu           = 0;
 
-    submcu_t* sm       = nullptr;
-    pcm_t* pcm         = nullptr;
-    mcu_timer_t* timer = nullptr;
-    lcd_t* lcd         = nullptr;
-
+    // uart_buffer is a ring written by MCU_PostUART, possibly from another thread, and read by the emulator through
+    // MCU_UART_HasByte/MCU_UART_ReadByte. One byte is always left unused so that a full ring can be told apart from an
+    // empty one.
     uint32_t uart_write_ptr = 0;
     uint32_t uart_read_ptr  = 0;
-    uint8_t uart_buffer[uart_buffer_size]{};
-    uint8_t uart_tx_buffer[uart_buffer_size]{};
-    uint8_t *uart_tx_ptr    = uart_tx_buffer;
+    uint8_t* const uart_buffer    = memory->uart_buffer;
+    uint8_t* const uart_tx_buffer = memory->uart_tx_buffer;
+    uint8_t *uart_tx_ptr          = uart_tx_buffer;
 
     uint8_t uart_rx_byte   = 0;
     uint64_t uart_rx_delay = 0;
@@ -287,15 +364,6 @@ struct mcu_t {
     Romset romset = Romset::MK2;
     MK1version revision = MK1version::NOT_MK1;
 
-    bool is_mk1   = false; // false - SC-55mkII, SC-55ST.     true - SC-55, CM-300/SCC-1
-    bool is_cm300 = false; // false - SC-55,                  true - CM-300/SCC-1
-    bool is_st    = false; // false - SC-55mk2,               true - SC-55ST
-    bool is_jv880 = false; // false - SC-55,                  true - JV880
-    bool is_scb55 = false; // false - sub mcu (e.g SC-55mk2), true - no sub mcu (e.g SCB-55)
-    bool is_sc155 = false; // false - SC-55(MK2),             true - SC-155(MK2)
-
-    int rom2_mask = ROM2_SIZE - 1;
-
     int ga_int[8]{};
     int ga_int_enable  = 0;
     int ga_int_trigger = 0;
@@ -312,17 +380,9 @@ struct mcu_t {
 
     int ssr_rd = 0;
 
-    uint32_t operand_type   = 0;
-    uint16_t operand_ea     = 0;
-    uint8_t operand_ep      = 0;
-    uint8_t operand_size    = 0;
-    uint8_t operand_reg     = 0;
-    uint8_t operand_status  = 0;
-    uint16_t operand_data   = 0;
-    uint8_t opcode_extended = 0;
-
     void* callback_userdata                 = nullptr;
     mcu_sample_callback sample_callback     = MCU_DefaultSampleCallback;
+    void* midiout_userdata                  = nullptr;
     mcu_midiout_callback midiout_callback   = MCU_DefaultMidiOutCallback;
 };
 
@@ -372,6 +432,17 @@ inline uint32_t MCU_GetPageForRegister(mcu_t& mcu, uint32_t reg)
     return mcu.dp;
 }
 
+// Computes the flags recorded by the last flag-setting instruction into sr. Called through MCU_SyncFlags.
+void MCU_EvaluateFlags(mcu_t& mcu);
+
+// Brings the N, Z, V and C bits of sr up to date. Must be called before reading them, and before modifying sr in a
+// way that keeps some of them.
+inline void MCU_SyncFlags(mcu_t& mcu)
+{
+    if (mcu.flags_op != LAZY_FLAGS_NONE)
+        MCU_EvaluateFlags(mcu);
+}
+
 inline void MCU_ControlRegisterWrite(mcu_t& mcu, uint32_t reg, uint32_t siz, uint32_t data)
 {
     if (siz)
@@ -380,6 +451,7 @@ inline void MCU_ControlRegisterWrite(mcu_t& mcu, uint32_t reg, uint32_t siz, uin
         {
             mcu.sr  = (uint16_t)data;
             mcu.sr &= sr_mask;
+            mcu.flags_op = LAZY_FLAGS_NONE;
         }
         else if (reg == 5) // FIXME: undocumented
         {
@@ -405,6 +477,7 @@ inline void MCU_ControlRegisterWrite(mcu_t& mcu, uint32_t reg, uint32_t siz, uin
             mcu.sr &= ~0xff;
             mcu.sr |= data & 0xff;
             mcu.sr &= sr_mask;
+            mcu.flags_op = LAZY_FLAGS_NONE;
         }
         else if (reg == 3)
         {
@@ -432,6 +505,7 @@ inline void MCU_ControlRegisterWrite(mcu_t& mcu, uint32_t reg, uint32_t siz, uin
 inline uint32_t MCU_ControlRegisterRead(mcu_t& mcu, uint32_t reg, uint32_t siz)
 {
     uint32_t ret = 0;
+    MCU_SyncFlags(mcu);
     if (siz)
     {
         if (reg == 0)
@@ -489,6 +563,7 @@ inline uint32_t MCU_ControlRegisterRead(mcu_t& mcu, uint32_t reg, uint32_t siz)
 
 inline void MCU_SetStatus(mcu_t& mcu, uint32_t condition, uint32_t mask)
 {
+    MCU_SyncFlags(mcu);
     if (condition)
         mcu.sr |= (uint16_t)mask;
     else
@@ -581,6 +656,27 @@ void MCU_RemoteControlTrigger(mcu_t& mcu, uint8_t data);
 void MCU_EncoderTrigger(mcu_t& mcu, int dir);
 
 void MCU_PostSample(mcu_t& mcu, const AudioFrame<int32_t>& frame);
+// Posts MIDI bytes to the UART receive buffer. Bytes that don't fit are dropped and counted in
+// EMU_Counters::uart_rx_dropped; use MCU_TryPostUART to find out how much was posted.
 void MCU_PostUART(mcu_t& mcu, uint8_t data);
+// Same as posting each byte of `data` in order, but copies whole runs at once.
+void MCU_PostUART(mcu_t& mcu, std::span<const uint8_t> data);
+// Posts as much of `data` as fits in the UART receive buffer and returns how many bytes were posted.
+size_t MCU_TryPostUART(mcu_t& mcu, std::span<const uint8_t> data);
+// Returns how many bytes the UART receive buffer can currently accept. Space only grows until the next post.
+size_t MCU_GetUARTWritable(mcu_t& mcu);
+
+inline bool MCU_UART_HasByte(mcu_t& mcu)
+{
+    return std::atomic_ref(mcu.uart_write_ptr).load(std::memory_order_acquire) != mcu.uart_read_ptr;
+}
+
+// Must only be called if MCU_UART_HasByte returned true.
+inline uint8_t MCU_UART_ReadByte(mcu_t& mcu)
+{
+    const uint8_t byte = mcu.uart_buffer[mcu.uart_read_ptr];
+    std::atomic_ref(mcu.uart_read_ptr).store((mcu.uart_read_ptr + 1) % uart_buffer_size, std::memory_order_release);
+    return byte;
+}
 
 void MCU_SetRomset(mcu_t& mcu, Romset romset);
@@ -33,11 +33,14 @@
  */
 #include "mcu_interrupt.h"
 #include "mcu.h"
+#include "emu_profiler.h"
+#include "emu_stats.h"
 
 void MCU_Interrupt_Start(mcu_t& mcu, int32_t mask)
 {
     MCU_PushStack(mcu, mcu.pc);
     MCU_PushStack(mcu, mcu.cp);
+    MCU_SyncFlags(mcu);
     MCU_PushStack(mcu, mcu.sr);
     mcu.sr &= ~STATUS_T;
     if (mask >= 0)
@@ -75,6 +78,8 @@ void MCU_Interrupt_StartVector(mcu_t& mcu, uint32_t vector, int32_t mask)
     MCU_Interrupt_Start(mcu, mask);
     mcu.cp = address >> 16;
     mcu.pc = address;
+    if (mcu.profiler)
+        mcu.profiler->mcu_stack.Call(EMU_CallStack::FRAME_INTERRUPT | address, mcu.r[7]);
 }
 
 void MCU_Interrupt_Handle(mcu_t& mcu)
@@ -102,6 +107,8 @@ void MCU_Interrupt_Handle(mcu_t& mcu)
         if (mcu.trapa_pending[i])
         {
             mcu.trapa_pending[i] = 0;
+            if (mcu.stats)
+                mcu.stats->traps.Add();
             MCU_Interrupt_StartVector(mcu, VECTOR_TRAPA_0 + i, -1);
             return;
         }
@@ -122,11 +129,15 @@ void MCU_Interrupt_Handle(mcu_t& mcu)
 
         }
         mcu.exception_pending = -1;
+        if (mcu.stats)
+            mcu.stats->traps.Add();
         return;
     }
     if (mcu.interrupt_pending[INTERRUPT_SOURCE_NMI])
     {
         // mcu.interrupt_pending[INTERRUPT_SOURCE_NMI] = 0;
+        if (mcu.stats)
+            mcu.stats->interrupts[INTERRUPT_SOURCE_NMI].Add();
         MCU_Interrupt_StartVector(mcu, VECTOR_NMI, 7);
         return;
     }
@@ -218,6 +229,8 @@ void MCU_Interrupt_Handle(mcu_t& mcu)
         if ((int32_t)mask < level)
         {
             // mcu.interrupt_pending[INTERRUPT_SOURCE_NMI] = 0;
+            if (mcu.stats)
+                mcu.stats->interrupts[i].Add();
             MCU_Interrupt_StartVector(mcu, vector, level);
             return;
         }
@@ -32,10 +32,26 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  */
 #include "mcu_opcodes.h"
+#include "emu_profiler.h"
 #include "mcu.h"
 #include "mcu_interrupt.h"
 
-int32_t MCU_SUB_Common(mcu_t& mcu, int32_t t1, int32_t t2, int32_t c_bit, uint32_t siz)
+// Called after a call instruction has pushed its return address and jumped.
+static inline void MCU_ProfileCall(mcu_t& mcu)
+{
+    if (mcu.profiler)
+        mcu.profiler->mcu_stack.Call(((uint32_t)mcu.cp << 16) | mcu.pc, mcu.r[7]);
+}
+
+// Called after a return instruction has popped its return address.
+static inline void MCU_ProfileReturn(mcu_t& mcu)
+{
+    if (mcu.profiler)
+        mcu.profiler->mcu_stack.Unwind(mcu.r[7]);
+}
+
+// Computes the N, Z, V and C flags of t1 + t2 + c_bit (or t1 - t2 - c_bit if `sub`) into sr.
+static void MCU_EvaluateAddSubFlags(mcu_t& mcu, int32_t t1, int32_t t2, int32_t c_bit, uint32_t siz, bool sub)
 {
     int32_t st1, st2;
     int32_t N, Z, C, V = 0;
@@ -45,16 +61,22 @@ int32_t MCU_SUB_Common(mcu_t& mcu, int32_t t1, int32_t t2, int32_t c_bit, uint32
         st2 = (int16_t)t2;
         t1  = (uint16_t)t1;
         t2  = (uint16_t)t2;
-        t1 -= t2;
-        t1 -= c_bit;
+        if (sub)
+        {
+            t1  -= t2 + c_bit;
+            st1 -= st2 + c_bit;
+        }
+        else
+        {
+            t1  += t2 + c_bit;
+            st1 += st2 + c_bit;
+        }
         C   = (t1 >> 16) & 1;
 
         t1 &= 0xffff;
         N   = (t1 & 0x8000) != 0;
         Z   = t1 == 0;
 
-        st1 -= st2;
-        st1 -= c_bit;
         if (st1 < INT16_MIN || st1 > INT16_MAX)
             V = 1;
     }
@@ -64,75 +86,72 @@ int32_t MCU_SUB_Common(mcu_t& mcu, int32_t t1, int32_t t2, int32_t c_bit, uint32
         st2 = (int8_t)t2;
         t1  = (uint8_t)t1;
         t2  = (uint8_t)t2;
-        t1 -= t2;
-        t1 -= c_bit;
+        if (sub)
+        {
+            t1  -= t2 + c_bit;
+            st1 -= st2 + c_bit;
+        }
+        else
+        {
+            t1  += t2 + c_bit;
+            st1 += st2 + c_bit;
+        }
         C   = (t1 >> 8) & 1;
 
         t1 &= 0xff;
         N   = (t1 & 0x80) != 0;
         Z   = t1 == 0;
 
-        st1 -= st2;
-        st1 -= c_bit;
         if (st1 < INT8_MIN || st1 > INT8_MAX)
             V = 1;
     }
-    MCU_SetStatus(mcu, N, STATUS_N);
-    MCU_SetStatus(mcu, Z, STATUS_Z);
-    MCU_SetStatus(mcu, C, STATUS_C);
-    MCU_SetStatus(mcu, V, STATUS_V);
 
-    return t1;
+    mcu.sr &= (uint16_t)~(STATUS_N | STATUS_Z | STATUS_V | STATUS_C);
+    mcu.sr |= (uint16_t)((N ? STATUS_N : 0) | (Z ? STATUS_Z : 0) | (V ? STATUS_V : 0) | (C ? STATUS_C : 0));
 }
 
-int32_t MCU_ADD_Common(mcu_t& mcu, int32_t t1, int32_t t2, int32_t c_bit, uint32_t siz)
+void MCU_EvaluateFlags(mcu_t& mcu)
 {
-    int32_t st1, st2;
-    int32_t N, Z, C, V = 0;
-    if (siz)
+    switch (mcu.flags_op)
     {
-        st1 = (int16_t)t1;
-        st2 = (int16_t)t2;
-        t1  = (uint16_t)t1;
-        t2  = (uint16_t)t2;
-        t1 += t2;
-        t1 += c_bit;
-        C   = (t1 >> 16) & 1;
-
-        t1 &= 0xffff;
-        N   = (t1 & 0x8000) != 0;
-        Z   = t1 == 0;
-
-        st1 += st2;
-        st1 += c_bit;
-        if (st1 < INT16_MIN || st1 > INT16_MAX)
-            V = 1;
-    }
-    else
+    case LAZY_FLAGS_LOGIC:
     {
-        st1 = (int8_t)t1;
-        st2 = (int8_t)t2;
-        t1  = (uint8_t)t1;
-        t2  = (uint8_t)t2;
-        t1 += t2;
-        t1 += c_bit;
-        C   = (t1 >> 8) & 1;
+        const uint32_t val = mcu.flags_siz ? (mcu.flags_t1 & 0xffff) : (mcu.flags_t1 & 0xff);
+        const uint32_t N   = mcu.flags_siz ? (val & 0x8000) : (val & 0x80);
+        mcu.sr &= (uint16_t)~(STATUS_N | STATUS_Z | STATUS_V);
+        mcu.sr |= (uint16_t)((N ? STATUS_N : 0) | (val == 0 ? STATUS_Z : 0));
+        break;
+    }
+    case LAZY_FLAGS_ADD:
+        MCU_EvaluateAddSubFlags(mcu, mcu.flags_t1, mcu.flags_t2, mcu.flags_c, mcu.flags_siz, false);
+        break;
+    case LAZY_FLAGS_SUB:
+        MCU_EvaluateAddSubFlags(mcu, mcu.flags_t1, mcu.flags_t2, mcu.flags_c, mcu.flags_siz, true);
+        break;
+    }
+    mcu.flags_op = LAZY_FLAGS_NONE;
+}
 
-        t1 &= 0xff;
-        N   = (t1 & 0x80) != 0;
-        Z   = t1 == 0;
+int32_t MCU_SUB_Common(mcu_t& mcu, int32_t t1, int32_t t2, int32_t c_bit, uint32_t siz)
+{
+    mcu.flags_op  = LAZY_FLAGS_SUB;
+    mcu.flags_t1  = t1;
+    mcu.flags_t2  = t2;
+    mcu.flags_c   = (uint8_t)c_bit;
+    mcu.flags_siz = (uint8_t)siz;
 
-        st1 += st2;
-        st1 += c_bit;
-        if (st1 < INT8_MIN || st1 > INT8_MAX)
-            V = 1;
-    }
-    MCU_SetStatus(mcu, N, STATUS_N);
-    MCU_SetStatus(mcu, Z, STATUS_Z);
-    MCU_SetStatus(mcu, C, STATUS_C);
-    MCU_SetStatus(mcu, V, STATUS_V);
+    return (t1 - t2 - c_bit) & (siz ? 0xffff : 0xff);
+}
 
-    return t1;
+int32_t MCU_ADD_Common(mcu_t& mcu, int32_t t1, int32_t t2, int32_t c_bit, uint32_t siz)
+{
+    mcu.flags_op  = LAZY_FLAGS_ADD;
+    mcu.flags_t1  = t1;
+    mcu.flags_t2  = t2;
+    mcu.flags_c   = (uint8_t)c_bit;
+    mcu.flags_siz = (uint8_t)siz;
+
+    return (t1 + t2 + c_bit) & (siz ? 0xffff : 0xff);
 }
 
 void MCU_Operand_Nop(mcu_t& mcu, uint8_t operand)
@@ -235,6 +254,7 @@ void MCU_Jump_PJSR(mcu_t& mcu, uint8_t operand)
     if (mcu.cp == 0x27)
         mcu.cp += 0;
     mcu.pc = address;
+    MCU_ProfileCall(mcu);
 }
 
 void MCU_Jump_JSR(mcu_t& mcu, uint8_t operand)
@@ -245,15 +265,18 @@ void MCU_Jump_JSR(mcu_t& mcu, uint8_t operand)
     address |= MCU_ReadCodeAdvance(mcu);
     MCU_PushStack(mcu, mcu.pc);
     mcu.pc = address;
+    MCU_ProfileCall(mcu);
 }
 
 void MCU_Jump_RTE(mcu_t& mcu, uint8_t operand)
 {
     (void)operand;
     mcu.sr = MCU_PopStack(mcu);
+    mcu.flags_op = LAZY_FLAGS_NONE;
     mcu.cp = (uint8_t)MCU_PopStack(mcu);
     mcu.pc = MCU_PopStack(mcu);
     mcu.ex_ignore = 1;
+    MCU_ProfileReturn(mcu);
 }   
 
 void MCU_Jump_Bcc(mcu_t& mcu, uint8_t operand)
@@ -273,6 +296,7 @@ void MCU_Jump_Bcc(mcu_t& mcu, uint8_t operand)
     }
     cond = operand & 0x0f;
 
+    MCU_SyncFlags(mcu);
     N = (mcu.sr & STATUS_N) != 0;
     C = (mcu.sr & STATUS_C) != 0;
     Z = (mcu.sr & STATUS_Z) != 0;
@@ -340,6 +364,7 @@ void MCU_Jump_RTS(mcu_t& mcu, uint8_t operand)
 {
     (void)operand;
     mcu.pc = MCU_PopStack(mcu);
+    MCU_ProfileReturn(mcu);
 }
 
 void MCU_Jump_RTD(mcu_t& mcu, uint8_t operand)
@@ -362,6 +387,7 @@ void MCU_Jump_RTD(mcu_t& mcu, uint8_t operand)
     {
         MCU_ErrorTrap(mcu);
     }
+    MCU_ProfileReturn(mcu);
 }
 
 void MCU_Jump_JMP(mcu_t& mcu, uint8_t operand)
@@ -375,6 +401,7 @@ void MCU_Jump_JMP(mcu_t& mcu, uint8_t operand)
         {
             mcu.cp = (uint8_t)MCU_PopStack(mcu);
             mcu.pc = MCU_PopStack(mcu);
+            MCU_ProfileReturn(mcu);
         }
         else if (opcode_h == 0x19)
         {
@@ -383,6 +410,7 @@ void MCU_Jump_JMP(mcu_t& mcu, uint8_t operand)
             opcode_l &= ~1;
             mcu.cp    = mcu.r[opcode_l] & 0xff;
             mcu.pc    = mcu.r[opcode_l + 1];
+            MCU_ProfileCall(mcu);
         }
         else if (opcode_h == 0x1a)
         {
@@ -392,6 +420,7 @@ void MCU_Jump_JMP(mcu_t& mcu, uint8_t operand)
         {
             MCU_PushStack(mcu, mcu.pc);
             mcu.pc = mcu.r[opcode_l];
+            MCU_ProfileCall(mcu);
         }
         else
         {
@@ -432,6 +461,7 @@ void MCU_Jump_JMP(mcu_t& mcu, uint8_t operand)
         if (opcode == 0x17)
         {
             uint16_t disp = (int8_t)MCU_ReadCodeAdvance(mcu);
+            MCU_SyncFlags(mcu);
             uint32_t Z    = (mcu.sr & STATUS_Z) != 0;
             if (Z)
             {
@@ -455,6 +485,7 @@ void MCU_Jump_JMP(mcu_t& mcu, uint8_t operand)
         if (opcode == 0x17)
         {
             uint16_t disp = (int8_t)MCU_ReadCodeAdvance(mcu);
+            MCU_SyncFlags(mcu);
             uint32_t Z    = (mcu.sr & STATUS_Z) != 0;
             if (!Z)
             {
@@ -490,6 +521,7 @@ void MCU_Jump_BSR(mcu_t& mcu, uint8_t operand)
     }
     MCU_PushStack(mcu, mcu.pc);
     mcu.pc += disp;
+    MCU_ProfileCall(mcu);
 }
 
 void MCU_Jump_PJMP(mcu_t& mcu, uint8_t operand)
@@ -696,16 +728,12 @@ void MCU_Operand_General(mcu_t& mcu, uint8_t operand)
 
 void MCU_SetStatusCommon(mcu_t& mcu, uint32_t val, uint32_t siz)
 {
-    if (siz)
-        val &= 0xffff;
-    else
-        val &= 0xff;
-    if (siz)
-        MCU_SetStatus(mcu, val & 0x8000, STATUS_N);
-    else
-        MCU_SetStatus(mcu, val & 0x80, STATUS_N);
-    MCU_SetStatus(mcu, val == 0, STATUS_Z);
-    MCU_SetStatus(mcu, 0, STATUS_V);
+    // C is kept, so a pending addition or subtraction has to produce it first.
+    if (mcu.flags_op == LAZY_FLAGS_ADD || mcu.flags_op == LAZY_FLAGS_SUB)
+        MCU_EvaluateFlags(mcu);
+    mcu.flags_op  = LAZY_FLAGS_LOGIC;
+    mcu.flags_t1  = (int32_t)val;
+    mcu.flags_siz = (uint8_t)siz;
 }
 
 void MCU_Opcode_Short_NotImplemented(mcu_t& mcu, uint8_t opcode)
@@ -1283,6 +1311,7 @@ void MCU_Opcode_SHLR(mcu_t& mcu, uint8_t opcode, uint8_t opcode_reg)
     else if (opcode_reg == 0x06 && mcu.operand_type != GENERAL_IMMEDIATE) // ROTXL
     {
         uint32_t data = MCU_Operand_Read(mcu);
+        MCU_SyncFlags(mcu);
         uint32_t bit  = (mcu.sr & STATUS_C) != 0;
         uint32_t C;
         if (mcu.operand_size)
@@ -1480,6 +1509,7 @@ void MCU_Opcode_ADDX(mcu_t& mcu, uint8_t opcode, uint8_t opcode_reg)
     (void)opcode;
     int32_t t1 = mcu.r[opcode_reg];
     int32_t t2 = MCU_Operand_Read(mcu);
+    MCU_SyncFlags(mcu);
     int32_t C  = (mcu.sr & STATUS_C) != 0;
     int32_t Z  = (mcu.sr & STATUS_Z) != 0;
     t1 = MCU_ADD_Common(mcu, t1, t2, C, mcu.operand_size);
@@ -1500,6 +1530,7 @@ void MCU_Opcode_SUBX(mcu_t& mcu, uint8_t opcode, uint8_t opcode_reg)
     (void)opcode;
     int32_t t1 = mcu.r[opcode_reg];
     int32_t t2 = MCU_Operand_Read(mcu);
+    MCU_SyncFlags(mcu);
     int32_t C  = (mcu.sr & STATUS_C) != 0;
     t1 = MCU_SUB_Common(mcu, t1, t2, C, mcu.operand_size);
     if (mcu.operand_size)
@@ -39,3 +39,9 @@ struct mcu_t;
 
 extern void (*MCU_Operand_Table[256])(mcu_t& mcu, uint8_t operand);
 extern void (*MCU_Opcode_Table[32])(mcu_t& mcu, uint8_t opcode, uint8_t opcode_reg);
+
+// Flag-setting helpers shared by the opcode handlers. They record their operands for MCU_SyncFlags instead of
+// updating sr.
+int32_t MCU_ADD_Common(mcu_t& mcu, int32_t t1, int32_t t2, int32_t c_bit, uint32_t siz);
+int32_t MCU_SUB_Common(mcu_t& mcu, int32_t t1, int32_t t2, int32_t c_bit, uint32_t siz);
+void MCU_SetStatusCommon(mcu_t& mcu, uint32_t val, uint32_t siz);
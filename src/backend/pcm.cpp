@@ -34,6 +34,8 @@
 #include "pcm.h"
 #include "mcu.h"
 #include "mcu_interrupt.h"
+#include "emu_stats.h"
+#include <bit>
 #include <cstdint>
 #include <cstdio>
 #include <cstring>
@@ -265,9 +267,19 @@ uint8_t PCM_Read(pcm_t& pcm, uint32_t address)
     return 0;
 }
 
+// Stands in for missing waveroms. Not const so that it lands in .bss instead of taking up 8 MB of the binary; nothing
+// writes to it.
+static uint8_t pcm_empty_waverom[0x800000]{};
+
 void PCM_Init(pcm_t& pcm, mcu_t& mcu)
 {
     pcm.mcu = &mcu;
+
+    pcm.waverom1     = pcm_empty_waverom;
+    pcm.waverom2     = pcm_empty_waverom;
+    pcm.waverom3     = pcm_empty_waverom;
+    pcm.waverom_card = pcm_empty_waverom;
+    pcm.waverom_exp  = pcm_empty_waverom;
 }
 
 // Sign-extends a 20-bit signed integer to a 32-bit signed integer.
@@ -585,9 +597,20 @@ void PCM_GetConfig(PCM_Config& config, uint8_t config_byte)
 
 void PCM_Update(pcm_t& pcm, uint64_t cycles)
 {
+    EMU_Counters* stats = pcm.mcu->stats;
+
     while (pcm.cycles < cycles)
     {
         const int voice_active = pcm.voice_mask & pcm.voice_mask_pending;
+
+        if (stats)
+        {
+            const int voices = std::popcount((uint32_t)voice_active);
+            stats->pcm_ticks.Add();
+            stats->voice_ticks.Add((uint64_t)voices);
+            stats->peak_voices.Max((uint64_t)voices);
+        }
+
         { // final mixing
             int shifter = pcm.ram2[30][10];
             int xr  = ((shifter >> 0) ^ (shifter >> 1) ^ (shifter >> 7) ^ (shifter >> 12)) & 1;
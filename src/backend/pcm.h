@@ -82,11 +82,13 @@ struct pcm_t {
 
     mcu_t* mcu = nullptr;
 
-    uint8_t waverom1[0x200000]{};
-    uint8_t waverom2[0x200000]{};
-    uint8_t waverom3[0x100000]{};
-    uint8_t waverom_card[0x200000]{};
-    uint8_t waverom_exp[0x800000]{};
+    // Waverom images, each GetWaveromCapacity bytes long. They are owned by whoever loaded the roms (usually a mapping
+    // of the unscrambled waverom cache); PCM_Init points them at a shared block of zeros.
+    const uint8_t* waverom1     = nullptr;
+    const uint8_t* waverom2     = nullptr;
+    const uint8_t* waverom3     = nullptr;
+    const uint8_t* waverom_card = nullptr;
+    const uint8_t* waverom_exp  = nullptr;
 
     bool disable_oversampling = false;
 };
@@ -0,0 +1,160 @@
+#include "resampler.h"
+
+#include "math_util.h"
+#include <algorithm>
+#include <cmath>
+
+// Number of sinc zero crossings on each side of the filter center. Controls the transition band width.
+static constexpr double RESAMPLER_ZERO_CROSSINGS = 16.0;
+// Kaiser window shape. 9 gives roughly 90 dB of stopband attenuation.
+static constexpr double RESAMPLER_KAISER_BETA = 9.0;
+// Passband edge as a fraction of the lower of the two Nyquist frequencies. Leaves room for the transition band so that
+// content above the output Nyquist frequency is attenuated instead of aliased.
+static constexpr double RESAMPLER_CUTOFF = 0.92;
+
+static constexpr double RESAMPLER_PI = 3.14159265358979323846;
+
+// Zeroth order modified Bessel function of the first kind.
+static double Resampler_BesselI0(double x)
+{
+    double sum  = 1.0;
+    double term = 1.0;
+    for (int k = 1; k < 64; ++k)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+        if (term < sum * 1e-12)
+        {
+            break;
+        }
+    }
+    return sum;
+}
+
+bool AudioResampler::Init(uint32_t input_rate, uint32_t output_rate)
+{
+    if (input_rate == 0 || output_rate == 0)
+    {
+        return false;
+    }
+
+    m_input_rate  = input_rate;
+    m_output_rate = output_rate;
+    m_step_int    = input_rate / output_rate;
+    m_step_frac   = input_rate % output_rate;
+
+    // Cutoff in cycles per input frame. When downsampling the filter must also remove everything above the output
+    // Nyquist frequency.
+    const double ratio  = std::min(1.0, (double)output_rate / (double)input_rate);
+    const double cutoff = 0.5 * RESAMPLER_CUTOFF * ratio;
+
+    // Half-width of the filter in input frames. Rounded up so that the tap count is a multiple of 4 for SIMD.
+    const double half_width = RESAMPLER_ZERO_CROSSINGS / (2.0 * cutoff);
+    m_taps                  = ((size_t)std::ceil(half_width) * 2 + 3) & ~(size_t)3;
+
+    const double half_taps   = (double)(m_taps / 2);
+    const double i0_beta_rec = 1.0 / Resampler_BesselI0(RESAMPLER_KAISER_BETA);
+
+    m_table.resize((PHASES + 1) * m_taps);
+    for (size_t phase = 0; phase <= PHASES; ++phase)
+    {
+        float* row = &m_table[phase * m_taps];
+
+        // Tap `j` is applied to the input frame this far before the output position.
+        const double offset = half_taps - 1.0 + (double)phase / (double)PHASES;
+
+        double sum = 0.0;
+        for (size_t j = 0; j < m_taps; ++j)
+        {
+            const double u = offset - (double)j;
+            const double x = 2.0 * cutoff * u;
+            const double sinc = x == 0.0 ? 1.0 : std::sin(RESAMPLER_PI * x) / (RESAMPLER_PI * x);
+
+            const double w = u / half_taps;
+            const double window =
+                std::abs(w) >= 1.0 ? 0.0 : Resampler_BesselI0(RESAMPLER_KAISER_BETA * std::sqrt(1.0 - w * w)) * i0_beta_rec;
+
+            const double h = 2.0 * cutoff * sinc * window;
+            row[j]         = (float)h;
+            sum += h;
+        }
+
+        // Normalize for unity gain at DC so that phase interpolation can't introduce ripple on constant signals.
+        for (size_t j = 0; j < m_taps; ++j)
+        {
+            row[j] = (float)(row[j] / sum);
+        }
+    }
+
+    Reset();
+
+    return true;
+}
+
+void AudioResampler::Reset()
+{
+    // Pad with silence so that the first output frame is centered on the first input frame.
+    for (auto& history : m_history)
+    {
+        history.assign(m_taps / 2 - 1, 0.0f);
+    }
+    m_pos  = 0;
+    m_frac = 0;
+}
+
+void AudioResampler::Process(std::span<const AudioFrame<float>> in, std::vector<AudioFrame<float>>& out)
+{
+    std::vector<float>& left  = m_history[0];
+    std::vector<float>& right = m_history[1];
+
+    const size_t old_size = left.size();
+    left.resize(old_size + in.size());
+    right.resize(old_size + in.size());
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        left[old_size + i]  = in[i].left;
+        right[old_size + i] = in[i].right;
+    }
+
+    const size_t available = left.size();
+    while (m_pos + m_taps <= available)
+    {
+        // Position between two adjacent phases. 64 bits because m_frac * PHASES can exceed 32 bits.
+        const uint64_t scaled = (uint64_t)m_frac * PHASES;
+        const size_t   phase  = (size_t)(scaled / m_output_rate);
+        const float    t      = (float)(scaled % m_output_rate) / (float)m_output_rate;
+
+        const float* h0 = Phase(phase);
+        const float* h1 = Phase(phase + 1);
+
+        const float l0 = DotProductF32(&left[m_pos], h0, m_taps);
+        const float l1 = DotProductF32(&left[m_pos], h1, m_taps);
+        const float r0 = DotProductF32(&right[m_pos], h0, m_taps);
+        const float r1 = DotProductF32(&right[m_pos], h1, m_taps);
+
+        out.push_back(AudioFrame<float>{
+            .left  = l0 + (l1 - l0) * t,
+            .right = r0 + (r1 - r0) * t,
+        });
+
+        m_pos += m_step_int;
+        m_frac += m_step_frac;
+        if (m_frac >= m_output_rate)
+        {
+            m_frac -= m_output_rate;
+            ++m_pos;
+        }
+    }
+
+    // Drop input that no future output frame will touch.
+    const size_t consumed = std::min(m_pos, available);
+    left.erase(left.begin(), left.begin() + (ptrdiff_t)consumed);
+    right.erase(right.begin(), right.begin() + (ptrdiff_t)consumed);
+    m_pos -= consumed;
+}
+
+void AudioResampler::Flush(std::vector<AudioFrame<float>>& out)
+{
+    const std::vector<AudioFrame<float>> silence(m_taps / 2, AudioFrame<float>{});
+    Process(silence, out);
+}
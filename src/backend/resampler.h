@@ -0,0 +1,74 @@
+#pragma once
+
+#include "audio.h"
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+// Stereo sample rate converter using a polyphase Kaiser-windowed sinc filter. The position of each output frame is
+// tracked as an exact rational number of input frames, so there is no drift over long streams. Filter coefficients for
+// positions between two precomputed phases are linearly interpolated.
+//
+// The filter is centered on each output position, so output frame `n` corresponds to input time `n * in / out`. The
+// last few input frames are held back until enough input follows them; call Flush at the end of a stream to drain
+// them.
+class AudioResampler
+{
+public:
+    // Prepares to convert from `input_rate` to `output_rate`. Discards any buffered input. Returns false if either rate
+    // is zero.
+    bool Init(uint32_t input_rate, uint32_t output_rate);
+
+    // Discards buffered input without changing the rates.
+    void Reset();
+
+    // Consumes all of `in` and appends as many output frames as can be computed to `out`.
+    void Process(std::span<const AudioFrame<float>> in, std::vector<AudioFrame<float>>& out);
+
+    // Pads the input with silence so that every output frame covering real input is appended to `out`.
+    void Flush(std::vector<AudioFrame<float>>& out);
+
+    uint32_t GetInputRate() const
+    {
+        return m_input_rate;
+    }
+
+    uint32_t GetOutputRate() const
+    {
+        return m_output_rate;
+    }
+
+    // Number of taps in each filter phase.
+    size_t GetTapCount() const
+    {
+        return m_taps;
+    }
+
+private:
+    // Number of precomputed filter phases per input frame.
+    static constexpr size_t PHASES = 256;
+
+    const float* Phase(size_t phase) const
+    {
+        return &m_table[phase * m_taps];
+    }
+
+    uint32_t m_input_rate  = 0;
+    uint32_t m_output_rate = 0;
+
+    // The input advances by `m_step_int + m_step_frac / m_output_rate` frames per output frame.
+    uint32_t m_step_int  = 0;
+    uint32_t m_step_frac = 0;
+
+    size_t m_taps = 0;
+
+    // (PHASES + 1) rows of `m_taps` coefficients. The extra row lets phase interpolation read one row past the last.
+    std::vector<float> m_table;
+
+    // Deinterleaved input not yet fully consumed. The first `m_taps` frames starting at `m_pos` are the filter input
+    // for the next output frame, which lies `m_frac / m_output_rate` frames after the filter center.
+    std::vector<float> m_history[AudioFrame<float>::channel_count];
+    size_t             m_pos  = 0;
+    uint32_t           m_frac = 0;
+};
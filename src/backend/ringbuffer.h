@@ -35,6 +35,8 @@
 
 #include <atomic>
 #include <cassert>
+#include <cstdint>
+#include <cstring>
 #include <memory>
 #include <span>
 
@@ -134,31 +136,35 @@ public:
 
     RingbufferView(const RingbufferView& rhs)
     {
-        m_read_head  = rhs.m_read_head.load();
-        m_write_head = rhs.m_write_head.load();
-        m_buffer     = rhs.m_buffer;
+        m_read_head   = rhs.m_read_head.load();
+        m_write_head  = rhs.m_write_head.load();
+        m_read_signal = rhs.m_read_signal.load();
+        m_buffer      = rhs.m_buffer;
     }
 
     RingbufferView& operator=(const RingbufferView& rhs)
     {
-        m_read_head  = rhs.m_read_head.load();
-        m_write_head = rhs.m_write_head.load();
-        m_buffer     = rhs.m_buffer;
+        m_read_head   = rhs.m_read_head.load();
+        m_write_head  = rhs.m_write_head.load();
+        m_read_signal = rhs.m_read_signal.load();
+        m_buffer      = rhs.m_buffer;
         return *this;
     }
 
     RingbufferView(RingbufferView&& rhs) noexcept
     {
-        m_read_head  = rhs.m_read_head.load();
-        m_write_head = rhs.m_write_head.load();
-        m_buffer     = rhs.m_buffer;
+        m_read_head   = rhs.m_read_head.load();
+        m_write_head  = rhs.m_write_head.load();
+        m_read_signal = rhs.m_read_signal.load();
+        m_buffer      = rhs.m_buffer;
     }
 
     RingbufferView& operator=(RingbufferView&& rhs) noexcept
     {
-        m_read_head  = rhs.m_read_head.load();
-        m_write_head = rhs.m_write_head.load();
-        m_buffer     = rhs.m_buffer;
+        m_read_head   = rhs.m_read_head.load();
+        m_write_head  = rhs.m_write_head.load();
+        m_read_signal = rhs.m_read_signal.load();
+        m_buffer      = rhs.m_buffer;
         return *this;
     }
 
@@ -214,6 +220,35 @@ public:
         m_read_head = Mask2(m_read_head + count * sizeof(ElemT));
     }
 
+    // Like UncheckedPrepareRead, but `count` is not required to line up with prior writes. If the read wraps around
+    // the end of the buffer, the elements are split across `first` and `second`; otherwise `second` is empty. Complete
+    // the read with UncheckedFinishReadAny.
+    template <typename ElemT>
+    void UncheckedPrepareReadAny(size_t count, std::span<ElemT>& first, std::span<ElemT>& second)
+    {
+        // elements must not straddle the end of the buffer
+        assert(m_buffer.size() % sizeof(ElemT) == 0);
+        // must have `count` elements
+        assert(GetReadableElements<ElemT>() >= count);
+        const size_t until_end = (m_buffer.size() - Mask(m_read_head)) / sizeof(ElemT);
+        if (count <= until_end)
+        {
+            first  = {(ElemT*)GetReadPtr(), count};
+            second = {};
+        }
+        else
+        {
+            first  = {(ElemT*)GetReadPtr(), until_end};
+            second = {(ElemT*)m_buffer.data(), count - until_end};
+        }
+    }
+
+    template <typename ElemT>
+    void UncheckedFinishReadAny(size_t count)
+    {
+        m_read_head = Mask2(m_read_head + count * sizeof(ElemT));
+    }
+
     size_t GetReadableBytes() const
     {
         return Mask(m_write_head - m_read_head);
@@ -224,6 +259,28 @@ public:
         return m_buffer.size() - GetReadableBytes();
     }
 
+    // Called by the reader after finishing one or more reads to wake a writer blocked in `WaitForReadableBelow`. Can
+    // also be called from any other thread to interrupt such a wait, e.g. on shutdown.
+    void NotifyRead()
+    {
+        m_read_signal.fetch_add(1, std::memory_order_release);
+        m_read_signal.notify_all();
+    }
+
+    // Blocks the writer until fewer than `byte_count` bytes are readable. The wait ends on the next `NotifyRead`, so
+    // this returns false if the buffer is still too full at that point and the caller should check again.
+    bool WaitForReadableBelow(size_t byte_count)
+    {
+        // Load the signal before checking the heads so that a read finishing in between is never missed.
+        const uint32_t signal = m_read_signal.load(std::memory_order_acquire);
+        if (GetReadableBytes() < byte_count)
+        {
+            return true;
+        }
+        m_read_signal.wait(signal, std::memory_order_acquire);
+        return GetReadableBytes() < byte_count;
+    }
+
     template <typename ElemT>
     size_t GetReadableElements() const
     {
@@ -261,4 +318,6 @@ private:
     std::span<uint8_t>  m_buffer;
     std::atomic<size_t> m_read_head  = 0;
     std::atomic<size_t> m_write_head = 0;
+    // Incremented by `NotifyRead`; writers wait on this rather than spinning on `m_read_head`.
+    std::atomic<uint32_t> m_read_signal = 0;
 };
@@ -62,6 +62,23 @@ bool IsWaverom(RomLocation location)
     }
 }
 
+size_t GetWaveromCapacity(RomLocation location)
+{
+    switch (location)
+    {
+    case RomLocation::WAVEROM1:
+    case RomLocation::WAVEROM2:
+    case RomLocation::WAVEROM_CARD:
+        return 0x200000;
+    case RomLocation::WAVEROM3:
+        return 0x100000;
+    case RomLocation::WAVEROM_EXP:
+        return 0x800000;
+    default:
+        return 0;
+    }
+}
+
 const char* ToCString(RomLocation location)
 {
     switch (location)
@@ -52,4 +52,8 @@ using RomLocationSet = std::array<bool, ROMLOCATION_COUNT>;
 // Returns true if `location` represents a waverom location.
 bool IsWaverom(RomLocation location);
 
+// Returns the number of bytes the PCM chip can address in the slot for waverom `location`, or 0 if `location` isn't a
+// waverom. Waverom images are zero-padded to this size so that the PCM never reads past the end of a smaller rom.
+size_t GetWaveromCapacity(RomLocation location);
+
 bool IsOptionalRom(Romset romset, RomLocation location);
@@ -0,0 +1,262 @@
+#include "rom_index.h"
+
+#include <charconv>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <string>
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+#endif
+
+// First line of the index file. Bump the version if the format or stamp semantics change; old files are then ignored.
+static constexpr const char* ROM_INDEX_HEADER = "nuked-sc55-rom-index 1";
+
+bool GetRomFileStamp(const std::filesystem::path& path, RomFileStamp& out_stamp)
+{
+    std::error_code ec;
+
+    out_stamp.size = std::filesystem::file_size(path, ec);
+    if (ec)
+    {
+        return false;
+    }
+
+    const auto mtime = std::filesystem::last_write_time(path, ec);
+    if (ec)
+    {
+        return false;
+    }
+    out_stamp.mtime = (int64_t)mtime.time_since_epoch().count();
+
+#if !defined(_WIN32)
+    struct stat st;
+    if (stat(path.c_str(), &st) != 0)
+    {
+        return false;
+    }
+    out_stamp.inode = (uint64_t)st.st_ino;
+#else
+    out_stamp.inode = 0;
+#endif
+
+    return true;
+}
+
+std::string RomHashIndex::Key(const std::filesystem::path& file)
+{
+    std::error_code ec;
+    std::filesystem::path absolute = std::filesystem::absolute(file, ec);
+    if (ec)
+    {
+        absolute = file;
+    }
+    const std::u8string str = absolute.lexically_normal().generic_u8string();
+    return std::string(str.begin(), str.end());
+}
+
+static bool RomIndex_ParseHex(std::string_view hex, SHA256Digest& out_digest)
+{
+    if (hex.size() != out_digest.size() * 2)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < out_digest.size(); ++i)
+    {
+        const char* first = hex.data() + 2 * i;
+        if (std::from_chars(first, first + 2, out_digest[i], 16).ptr != first + 2)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+template <typename T>
+static bool RomIndex_ParseField(std::string_view& line, T& out_value)
+{
+    const size_t space = line.find(' ');
+    if (space == std::string_view::npos)
+    {
+        return false;
+    }
+    const auto result = std::from_chars(line.data(), line.data() + space, out_value);
+    if (result.ec != std::errc{} || result.ptr != line.data() + space)
+    {
+        return false;
+    }
+    line.remove_prefix(space + 1);
+    return true;
+}
+
+bool RomHashIndex::Load(const std::filesystem::path& path)
+{
+    m_entries.clear();
+    m_dirty = false;
+
+    std::ifstream input(path, std::ios::binary);
+    if (!input)
+    {
+        return true;
+    }
+
+    std::string line;
+    if (!std::getline(input, line) || line != ROM_INDEX_HEADER)
+    {
+        // Either corrupt or written by an incompatible version. It will be rewritten on the next save.
+        m_dirty = true;
+        return false;
+    }
+
+    while (std::getline(input, line))
+    {
+        // <digest> <size> <mtime> <inode> <path>
+        std::string_view rest = line;
+
+        Entry entry;
+        if (rest.size() < 65 || rest[64] != ' ' || !RomIndex_ParseHex(rest.substr(0, 64), entry.digest))
+        {
+            m_entries.clear();
+            m_dirty = true;
+            return false;
+        }
+        rest.remove_prefix(65);
+
+        if (!RomIndex_ParseField(rest, entry.stamp.size) || !RomIndex_ParseField(rest, entry.stamp.mtime) ||
+            !RomIndex_ParseField(rest, entry.stamp.inode) || rest.empty())
+        {
+            m_entries.clear();
+            m_dirty = true;
+            return false;
+        }
+
+        m_entries.emplace(std::string(rest), entry);
+    }
+
+    return true;
+}
+
+bool RomHashIndex::Save(const std::filesystem::path& path)
+{
+    if (!m_dirty)
+    {
+        return true;
+    }
+
+    std::error_code ec;
+    if (path.has_parent_path())
+    {
+        std::filesystem::create_directories(path.parent_path(), ec);
+        if (ec)
+        {
+            return false;
+        }
+    }
+
+    // Write to a temporary file and rename it over the old one so that a concurrent reader never sees a partial index.
+    // The temporary name is unique per process so that two processes saving at once don't write into the same file.
+    std::filesystem::path temp_path = path;
+    temp_path += ".tmp" + std::to_string(std::random_device{}());
+
+    {
+        std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+        if (!output)
+        {
+            return false;
+        }
+
+        output << ROM_INDEX_HEADER << '\n';
+
+        for (const auto& [key, entry] : m_entries)
+        {
+            if (key.find('\n') != std::string::npos)
+            {
+                // can't be represented in this format; the file will just be hashed every time
+                continue;
+            }
+
+            char hex[65];
+            for (size_t i = 0; i < entry.digest.size(); ++i)
+            {
+                snprintf(&hex[2 * i], 3, "%02x", entry.digest[i]);
+            }
+
+            output << hex << ' ' << entry.stamp.size << ' ' << entry.stamp.mtime << ' ' << entry.stamp.inode << ' '
+                   << key << '\n';
+        }
+
+        if (!output.good())
+        {
+            output.close();
+            std::filesystem::remove(temp_path, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp_path, path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    m_dirty = false;
+    return true;
+}
+
+const SHA256Digest* RomHashIndex::Find(const std::filesystem::path& file, const RomFileStamp& stamp)
+{
+    auto it = m_entries.find(Key(file));
+    if (it == m_entries.end())
+    {
+        return nullptr;
+    }
+
+    it->second.seen = true;
+
+    if (it->second.stamp != stamp)
+    {
+        return nullptr;
+    }
+
+    return &it->second.digest;
+}
+
+void RomHashIndex::Insert(const std::filesystem::path& file, const RomFileStamp& stamp, const SHA256Digest& digest)
+{
+    m_entries[Key(file)] = Entry{.stamp = stamp, .digest = digest, .seen = true};
+    m_dirty              = true;
+}
+
+void RomHashIndex::PruneUnseen(const std::filesystem::path& directory)
+{
+    std::string prefix = Key(directory);
+    if (prefix.empty() || prefix.back() != '/')
+    {
+        prefix += '/';
+    }
+
+    for (auto it = m_entries.begin(); it != m_entries.end();)
+    {
+        const std::string& key = it->first;
+
+        const bool in_directory =
+            key.starts_with(prefix) && key.find('/', prefix.size()) == std::string::npos;
+
+        if (in_directory && !it->second.seen)
+        {
+            it      = m_entries.erase(it);
+            m_dirty = true;
+        }
+        else
+        {
+            if (in_directory)
+            {
+                // start over for the next scan of this directory
+                it->second.seen = false;
+            }
+            ++it;
+        }
+    }
+}
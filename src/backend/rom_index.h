@@ -0,0 +1,63 @@
+#pragma once
+
+#include "sha256.h"
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <unordered_map>
+
+// Identifies the contents of a file without reading it. If any field differs from a previous stamp, the file is assumed
+// to have changed.
+struct RomFileStamp
+{
+    uintmax_t size  = 0;
+    int64_t   mtime = 0;
+    // Zero on platforms where std::filesystem doesn't expose a file id.
+    uint64_t inode = 0;
+
+    bool operator==(const RomFileStamp&) const = default;
+};
+
+// Fills `out_stamp` for the file at `path`. Returns false if the file can't be examined.
+bool GetRomFileStamp(const std::filesystem::path& path, RomFileStamp& out_stamp);
+
+// Persistent cache of file digests, so that rom detection only needs to hash files that are new or have changed since
+// the last run. Entries are keyed by absolute path and validated by RomFileStamp.
+class RomHashIndex
+{
+public:
+    // Replaces the contents of the index with the entries in `path`. A missing file is not an error and leaves the
+    // index empty. Returns false if the file exists but couldn't be parsed; the index is empty in that case too.
+    bool Load(const std::filesystem::path& path);
+
+    // Writes the index to `path`, creating parent directories as needed. Does nothing if the index hasn't changed since
+    // it was loaded.
+    bool Save(const std::filesystem::path& path);
+
+    // Returns the digest recorded for `file` if its stamp still matches, or nullptr if it has to be rehashed.
+    const SHA256Digest* Find(const std::filesystem::path& file, const RomFileStamp& stamp);
+
+    void Insert(const std::filesystem::path& file, const RomFileStamp& stamp, const SHA256Digest& digest);
+
+    // Drops entries for files directly inside `directory` that weren't passed to Find or Insert since the index was
+    // loaded or `directory` was last pruned, i.e. files that have been deleted or renamed.
+    void PruneUnseen(const std::filesystem::path& directory);
+
+    size_t GetEntryCount() const
+    {
+        return m_entries.size();
+    }
+
+private:
+    struct Entry
+    {
+        RomFileStamp stamp;
+        SHA256Digest digest{};
+        bool         seen = false;
+    };
+
+    static std::string Key(const std::filesystem::path& file);
+
+    std::unordered_map<std::string, Entry> m_entries;
+    bool                                   m_dirty = false;
+};
@@ -1,14 +1,14 @@
 #include "rom_io.h"
 #include "cast.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
 #include <fstream>
+#include <random>
 #include <span>
-
-extern "C"
-{
-#include "sha/sha.h"
-}
-
-using SHA256Digest = std::array<uint8_t, SHA256HashSize>;
+#include <string>
+#include <string_view>
+#include <thread>
 
 const char* legacy_rom_names[(size_t)ROMSET_COUNT][ROMLOCATION_COUNT] = {
     // MK2
@@ -474,9 +474,89 @@ static constexpr KnownHash ROM_HASHES[] = {
 // clang-format on
 
 
+// A file in the rom directory that may be a rom.
+struct RomCandidate
+{
+    std::filesystem::path path;
+    RomFileStamp          stamp;
+    bool                  has_stamp = false;
+
+    SHA256Digest digest{};
+    // False until the digest is known, either from the index or by hashing.
+    bool has_digest = false;
+
+    // File contents. Only kept when the file had to be read anyway and it turned out to be a desired rom.
+    std::vector<uint8_t> data;
+};
+
+static bool IsDesiredDigest(const SHA256Digest& digest, const RomLocationSet* desired)
+{
+    if (!desired)
+    {
+        return false;
+    }
+
+    for (const auto& known : ROM_HASHES)
+    {
+        if (known.hash == digest && (*desired)[(size_t)known.location])
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+// Hashes `work` using a small pool of threads. Reading and hashing files is independent, so this mostly helps with
+// overlapping IO on one file with hashing another.
+static void HashRomCandidates(std::span<RomCandidate*> work, const RomLocationSet* desired)
+{
+    // Beyond this we're limited by the disk rather than the CPU.
+    constexpr size_t MAX_THREADS = 8;
+
+    std::atomic<size_t> next = 0;
+
+    const auto worker = [&] {
+        std::vector<uint8_t> buffer;
+        for (size_t i = next++; i < work.size(); i = next++)
+        {
+            RomCandidate& candidate = *work[i];
+
+            if (!ReadAllBytes(candidate.path, buffer))
+            {
+                continue;
+            }
+
+            HashSHA256(buffer, candidate.digest);
+            candidate.has_digest = true;
+
+            if (IsDesiredDigest(candidate.digest, desired))
+            {
+                candidate.data = std::move(buffer);
+                buffer         = {};
+            }
+        }
+    };
+
+    const size_t hardware_threads = std::max<size_t>(1, std::thread::hardware_concurrency());
+    const size_t thread_count     = std::min({work.size(), hardware_threads, MAX_THREADS});
+
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < thread_count; ++i)
+    {
+        threads.emplace_back(worker);
+    }
+    worker();
+    for (auto& thread : threads)
+    {
+        thread.join();
+    }
+}
+
 bool DetectRomsetsByHash(const std::filesystem::path& base_path,
-                             AllRomsetInfo&           all_info,
-                             RomLocationSet*          desired)
+                         AllRomsetInfo&               all_info,
+                         RomLocationSet*              desired,
+                         RomHashIndex*                index)
 {
     std::error_code ec;
 
@@ -488,7 +568,7 @@ bool DetectRomsetsByHash(const std::filesystem::path& base_path,
         return false;
     }
 
-    std::vector<uint8_t> buffer;
+    std::vector<RomCandidate> candidates;
 
     while (dir_iter != std::filesystem::directory_iterator{})
     {
@@ -535,44 +615,84 @@ bool DetectRomsetsByHash(const std::filesystem::path& base_path,
             continue;
         }
 
-        ReadAllBytes(dir_iter->path(), buffer);
+        RomCandidate& candidate = candidates.emplace_back();
+        candidate.path          = dir_iter->path();
 
-        SHA256Context ctx;
-        SHA256Digest  digest_bytes;
+        if (index)
+        {
+            candidate.has_stamp = GetRomFileStamp(candidate.path, candidate.stamp);
+            if (candidate.has_stamp)
+            {
+                if (const SHA256Digest* digest = index->Find(candidate.path, candidate.stamp))
+                {
+                    candidate.digest     = *digest;
+                    candidate.has_digest = true;
+                }
+            }
+        }
 
-        SHA256Reset(&ctx);
-        SHA256Input(&ctx, buffer.data(), buffer.size());
-        SHA256Result(&ctx, digest_bytes.data());
+        dir_iter.increment(ec);
+        if (ec)
+        {
+            fprintf(stderr, "Failed to get next file: %s\n", ec.message().c_str());
+            return false;
+        }
+    }
+
+    std::vector<RomCandidate*> work;
+    for (auto& candidate : candidates)
+    {
+        if (!candidate.has_digest)
+        {
+            work.push_back(&candidate);
+        }
+    }
+
+    HashRomCandidates(work, desired);
+
+    if (index)
+    {
+        for (RomCandidate* candidate : work)
+        {
+            if (candidate->has_digest && candidate->has_stamp)
+            {
+                index->Insert(candidate->path, candidate->stamp, candidate->digest);
+            }
+        }
+        index->PruneUnseen(base_path);
+    }
+
+    // Matching happens in directory order so that results don't depend on which thread finished first.
+    for (auto& candidate : candidates)
+    {
+        if (!candidate.has_digest)
+        {
+            continue;
+        }
 
         for (const auto& known : ROM_HASHES)
         {
-            if (known.hash == digest_bytes && !all_info.romsets[(size_t)known.romset].HasRom(known.location))
+            if (known.hash == candidate.digest && !all_info.romsets[(size_t)known.romset].HasRom(known.location))
             {
-                all_info.romsets[(size_t)known.romset].rom_paths[(size_t)known.location] = dir_iter->path();
+                all_info.romsets[(size_t)known.romset].rom_paths[(size_t)known.location] = candidate.path;
 
-                if (desired && (*desired)[(size_t)known.location])
+                // Data is only present if the file was read during this scan. Otherwise LoadRomset reads it later.
+                if (desired && (*desired)[(size_t)known.location] && !candidate.data.empty())
                 {
                     auto& rom_data = all_info.romsets[(size_t)known.romset].rom_data[(size_t)known.location];
                     if (IsWaverom(known.location))
                     {
-                        rom_data.resize(buffer.size());
-                        unscramble(rom_data.data(), buffer.data(), (int)buffer.size());
+                        rom_data.resize(candidate.data.size());
+                        unscramble(candidate.data.data(), rom_data.data(), (int)candidate.data.size());
                     }
                     else
                     {
-                        rom_data = std::move(buffer);
-                        buffer   = {};
+                        rom_data       = std::move(candidate.data);
+                        candidate.data = {};
                     }
                 }
             }
         }
-
-        dir_iter.increment(ec);
-        if (ec)
-        {
-            fprintf(stderr, "Failed to get next file: %s\n", ec.message().c_str());
-            return false;
-        }
     }
 
     return true;
@@ -695,11 +815,29 @@ void RomsetInfo::PurgeRomData()
     {
         vec = {};
     }
+    for (auto& map : rom_maps)
+    {
+        map.reset();
+    }
 }
 
 bool RomsetInfo::HasRom(RomLocation location) const
 {
-    return !(rom_paths[(size_t)location].empty() && rom_data[(size_t)location].empty());
+    return !rom_paths[(size_t)location].empty() || HasRomData(location);
+}
+
+bool RomsetInfo::HasRomData(RomLocation location) const
+{
+    return rom_maps[(size_t)location] || !rom_data[(size_t)location].empty();
+}
+
+std::span<const uint8_t> RomsetInfo::GetRomData(RomLocation location) const
+{
+    if (rom_maps[(size_t)location])
+    {
+        return rom_maps[(size_t)location]->GetData();
+    }
+    return rom_data[(size_t)location];
 }
 
 void AllRomsetInfo::PurgeRomData()
@@ -710,12 +848,204 @@ void AllRomsetInfo::PurgeRomData()
     }
 }
 
-bool LoadRomset(Romset romset, AllRomsetInfo& all_info, RomLoadStatusSet* loaded)
+static std::shared_ptr<const MappedFile> MapRomFile(const std::filesystem::path& path)
 {
-    bool all_loaded = true;
+    MappedFile file;
+    if (!file.Open(path))
+    {
+        return nullptr;
+    }
+    return std::make_shared<const MappedFile>(std::move(file));
+}
+
+// FNV-1a; this only has to avoid accidental collisions between a handful of files.
+static uint64_t HashCacheKey(std::string_view key)
+{
+    uint64_t hash = 0xcbf29ce484222325;
+    for (char c : key)
+    {
+        hash ^= (uint8_t)c;
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+// Returns the path of the cached unscrambled image of the waverom at `path`. The name is `<location>-<stamp>.bin`,
+// hashes of the file's location and of its stamp, so a modified or replaced rom gets a new cache file and
+// PruneWaveromCache can find the stale one by its location prefix.
+static bool GetWaveromCachePath(const std::filesystem::path& cache_dir,
+                                const std::filesystem::path& path,
+                                std::filesystem::path&       out_cache_path)
+{
+    RomFileStamp stamp;
+    if (!GetRomFileStamp(path, stamp))
+    {
+        return false;
+    }
+
+    std::error_code       ec;
+    std::filesystem::path absolute = std::filesystem::absolute(path, ec);
+    if (ec)
+    {
+        absolute = path;
+    }
+
+    // Bump the version if the unscrambled layout or padding ever changes.
+    std::string location_key = "nuked-sc55-waverom 1\n";
+    const std::u8string path_str = absolute.lexically_normal().generic_u8string();
+    location_key.append(path_str.begin(), path_str.end());
+
+    const std::string stamp_key =
+        std::to_string(stamp.size) + ' ' + std::to_string(stamp.mtime) + ' ' + std::to_string(stamp.inode);
+
+    char name[48];
+    snprintf(name,
+             sizeof(name),
+             "%016llx-%016llx.bin",
+             (unsigned long long)HashCacheKey(location_key),
+             (unsigned long long)HashCacheKey(stamp_key));
+    out_cache_path = cache_dir / name;
+    return true;
+}
 
-    // We cannot unscramble in-place.
-    std::vector<uint8_t> on_demand_buffer;
+// Removes cached images of older versions of the rom that `cache_path` was just written for, i.e. files with the same
+// location prefix but a different stamp, so the cache doesn't grow every time a rom file changes. Temporary files are
+// left alone since another process may be writing one. Failures are ignored; e.g. on Windows an image that another
+// process still has mapped can't be removed, and will be retried the next time the rom changes.
+static void PruneWaveromCache(const std::filesystem::path& cache_path)
+{
+    const std::string current = cache_path.filename().string();
+    const std::string prefix  = current.substr(0, current.find('-') + 1);
+
+    std::error_code ec;
+    std::vector<std::filesystem::path> stale;
+    for (const auto& entry : std::filesystem::directory_iterator(cache_path.parent_path(), ec))
+    {
+        const std::string name = entry.path().filename().string();
+        if (name != current && name.starts_with(prefix) && entry.path().extension() == ".bin")
+        {
+            stale.push_back(entry.path());
+        }
+    }
+
+    for (const auto& path : stale)
+    {
+        std::filesystem::remove(path, ec);
+    }
+}
+
+// Writes `image` to `cache_path` through a temporary file, so that other processes either see the complete image or
+// nothing. The temporary name is unique per process because several instances may be starting at the same time.
+static bool WriteWaveromCache(const std::filesystem::path& cache_path, std::span<const uint8_t> image)
+{
+    std::error_code ec;
+    std::filesystem::create_directories(cache_path.parent_path(), ec);
+    if (ec)
+    {
+        return false;
+    }
+
+    std::filesystem::path temp_path = cache_path;
+    temp_path += ".tmp" + std::to_string(std::random_device{}());
+
+    {
+        std::ofstream output(temp_path, std::ios::binary | std::ios::trunc);
+        if (!output)
+        {
+            return false;
+        }
+        output.write((const char*)image.data(), RangeCast<std::streamsize>(image.size()));
+        if (!output.good())
+        {
+            output.close();
+            std::filesystem::remove(temp_path, ec);
+            return false;
+        }
+    }
+
+    std::filesystem::rename(temp_path, cache_path, ec);
+    if (ec)
+    {
+        std::filesystem::remove(temp_path, ec);
+        return false;
+    }
+
+    return true;
+}
+
+// Moves the unscrambled waverom in `rom_data` into the cache and replaces it with a mapping of the cache file. Leaves
+// `rom_data` alone on failure.
+static void MoveWaveromToCache(RomLocation                        location,
+                               const std::filesystem::path&       cache_path,
+                               std::vector<uint8_t>&              rom_data,
+                               std::shared_ptr<const MappedFile>& rom_map)
+{
+    const size_t capacity = GetWaveromCapacity(location);
+    if (rom_data.size() > capacity)
+    {
+        // Emulator::LoadRom will report this.
+        return;
+    }
+
+    rom_data.resize(capacity);
+
+    if (!WriteWaveromCache(cache_path, rom_data) || !(rom_map = MapRomFile(cache_path)))
+    {
+        fprintf(stderr,
+                "WARNING: Failed to write waverom cache `%s`; the waverom will be unscrambled on every load\n",
+                cache_path.generic_string().c_str());
+        return;
+    }
+
+    rom_data = {};
+
+    PruneWaveromCache(cache_path);
+}
+
+static bool LoadWaverom(RomLocation                  location,
+                        const std::filesystem::path& path,
+                        const std::filesystem::path& cache_dir,
+                        RomsetInfo&                  info)
+{
+    auto& rom_data = info.rom_data[(size_t)location];
+    auto& rom_map  = info.rom_maps[(size_t)location];
+
+    std::filesystem::path cache_path;
+    const bool            use_cache = !cache_dir.empty() && GetWaveromCachePath(cache_dir, path, cache_path);
+
+    if (use_cache)
+    {
+        rom_map = MapRomFile(cache_path);
+        if (rom_map && rom_map->GetData().size() == GetWaveromCapacity(location))
+        {
+            return true;
+        }
+        rom_map.reset();
+    }
+
+    const auto source = MapRomFile(path);
+    if (!source)
+    {
+        return false;
+    }
+
+    rom_data.resize(source->GetData().size());
+    unscramble(source->GetData().data(), rom_data.data(), (int)rom_data.size());
+
+    if (use_cache)
+    {
+        MoveWaveromToCache(location, cache_path, rom_data, rom_map);
+    }
+
+    return true;
+}
+
+bool LoadRomset(Romset                       romset,
+                AllRomsetInfo&               all_info,
+                RomLoadStatusSet*            loaded,
+                const std::filesystem::path& waverom_cache_dir)
+{
+    bool all_loaded = true;
 
     RomsetInfo& info = all_info.romsets[(size_t)romset];
 
@@ -723,7 +1053,7 @@ bool LoadRomset(Romset romset, AllRomsetInfo& all_info, RomLoadStatusSet* loaded
     {
         const RomLocation location = (RomLocation)i;
 
-        if (info.rom_paths[i].empty() && info.rom_data[i].empty())
+        if (!info.HasRom(location))
         {
             if (loaded)
             {
@@ -731,9 +1061,20 @@ bool LoadRomset(Romset romset, AllRomsetInfo& all_info, RomLoadStatusSet* loaded
             }
             continue;
         }
-        else if (!info.rom_paths[i].empty() && info.rom_data[i].empty())
+        else if (!info.HasRomData(location))
         {
-            if (!ReadAllBytes(info.rom_paths[i], on_demand_buffer))
+            bool success;
+            if (IsWaverom(location))
+            {
+                success = LoadWaverom(location, info.rom_paths[i], waverom_cache_dir, info);
+            }
+            else
+            {
+                info.rom_maps[i] = MapRomFile(info.rom_paths[i]);
+                success          = info.rom_maps[i] != nullptr;
+            }
+
+            if (!success)
             {
                 all_loaded = false;
                 if (loaded)
@@ -743,24 +1084,21 @@ bool LoadRomset(Romset romset, AllRomsetInfo& all_info, RomLoadStatusSet* loaded
                 continue;
             }
 
-            if (IsWaverom(location))
-            {
-                info.rom_data[i].resize(on_demand_buffer.size());
-                unscramble(on_demand_buffer.data(), info.rom_data[i].data(), (int)on_demand_buffer.size());
-            }
-            else
-            {
-                info.rom_data[i] = std::move(on_demand_buffer);
-                on_demand_buffer = {};
-            }
-
             if (loaded)
             {
                 (*loaded)[i] = RomLoadStatus::Loaded;
             }
         }
-        else if (!info.rom_data[i].empty())
+        else
         {
+            // Detection may have unscrambled this waverom already; cache it so that the next run can map it.
+            std::filesystem::path cache_path;
+            if (IsWaverom(location) && !info.rom_maps[i] && !info.rom_paths[i].empty() && !waverom_cache_dir.empty() &&
+                GetWaveromCachePath(waverom_cache_dir, info.rom_paths[i], cache_path))
+            {
+                MoveWaveromToCache(location, cache_path, info.rom_data[i], info.rom_maps[i]);
+            }
+
             if (loaded)
             {
                 (*loaded)[i] = RomLoadStatus::Loaded;
@@ -1,7 +1,11 @@
 #pragma once
 
+#include "mapped_file.h"
 #include "rom.h"
+#include "rom_index.h"
 #include <filesystem>
+#include <memory>
+#include <span>
 #include <vector>
 
 enum class RomLoadStatus
@@ -40,12 +44,22 @@ struct RomsetInfo
     // Array indexed by RomLocation
     std::filesystem::path rom_paths[ROMLOCATION_COUNT]{};
     std::vector<uint8_t>  rom_data[ROMLOCATION_COUNT]{};
+    // Read-only mapping of the rom file, or for waveroms of the unscrambled image in the waverom cache. Takes precedence
+    // over `rom_data` when present. Shared so that an emulator can keep using it after PurgeRomData.
+    std::shared_ptr<const MappedFile> rom_maps[ROMLOCATION_COUNT]{};
 
-    // Release all rom_data for all roms in this romset.
+    // Release all rom_data and rom_maps for all roms in this romset.
     void PurgeRomData();
 
-    // Returns true if at least one of `rom_path` or `rom_data` is populated for `location`.
+    // Returns true if at least one of `rom_path`, `rom_data` or `rom_maps` is populated for `location`.
     bool HasRom(RomLocation location) const;
+
+    // Returns true if `rom_data` or `rom_maps` is populated for `location`.
+    bool HasRomData(RomLocation location) const;
+
+    // Returns the contents of the rom at `location` from `rom_maps` or `rom_data`, or an empty span if neither is
+    // populated.
+    std::span<const uint8_t> GetRomData(RomLocation location) const;
 };
 
 // Contains RomsetInfo for all supported romsets.
@@ -75,9 +89,13 @@ bool DetectRomsetsByFilename(const std::filesystem::path& base_path,
 //
 // If `desired` is non-null, this function will use it as a hint to determine what hashes to consider. This function may
 // also load `rom_data` for desired roms.
+//
+// If `index` is non-null, files whose digest it already holds are not read at all, and digests of newly hashed files
+// are added to it. Files that do need hashing are hashed in parallel.
 bool DetectRomsetsByHash(const std::filesystem::path& base_path,
                          AllRomsetInfo&               all_info,
-                         RomLocationSet*              desired = nullptr);
+                         RomLocationSet*              desired = nullptr,
+                         RomHashIndex*                index   = nullptr);
 
 // Returns true if `all_info` contains all the files required to load `romset`. Missing roms will be reported in
 // `missing`.
@@ -89,12 +107,20 @@ size_t CountPresent(const RomCompletionStatusSet& status);
 // returned is unspecified. Returns true if successful, or false if there are no complete romsets.
 bool PickCompleteRomset(const AllRomsetInfo& all_info, Romset& out_romset);
 
-// For each `rom` in `romset`, this function loads the file referenced by `all_info.romsets[romset].rom_paths[rom]` into
-// the corresponding `rom_data`. Waveroms will be unscrambled at this point.
+// For each `rom` in `romset`, this function maps the file referenced by `all_info.romsets[romset].rom_paths[rom]` into
+// the corresponding `rom_maps`. Waveroms will be unscrambled at this point.
+//
+// `rom` will only be loaded when it has no data yet and `rom_path` is non-empty.
 //
-// `rom` will only be loaded when `rom_data` is empty and `rom_path` is non-empty.
+// If `waverom_cache_dir` is non-empty, unscrambled waveroms are stored there, padded to GetWaveromCapacity, and mapped
+// from there on later runs instead of being unscrambled again. Waveroms that already have `rom_data` are moved to the
+// cache as well. Without a cache directory, or if the cache can't be written, unscrambled waveroms go in `rom_data`.
+// Writing a waverom's image removes the cached images of earlier versions of the same file.
 //
 // To automatically determine rom_paths, call `DetectRomsetsByHash` with a directory containing roms.
 //
 // Roms that were loaded successfully will be marked as true in `loaded`.
-bool LoadRomset(Romset romset, AllRomsetInfo& all_info, RomLoadStatusSet* loaded = nullptr);
+bool LoadRomset(Romset                       romset,
+                AllRomsetInfo&               all_info,
+                RomLoadStatusSet*            loaded            = nullptr,
+                const std::filesystem::path& waverom_cache_dir = {});
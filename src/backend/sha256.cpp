@@ -0,0 +1,330 @@
+#include "sha256.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+extern "C"
+{
+#include "sha/sha.h"
+}
+
+static_assert(std::tuple_size_v<SHA256Digest> == SHA256HashSize);
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define NUKED_SHA256_X86 1
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif (defined(__aarch64__) && (defined(__ARM_FEATURE_SHA2) || defined(__ARM_FEATURE_CRYPTO))) || defined(_M_ARM64)
+// Unlike x86, GCC and Clang disagree on how to enable the crypto extensions per function, so this path is only built
+// when the compiler already targets them (the default on Apple and Windows). Generic aarch64 Linux builds need
+// -march=armv8-a+crypto to get it.
+#define NUKED_SHA256_ARM 1
+#include <arm_neon.h>
+#if defined(__linux__)
+#include <sys/auxv.h>
+#elif defined(_WIN32)
+#include <Windows.h>
+#endif
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define NUKED_SHA256_TARGET(x) __attribute__((target(x)))
+// The round loops need to be fully unrolled so that the schedule indices become constants; this roughly doubles
+// throughput with GCC, which doesn't do it on its own.
+#define NUKED_SHA256_UNROLL _Pragma("GCC unroll 16")
+#else
+#define NUKED_SHA256_TARGET(x)
+#define NUKED_SHA256_UNROLL
+#endif
+
+alignas(16) static constexpr uint32_t SHA256_K[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+// Processes `block_count` 64-byte blocks starting at `blocks`, updating `state` in place.
+using SHA256CompressFn = void (*)(uint32_t state[8], const uint8_t* blocks, size_t block_count);
+
+#if NUKED_SHA256_X86
+NUKED_SHA256_TARGET("sha,sse4.1")
+static void SHA256_CompressShaNi(uint32_t state[8], const uint8_t* blocks, size_t block_count)
+{
+    const __m128i byteswap = _mm_set_epi64x(0x0c0d0e0f08090a0bll, 0x0405060700010203ll);
+
+    // The SHA instructions want the state as ABEF/CDGH rather than ABCD/EFGH.
+    __m128i tmp    = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[0]), 0xb1); // CDAB
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i*)&state[4]), 0x1b); // EFGH
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);                                    // ABEF
+    state1         = _mm_blend_epi16(state1, tmp, 0xf0);                                 // CDGH
+
+    for (; block_count != 0; --block_count, blocks += 64)
+    {
+        const __m128i abef_save = state0;
+        const __m128i cdgh_save = state1;
+
+        // Message schedule, four words per register. w[i & 3] holds words 4i..4i+3 of the schedule.
+        __m128i w[4];
+
+        NUKED_SHA256_UNROLL
+        for (int i = 0; i < 16; ++i)
+        {
+            if (i < 4)
+            {
+                w[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)(blocks + 16 * i)), byteswap);
+            }
+            else
+            {
+                const __m128i w7 = _mm_alignr_epi8(w[(i + 3) & 3], w[(i + 2) & 3], 4);
+                w[i & 3] = _mm_sha256msg1_epu32(w[i & 3], w[(i + 1) & 3]);
+                w[i & 3] = _mm_add_epi32(w[i & 3], w7);
+                w[i & 3] = _mm_sha256msg2_epu32(w[i & 3], w[(i + 3) & 3]);
+            }
+
+            __m128i msg = _mm_add_epi32(w[i & 3], _mm_load_si128((const __m128i*)&SHA256_K[4 * i]));
+            state1      = _mm_sha256rnds2_epu32(state1, state0, msg);
+            msg         = _mm_shuffle_epi32(msg, 0x0e);
+            state0      = _mm_sha256rnds2_epu32(state0, state1, msg);
+        }
+
+        state0 = _mm_add_epi32(state0, abef_save);
+        state1 = _mm_add_epi32(state1, cdgh_save);
+    }
+
+    tmp    = _mm_shuffle_epi32(state0, 0x1b);    // FEBA
+    state1 = _mm_shuffle_epi32(state1, 0xb1);    // DCHG
+    state0 = _mm_blend_epi16(tmp, state1, 0xf0); // DCBA
+    state1 = _mm_alignr_epi8(state1, tmp, 8);    // ABEF
+
+    _mm_storeu_si128((__m128i*)&state[0], state0);
+    _mm_storeu_si128((__m128i*)&state[4], state1);
+}
+
+static bool SHA256_CpuHasShaNi()
+{
+    unsigned int leaf1[4]{};
+    unsigned int leaf7[4]{};
+#if defined(_MSC_VER)
+    int regs[4];
+    __cpuid(regs, 0);
+    if (regs[0] < 7)
+    {
+        return false;
+    }
+    __cpuidex(regs, 1, 0);
+    memcpy(leaf1, regs, sizeof(leaf1));
+    __cpuidex(regs, 7, 0);
+    memcpy(leaf7, regs, sizeof(leaf7));
+#else
+    if (__get_cpuid_max(0, nullptr) < 7)
+    {
+        return false;
+    }
+    __cpuid_count(1, 0, leaf1[0], leaf1[1], leaf1[2], leaf1[3]);
+    __cpuid_count(7, 0, leaf7[0], leaf7[1], leaf7[2], leaf7[3]);
+#endif
+    const bool has_ssse3  = (leaf1[2] & (1u << 9)) != 0;
+    const bool has_sse41  = (leaf1[2] & (1u << 19)) != 0;
+    const bool has_sha_ni = (leaf7[1] & (1u << 29)) != 0;
+    return has_ssse3 && has_sse41 && has_sha_ni;
+}
+#endif
+
+#if NUKED_SHA256_ARM
+static void SHA256_CompressArmSha2(uint32_t state[8], const uint8_t* blocks, size_t block_count)
+{
+    uint32x4_t state0 = vld1q_u32(&state[0]);
+    uint32x4_t state1 = vld1q_u32(&state[4]);
+
+    for (; block_count != 0; --block_count, blocks += 64)
+    {
+        const uint32x4_t abcd_save = state0;
+        const uint32x4_t efgh_save = state1;
+
+        // w[i & 3] holds words 4i..4i+3 of the message schedule.
+        uint32x4_t w[4];
+        for (int i = 0; i < 4; ++i)
+        {
+            w[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(blocks + 16 * i)));
+        }
+
+        NUKED_SHA256_UNROLL
+        for (int i = 0; i < 16; ++i)
+        {
+            const uint32x4_t msg = vaddq_u32(w[i & 3], vld1q_u32(&SHA256_K[4 * i]));
+
+            if (i < 12)
+            {
+                w[i & 3] = vsha256su1q_u32(vsha256su0q_u32(w[i & 3], w[(i + 1) & 3]), w[(i + 2) & 3], w[(i + 3) & 3]);
+            }
+
+            const uint32x4_t abcd = state0;
+            state0                = vsha256hq_u32(state0, state1, msg);
+            state1                = vsha256h2q_u32(state1, abcd, msg);
+        }
+
+        state0 = vaddq_u32(state0, abcd_save);
+        state1 = vaddq_u32(state1, efgh_save);
+    }
+
+    vst1q_u32(&state[0], state0);
+    vst1q_u32(&state[4], state1);
+}
+
+static bool SHA256_CpuHasArmSha2()
+{
+#if defined(__linux__)
+    // HWCAP_SHA2 from <asm/hwcap.h>
+    return (getauxval(AT_HWCAP) & (1ul << 6)) != 0;
+#elif defined(_WIN32)
+    return IsProcessorFeaturePresent(PF_ARM_V8_CRYPTO_INSTRUCTIONS_AVAILABLE) != 0;
+#else
+    // We only get here if the compiler targets the extension anyway.
+    return true;
+#endif
+}
+#endif
+
+// Runs the full hash around a block function: whole blocks straight from `data`, then the padded tail.
+static void SHA256_HashWith(SHA256CompressFn compress, std::span<const uint8_t> data, SHA256Digest& out_digest)
+{
+    uint32_t state[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+
+    const size_t full_blocks = data.size() / 64;
+    compress(state, data.data(), full_blocks);
+
+    // The remainder plus 0x80 and the 64-bit length fits in one block, or two if it's more than 55 bytes.
+    uint8_t      tail[128]{};
+    const size_t remainder = data.size() % 64;
+    if (remainder != 0)
+    {
+        memcpy(tail, data.data() + full_blocks * 64, remainder);
+    }
+    tail[remainder] = 0x80;
+
+    const size_t   tail_size = remainder < 56 ? 64 : 128;
+    const uint64_t bit_count = (uint64_t)data.size() * 8;
+    for (size_t i = 0; i < 8; ++i)
+    {
+        tail[tail_size - 1 - i] = (uint8_t)(bit_count >> (8 * i));
+    }
+    compress(state, tail, tail_size / 64);
+
+    for (size_t i = 0; i < 8; ++i)
+    {
+        out_digest[4 * i + 0] = (uint8_t)(state[i] >> 24);
+        out_digest[4 * i + 1] = (uint8_t)(state[i] >> 16);
+        out_digest[4 * i + 2] = (uint8_t)(state[i] >> 8);
+        out_digest[4 * i + 3] = (uint8_t)(state[i]);
+    }
+}
+
+static void SHA256_HashPortable(std::span<const uint8_t> data, SHA256Digest& out_digest)
+{
+    SHA256Context ctx;
+    SHA256Reset(&ctx);
+    // SHA256Input takes an unsigned int length
+    constexpr size_t MAX_CHUNK = 1u << 30;
+    while (!data.empty())
+    {
+        const size_t chunk = data.size() < MAX_CHUNK ? data.size() : MAX_CHUNK;
+        SHA256Input(&ctx, data.data(), (unsigned int)chunk);
+        data = data.subspan(chunk);
+    }
+    SHA256Result(&ctx, out_digest.data());
+}
+
+const char* ToCString(SHA256Backend backend)
+{
+    switch (backend)
+    {
+    case SHA256Backend::Portable:
+        return "portable";
+    case SHA256Backend::X86ShaNi:
+        return "SHA-NI";
+    case SHA256Backend::ArmSha2:
+        return "ARMv8 SHA2";
+    }
+    return "invalid";
+}
+
+bool IsSHA256BackendSupported(SHA256Backend backend)
+{
+    switch (backend)
+    {
+    case SHA256Backend::Portable:
+        return true;
+    case SHA256Backend::X86ShaNi:
+#if NUKED_SHA256_X86
+        return SHA256_CpuHasShaNi();
+#else
+        return false;
+#endif
+    case SHA256Backend::ArmSha2:
+#if NUKED_SHA256_ARM
+        return SHA256_CpuHasArmSha2();
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+SHA256Backend GetBestSHA256Backend()
+{
+    static const SHA256Backend best = [] {
+        if (IsSHA256BackendSupported(SHA256Backend::X86ShaNi))
+        {
+            return SHA256Backend::X86ShaNi;
+        }
+        if (IsSHA256BackendSupported(SHA256Backend::ArmSha2))
+        {
+            return SHA256Backend::ArmSha2;
+        }
+        return SHA256Backend::Portable;
+    }();
+    return best;
+}
+
+void HashSHA256(std::span<const uint8_t> data, SHA256Digest& out_digest)
+{
+    HashSHA256(GetBestSHA256Backend(), data, out_digest);
+}
+
+void HashSHA256(SHA256Backend backend, std::span<const uint8_t> data, SHA256Digest& out_digest)
+{
+    switch (backend)
+    {
+    case SHA256Backend::Portable:
+        SHA256_HashPortable(data, out_digest);
+        return;
+    case SHA256Backend::X86ShaNi:
+#if NUKED_SHA256_X86
+        SHA256_HashWith(SHA256_CompressShaNi, data, out_digest);
+        return;
+#else
+        break;
+#endif
+    case SHA256Backend::ArmSha2:
+#if NUKED_SHA256_ARM
+        SHA256_HashWith(SHA256_CompressArmSha2, data, out_digest);
+        return;
+#else
+        break;
+#endif
+    }
+    fprintf(stderr, "FATAL: SHA-256 backend %s is not available in this build\n", ToCString(backend));
+    std::abort();
+}
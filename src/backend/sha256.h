@@ -0,0 +1,31 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+
+using SHA256Digest = std::array<uint8_t, 32>;
+
+enum class SHA256Backend
+{
+    // RFC 6234 reference implementation in sha/sha224-256.c. Always available.
+    Portable,
+    // x86 SHA extensions (SHA-NI).
+    X86ShaNi,
+    // ARMv8 SHA2 crypto extensions.
+    ArmSha2,
+};
+
+const char* ToCString(SHA256Backend backend);
+
+// Returns true if this build contains `backend` and the CPU we're running on supports it.
+bool IsSHA256BackendSupported(SHA256Backend backend);
+
+// Returns the fastest supported backend. The result is computed once and cached.
+SHA256Backend GetBestSHA256Backend();
+
+// Hashes `data` with the fastest supported backend.
+void HashSHA256(std::span<const uint8_t> data, SHA256Digest& out_digest);
+
+// Hashes `data` with `backend`, which must be supported. Mostly useful for testing and benchmarking.
+void HashSHA256(SHA256Backend backend, std::span<const uint8_t> data, SHA256Digest& out_digest);
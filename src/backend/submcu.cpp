@@ -33,7 +33,12 @@
  */
 #include "submcu.h"
 #include "mcu.h"
+#include "emu_profiler.h"
+#include "emu_stats.h"
 #include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <vector>
 
 enum {
     SM_VECTOR_UART3_TX = 0,
@@ -186,6 +191,7 @@ void SM_Write(submcu_t& sm, uint16_t address, uint8_t data)
                 if(sm.mcu->uart_tx_ptr == sm.mcu->uart_tx_buffer && (data & 0x80) == 0)
                     sm.mcu->uart_tx_ptr = sm.mcu->uart_tx_buffer +1;
                 *(sm.mcu->uart_tx_ptr)++ = data;
+                sm.mcu->uart_tx_pending = 1;
                 break;
             case SM_DEV_UART3_DATA:
                 break;
@@ -339,14 +345,19 @@ void SM_Init(submcu_t& sm, mcu_t& mcu)
     sm.mcu = &mcu;
 }
 
+void SM_DecodeRom(submcu_t& sm);
+
 void SM_Reset(submcu_t& sm)
 {
+    SM_DecodeRom(sm);
+
     sm.pc = SM_GetVectorAddress(sm, SM_VECTOR_RESET);
     sm.a = 0;
     sm.x = 0;
     sm.y = 0;
     sm.s = 0;
     sm.sr = 0;
+    sm.nz_pending = 0;
     sm.cycles = 0;
     sm.sleep = 0;
 }
@@ -358,13 +369,6 @@ uint8_t SM_ReadAdvance(submcu_t& sm)
     return byte;
 }
 
-uint16_t SM_ReadAdvance16(submcu_t& sm)
-{
-    uint16_t word = SM_ReadAdvance(sm);
-    word         |= SM_ReadAdvance(sm) << 8;
-    return word;
-}
-
 uint16_t SM_Read16(submcu_t& sm, uint16_t address)
 {
     uint16_t word = SM_Read(sm, address);
@@ -372,10 +376,22 @@ uint16_t SM_Read16(submcu_t& sm, uint16_t address)
     return word;
 }
 
+// Flag-setting instructions only record their result; N and Z are computed from it when a branch or an interrupt
+// needs them.
 void SM_Update_NZ(submcu_t& sm, uint8_t val)
 {
-    SM_SetStatus(sm, val == 0, SM_STATUS_Z);
-    SM_SetStatus(sm, val & 0x80, SM_STATUS_N);
+    sm.nz_result  = val;
+    sm.nz_pending = 1;
+}
+
+void SM_SyncFlags(submcu_t& sm)
+{
+    if (!sm.nz_pending)
+        return;
+
+    SM_SetStatus(sm, sm.nz_result == 0, SM_STATUS_Z);
+    SM_SetStatus(sm, sm.nz_result & 0x80, SM_STATUS_N);
+    sm.nz_pending = 0;
 }
 
 void SM_PushStack(submcu_t& sm, uint8_t data)
@@ -390,263 +406,225 @@ uint8_t SM_PopStack(submcu_t& sm)
     return SM_Read(sm, sm.s);
 }
 
-void SM_Opcode_NotImplemented(submcu_t& sm, uint8_t opcode)
+enum {
+    SM_MODE_IMPLIED = 0,
+    SM_MODE_IMMEDIATE,
+    SM_MODE_RELATIVE,
+    SM_MODE_ZERO_PAGE,
+    SM_MODE_ZERO_PAGE_X,
+    // Zero page plus x without wrapping to the zero page.
+    SM_MODE_ZERO_PAGE_X_LONG,
+    SM_MODE_ZERO_PAGE_Y,
+    SM_MODE_ZERO_PAGE_INDIRECT,
+    SM_MODE_ZERO_PAGE_RELATIVE,
+    SM_MODE_ABSOLUTE,
+    SM_MODE_ABSOLUTE_X,
+    SM_MODE_ABSOLUTE_Y,
+    SM_MODE_INDIRECT,
+    SM_MODE_INDIRECT_X,
+    SM_MODE_INDIRECT_Y,
+    SM_MODE_SPECIAL_PAGE,
+    // Immediate value followed by a zero page address.
+    SM_MODE_IMMEDIATE_ZERO_PAGE,
+    SM_MODE_COUNT
+};
+
+const uint8_t SM_Mode_Length[SM_MODE_COUNT] = {
+    1, // SM_MODE_IMPLIED
+    2, // SM_MODE_IMMEDIATE
+    2, // SM_MODE_RELATIVE
+    2, // SM_MODE_ZERO_PAGE
+    2, // SM_MODE_ZERO_PAGE_X
+    2, // SM_MODE_ZERO_PAGE_X_LONG
+    2, // SM_MODE_ZERO_PAGE_Y
+    2, // SM_MODE_ZERO_PAGE_INDIRECT
+    3, // SM_MODE_ZERO_PAGE_RELATIVE
+    3, // SM_MODE_ABSOLUTE
+    3, // SM_MODE_ABSOLUTE_X
+    3, // SM_MODE_ABSOLUTE_Y
+    3, // SM_MODE_INDIRECT
+    2, // SM_MODE_INDIRECT_X
+    2, // SM_MODE_INDIRECT_Y
+    2, // SM_MODE_SPECIAL_PAGE
+    3, // SM_MODE_IMMEDIATE_ZERO_PAGE
+};
+
+// The address an instruction operates on, or jumps to.
+inline uint16_t SM_OperandAddress(submcu_t& sm, const SM_Instruction& insn)
 {
-    (void)opcode;
+    switch (insn.mode)
+    {
+        case SM_MODE_ZERO_PAGE:
+        case SM_MODE_ABSOLUTE:
+            return insn.operand;
+        case SM_MODE_ZERO_PAGE_X:
+            return (insn.operand + sm.x) & 0xff;
+        case SM_MODE_ZERO_PAGE_X_LONG:
+        case SM_MODE_ABSOLUTE_X:
+            return insn.operand + sm.x;
+        case SM_MODE_ZERO_PAGE_Y:
+            return (insn.operand + sm.y) & 0xff;
+        case SM_MODE_ABSOLUTE_Y:
+            return insn.operand + sm.y;
+        case SM_MODE_ZERO_PAGE_INDIRECT:
+        case SM_MODE_INDIRECT:
+            return SM_Read16(sm, insn.operand);
+        case SM_MODE_INDIRECT_X:
+            return SM_Read16(sm, (insn.operand + sm.x) & 0xff);
+        case SM_MODE_INDIRECT_Y:
+            return SM_Read16(sm, insn.operand) + sm.y;
+        case SM_MODE_SPECIAL_PAGE:
+            return 0xff00 | insn.operand;
+    }
+    return 0;
+}
+
+inline uint8_t SM_ReadOperand(submcu_t& sm, const SM_Instruction& insn)
+{
+    if (insn.mode == SM_MODE_IMMEDIATE)
+        return (uint8_t)insn.operand;
+
+    return SM_Read(sm, SM_OperandAddress(sm, insn));
+}
+
+void SM_Branch(submcu_t& sm, int8_t diff, bool condition)
+{
+    if (condition)
+        sm.pc += diff;
+}
+
+void SM_Opcode_NotImplemented(submcu_t& sm, const SM_Instruction& insn)
+{
+    (void)insn;
     SM_ErrorTrap(sm);
 }
 
-void SM_Opcode_SEI(submcu_t& sm, uint8_t opcode) // 78
+void SM_Opcode_SEI(submcu_t& sm, const SM_Instruction& insn) // 78
 {
-    (void)opcode;
+    (void)insn;
     SM_SetStatus(sm, 1, SM_STATUS_I);
 }
 
-void SM_Opcode_CLD(submcu_t& sm, uint8_t opcode) // d8
+void SM_Opcode_CLD(submcu_t& sm, const SM_Instruction& insn) // d8
 {
-    (void)opcode;
+    (void)insn;
     SM_SetStatus(sm, 0, SM_STATUS_D);
 }
 
-void SM_Opcode_CLT(submcu_t& sm, uint8_t opcode) // 12
+void SM_Opcode_CLT(submcu_t& sm, const SM_Instruction& insn) // 12
 {
-    (void)opcode;
+    (void)insn;
     SM_SetStatus(sm, 0, SM_STATUS_T);
 }
 
-void SM_Opcode_LDX(submcu_t& sm, uint8_t opcode) // a2, a6, ae, b6, be
+void SM_Opcode_LDX(submcu_t& sm, const SM_Instruction& insn) // a2, a6, ae, b6, be
 {
-    uint8_t val = 0;
-    switch (opcode)
-    {
-        case 0xa2:
-            val = SM_ReadAdvance(sm);
-            break;
-        case 0xa6:
-            val = SM_Read(sm, SM_ReadAdvance(sm));
-            break;
-        case 0xb6:
-            val = SM_Read(sm, (SM_ReadAdvance(sm) + sm.y) & 0xff);
-            break;
-        case 0xae:
-            val = SM_Read(sm, SM_ReadAdvance16(sm));
-            break;
-        case 0xbe:
-            val = SM_Read(sm, SM_ReadAdvance16(sm) + sm.y);
-            break;
-    }
-    sm.x = val;
+    sm.x = SM_ReadOperand(sm, insn);
     SM_Update_NZ(sm, sm.x);
 }
 
-void SM_Opcode_LDY(submcu_t& sm, uint8_t opcode) // a0, a4, ac, b4, bc
+void SM_Opcode_LDY(submcu_t& sm, const SM_Instruction& insn) // a0, a4, ac, b4, bc
 {
-    uint8_t val = 0;
-    switch (opcode)
-    {
-        case 0xa0:
-            val = SM_ReadAdvance(sm);
-            break;
-        case 0xa4:
-            val = SM_Read(sm, SM_ReadAdvance(sm));
-            break;
-        case 0xac:
-            val = SM_Read(sm, SM_ReadAdvance16(sm));
-            break;
-        case 0xb4:
-            val = SM_Read(sm, (SM_ReadAdvance(sm) + sm.x) & 0xff);
-            break;
-        case 0xbc:
-            val = SM_Read(sm, SM_ReadAdvance16(sm) + sm.x);
-            break;
-    }
-    sm.y = val;
+    sm.y = SM_ReadOperand(sm, insn);
     SM_Update_NZ(sm, sm.y);
 }
 
-void SM_Opcode_TXS(submcu_t& sm, uint8_t opcode) // 9a
+void SM_Opcode_TXS(submcu_t& sm, const SM_Instruction& insn) // 9a
 {
-    (void)opcode;
+    (void)insn;
     sm.s = sm.x;
 }
 
-void SM_Opcode_TXA(submcu_t& sm, uint8_t opcode) // 8a
+void SM_Opcode_TXA(submcu_t& sm, const SM_Instruction& insn) // 8a
 {
-    (void)opcode;
+    (void)insn;
     sm.a = sm.x;
     SM_Update_NZ(sm, sm.a);
 }
 
-void SM_Opcode_STA(submcu_t& sm, uint8_t opcode) // 85, 95, 8d, 9d, 99, 81, 91
+void SM_Opcode_STA(submcu_t& sm, const SM_Instruction& insn) // 85, 95, 8d, 9d, 99, 81, 91
 {
-    uint16_t dest = 0;
-    switch (opcode)
-    {
-        case 0x85:
-            dest = SM_ReadAdvance(sm);
-            break;
-        case 0x95:
-            dest = SM_ReadAdvance(sm) + sm.x;
-            break;
-        case 0x8d:
-            dest = SM_ReadAdvance16(sm);
-            break;
-        case 0x9d:
-            dest = SM_ReadAdvance16(sm) + sm.x;
-            break;
-        case 0x99:
-            dest = SM_ReadAdvance16(sm) + sm.y;
-            break;
-        case 0x81:
-            dest = SM_Read16(sm, (SM_ReadAdvance(sm) + sm.x) & 0xff);
-            break;
-        case 0x91:
-            dest = SM_Read16(sm, SM_ReadAdvance(sm)) + sm.y;
-            break;
-    }
-
-    SM_Write(sm, dest, sm.a);
+    SM_Write(sm, SM_OperandAddress(sm, insn), sm.a);
 }
 
-void SM_Opcode_INX(submcu_t& sm, uint8_t opcode) // e8
+void SM_Opcode_INX(submcu_t& sm, const SM_Instruction& insn) // e8
 {
-    (void)opcode;
+    (void)insn;
     sm.x++;
     SM_Update_NZ(sm, sm.x);
 }
 
-void SM_Opcode_INY(submcu_t& sm, uint8_t opcode) // c8
+void SM_Opcode_INY(submcu_t& sm, const SM_Instruction& insn) // c8
 {
-    (void)opcode;
+    (void)insn;
     sm.y++;
     SM_Update_NZ(sm, sm.y);
 }
 
-void SM_Opcode_BBC_BBS(submcu_t& sm, uint8_t opcode)
+void SM_Opcode_BBC_BBS(submcu_t& sm, const SM_Instruction& insn)
 {
-    int32_t zp   = (opcode & 4) != 0;
-    int32_t bit  = (opcode >> 5) & 7;
-    int32_t type = (opcode >> 4) & 1;
+    int32_t bit  = (insn.opcode >> 5) & 7;
+    int32_t type = (insn.opcode >> 4) & 1;
     uint8_t val  = 0;
+    int8_t  diff = 0;
 
-    if (!zp)
+    if (insn.mode == SM_MODE_RELATIVE)
     {
-        val = sm.a;
+        val  = sm.a;
+        diff = (int8_t)insn.operand;
     }
     else
     {
-        val = SM_Read(sm, SM_ReadAdvance(sm));
+        val  = SM_Read(sm, insn.operand & 0xff);
+        diff = (int8_t)(insn.operand >> 8);
     }
 
-    int8_t diff = SM_ReadAdvance(sm);
-
     int32_t set = (val >> bit) & 1;
-    
-    if (set != type)
-        sm.pc += diff;
+
+    SM_Branch(sm, diff, set != type);
 }
 
-void SM_Opcode_CPX(submcu_t& sm, uint8_t opcode) // e0, e4, ec
+void SM_Compare(submcu_t& sm, uint8_t reg, uint8_t operand)
 {
-    uint8_t operand = 0;
-    switch (opcode)
-    {
-        case 0xe0:
-            operand = SM_ReadAdvance(sm);
-            break;
-        case 0xe4:
-            operand = SM_Read(sm, SM_ReadAdvance(sm));
-            break;
-        case 0xec:
-            operand = SM_Read(sm, SM_ReadAdvance16(sm));
-            break;
-    }
-    int diff = sm.x - operand;
+    int diff = reg - operand;
     SM_SetStatus(sm, (diff & 0x100) == 0, SM_STATUS_C);
     SM_Update_NZ(sm, diff & 0xff);
 }
 
-void SM_Opcode_CPY(submcu_t& sm, uint8_t opcode) // c0, c4, cc
+void SM_Opcode_CPX(submcu_t& sm, const SM_Instruction& insn) // e0, e4, ec
 {
-    uint8_t operand = 0;
-    switch (opcode)
-    {
-        case 0xc0:
-            operand = SM_ReadAdvance(sm);
-            break;
-        case 0xc4:
-            operand = SM_Read(sm, SM_ReadAdvance(sm));
-            break;
-        case 0xcc:
-            operand = SM_Read(sm, SM_ReadAdvance16(sm));
-            break;
-    }
-    int diff = sm.y - operand;
-    SM_SetStatus(sm, (diff & 0x100) == 0, SM_STATUS_C);
-    SM_Update_NZ(sm, diff & 0xff);
+    SM_Compare(sm, sm.x, SM_ReadOperand(sm, insn));
 }
 
-void SM_Opcode_BEQ(submcu_t& sm, uint8_t opcode) // f0
+void SM_Opcode_CPY(submcu_t& sm, const SM_Instruction& insn) // c0, c4, cc
 {
-    (void)opcode;
-    int8_t diff = SM_ReadAdvance(sm);
-    if ((sm.sr & SM_STATUS_Z) != 0)
-        sm.pc += diff;
+    SM_Compare(sm, sm.y, SM_ReadOperand(sm, insn));
 }
 
-void SM_Opcode_BCC(submcu_t& sm, uint8_t opcode) // 90
+void SM_Opcode_BEQ(submcu_t& sm, const SM_Instruction& insn) // f0
 {
-    (void)opcode;
-    int8_t diff = SM_ReadAdvance(sm);
-    if ((sm.sr & SM_STATUS_C) == 0)
-        sm.pc += diff;
+    SM_SyncFlags(sm);
+    SM_Branch(sm, (int8_t)insn.operand, (sm.sr & SM_STATUS_Z) != 0);
 }
 
-void SM_Opcode_BCS(submcu_t& sm, uint8_t opcode) // b0
+void SM_Opcode_BCC(submcu_t& sm, const SM_Instruction& insn) // 90
 {
-    (void)opcode;
-    int8_t diff = SM_ReadAdvance(sm);
-    if ((sm.sr & SM_STATUS_C) != 0)
-        sm.pc += diff;
+    SM_Branch(sm, (int8_t)insn.operand, (sm.sr & SM_STATUS_C) == 0);
 }
 
-void SM_Opcode_LDM(submcu_t& sm, uint8_t opcode) // 3c
+void SM_Opcode_BCS(submcu_t& sm, const SM_Instruction& insn) // b0
 {
-    (void)opcode;
-    uint8_t val = SM_ReadAdvance(sm);
-    SM_Write(sm, SM_ReadAdvance(sm), val);
+    SM_Branch(sm, (int8_t)insn.operand, (sm.sr & SM_STATUS_C) != 0);
 }
 
-void SM_Opcode_LDA(submcu_t& sm, uint8_t opcode) // a9, a5, b5, ad, bd, b9, a1, b1
+void SM_Opcode_LDM(submcu_t& sm, const SM_Instruction& insn) // 3c
 {
-    uint8_t val = 0;
-    switch (opcode)
-    {
-        case 0xa9:
-            val = SM_ReadAdvance(sm);
-            break;
-        case 0xa5:
-            val = SM_Read(sm, SM_ReadAdvance(sm));
-            break;
-        case 0xb5:
-            val = SM_Read(sm, (SM_ReadAdvance(sm) + sm.x) & 0xff);
-            break;
-        case 0xad:
-            val = SM_Read(sm, SM_ReadAdvance16(sm));
-            break;
-        case 0xbd:
-            val = SM_Read(sm, SM_ReadAdvance16(sm) + sm.x);
-            break;
-        case 0xb9:
-            val = SM_Read(sm, SM_ReadAdvance16(sm) + sm.y);
-            break;
-        case 0xa1:
-            val = SM_Read(sm, SM_Read16(sm, (SM_ReadAdvance(sm) + sm.x) & 0xff));
-            break;
-        case 0xb1:
-            val = SM_Read(sm, SM_Read16(sm, SM_ReadAdvance(sm)) + sm.y);
-            break;
-    }
+    SM_Write(sm, insn.operand >> 8, insn.operand & 0xff);
+}
+
+void SM_Opcode_LDA(submcu_t& sm, const SM_Instruction& insn) // a9, a5, b5, ad, bd, b9, a1, b1
+{
+    uint8_t val = SM_ReadOperand(sm, insn);
 
     if ((sm.sr & SM_STATUS_T) == 0)
     {
@@ -660,29 +638,29 @@ void SM_Opcode_LDA(submcu_t& sm, uint8_t opcode) // a9, a5, b5, ad, bd, b9, a1,
     }
 }
 
-void SM_Opcode_CLI(submcu_t& sm, uint8_t opcode) // 58
+void SM_Opcode_CLI(submcu_t& sm, const SM_Instruction& insn) // 58
 {
-    (void)opcode;
+    (void)insn;
     SM_SetStatus(sm, 0, SM_STATUS_I);
 }
 
-void SM_Opcode_STP(submcu_t& sm, uint8_t opcode) // 42
+void SM_Opcode_STP(submcu_t& sm, const SM_Instruction& insn) // 42
 {
-    (void)opcode;
+    (void)insn;
     sm.sleep = 1;
 }
 
-void SM_Opcode_PHA(submcu_t& sm, uint8_t opcode) // 48
+void SM_Opcode_PHA(submcu_t& sm, const SM_Instruction& insn) // 48
 {
-    (void)opcode;
+    (void)insn;
     SM_PushStack(sm, sm.a);
 }
 
-void SM_Opcode_SEB_CLB(submcu_t& sm, uint8_t opcode)
+void SM_Opcode_SEB_CLB(submcu_t& sm, const SM_Instruction& insn)
 {
-    int32_t zp   = (opcode & 4) != 0;
-    int32_t bit  = (opcode >> 5) & 7;
-    int32_t type = (opcode >> 4) & 1;
+    int32_t zp   = insn.mode == SM_MODE_ZERO_PAGE;
+    int32_t bit  = (insn.opcode >> 5) & 7;
+    int32_t type = (insn.opcode >> 4) & 1;
     uint8_t val  = 0;
     uint8_t dest = 0;
 
@@ -692,7 +670,7 @@ void SM_Opcode_SEB_CLB(submcu_t& sm, uint8_t opcode)
     }
     else
     {
-        dest = SM_ReadAdvance(sm);
+        dest = (uint8_t)insn.operand;
         val  = SM_Read(sm, dest);
     }
 
@@ -711,119 +689,72 @@ void SM_Opcode_SEB_CLB(submcu_t& sm, uint8_t opcode)
     }
 }
 
-void SM_Opcode_RTI(submcu_t& sm, uint8_t opcode) // 40
+void SM_Opcode_RTI(submcu_t& sm, const SM_Instruction& insn) // 40
 {
-    (void)opcode;
+    (void)insn;
     sm.sr  = SM_PopStack(sm);
     sm.pc  = SM_PopStack(sm);
     sm.pc |= SM_PopStack(sm) << 8;
+
+    sm.nz_pending = 0;
+
+    if (sm.mcu->profiler)
+        sm.mcu->profiler->sm_stack.Unwind(sm.s);
 }
 
-void SM_Opcode_PLA(submcu_t& sm, uint8_t opcode) // 68
+void SM_Opcode_PLA(submcu_t& sm, const SM_Instruction& insn) // 68
 {
-    (void)opcode;
+    (void)insn;
     sm.a = SM_PopStack(sm);
     SM_Update_NZ(sm, sm.a);
 }
 
-void SM_Opcode_BRA(submcu_t& sm, uint8_t opcode) // 80
+void SM_Opcode_BRA(submcu_t& sm, const SM_Instruction& insn) // 80
 {
-    (void)opcode;
-    int8_t disp = SM_ReadAdvance(sm);
-    sm.pc      += disp;
+    SM_Branch(sm, (int8_t)insn.operand, true);
 }
 
-void SM_Opcode_JSR(submcu_t& sm, uint8_t opcode) // 20, 02, 22
+void SM_Opcode_JSR(submcu_t& sm, const SM_Instruction& insn) // 20, 02, 22
 {
-    uint16_t newpc = 0;
-    switch (opcode)
-    {
-        case 0x20:
-            newpc = SM_ReadAdvance16(sm);
-            break;
-        case 0x02:
-            newpc = SM_Read16(sm, SM_ReadAdvance(sm));
-            break;
-        case 0x22:
-            newpc = 0xff00 | SM_ReadAdvance(sm);
-            break;
-    }
+    uint16_t newpc = SM_OperandAddress(sm, insn);
 
     SM_PushStack(sm, sm.pc >> 8);
     SM_PushStack(sm, sm.pc & 0xff);
     sm.pc = newpc;
+
+    if (sm.mcu->profiler)
+        sm.mcu->profiler->sm_stack.Call(sm.pc, sm.s);
 }
 
-void SM_Opcode_CMP(submcu_t& sm, uint8_t opcode) // c9, c5, d5, cd, dd, d9, c1, d1
+void SM_Opcode_CMP(submcu_t& sm, const SM_Instruction& insn) // c9, c5, d5, cd, dd, d9, c1, d1
 {
-    uint8_t operand = 0;
-    switch (opcode)
-    {
-        case 0xc9:
-            operand = SM_ReadAdvance(sm);
-            break;
-        case 0xc5:
-            operand = SM_Read(sm, SM_ReadAdvance(sm));
-            break;
-        case 0xd5:
-            operand = SM_Read(sm, (SM_ReadAdvance(sm)+sm.x)&0xff);
-            break;
-        case 0xcd:
-            operand = SM_Read(sm, SM_ReadAdvance16(sm));
-            break;
-        case 0xdd:
-            operand = SM_Read(sm, SM_ReadAdvance16(sm) + sm.x);
-            break;
-        case 0xd9:
-            operand = SM_Read(sm, SM_ReadAdvance16(sm) + sm.y);
-            break;
-        case 0xc1:
-            operand = SM_Read(sm, SM_Read16(sm, (SM_ReadAdvance(sm) + sm.x) & 0xff));
-            break;
-        case 0xd1:
-            operand = SM_Read(sm, SM_Read16(sm, SM_ReadAdvance(sm)) + sm.y);
-            break;
-    }
-    int diff = sm.a - operand;
-    SM_SetStatus(sm, (diff & 0x100) == 0, SM_STATUS_C);
-    SM_Update_NZ(sm, diff & 0xff);
+    SM_Compare(sm, sm.a, SM_ReadOperand(sm, insn));
 }
 
-void SM_Opcode_BNE(submcu_t& sm, uint8_t opcode) // d0
+void SM_Opcode_BNE(submcu_t& sm, const SM_Instruction& insn) // d0
 {
-    (void)opcode;
-    int8_t diff = SM_ReadAdvance(sm);
-    if ((sm.sr & SM_STATUS_Z) == 0)
-        sm.pc += diff;
+    SM_SyncFlags(sm);
+    SM_Branch(sm, (int8_t)insn.operand, (sm.sr & SM_STATUS_Z) == 0);
 }
 
-void SM_Opcode_RTS(submcu_t& sm, uint8_t opcode) // 60
+void SM_Opcode_RTS(submcu_t& sm, const SM_Instruction& insn) // 60
 {
-    (void)opcode;
+    (void)insn;
     sm.pc  = SM_PopStack(sm);
     sm.pc |= SM_PopStack(sm) << 8;
+
+    if (sm.mcu->profiler)
+        sm.mcu->profiler->sm_stack.Unwind(sm.s);
 }
 
-void SM_Opcode_JMP(submcu_t& sm, uint8_t opcode) // 4c, 6c, b2
+void SM_Opcode_JMP(submcu_t& sm, const SM_Instruction& insn) // 4c, 6c, b2
 {
-    switch (opcode)
-    {
-        case 0x4c:
-            sm.pc = SM_ReadAdvance16(sm);
-            break;
-        case 0x6c:
-            sm.pc = SM_Read16(sm, SM_ReadAdvance16(sm));
-            break;
-        case 0xb2:
-            sm.pc = SM_Read16(sm, SM_ReadAdvance(sm));
-            break;
-    }
+    sm.pc = SM_OperandAddress(sm, insn);
 }
 
-void SM_Opcode_ORA(submcu_t& sm, uint8_t opcode) // 09, 05, 15, 0d, 1d, 01, 11
+void SM_Opcode_ORA(submcu_t& sm, const SM_Instruction& insn) // 09, 05, 15, 0d, 1d, 01, 11
 {
-    uint8_t val  = 0;
-    uint8_t val2 = 0;
+    uint8_t val = 0;
 
     if ((sm.sr & SM_STATUS_T) == 0)
     {
@@ -835,35 +766,7 @@ void SM_Opcode_ORA(submcu_t& sm, uint8_t opcode) // 09, 05, 15, 0d, 1d, 01, 11
         val = SM_Read(sm, sm.x);
     }
 
-    switch (opcode)
-    {
-        case 0x09:
-            val2 = SM_ReadAdvance(sm);
-            break;
-        case 0x05:
-            val2 = SM_Read(sm, SM_ReadAdvance(sm));
-            break;
-        case 0x15:
-            val2 = SM_Read(sm, (SM_ReadAdvance(sm) + sm.x) & 0xff);
-            break;
-        case 0x0d:
-            val2 = SM_Read(sm, SM_ReadAdvance16(sm));
-            break;
-        case 0x1d:
-            val2 = SM_Read(sm, SM_ReadAdvance16(sm) + sm.x);
-            break;
-        case 0x19:
-            val2 = SM_Read(sm, SM_ReadAdvance16(sm) + sm.y);
-            break;
-        case 0x01:
-            val2 = SM_Read(sm, SM_Read16(sm, (SM_ReadAdvance(sm) + sm.x) & 0xff));
-            break;
-        case 0x11:
-            val2 = SM_Read(sm, SM_Read16(sm, SM_ReadAdvance(sm)) + sm.y);
-            break;
-    }
-
-    val |= val2;
+    val |= SM_ReadOperand(sm, insn);
 
     if ((sm.sr & SM_STATUS_T) == 0)
     {
@@ -878,110 +781,65 @@ void SM_Opcode_ORA(submcu_t& sm, uint8_t opcode) // 09, 05, 15, 0d, 1d, 01, 11
     }
 }
 
-void SM_Opcode_DEC(submcu_t& sm, uint8_t opcode) // 1a, c6, d6, ce, de
+void SM_Opcode_DEC(submcu_t& sm, const SM_Instruction& insn) // 1a, c6, d6, ce, de
 {
-    uint8_t val   = 0;
-    uint16_t dest = 0;
-    switch (opcode)
+    if (insn.mode == SM_MODE_IMPLIED)
     {
-        case 0x1a:
-            sm.a--;
-            SM_Update_NZ(sm, sm.a);
-            return;
-        case 0xc6:
-            dest = SM_ReadAdvance(sm);
-            break;
-        case 0xd6:
-            dest = (SM_ReadAdvance(sm) + sm.x) & 0xff;
-            break;
-        case 0xce:
-            dest = SM_ReadAdvance16(sm);
-            break;
-        case 0xde:
-            dest = SM_ReadAdvance16(sm) + sm.x;
-            break;
+        sm.a--;
+        SM_Update_NZ(sm, sm.a);
+        return;
     }
-    val = SM_Read(sm, dest);
+    uint16_t dest = SM_OperandAddress(sm, insn);
+    uint8_t  val  = SM_Read(sm, dest);
     val--;
     SM_Write(sm, dest, val);
     SM_Update_NZ(sm, val);
 }
 
-void SM_Opcode_TAX(submcu_t& sm, uint8_t opcode) // aa
+void SM_Opcode_TAX(submcu_t& sm, const SM_Instruction& insn) // aa
 {
-    (void)opcode;
+    (void)insn;
     sm.x = sm.a;
     SM_Update_NZ(sm, sm.x);
 }
 
-void SM_Opcode_STX(submcu_t& sm, uint8_t opcode) // 86 96 8e
+void SM_Opcode_STX(submcu_t& sm, const SM_Instruction& insn) // 86 96 8e
 {
-    uint16_t dest = 0;
-    switch (opcode)
-    {
-        case 0x86:
-            dest = SM_ReadAdvance(sm);
-            break;
-        case 0x96:
-            dest = SM_ReadAdvance(sm) + sm.x;
-            break;
-        case 0x8e:
-            dest = SM_ReadAdvance16(sm);
-            break;
-    }
-
-    SM_Write(sm, dest, sm.x);
+    SM_Write(sm, SM_OperandAddress(sm, insn), sm.x);
 }
 
-void SM_Opcode_STY(submcu_t& sm, uint8_t opcode) // 84 8c 94
+void SM_Opcode_STY(submcu_t& sm, const SM_Instruction& insn) // 84 8c 94
 {
-    uint16_t dest = 0;
-    switch (opcode)
-    {
-        case 0x84:
-            dest = SM_ReadAdvance(sm);
-            break;
-        case 0x94:
-            dest = (SM_ReadAdvance(sm) + sm.x) & 0xff;
-            break;
-        case 0x8c:
-            dest = SM_ReadAdvance16(sm);
-            break;
-    }
-
-    SM_Write(sm, dest, sm.y);
+    SM_Write(sm, SM_OperandAddress(sm, insn), sm.y);
 }
 
-void SM_Opcode_SEC(submcu_t& sm, uint8_t opcode) // 38
+void SM_Opcode_SEC(submcu_t& sm, const SM_Instruction& insn) // 38
 {
-    (void)opcode;
+    (void)insn;
     SM_SetStatus(sm, 1, SM_STATUS_C);
 }
 
-void SM_Opcode_NOP(submcu_t& sm, uint8_t opcode) // EA
+void SM_Opcode_NOP(submcu_t& sm, const SM_Instruction& insn) // EA
 {
     (void)sm;
-    (void)opcode;
+    (void)insn;
 }
 
-void SM_Opcode_BPL_BMI(submcu_t& sm, uint8_t opcode) // 10
+void SM_Opcode_BPL_BMI(submcu_t& sm, const SM_Instruction& insn) // 10
 {
-    (void)opcode;
-    int8_t diff = SM_ReadAdvance(sm);
-    if ((sm.sr & SM_STATUS_N) == ((opcode & 0x20) == 0x20))
-        sm.pc += diff;
+    SM_SyncFlags(sm);
+    SM_Branch(sm, (int8_t)insn.operand, (sm.sr & SM_STATUS_N) == ((insn.opcode & 0x20) == 0x20));
 }
 
-void SM_Opcode_CLC(submcu_t& sm, uint8_t opcode) // 18
+void SM_Opcode_CLC(submcu_t& sm, const SM_Instruction& insn) // 18
 {
-    (void)opcode;
+    (void)insn;
     SM_SetStatus(sm, 0, SM_STATUS_C);
 }
 
-void SM_Opcode_AND(submcu_t& sm, uint8_t opcode) // 29, 25, 35, 2d, 3d, 21, 31
+void SM_Opcode_AND(submcu_t& sm, const SM_Instruction& insn) // 29, 25, 35, 2d, 3d, 21, 31
 {
-    uint8_t val  = 0;
-    uint8_t val2 = 0;
+    uint8_t val = 0;
 
     if ((sm.sr & SM_STATUS_T) == 0)
     {
@@ -993,35 +851,7 @@ void SM_Opcode_AND(submcu_t& sm, uint8_t opcode) // 29, 25, 35, 2d, 3d, 21, 31
         val = SM_Read(sm, sm.x);
     }
 
-    switch (opcode)
-    {
-        case 0x29:
-            val2 = SM_ReadAdvance(sm);
-            break;
-        case 0x25:
-            val2 = SM_Read(sm, SM_ReadAdvance(sm));
-            break;
-        case 0x35:
-            val2 = SM_Read(sm, (SM_ReadAdvance(sm) + sm.x) & 0xff);
-            break;
-        case 0x2d:
-            val2 = SM_Read(sm, SM_ReadAdvance16(sm));
-            break;
-        case 0x3d:
-            val2 = SM_Read(sm, SM_ReadAdvance16(sm) + sm.x);
-            break;
-        case 0x39:
-            val2 = SM_Read(sm, SM_ReadAdvance16(sm) + sm.y);
-            break;
-        case 0x21:
-            val2 = SM_Read(sm, SM_Read16(sm, (SM_ReadAdvance(sm) + sm.x) & 0xff));
-            break;
-        case 0x31:
-            val2 = SM_Read(sm, SM_Read16(sm, SM_ReadAdvance(sm)) + sm.y);
-            break;
-    }
-
-    val &= val2;
+    val &= SM_ReadOperand(sm, insn);
 
     if ((sm.sr & SM_STATUS_T) == 0)
     {
@@ -1036,305 +866,380 @@ void SM_Opcode_AND(submcu_t& sm, uint8_t opcode) // 29, 25, 35, 2d, 3d, 21, 31
     }
 }
 
-void SM_Opcode_INC(submcu_t& sm, uint8_t opcode) // 3a, e6, f6, ee, fe
+void SM_Opcode_INC(submcu_t& sm, const SM_Instruction& insn) // 3a, e6, f6, ee, fe
 {
-    uint8_t val   = 0;
-    uint16_t dest = 0;
-    switch (opcode)
+    if (insn.mode == SM_MODE_IMPLIED)
     {
-        case 0x3a:
-            sm.a++;
-            SM_Update_NZ(sm, sm.a);
-            return;
-        case 0xe6:
-            dest = SM_ReadAdvance(sm);
-            break;
-        case 0xf6:
-            dest = (SM_ReadAdvance(sm) + sm.x) & 0xff;
-            break;
-        case 0xee:
-            dest = SM_ReadAdvance16(sm);
-            break;
-        case 0xfe:
-            dest = SM_ReadAdvance16(sm) + sm.x;
-            break;
+        sm.a++;
+        SM_Update_NZ(sm, sm.a);
+        return;
     }
-    val = SM_Read(sm, dest);
+    uint16_t dest = SM_OperandAddress(sm, insn);
+    uint8_t  val  = SM_Read(sm, dest);
     val++;
     SM_Write(sm, dest, val);
     SM_Update_NZ(sm, val);
 }
 
-void (*SM_Opcode_Table[256])(submcu_t& sm, uint8_t opcode)
-{
-    SM_Opcode_NotImplemented, // 00
-    SM_Opcode_ORA,            // 01
-    SM_Opcode_JSR,            // 02
-    SM_Opcode_BBC_BBS,        // 03
-    SM_Opcode_NotImplemented, // 04
-    SM_Opcode_ORA,            // 05
-    SM_Opcode_NotImplemented, // 06
-    SM_Opcode_BBC_BBS,        // 07
-    SM_Opcode_NotImplemented, // 08
-    SM_Opcode_ORA,            // 09
-    SM_Opcode_NotImplemented, // 0a
-    SM_Opcode_SEB_CLB,        // 0b
-    SM_Opcode_NotImplemented, // 0c
-    SM_Opcode_ORA,            // 0d
-    SM_Opcode_NotImplemented, // 0e
-    SM_Opcode_SEB_CLB,        // 0f
-    SM_Opcode_BPL_BMI,        // 10
-    SM_Opcode_ORA,            // 11
-    SM_Opcode_CLT,            // 12
-    SM_Opcode_BBC_BBS,        // 13
-    SM_Opcode_NotImplemented, // 14
-    SM_Opcode_ORA,            // 15
-    SM_Opcode_NotImplemented, // 16
-    SM_Opcode_BBC_BBS,        // 17
-    SM_Opcode_CLC,            // 18
-    SM_Opcode_ORA,            // 19
-    SM_Opcode_DEC,            // 1a
-    SM_Opcode_SEB_CLB,        // 1b
-    SM_Opcode_NotImplemented, // 1c
-    SM_Opcode_ORA,            // 1d
-    SM_Opcode_NotImplemented, // 1e
-    SM_Opcode_SEB_CLB,        // 1f
-    SM_Opcode_JSR,            // 20
-    SM_Opcode_AND,            // 21
-    SM_Opcode_JSR,            // 22
-    SM_Opcode_BBC_BBS,        // 23
-    SM_Opcode_NotImplemented, // 24
-    SM_Opcode_AND,            // 25
-    SM_Opcode_NotImplemented, // 26
-    SM_Opcode_BBC_BBS,        // 27
-    SM_Opcode_NotImplemented, // 28
-    SM_Opcode_AND,            // 29
-    SM_Opcode_NotImplemented, // 2a
-    SM_Opcode_SEB_CLB,        // 2b
-    SM_Opcode_NotImplemented, // 2c
-    SM_Opcode_AND,            // 2d
-    SM_Opcode_NotImplemented, // 2e
-    SM_Opcode_SEB_CLB,        // 2f
-    SM_Opcode_BPL_BMI,        // 30
-    SM_Opcode_AND,            // 31
-    SM_Opcode_NotImplemented, // 32
-    SM_Opcode_BBC_BBS,        // 33
-    SM_Opcode_NotImplemented, // 34
-    SM_Opcode_AND,            // 35
-    SM_Opcode_NotImplemented, // 36
-    SM_Opcode_BBC_BBS,        // 37
-    SM_Opcode_SEC,            // 38
-    SM_Opcode_AND,            // 39
-    SM_Opcode_INC,            // 3a
-    SM_Opcode_SEB_CLB,        // 3b
-    SM_Opcode_LDM,            // 3c
-    SM_Opcode_AND,            // 3d
-    SM_Opcode_NotImplemented, // 3e
-    SM_Opcode_SEB_CLB,        // 3f
-    SM_Opcode_RTI,            // 40
-    SM_Opcode_NotImplemented, // 41
-    SM_Opcode_STP,            // 42
-    SM_Opcode_BBC_BBS,        // 43
-    SM_Opcode_NotImplemented, // 44
-    SM_Opcode_NotImplemented, // 45
-    SM_Opcode_NotImplemented, // 46
-    SM_Opcode_BBC_BBS,        // 47
-    SM_Opcode_PHA,            // 48
-    SM_Opcode_NotImplemented, // 49
-    SM_Opcode_NotImplemented, // 4a
-    SM_Opcode_SEB_CLB,        // 4b
-    SM_Opcode_JMP,            // 4c
-    SM_Opcode_NotImplemented, // 4d
-    SM_Opcode_NotImplemented, // 4e
-    SM_Opcode_SEB_CLB,        // 4f
-    SM_Opcode_NotImplemented, // 50
-    SM_Opcode_NotImplemented, // 51
-    SM_Opcode_NotImplemented, // 52
-    SM_Opcode_BBC_BBS,        // 53
-    SM_Opcode_NotImplemented, // 54
-    SM_Opcode_NotImplemented, // 55
-    SM_Opcode_NotImplemented, // 56
-    SM_Opcode_BBC_BBS,        // 57
-    SM_Opcode_CLI,            // 58
-    SM_Opcode_NotImplemented, // 59
-    SM_Opcode_NotImplemented, // 5a
-    SM_Opcode_SEB_CLB,        // 5b
-    SM_Opcode_NotImplemented, // 5c
-    SM_Opcode_NotImplemented, // 5d
-    SM_Opcode_NotImplemented, // 5e
-    SM_Opcode_SEB_CLB,        // 5f
-    SM_Opcode_RTS,            // 60
-    SM_Opcode_NotImplemented, // 61
-    SM_Opcode_NotImplemented, // 62
-    SM_Opcode_BBC_BBS,        // 63
-    SM_Opcode_NotImplemented, // 64
-    SM_Opcode_NotImplemented, // 65
-    SM_Opcode_NotImplemented, // 66
-    SM_Opcode_BBC_BBS,        // 67
-    SM_Opcode_PLA,            // 68
-    SM_Opcode_NotImplemented, // 69
-    SM_Opcode_NotImplemented, // 6a
-    SM_Opcode_SEB_CLB,        // 6b
-    SM_Opcode_JMP,            // 6c
-    SM_Opcode_NotImplemented, // 6d
-    SM_Opcode_NotImplemented, // 6e
-    SM_Opcode_SEB_CLB,        // 6f
-    SM_Opcode_NotImplemented, // 70
-    SM_Opcode_NotImplemented, // 71
-    SM_Opcode_NotImplemented, // 72
-    SM_Opcode_BBC_BBS,        // 73
-    SM_Opcode_NotImplemented, // 74
-    SM_Opcode_NotImplemented, // 75
-    SM_Opcode_NotImplemented, // 76
-    SM_Opcode_BBC_BBS,        // 77
-    SM_Opcode_SEI,            // 78
-    SM_Opcode_NotImplemented, // 79
-    SM_Opcode_NotImplemented, // 7a
-    SM_Opcode_SEB_CLB,        // 7b
-    SM_Opcode_NotImplemented, // 7c
-    SM_Opcode_NotImplemented, // 7d
-    SM_Opcode_NotImplemented, // 7e
-    SM_Opcode_SEB_CLB,        // 7f
-    SM_Opcode_BRA,            // 80
-    SM_Opcode_STA,            // 81
-    SM_Opcode_NotImplemented, // 82
-    SM_Opcode_BBC_BBS,        // 83
-    SM_Opcode_STY,            // 84
-    SM_Opcode_STA,            // 85
-    SM_Opcode_STX,            // 86
-    SM_Opcode_BBC_BBS,        // 87
-    SM_Opcode_NotImplemented, // 88
-    SM_Opcode_NotImplemented, // 89
-    SM_Opcode_TXA,            // 8a
-    SM_Opcode_SEB_CLB,        // 8b
-    SM_Opcode_STY,            // 8c
-    SM_Opcode_STA,            // 8d
-    SM_Opcode_STX,            // 8e
-    SM_Opcode_SEB_CLB,        // 8f
-    SM_Opcode_BCC,            // 90
-    SM_Opcode_STA,            // 91
-    SM_Opcode_NotImplemented, // 92
-    SM_Opcode_BBC_BBS,        // 93
-    SM_Opcode_STY,            // 94
-    SM_Opcode_STA,            // 95
-    SM_Opcode_STX,            // 96
-    SM_Opcode_BBC_BBS,        // 97
-    SM_Opcode_NotImplemented, // 98
-    SM_Opcode_STA,            // 99
-    SM_Opcode_TXS,            // 9a
-    SM_Opcode_SEB_CLB,        // 9b
-    SM_Opcode_NotImplemented, // 9c
-    SM_Opcode_STA,            // 9d
-    SM_Opcode_NotImplemented, // 9e
-    SM_Opcode_SEB_CLB,        // 9f
-    SM_Opcode_LDY,            // a0
-    SM_Opcode_LDA,            // a1
-    SM_Opcode_LDX,            // a2
-    SM_Opcode_BBC_BBS,        // a3
-    SM_Opcode_LDY,            // a4
-    SM_Opcode_LDA,            // a5
-    SM_Opcode_LDX,            // a6
-    SM_Opcode_BBC_BBS,        // a7
-    SM_Opcode_NotImplemented, // a8
-    SM_Opcode_LDA,            // a9
-    SM_Opcode_TAX,            // aa
-    SM_Opcode_SEB_CLB,        // ab
-    SM_Opcode_LDY,            // ac
-    SM_Opcode_LDA,            // ad
-    SM_Opcode_LDX,            // ae
-    SM_Opcode_SEB_CLB,        // af
-    SM_Opcode_BCS,            // b0
-    SM_Opcode_LDA,            // b1
-    SM_Opcode_JMP,            // b2
-    SM_Opcode_BBC_BBS,        // b3
-    SM_Opcode_LDY,            // b4
-    SM_Opcode_LDA,            // b5
-    SM_Opcode_LDX,            // b6
-    SM_Opcode_BBC_BBS,        // b7
-    SM_Opcode_NotImplemented, // b8
-    SM_Opcode_LDA,            // b9
-    SM_Opcode_NotImplemented, // ba
-    SM_Opcode_SEB_CLB,        // bb
-    SM_Opcode_LDY,            // bc
-    SM_Opcode_LDA,            // bd
-    SM_Opcode_LDX,            // be
-    SM_Opcode_SEB_CLB,        // bf
-    SM_Opcode_CPY,            // c0
-    SM_Opcode_CMP,            // c1
-    SM_Opcode_NotImplemented, // c2
-    SM_Opcode_BBC_BBS,        // c3
-    SM_Opcode_CPY,            // c4
-    SM_Opcode_CMP,            // c5
-    SM_Opcode_DEC,            // c6
-    SM_Opcode_BBC_BBS,        // c7
-    SM_Opcode_INY,            // c8
-    SM_Opcode_CMP,            // c9
-    SM_Opcode_NotImplemented, // ca
-    SM_Opcode_SEB_CLB,        // cb
-    SM_Opcode_CPY,            // cc
-    SM_Opcode_CMP,            // cd
-    SM_Opcode_DEC,            // ce
-    SM_Opcode_SEB_CLB,         // cf
-    SM_Opcode_BNE,            // d0
-    SM_Opcode_CMP,            // d1
-    SM_Opcode_NotImplemented, // d2
-    SM_Opcode_BBC_BBS,        // d3
-    SM_Opcode_NotImplemented, // d4
-    SM_Opcode_CMP,            // d5
-    SM_Opcode_DEC,            // d6
-    SM_Opcode_BBC_BBS,        // d7
-    SM_Opcode_CLD,            // d8
-    SM_Opcode_CMP,            // d9
-    SM_Opcode_NotImplemented, // da
-    SM_Opcode_SEB_CLB,        // db
-    SM_Opcode_NotImplemented, // dc
-    SM_Opcode_CMP,            // dd
-    SM_Opcode_DEC,            // de
-    SM_Opcode_SEB_CLB,        // df
-    SM_Opcode_CPX,            // e0
-    SM_Opcode_NotImplemented, // e1
-    SM_Opcode_NotImplemented, // e2
-    SM_Opcode_BBC_BBS,        // e3
-    SM_Opcode_CPX,            // e4
-    SM_Opcode_NotImplemented, // e5
-    SM_Opcode_INC,            // e6
-    SM_Opcode_BBC_BBS,        // e7
-    SM_Opcode_INX,            // e8
-    SM_Opcode_NotImplemented, // e9
-    SM_Opcode_NOP,            // ea
-    SM_Opcode_SEB_CLB,        // eb
-    SM_Opcode_CPX,            // ec
-    SM_Opcode_NotImplemented, // ed
-    SM_Opcode_INC,            // ee
-    SM_Opcode_SEB_CLB,        // ef
-    SM_Opcode_BEQ,            // f0
-    SM_Opcode_NotImplemented, // f1
-    SM_Opcode_NotImplemented, // f2
-    SM_Opcode_BBC_BBS,        // f3
-    SM_Opcode_NotImplemented, // f4
-    SM_Opcode_NotImplemented, // f5
-    SM_Opcode_INC,            // f6
-    SM_Opcode_BBC_BBS,        // f7
-    SM_Opcode_NotImplemented, // f8
-    SM_Opcode_NotImplemented, // f9
-    SM_Opcode_NotImplemented, // fa
-    SM_Opcode_SEB_CLB,        // fb
-    SM_Opcode_NotImplemented, // fc
-    SM_Opcode_NotImplemented, // fd
-    SM_Opcode_INC,            // fe
-    SM_Opcode_SEB_CLB,        // ff
+struct SM_OpcodeInfo
+{
+    sm_opcode_handler handler;
+    uint8_t mode;
 };
 
+const SM_OpcodeInfo SM_Opcode_Table[256] = {
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 00
+    {SM_Opcode_ORA,            SM_MODE_INDIRECT_X},            // 01
+    {SM_Opcode_JSR,            SM_MODE_ZERO_PAGE_INDIRECT},    // 02
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // 03
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 04
+    {SM_Opcode_ORA,            SM_MODE_ZERO_PAGE},             // 05
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 06
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // 07
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 08
+    {SM_Opcode_ORA,            SM_MODE_IMMEDIATE},             // 09
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 0a
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // 0b
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 0c
+    {SM_Opcode_ORA,            SM_MODE_ABSOLUTE},              // 0d
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 0e
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // 0f
+    {SM_Opcode_BPL_BMI,        SM_MODE_RELATIVE},              // 10
+    {SM_Opcode_ORA,            SM_MODE_INDIRECT_Y},            // 11
+    {SM_Opcode_CLT,            SM_MODE_IMPLIED},               // 12
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // 13
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 14
+    {SM_Opcode_ORA,            SM_MODE_ZERO_PAGE_X},           // 15
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 16
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // 17
+    {SM_Opcode_CLC,            SM_MODE_IMPLIED},               // 18
+    {SM_Opcode_ORA,            SM_MODE_ABSOLUTE_Y},            // 19
+    {SM_Opcode_DEC,            SM_MODE_IMPLIED},               // 1a
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // 1b
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 1c
+    {SM_Opcode_ORA,            SM_MODE_ABSOLUTE_X},            // 1d
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 1e
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // 1f
+    {SM_Opcode_JSR,            SM_MODE_ABSOLUTE},              // 20
+    {SM_Opcode_AND,            SM_MODE_INDIRECT_X},            // 21
+    {SM_Opcode_JSR,            SM_MODE_SPECIAL_PAGE},          // 22
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // 23
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 24
+    {SM_Opcode_AND,            SM_MODE_ZERO_PAGE},             // 25
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 26
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // 27
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 28
+    {SM_Opcode_AND,            SM_MODE_IMMEDIATE},             // 29
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 2a
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // 2b
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 2c
+    {SM_Opcode_AND,            SM_MODE_ABSOLUTE},              // 2d
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 2e
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // 2f
+    {SM_Opcode_BPL_BMI,        SM_MODE_RELATIVE},              // 30
+    {SM_Opcode_AND,            SM_MODE_INDIRECT_Y},            // 31
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 32
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // 33
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 34
+    {SM_Opcode_AND,            SM_MODE_ZERO_PAGE_X},           // 35
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 36
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // 37
+    {SM_Opcode_SEC,            SM_MODE_IMPLIED},               // 38
+    {SM_Opcode_AND,            SM_MODE_ABSOLUTE_Y},            // 39
+    {SM_Opcode_INC,            SM_MODE_IMPLIED},               // 3a
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // 3b
+    {SM_Opcode_LDM,            SM_MODE_IMMEDIATE_ZERO_PAGE},   // 3c
+    {SM_Opcode_AND,            SM_MODE_ABSOLUTE_X},            // 3d
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 3e
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // 3f
+    {SM_Opcode_RTI,            SM_MODE_IMPLIED},               // 40
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 41
+    {SM_Opcode_STP,            SM_MODE_IMPLIED},               // 42
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // 43
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 44
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 45
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 46
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // 47
+    {SM_Opcode_PHA,            SM_MODE_IMPLIED},               // 48
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 49
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 4a
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // 4b
+    {SM_Opcode_JMP,            SM_MODE_ABSOLUTE},              // 4c
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 4d
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 4e
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // 4f
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 50
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 51
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 52
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // 53
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 54
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 55
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 56
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // 57
+    {SM_Opcode_CLI,            SM_MODE_IMPLIED},               // 58
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 59
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 5a
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // 5b
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 5c
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 5d
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 5e
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // 5f
+    {SM_Opcode_RTS,            SM_MODE_IMPLIED},               // 60
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 61
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 62
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // 63
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 64
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 65
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 66
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // 67
+    {SM_Opcode_PLA,            SM_MODE_IMPLIED},               // 68
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 69
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 6a
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // 6b
+    {SM_Opcode_JMP,            SM_MODE_INDIRECT},              // 6c
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 6d
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 6e
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // 6f
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 70
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 71
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 72
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // 73
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 74
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 75
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 76
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // 77
+    {SM_Opcode_SEI,            SM_MODE_IMPLIED},               // 78
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 79
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 7a
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // 7b
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 7c
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 7d
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 7e
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // 7f
+    {SM_Opcode_BRA,            SM_MODE_RELATIVE},              // 80
+    {SM_Opcode_STA,            SM_MODE_INDIRECT_X},            // 81
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 82
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // 83
+    {SM_Opcode_STY,            SM_MODE_ZERO_PAGE},             // 84
+    {SM_Opcode_STA,            SM_MODE_ZERO_PAGE},             // 85
+    {SM_Opcode_STX,            SM_MODE_ZERO_PAGE},             // 86
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // 87
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 88
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 89
+    {SM_Opcode_TXA,            SM_MODE_IMPLIED},               // 8a
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // 8b
+    {SM_Opcode_STY,            SM_MODE_ABSOLUTE},              // 8c
+    {SM_Opcode_STA,            SM_MODE_ABSOLUTE},              // 8d
+    {SM_Opcode_STX,            SM_MODE_ABSOLUTE},              // 8e
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // 8f
+    {SM_Opcode_BCC,            SM_MODE_RELATIVE},              // 90
+    {SM_Opcode_STA,            SM_MODE_INDIRECT_Y},            // 91
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 92
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // 93
+    {SM_Opcode_STY,            SM_MODE_ZERO_PAGE_X},           // 94
+    {SM_Opcode_STA,            SM_MODE_ZERO_PAGE_X_LONG},      // 95
+    {SM_Opcode_STX,            SM_MODE_ZERO_PAGE_X_LONG},      // 96
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // 97
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 98
+    {SM_Opcode_STA,            SM_MODE_ABSOLUTE_Y},            // 99
+    {SM_Opcode_TXS,            SM_MODE_IMPLIED},               // 9a
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // 9b
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 9c
+    {SM_Opcode_STA,            SM_MODE_ABSOLUTE_X},            // 9d
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // 9e
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // 9f
+    {SM_Opcode_LDY,            SM_MODE_IMMEDIATE},             // a0
+    {SM_Opcode_LDA,            SM_MODE_INDIRECT_X},            // a1
+    {SM_Opcode_LDX,            SM_MODE_IMMEDIATE},             // a2
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // a3
+    {SM_Opcode_LDY,            SM_MODE_ZERO_PAGE},             // a4
+    {SM_Opcode_LDA,            SM_MODE_ZERO_PAGE},             // a5
+    {SM_Opcode_LDX,            SM_MODE_ZERO_PAGE},             // a6
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // a7
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // a8
+    {SM_Opcode_LDA,            SM_MODE_IMMEDIATE},             // a9
+    {SM_Opcode_TAX,            SM_MODE_IMPLIED},               // aa
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // ab
+    {SM_Opcode_LDY,            SM_MODE_ABSOLUTE},              // ac
+    {SM_Opcode_LDA,            SM_MODE_ABSOLUTE},              // ad
+    {SM_Opcode_LDX,            SM_MODE_ABSOLUTE},              // ae
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // af
+    {SM_Opcode_BCS,            SM_MODE_RELATIVE},              // b0
+    {SM_Opcode_LDA,            SM_MODE_INDIRECT_Y},            // b1
+    {SM_Opcode_JMP,            SM_MODE_ZERO_PAGE_INDIRECT},    // b2
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // b3
+    {SM_Opcode_LDY,            SM_MODE_ZERO_PAGE_X},           // b4
+    {SM_Opcode_LDA,            SM_MODE_ZERO_PAGE_X},           // b5
+    {SM_Opcode_LDX,            SM_MODE_ZERO_PAGE_Y},           // b6
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // b7
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // b8
+    {SM_Opcode_LDA,            SM_MODE_ABSOLUTE_Y},            // b9
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // ba
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // bb
+    {SM_Opcode_LDY,            SM_MODE_ABSOLUTE_X},            // bc
+    {SM_Opcode_LDA,            SM_MODE_ABSOLUTE_X},            // bd
+    {SM_Opcode_LDX,            SM_MODE_ABSOLUTE_Y},            // be
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // bf
+    {SM_Opcode_CPY,            SM_MODE_IMMEDIATE},             // c0
+    {SM_Opcode_CMP,            SM_MODE_INDIRECT_X},            // c1
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // c2
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // c3
+    {SM_Opcode_CPY,            SM_MODE_ZERO_PAGE},             // c4
+    {SM_Opcode_CMP,            SM_MODE_ZERO_PAGE},             // c5
+    {SM_Opcode_DEC,            SM_MODE_ZERO_PAGE},             // c6
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // c7
+    {SM_Opcode_INY,            SM_MODE_IMPLIED},               // c8
+    {SM_Opcode_CMP,            SM_MODE_IMMEDIATE},             // c9
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // ca
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // cb
+    {SM_Opcode_CPY,            SM_MODE_ABSOLUTE},              // cc
+    {SM_Opcode_CMP,            SM_MODE_ABSOLUTE},              // cd
+    {SM_Opcode_DEC,            SM_MODE_ABSOLUTE},              // ce
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // cf
+    {SM_Opcode_BNE,            SM_MODE_RELATIVE},              // d0
+    {SM_Opcode_CMP,            SM_MODE_INDIRECT_Y},            // d1
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // d2
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // d3
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // d4
+    {SM_Opcode_CMP,            SM_MODE_ZERO_PAGE_X},           // d5
+    {SM_Opcode_DEC,            SM_MODE_ZERO_PAGE_X},           // d6
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // d7
+    {SM_Opcode_CLD,            SM_MODE_IMPLIED},               // d8
+    {SM_Opcode_CMP,            SM_MODE_ABSOLUTE_Y},            // d9
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // da
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // db
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // dc
+    {SM_Opcode_CMP,            SM_MODE_ABSOLUTE_X},            // dd
+    {SM_Opcode_DEC,            SM_MODE_ABSOLUTE_X},            // de
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // df
+    {SM_Opcode_CPX,            SM_MODE_IMMEDIATE},             // e0
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // e1
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // e2
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // e3
+    {SM_Opcode_CPX,            SM_MODE_ZERO_PAGE},             // e4
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // e5
+    {SM_Opcode_INC,            SM_MODE_ZERO_PAGE},             // e6
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // e7
+    {SM_Opcode_INX,            SM_MODE_IMPLIED},               // e8
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // e9
+    {SM_Opcode_NOP,            SM_MODE_IMPLIED},               // ea
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // eb
+    {SM_Opcode_CPX,            SM_MODE_ABSOLUTE},              // ec
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // ed
+    {SM_Opcode_INC,            SM_MODE_ABSOLUTE},              // ee
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // ef
+    {SM_Opcode_BEQ,            SM_MODE_RELATIVE},              // f0
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // f1
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // f2
+    {SM_Opcode_BBC_BBS,        SM_MODE_RELATIVE},              // f3
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // f4
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // f5
+    {SM_Opcode_INC,            SM_MODE_ZERO_PAGE_X},           // f6
+    {SM_Opcode_BBC_BBS,        SM_MODE_ZERO_PAGE_RELATIVE},    // f7
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // f8
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // f9
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // fa
+    {SM_Opcode_SEB_CLB,        SM_MODE_IMPLIED},               // fb
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // fc
+    {SM_Opcode_NotImplemented, SM_MODE_IMPLIED},               // fd
+    {SM_Opcode_INC,            SM_MODE_ABSOLUTE_X},            // fe
+    {SM_Opcode_SEB_CLB,        SM_MODE_ZERO_PAGE},             // ff
+};
+
+void SM_Decode(SM_Instruction& insn, uint8_t opcode, uint8_t byte1, uint8_t byte2)
+{
+    const SM_OpcodeInfo& info = SM_Opcode_Table[opcode];
+
+    insn.handler = info.handler;
+    insn.opcode  = opcode;
+    insn.mode    = info.mode;
+    insn.length  = SM_Mode_Length[info.mode];
+    insn.operand = 0;
+    if (insn.length >= 2)
+        insn.operand = byte1;
+    if (insn.length >= 3)
+        insn.operand |= byte2 << 8;
+}
+
+// Fetches the instruction at pc through SM_Read, for code outside rom.
+void SM_DecodeAdvance(submcu_t& sm, SM_Instruction& insn)
+{
+    const uint8_t opcode = SM_ReadAdvance(sm);
+    const uint8_t length = SM_Mode_Length[SM_Opcode_Table[opcode].mode];
+
+    uint8_t byte1 = 0;
+    uint8_t byte2 = 0;
+    if (length >= 2)
+        byte1 = SM_ReadAdvance(sm);
+    if (length >= 3)
+        byte2 = SM_ReadAdvance(sm);
+
+    SM_Decode(insn, opcode, byte1, byte2);
+}
+
+static std::shared_ptr<SM_DecodedRom> SM_DecodeRomImage(const uint8_t* rom)
+{
+    auto decoded = std::make_shared<SM_DecodedRom>();
+    const uint32_t rom_size = sizeof(decoded->rom);
+
+    memcpy(decoded->rom, rom, rom_size);
+    for (uint32_t address = 0; address < rom_size; ++address)
+    {
+        const uint8_t byte1 = address + 1 < rom_size ? rom[address + 1] : 0;
+        const uint8_t byte2 = address + 2 < rom_size ? rom[address + 2] : 0;
+
+        SM_Instruction& insn = decoded->code[address];
+        SM_Decode(insn, rom[address], byte1, byte2);
+
+        // The operand bytes would come from ram.
+        if (address + insn.length > rom_size)
+            insn.handler = nullptr;
+    }
+    return decoded;
+}
+
+// Finds the decoded image of sm.rom among those in use by other instances, or decodes it. Instances may be reset from
+// different threads.
+void SM_DecodeRom(submcu_t& sm)
+{
+    static std::mutex s_decoded_mutex;
+    static std::vector<std::weak_ptr<const SM_DecodedRom>> s_decoded;
+
+    if (sm.rom_code && memcmp(sm.rom_code->rom, sm.rom, sizeof(sm.rom)) == 0)
+        return;
+
+    std::scoped_lock lock(s_decoded_mutex);
+
+    std::erase_if(s_decoded, [](const auto& entry) { return entry.expired(); });
+    for (const auto& entry : s_decoded)
+    {
+        auto decoded = entry.lock();
+        if (decoded && memcmp(decoded->rom, sm.rom, sizeof(sm.rom)) == 0)
+        {
+            sm.rom_code = std::move(decoded);
+            return;
+        }
+    }
+
+    auto decoded = SM_DecodeRomImage(sm.rom);
+    s_decoded.emplace_back(decoded);
+    sm.rom_code = std::move(decoded);
+}
+
 void SM_StartVector(submcu_t& sm, uint32_t vector)
 {
     SM_PushStack(sm, sm.pc >> 8);
     SM_PushStack(sm, sm.pc & 0xff);
+    SM_SyncFlags(sm);
     SM_PushStack(sm, sm.sr);
 
     sm.sr   |= SM_STATUS_I;
     sm.sleep = 0;
 
     sm.pc = SM_GetVectorAddress(sm, vector);
+
+    if (sm.mcu->profiler)
+        sm.mcu->profiler->sm_stack.Call(EMU_CallStack::FRAME_INTERRUPT | sm.pc, sm.s);
 }
 
 void SM_HandleInterrupt(submcu_t& sm)
@@ -1449,7 +1354,7 @@ void SM_UpdateUART(submcu_t& sm)
     if ((sm.device_mode[SM_DEV_UART2_CTRL] & 4) == 0) // RX disabled
         return;
 
-    if (mcu.uart_write_ptr == mcu.uart_read_ptr) // no byte
+    if (!MCU_UART_HasByte(mcu)) // no byte
         return;
 
     if (sm.uart_rx_gotbyte)
@@ -1458,8 +1363,7 @@ void SM_UpdateUART(submcu_t& sm)
     if (sm.cycles < mcu.uart_rx_delay)
         return;
 
-    mcu.uart_rx_byte   = mcu.uart_buffer[mcu.uart_read_ptr];
-    mcu.uart_read_ptr  = (mcu.uart_read_ptr + 1) % uart_buffer_size;
+    mcu.uart_rx_byte   = MCU_UART_ReadByte(mcu);
 
     sm.uart_rx_gotbyte = 1;
     sm.device_mode[SM_DEV_INT_REQUEST] |= 0x40;
@@ -1489,15 +1393,29 @@ void SM_UpdateSerial(submcu_t& sm)
 
 void SM_Update(submcu_t& sm, uint64_t cycles)
 {
+    uint64_t steps = 0;
+
     while (sm.cycles < cycles * 5)
     {
+        ++steps;
+
         SM_HandleInterrupt(sm);
 
         if (!sm.sleep)
         {
-            uint8_t opcode = SM_ReadAdvance(sm);
-
-            SM_Opcode_Table[opcode](sm, opcode);
+            const uint16_t address = sm.pc & 0x1fff;
+            if ((address & 0x1000) && sm.rom_code->code[address & 0xfff].handler)
+            {
+                const SM_Instruction& insn = sm.rom_code->code[address & 0xfff];
+                sm.pc += insn.length;
+                insn.handler(sm, insn);
+            }
+            else
+            {
+                SM_Instruction insn;
+                SM_DecodeAdvance(sm, insn);
+                insn.handler(sm, insn);
+            }
         }
 
         sm.cycles += 12 * 4; // FIXME
@@ -1506,12 +1424,18 @@ void SM_Update(submcu_t& sm, uint64_t cycles)
         SM_UpdateUART(sm);
         SM_UpdateSerial(sm);
     }
+
+    if (sm.mcu->stats)
+        sm.mcu->stats->submcu_steps.Add(steps);
 }
 
 void SM_PostSerial(submcu_t& sm, uint8_t data)
 {
     sm.serial_buffer[sm.serial_write_ptr] = data;
     sm.serial_write_ptr = (sm.serial_write_ptr + 1) % sm.serial_buffer_size;
+
+    if (sm.mcu->stats)
+        sm.mcu->stats->uart_rx_bytes.Add();
 }
 
 void SM_SerialPostCallback(uint8_t data)
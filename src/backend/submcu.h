@@ -34,6 +34,7 @@
 #pragma once
 
 #include <cstdint>
+#include <memory>
 
 struct mcu_t;
 struct submcu_t;
@@ -56,17 +57,44 @@ typedef void (*sm_serial_update_callback)(submcu_t& sm);
 
 void SM_SerialPostCallback(uint8_t data);
 
+struct SM_Instruction;
+typedef void (*sm_opcode_handler)(submcu_t& sm, const SM_Instruction& insn);
+
+// An instruction with its operand bytes already fetched. `mode` is one of the SM_MODE_* addressing modes in
+// submcu.cpp.
+struct SM_Instruction {
+    sm_opcode_handler handler = nullptr;
+    // First operand byte in the low half, second in the high half.
+    uint16_t operand = 0;
+    uint8_t  opcode  = 0;
+    uint8_t  mode    = 0;
+    // Opcode and operand bytes.
+    uint8_t  length  = 0;
+};
+
+// A sub-MCU rom decoded at every address. An entry without a handler is an instruction that runs past the end of rom;
+// it is decoded as it executes. Every instance running the same rom shares one of these read-only.
+struct SM_DecodedRom {
+    uint8_t rom[4096]{};
+    SM_Instruction code[4096]{};
+};
+
 struct submcu_t {
     uint16_t pc     = 0;
     uint8_t a       = 0;
     uint8_t x       = 0;
     uint8_t y       = 0;
     uint8_t s       = 0;
+    // N and Z are only valid while nz_pending is 0; otherwise they follow from nz_result.
     uint8_t sr      = 0;
+    uint8_t nz_pending = 0;
+    uint8_t nz_result  = 0;
     uint64_t cycles = 0;
     uint8_t sleep   = 0;
     mcu_t* mcu      = nullptr;
     uint8_t rom[4096]{};
+    // rom decoded by SM_Reset, shared with every other instance that loaded the same rom.
+    std::shared_ptr<const SM_DecodedRom> rom_code;
 
     uint8_t ram[128]{};
     uint8_t shared_ram[192]{};
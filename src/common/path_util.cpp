@@ -1,5 +1,6 @@
 #include "path_util.h"
 #include <cstdio>
+#include <cstdlib>
 
 #if defined(_WIN32)
 #include <Windows.h>
@@ -46,4 +47,34 @@ std::filesystem::path GetProcessPath()
     return std::filesystem::path(path, path + (size_t)actual_size);
 }
 
+std::filesystem::path GetCacheDirectory()
+{
+#if defined(_WIN32)
+    const wchar_t* local_app_data = _wgetenv(L"LOCALAPPDATA");
+    if (local_app_data && *local_app_data)
+    {
+        return std::filesystem::path(local_app_data) / "nuked-sc55";
+    }
+#else
+    const char* home = getenv("HOME");
+#if defined(__APPLE__)
+    if (home && *home)
+    {
+        return std::filesystem::path(home) / "Library" / "Caches" / "nuked-sc55";
+    }
+#else
+    const char* xdg_cache_home = getenv("XDG_CACHE_HOME");
+    if (xdg_cache_home && *xdg_cache_home)
+    {
+        return std::filesystem::path(xdg_cache_home) / "nuked-sc55";
+    }
+    if (home && *home)
+    {
+        return std::filesystem::path(home) / ".cache" / "nuked-sc55";
+    }
+#endif
+#endif
+    return {};
+}
+
 }
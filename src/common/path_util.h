@@ -7,4 +7,8 @@ namespace common
 
 std::filesystem::path GetProcessPath();
 
+// Returns the per-user directory for files that can be regenerated at any time, with a `nuked-sc55` subdirectory
+// appended. The directory may not exist yet. Returns an empty path if no suitable location is known.
+std::filesystem::path GetCacheDirectory();
+
 }
@@ -1,4 +1,5 @@
 #include "rom_loader.h"
+#include "path_util.h"
 
 namespace common
 {
@@ -29,6 +30,38 @@ const char* ToCString(LoadRomsetError error)
     }
 }
 
+// Wraps DetectRomsetsByHash with a RomHashIndex that persists across runs in the user's cache directory, so that only
+// new or modified files are hashed.
+static bool DetectRomsetsByHashIndexed(const std::filesystem::path& rom_directory,
+                                       AllRomsetInfo&               romset_info,
+                                       RomLocationSet*              desired)
+{
+    std::filesystem::path index_path = GetCacheDirectory();
+    if (index_path.empty())
+    {
+        return DetectRomsetsByHash(rom_directory, romset_info, desired);
+    }
+    index_path /= "rom_index.txt";
+
+    RomHashIndex index;
+    if (!index.Load(index_path))
+    {
+        fprintf(stderr, "WARNING: Rom index `%s` is invalid; rebuilding it\n", index_path.generic_string().c_str());
+    }
+
+    if (!DetectRomsetsByHash(rom_directory, romset_info, desired, &index))
+    {
+        return false;
+    }
+
+    if (!index.Save(index_path))
+    {
+        fprintf(stderr, "WARNING: Failed to write rom index `%s`\n", index_path.generic_string().c_str());
+    }
+
+    return true;
+}
+
 LoadRomsetError LoadRomset(AllRomsetInfo&               romset_info,
                            const std::filesystem::path& rom_directory,
                            std::string_view             desired_romset,
@@ -56,7 +89,7 @@ LoadRomsetError LoadRomset(AllRomsetInfo&               romset_info,
         }
         else
         {
-            if (!DetectRomsetsByHash(rom_directory, romset_info, &desired))
+            if (!DetectRomsetsByHashIndexed(rom_directory, romset_info, &desired))
             {
                 return LoadRomsetError::DetectionFailed;
             }
@@ -74,7 +107,7 @@ LoadRomsetError LoadRomset(AllRomsetInfo&               romset_info,
         }
         else
         {
-            if (!DetectRomsetsByHash(rom_directory, romset_info))
+            if (!DetectRomsetsByHashIndexed(rom_directory, romset_info, nullptr))
             {
                 return LoadRomsetError::DetectionFailed;
             }
@@ -94,6 +127,7 @@ LoadRomsetError LoadRomset(AllRomsetInfo&               romset_info,
             {
                 romset_info.romsets[i].rom_paths[j] = overrides[j];
                 romset_info.romsets[i].rom_data[j].clear();
+                romset_info.romsets[i].rom_maps[j].reset();
             }
         }
     }
@@ -103,7 +137,13 @@ LoadRomsetError LoadRomset(AllRomsetInfo&               romset_info,
         return LoadRomsetError::IncompleteRomset;
     }
 
-    if (!LoadRomset(result.romset, romset_info, &result.loaded))
+    std::filesystem::path waverom_cache_dir = GetCacheDirectory();
+    if (!waverom_cache_dir.empty())
+    {
+        waverom_cache_dir /= "waveroms";
+    }
+
+    if (!LoadRomset(result.romset, romset_info, &result.loaded, waverom_cache_dir))
     {
         return LoadRomsetError::RomLoadFailed;
     }
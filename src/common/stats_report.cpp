@@ -0,0 +1,77 @@
+#include "stats_report.h"
+
+namespace common
+{
+
+void PrintEmulatorStats(FILE* output, size_t instance_id, const EMU_Stats& stats, double busy_seconds)
+{
+    if (!stats.enabled)
+    {
+        return;
+    }
+
+    const double seconds = busy_seconds > 0 ? busy_seconds : stats.wall_seconds;
+
+    fprintf(output,
+            "#%02zu: %.2fs emulated in %.2fs%s (%.2f emulated seconds per second)\n",
+            instance_id,
+            stats.emulated_seconds,
+            seconds,
+            busy_seconds > 0 ? " busy" : "",
+            stats.GetSpeed(busy_seconds));
+    fprintf(output,
+            "     MCU: %llu instructions, asleep %.1f%% (%.2fs); sub-MCU: %llu steps\n",
+            (unsigned long long)stats.instructions,
+            100.0 * stats.GetSleepFraction(),
+            stats.GetSleepFraction() * stats.emulated_seconds,
+            (unsigned long long)stats.submcu_steps);
+    fprintf(output,
+            "     PCM: %llu ticks, %.1f voices on average, %llu peak\n",
+            (unsigned long long)stats.pcm_ticks,
+            stats.GetAverageVoices(),
+            (unsigned long long)stats.peak_voices);
+    fprintf(output,
+            "     UART: %llu bytes in, %llu bytes out; LCD: %llu renders\n",
+            (unsigned long long)stats.uart_rx_bytes,
+            (unsigned long long)stats.uart_tx_bytes,
+            (unsigned long long)stats.lcd_renders);
+    if (stats.uart_rx_dropped != 0)
+    {
+        fprintf(output,
+                "     WARNING: %llu MIDI bytes dropped because the UART receive buffer was full\n",
+                (unsigned long long)stats.uart_rx_dropped);
+    }
+
+    fprintf(output, "     Interrupts:");
+    for (uint32_t i = 0; i < INTERRUPT_SOURCE_MAX; ++i)
+    {
+        if (stats.interrupts[i] != 0)
+        {
+            fprintf(output, " %s=%llu", EMU_InterruptSourceName(i), (unsigned long long)stats.interrupts[i]);
+        }
+    }
+    fprintf(output, " traps=%llu\n", (unsigned long long)stats.traps);
+
+    if (stats.arena_backing != EMU_ArenaBacking::None)
+    {
+        constexpr double mb = 1024.0 * 1024.0;
+        fprintf(output,
+                "     Memory: %.1f MB arena on %s",
+                (double)stats.arena.size / mb,
+                ToCString(stats.arena_backing));
+        if (stats.arena.known)
+        {
+            fprintf(output,
+                    "; %.1f MB resident, %.0f%% of it in huge pages (%zu pages to map)\n",
+                    (double)stats.arena.resident / mb,
+                    stats.arena.resident == 0 ? 0.0 : 100.0 * (double)stats.arena.huge / (double)stats.arena.resident,
+                    stats.arena.GetResidentPages());
+        }
+        else
+        {
+            fprintf(output, "; residency unknown\n");
+        }
+    }
+}
+
+} // namespace common
@@ -0,0 +1,13 @@
+#pragma once
+
+#include "emu_stats.h"
+#include <cstdio>
+
+namespace common
+{
+
+// Prints a --stats report for one emulator instance. `busy_seconds`, if nonzero, is the time the instance thread
+// spent stepping the emulator and is used instead of wall time for the speed figure.
+void PrintEmulatorStats(FILE* output, size_t instance_id, const EMU_Stats& stats, double busy_seconds = 0);
+
+} // namespace common
@@ -0,0 +1,234 @@
+#include "thread_util.h"
+
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+
+#if defined(_WIN32)
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+#if defined(__linux__)
+#include <sys/syscall.h>
+#endif
+
+namespace common
+{
+
+bool ParseThreadPolicy(std::string_view str, ThreadPolicy& out_policy)
+{
+    if (str == "default")
+    {
+        out_policy = ThreadPolicy::Default;
+    }
+    else if (str == "fifo")
+    {
+        out_policy = ThreadPolicy::Fifo;
+    }
+    else if (str == "rr")
+    {
+        out_policy = ThreadPolicy::RoundRobin;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+static bool ParseCpu(std::string_view str, uint32_t& out_cpu)
+{
+    if (str.empty())
+    {
+        return false;
+    }
+    const auto result = std::from_chars(str.data(), str.data() + str.size(), out_cpu);
+    return result.ec == std::errc{} && result.ptr == str.data() + str.size();
+}
+
+bool ParseCpuList(std::string_view str, std::vector<uint32_t>& out_cpus)
+{
+    // Far more than any machine we'd run on; stops "0-4000000000" from allocating gigabytes.
+    constexpr uint32_t MAX_CPU = 4096;
+
+    out_cpus.clear();
+
+    while (!str.empty())
+    {
+        const size_t     comma = str.find(',');
+        std::string_view item  = str.substr(0, comma);
+        str                    = comma == std::string_view::npos ? std::string_view{} : str.substr(comma + 1);
+
+        uint32_t first = 0;
+        uint32_t last  = 0;
+
+        const size_t dash = item.find('-');
+        if (dash == std::string_view::npos)
+        {
+            if (!ParseCpu(item, first))
+            {
+                return false;
+            }
+            last = first;
+        }
+        else if (!ParseCpu(item.substr(0, dash), first) || !ParseCpu(item.substr(dash + 1), last))
+        {
+            return false;
+        }
+
+        if (first > last || last >= MAX_CPU)
+        {
+            return false;
+        }
+
+        for (uint32_t cpu = first; cpu <= last; ++cpu)
+        {
+            out_cpus.push_back(cpu);
+        }
+
+        if (comma != std::string_view::npos && str.empty())
+        {
+            // trailing comma
+            return false;
+        }
+    }
+
+    return !out_cpus.empty();
+}
+
+bool PinCurrentThread(uint32_t cpu, const char* thread_name)
+{
+#if defined(_WIN32)
+    if (cpu >= sizeof(DWORD_PTR) * 8)
+    {
+        fprintf(stderr, "WARNING: Couldn't pin %s thread to CPU %u: CPU number too large\n", thread_name, cpu);
+        return false;
+    }
+    if (SetThreadAffinityMask(GetCurrentThread(), (DWORD_PTR)1 << cpu) == 0)
+    {
+        fprintf(stderr,
+                "WARNING: Couldn't pin %s thread to CPU %u: error %lu\n",
+                thread_name,
+                cpu,
+                (unsigned long)GetLastError());
+        return false;
+    }
+    return true;
+#elif defined(__linux__)
+    if (cpu >= CPU_SETSIZE)
+    {
+        fprintf(stderr, "WARNING: Couldn't pin %s thread to CPU %u: CPU number too large\n", thread_name, cpu);
+        return false;
+    }
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    const int err = pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    if (err != 0)
+    {
+        fprintf(stderr, "WARNING: Couldn't pin %s thread to CPU %u: %s\n", thread_name, cpu, strerror(err));
+        return false;
+    }
+    return true;
+#else
+    fprintf(stderr,
+            "WARNING: Couldn't pin %s thread to CPU %u: not supported on this platform\n",
+            thread_name,
+            cpu);
+    return false;
+#endif
+}
+
+bool SetCurrentThreadPolicy(ThreadPolicy policy, int priority, const char* thread_name)
+{
+    if (policy == ThreadPolicy::Default)
+    {
+        return true;
+    }
+
+#if defined(_WIN32)
+    (void)priority;
+    if (!SetThreadPriority(GetCurrentThread(), THREAD_PRIORITY_TIME_CRITICAL))
+    {
+        fprintf(stderr,
+                "WARNING: Couldn't raise %s thread priority: error %lu\n",
+                thread_name,
+                (unsigned long)GetLastError());
+        return false;
+    }
+    return true;
+#else
+    const int posix_policy = policy == ThreadPolicy::Fifo ? SCHED_FIFO : SCHED_RR;
+
+    const int min_priority = sched_get_priority_min(posix_policy);
+    const int max_priority = sched_get_priority_max(posix_policy);
+
+    sched_param param{};
+    param.sched_priority = priority < min_priority ? min_priority : priority > max_priority ? max_priority : priority;
+
+    const int err = pthread_setschedparam(pthread_self(), posix_policy, &param);
+    if (err != 0)
+    {
+        fprintf(stderr,
+                "WARNING: Couldn't set real-time scheduling for %s thread: %s; continuing with default scheduling\n",
+                thread_name,
+                strerror(err));
+        if (err == EPERM)
+        {
+            fprintf(stderr, "         Real-time scheduling requires CAP_SYS_NICE or a nonzero RLIMIT_RTPRIO\n");
+        }
+        return false;
+    }
+    return true;
+#endif
+}
+
+bool BindMemoryToCurrentNode(void* ptr, size_t size)
+{
+#if defined(__linux__)
+    // Values from <linux/mempolicy.h>. We call the syscalls directly so that we don't need libnuma.
+    constexpr int           MPOL_PREFERRED_ = 1;
+    constexpr unsigned long MPOL_MF_MOVE_   = 1ul << 1;
+
+    unsigned cpu  = 0;
+    unsigned node = 0;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+    {
+        return false;
+    }
+
+    constexpr size_t BITS_PER_WORD = sizeof(unsigned long) * 8;
+    if (node >= BITS_PER_WORD * 16)
+    {
+        return false;
+    }
+
+    unsigned long nodemask[16]{};
+    nodemask[node / BITS_PER_WORD] = 1ul << (node % BITS_PER_WORD);
+
+    const long      page_size_l = sysconf(_SC_PAGESIZE);
+    const uintptr_t page_size   = page_size_l > 0 ? (uintptr_t)page_size_l : 4096;
+    const uintptr_t first       = (uintptr_t)ptr & ~(page_size - 1);
+    const uintptr_t last        = ((uintptr_t)ptr + size + page_size - 1) & ~(page_size - 1);
+
+    return syscall(SYS_mbind,
+                   first,
+                   last - first,
+                   MPOL_PREFERRED_,
+                   nodemask,
+                   // The kernel reads one bit less than maxnode.
+                   (unsigned long)(BITS_PER_WORD * 16 + 1),
+                   MPOL_MF_MOVE_) == 0;
+#else
+    (void)ptr;
+    (void)size;
+    return false;
+#endif
+}
+
+} // namespace common
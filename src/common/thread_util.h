@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace common
+{
+
+enum class ThreadPolicy
+{
+    // Leave the scheduling policy alone.
+    Default,
+    // SCHED_FIFO on POSIX systems.
+    Fifo,
+    // SCHED_RR on POSIX systems.
+    RoundRobin,
+};
+
+// Parses `str` as a policy name: default, fifo, or rr.
+bool ParseThreadPolicy(std::string_view str, ThreadPolicy& out_policy);
+
+// Parses a comma-separated list of CPU numbers and inclusive ranges, e.g. "0,2,4-7". The result is in the order given.
+bool ParseCpuList(std::string_view str, std::vector<uint32_t>& out_cpus);
+
+// Restricts the calling thread to `cpu`. On failure, prints a warning naming `thread_name` and returns false.
+bool PinCurrentThread(uint32_t cpu, const char* thread_name);
+
+// Switches the calling thread to `policy` with the given POSIX priority, which is clamped to the range the policy
+// supports. On Windows any policy other than Default raises the thread to time-critical priority and `priority` is
+// ignored.
+//
+// Real-time scheduling usually requires privileges (CAP_SYS_NICE or an RLIMIT_RTPRIO allowance on Linux). On failure,
+// prints a warning naming `thread_name`, leaves the thread's scheduling unchanged and returns false.
+bool SetCurrentThreadPolicy(ThreadPolicy policy, int priority, const char* thread_name);
+
+// Migrates the pages in [ptr, ptr + size) to the NUMA node of the CPU the calling thread is running on, and makes that
+// node preferred for pages faulted in later. Pages partially covered by the range are included. Only supported on
+// Linux; elsewhere this returns false without doing anything.
+bool BindMemoryToCurrentNode(void* ptr, size_t size);
+
+} // namespace common
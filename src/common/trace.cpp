@@ -0,0 +1,238 @@
+#include "trace.h"
+
+#include <atomic>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace common
+{
+
+namespace
+{
+
+enum class TracePhase : uint8_t
+{
+    Complete,
+    Instant,
+    Counter,
+};
+
+struct TraceEvent
+{
+    const char* name;
+    uint64_t    start_ns;
+    uint64_t    duration_ns;
+    int64_t     value;
+    TracePhase  phase;
+};
+
+// About 40MB of address space per thread. Pages are only touched as events are recorded.
+constexpr size_t TRACE_EVENTS_PER_THREAD = 1 << 20;
+
+// Written only by its owning thread. `count` is published with release so TraceWrite can read events while the owner
+// keeps recording.
+struct TraceBuffer
+{
+    uint32_t                      tid = 0;
+    std::string                   thread_name;
+    std::unique_ptr<TraceEvent[]> events;
+    std::atomic<size_t>           count   = 0;
+    std::atomic<uint64_t>         dropped = 0;
+};
+
+std::atomic<bool>                         g_enabled = false;
+std::chrono::steady_clock::time_point     g_start;
+std::mutex                                g_buffers_mutex;
+std::vector<std::unique_ptr<TraceBuffer>> g_buffers;
+
+thread_local TraceBuffer* t_buffer = nullptr;
+
+TraceBuffer& GetThreadBuffer()
+{
+    if (!t_buffer)
+    {
+        auto buffer    = std::make_unique<TraceBuffer>();
+        buffer->events = std::unique_ptr<TraceEvent[]>(new TraceEvent[TRACE_EVENTS_PER_THREAD]);
+
+        std::scoped_lock lk(g_buffers_mutex);
+        buffer->tid = (uint32_t)g_buffers.size() + 1;
+        t_buffer    = buffer.get();
+        g_buffers.push_back(std::move(buffer));
+    }
+    return *t_buffer;
+}
+
+uint64_t ToTraceTime(std::chrono::steady_clock::time_point t)
+{
+    if (t < g_start)
+    {
+        return 0;
+    }
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(t - g_start).count();
+}
+
+void Record(const char* name, TracePhase phase, uint64_t start_ns, uint64_t duration_ns, int64_t value)
+{
+    TraceBuffer& buffer = GetThreadBuffer();
+
+    const size_t count = buffer.count.load(std::memory_order_relaxed);
+    if (count == TRACE_EVENTS_PER_THREAD)
+    {
+        buffer.dropped.store(buffer.dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return;
+    }
+
+    buffer.events[count] = {name, start_ns, duration_ns, value, phase};
+    buffer.count.store(count + 1, std::memory_order_release);
+}
+
+void WriteJSONString(FILE* output, const char* str)
+{
+    fputc('"', output);
+    for (; *str; ++str)
+    {
+        const char ch = *str;
+        if (ch == '"' || ch == '\\')
+        {
+            fputc('\\', output);
+            fputc(ch, output);
+        }
+        else if ((unsigned char)ch < 0x20)
+        {
+            fprintf(output, "\\u%04x", (unsigned)ch);
+        }
+        else
+        {
+            fputc(ch, output);
+        }
+    }
+    fputc('"', output);
+}
+
+} // namespace
+
+void TraceStart()
+{
+    g_start = std::chrono::steady_clock::now();
+    g_enabled.store(true, std::memory_order_release);
+}
+
+bool TraceIsEnabled()
+{
+    return g_enabled.load(std::memory_order_relaxed);
+}
+
+void TraceSetThreadName(const char* name)
+{
+    if (!TraceIsEnabled())
+    {
+        return;
+    }
+
+    TraceBuffer& buffer = GetThreadBuffer();
+
+    std::scoped_lock lk(g_buffers_mutex);
+    buffer.thread_name = name;
+}
+
+void TraceInstant(const char* name, int64_t value)
+{
+    if (!TraceIsEnabled())
+    {
+        return;
+    }
+    Record(name, TracePhase::Instant, ToTraceTime(std::chrono::steady_clock::now()), 0, value);
+}
+
+void TraceCounter(const char* name, int64_t value)
+{
+    if (!TraceIsEnabled())
+    {
+        return;
+    }
+    Record(name, TracePhase::Counter, ToTraceTime(std::chrono::steady_clock::now()), 0, value);
+}
+
+void TraceComplete(const char* name, std::chrono::steady_clock::time_point start, int64_t value)
+{
+    if (!TraceIsEnabled())
+    {
+        return;
+    }
+    const uint64_t start_ns = ToTraceTime(start);
+    const uint64_t end_ns   = ToTraceTime(std::chrono::steady_clock::now());
+    Record(name, TracePhase::Complete, start_ns, end_ns - start_ns, value);
+}
+
+bool TraceWrite(const std::filesystem::path& filename)
+{
+    FILE* output = fopen(filename.string().c_str(), "w");
+    if (!output)
+    {
+        fprintf(stderr, "WARNING: Failed to open %s for writing\n", filename.string().c_str());
+        return false;
+    }
+
+    std::scoped_lock lk(g_buffers_mutex);
+
+    uint64_t events  = 0;
+    uint64_t dropped = 0;
+
+    fprintf(output, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+    fprintf(output, "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"nuked-sc55\"}}");
+
+    for (const auto& buffer : g_buffers)
+    {
+        if (!buffer->thread_name.empty())
+        {
+            fprintf(output, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":", buffer->tid);
+            WriteJSONString(output, buffer->thread_name.c_str());
+            fprintf(output, "}}");
+        }
+
+        const size_t count = buffer->count.load(std::memory_order_acquire);
+        for (size_t i = 0; i < count; ++i)
+        {
+            const TraceEvent& event = buffer->events[i];
+
+            fprintf(output, ",\n{\"name\":");
+            WriteJSONString(output, event.name);
+            fprintf(output, ",\"pid\":1,\"tid\":%u,\"ts\":%.3f", buffer->tid, (double)event.start_ns / 1e3);
+
+            switch (event.phase)
+            {
+            case TracePhase::Complete:
+                fprintf(output, ",\"ph\":\"X\",\"dur\":%.3f", (double)event.duration_ns / 1e3);
+                break;
+            case TracePhase::Instant:
+                fprintf(output, ",\"ph\":\"i\",\"s\":\"t\"");
+                break;
+            case TracePhase::Counter:
+                fprintf(output, ",\"ph\":\"C\"");
+                break;
+            }
+
+            fprintf(output, ",\"args\":{\"value\":%lld}}", (long long)event.value);
+        }
+
+        events += count;
+        dropped += buffer->dropped.load(std::memory_order_relaxed);
+    }
+
+    fprintf(output, "\n]}\n");
+    fclose(output);
+
+    fprintf(stderr, "Wrote %llu trace events to %s", (unsigned long long)events, filename.string().c_str());
+    if (dropped)
+    {
+        fprintf(stderr, " (%llu dropped because a thread's buffer was full)", (unsigned long long)dropped);
+    }
+    fprintf(stderr, "\n");
+
+    return true;
+}
+
+} // namespace common
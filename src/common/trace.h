@@ -0,0 +1,74 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+
+namespace common
+{
+
+// Optional timeline of pipeline events, written as Chrome trace JSON that chrome://tracing and ui.perfetto.dev can
+// open. Tracing is off until TraceStart is called; until then every function here returns after a single relaxed
+// load.
+//
+// Each thread records into its own fixed-size buffer, so recording never takes a lock or allocates after the thread's
+// first event. When a thread's buffer fills up, further events from that thread are dropped and counted.
+//
+// Event names must be string literals or otherwise outlive the trace; only the pointer is stored.
+
+// Starts recording. Timestamps in the trace are relative to this call. Call before starting any thread that records
+// events.
+void TraceStart();
+
+bool TraceIsEnabled();
+
+// Names the calling thread in the trace. Has no effect if tracing hasn't started.
+void TraceSetThreadName(const char* name);
+
+// Records a point-in-time event with an optional value, e.g. a buffer underrun or a MIDI message arriving.
+void TraceInstant(const char* name, int64_t value = 0);
+
+// Records the value of a counter, e.g. the number of chunks queued. Counters are drawn as a graph per name.
+void TraceCounter(const char* name, int64_t value);
+
+// Records an event that started at `start` and ends now.
+void TraceComplete(const char* name, std::chrono::steady_clock::time_point start, int64_t value = 0);
+
+// Writes every event recorded so far to `filename`. Other threads may still be recording; events they record during
+// the write may be missing from the file. Returns false and prints a warning if the file can't be written.
+bool TraceWrite(const std::filesystem::path& filename);
+
+// Records the lifetime of the scope as one event.
+class TraceScope
+{
+public:
+    explicit TraceScope(const char* name, int64_t value = 0)
+        : m_name(name)
+        , m_value(value)
+        , m_enabled(TraceIsEnabled())
+    {
+        if (m_enabled)
+        {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~TraceScope()
+    {
+        if (m_enabled)
+        {
+            TraceComplete(m_name, m_start, m_value);
+        }
+    }
+
+    TraceScope(const TraceScope&)            = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char*                           m_name;
+    int64_t                               m_value;
+    bool                                  m_enabled;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+} // namespace common
@@ -3,6 +3,9 @@
 #include "config.h"
 #include "emu.h"
 #include "math_util.h"
+#include "partition.h"
+#include "player.h"
+#include "resampler.h"
 #include "smf.h"
 #include "wav.h"
 #include <algorithm>
@@ -13,6 +16,7 @@
 #include <functional>
 #include <memory>
 #include <mutex>
+#include <optional>
 #include <source_location>
 #include <string>
 #include <thread>
@@ -21,6 +25,8 @@
 #include "common/gain.h"
 #include "common/path_util.h"
 #include "common/rom_loader.h"
+#include "common/stats_report.h"
+#include "common/trace.h"
 
 #ifdef _WIN32
 #include <fcntl.h>
@@ -37,6 +43,14 @@ enum class R_EndBehavior
     Release,
 };
 
+enum class R_ProfileFormat
+{
+    // Call stacks in the format read by flamegraph.pl.
+    Folded,
+    // Sample counts per program counter.
+    Histogram,
+};
+
 struct R_AdvancedParameters
 {
     common::RomOverrides rom_overrides;
@@ -56,11 +70,20 @@ struct R_Parameters
     bool disable_oversampling = false;
     std::string_view romset_name;
     bool debug = false;
+    bool stats = false;
+    EMU_MemoryMode instance_memory = EMU_MemoryMode::Heap;
     R_EndBehavior end_behavior = R_EndBehavior::Cut;
     std::filesystem::path nvram_filename;
     bool legacy_romset_detection = false;
+    SMF_StepPlacement step_placement = SMF_StepPlacement::Exact;
     bool dump_emidi_loop_points = false;
     float gain = 1.0f;
+    std::optional<uint32_t> output_rate;
+    R_PartitionMode partition_mode = R_PartitionMode::Modulo;
+    std::filesystem::path profile_filename;
+    R_ProfileFormat profile_format = R_ProfileFormat::Folded;
+    uint64_t profile_interval = 24000;
+    std::filesystem::path trace_filename;
     R_AdvancedParameters adv;
 };
 
@@ -78,6 +101,11 @@ enum class R_ParseError
     EndInvalid,
     ResetInvalid,
     GainInvalid,
+    RateInvalid,
+    PartitionInvalid,
+    ProfileFormatInvalid,
+    ProfileIntervalInvalid,
+    MemoryModeInvalid,
 };
 
 const char* R_ParseErrorStr(R_ParseError err)
@@ -108,6 +136,16 @@ const char* R_ParseErrorStr(R_ParseError err)
             return "Reset invalid (should be none, gs, or gm)";
         case R_ParseError::GainInvalid:
             return "Gain invalid (should be a number optionally ending in 'db')";
+        case R_ParseError::RateInvalid:
+            return "Sample rate invalid (should be 8000-192000)";
+        case R_ParseError::PartitionInvalid:
+            return "Partition invalid (should be modulo or balanced)";
+        case R_ParseError::ProfileFormatInvalid:
+            return "Profile format invalid (should be folded or histogram)";
+        case R_ParseError::ProfileIntervalInvalid:
+            return "Profile interval invalid (should be a positive number of cycles)";
+        case R_ParseError::MemoryModeInvalid:
+            return "Instance memory mode invalid (should be heap, arena, or hugepages)";
     }
     return "Unknown error";
 }
@@ -141,6 +179,22 @@ R_ParseError R_ParseCommandLine(int argc, char* argv[], R_Parameters& result)
         {
             result.debug = true;
         }
+        else if (reader.Any("--stats"))
+        {
+            result.stats = true;
+        }
+        else if (reader.Any("--instance-memory"))
+        {
+            if (!reader.Next())
+            {
+                return R_ParseError::UnexpectedEnd;
+            }
+
+            if (!ParseMemoryMode(reader.Arg(), result.instance_memory))
+            {
+                return R_ParseError::MemoryModeInvalid;
+            }
+        }
         else if (reader.Any("-n", "--instances"))
         {
             if (!reader.Next())
@@ -257,10 +311,29 @@ R_ParseError R_ParseCommandLine(int argc, char* argv[], R_Parameters& result)
                 return R_ParseError::GainInvalid;
             }
         }
+        else if (reader.Any("--rate"))
+        {
+            if (!reader.Next())
+            {
+                return R_ParseError::UnexpectedEnd;
+            }
+
+            uint32_t rate = 0;
+            if (!reader.TryParse(rate) || rate < 8000 || rate > 192000)
+            {
+                return R_ParseError::RateInvalid;
+            }
+
+            result.output_rate = rate;
+        }
         else if (reader.Any("--legacy-romset-detection"))
         {
             result.legacy_romset_detection = true;
         }
+        else if (reader.Any("--legacy-timing"))
+        {
+            result.step_placement = SMF_StepPlacement::Legacy;
+        }
         else if (reader.Any("--end"))
         {
             if (!reader.Next())
@@ -281,6 +354,76 @@ R_ParseError R_ParseCommandLine(int argc, char* argv[], R_Parameters& result)
                 return R_ParseError::EndInvalid;
             }
         }
+        else if (reader.Any("--partition"))
+        {
+            if (!reader.Next())
+            {
+                return R_ParseError::UnexpectedEnd;
+            }
+
+            if (reader.Arg() == "modulo")
+            {
+                result.partition_mode = R_PartitionMode::Modulo;
+            }
+            else if (reader.Arg() == "balanced")
+            {
+                result.partition_mode = R_PartitionMode::Balanced;
+            }
+            else
+            {
+                return R_ParseError::PartitionInvalid;
+            }
+        }
+        else if (reader.Any("--profile"))
+        {
+            if (!reader.Next())
+            {
+                return R_ParseError::UnexpectedEnd;
+            }
+
+            result.profile_filename = reader.Arg();
+        }
+        else if (reader.Any("--trace"))
+        {
+            if (!reader.Next())
+            {
+                return R_ParseError::UnexpectedEnd;
+            }
+
+            result.trace_filename = reader.Arg();
+        }
+        else if (reader.Any("--profile-format"))
+        {
+            if (!reader.Next())
+            {
+                return R_ParseError::UnexpectedEnd;
+            }
+
+            if (reader.Arg() == "folded")
+            {
+                result.profile_format = R_ProfileFormat::Folded;
+            }
+            else if (reader.Arg() == "histogram")
+            {
+                result.profile_format = R_ProfileFormat::Histogram;
+            }
+            else
+            {
+                return R_ParseError::ProfileFormatInvalid;
+            }
+        }
+        else if (reader.Any("--profile-interval"))
+        {
+            if (!reader.Next())
+            {
+                return R_ParseError::UnexpectedEnd;
+            }
+
+            if (!reader.TryParse(result.profile_interval) || result.profile_interval == 0)
+            {
+                return R_ParseError::ProfileIntervalInvalid;
+            }
+        }
         else if (reader.Any("--override-rom1"))
         {
             if (!reader.Next())
@@ -655,6 +798,8 @@ public:
     // Blocks the calling thread until there's enough data in queues to mix.
     void WaitForWork()
     {
+        common::TraceScope trace("wait for chunks");
+
         std::unique_lock lk(m_mutex);
         m_cond.wait(lk, [this]() { return GetReadyChunkCount() > 0; });
     }
@@ -692,6 +837,7 @@ public:
         {
             m_queues[queue_id].Enqueue(std::move(m_chunks[queue_id]));
             m_cond.notify_one();
+            common::TraceInstant("enqueue chunk", (int64_t)m_queues[queue_id].ChunkCount());
             m_chunks[queue_id] = AllocChunk<T>();
         }
         ++m_frames_written[queue_id];
@@ -714,12 +860,11 @@ public:
         {
             // It seems possible to end up in a rare state where e.g. at the end of the midi we have two queues marked
             // as complete but only one has data. Normally this shouldn't happen because the emulators should be stepped
-            // for roughly the same amount of time and produce roughly the same number of samples. I have not
-            // encountered this problem yet, but multi instance rendering tends to desync slightly. On some midi files,
-            // one emulator steps for longer than the other despite the two sharing end-of-track messages with the same
-            // SMF tick timestamp. I can only guess this is caused by the integer division converting SMF ticks to
-            // microseconds. Until I can find a good test midi or construct one I'm not sure how to solve this, or if
-            // it's even a real problem. However, I have observed 400us/28 frame differences.
+            // for roughly the same amount of time and produce roughly the same number of samples. Multi instance
+            // rendering used to desync slightly (400us/28 frames observed) because each instance accumulated its own
+            // rounding error converting SMF ticks to microseconds. SMF_StepPlacement::Exact places events with the
+            // same tick timestamp on the same step in every instance, but --legacy-timing still rounds per instance,
+            // and with --end release each instance still runs for as long as its own notes take to decay.
             //
             // To try to deal with this, we do not consider queues marked as complete and having zero chunks, as they
             // will never receive new data. However, if another queue is incomplete and has zero chunks, the emulator
@@ -740,6 +885,8 @@ public:
     template <typename T, typename MixFn>
     size_t MixFrames(std::vector<AudioFrame<T>>& output_buffer, MixFn mix)
     {
+        common::TraceScope trace("mix");
+
         output_buffer.clear();
 
         R_OwnedChunk chunks[QUEUE_COUNT];
@@ -873,7 +1020,9 @@ struct R_TrackRenderState
     R_Mixer* mixer = nullptr;
     size_t queue_id = 0;
     size_t ns_simulated = 0;
-    const SMF_Track* track = nullptr;
+    const SMF_MappedData* data = nullptr;
+    const R_Partition* partition = nullptr;
+    SMF_StepPlacement step_placement = SMF_StepPlacement::Exact;
     std::thread thread;
     std::chrono::high_resolution_clock::duration elapsed;
     size_t num_silent_frames = 0;
@@ -884,6 +1033,7 @@ struct R_TrackRenderState
 
     // these fields are accessed from main thread during render process
     std::atomic<size_t> events_processed = 0;
+    std::atomic<size_t> bytes_processed = 0;
     std::atomic<bool> done;
 };
 
@@ -955,62 +1105,6 @@ void R_RunReset(Emulator& emu, EMU_SystemReset reset)
     }
 }
 
-void R_PostEvent(Emulator& emu, const SMF_Data& data, const SMF_Event& ev)
-{
-    emu.PostMIDI(ev.status);
-    emu.PostMIDI(ev.GetData(data.bytes));
-}
-
-struct R_TrackList
-{
-    std::vector<SMF_Track> tracks;
-};
-
-// Splits a track into `n` tracks, each track can be processed by a single
-// emulator instance.
-R_TrackList R_SplitTrackModulo(const SMF_Track& merged_track, size_t n)
-{
-    R_TrackList result;
-    result.tracks.resize(n);
-
-    for (auto& event : merged_track.events)
-    {
-        // System events need to be processed by all emulators
-        if (event.IsSystem())
-        {
-            for (auto& dest : result.tracks)
-            {
-                dest.events.emplace_back(event);
-            }
-        }
-        else
-        {
-            auto& dest = result.tracks[event.GetChannel() % n];
-            dest.events.emplace_back(event);
-        }
-    }
-
-    for (auto& track : result.tracks)
-    {
-        SMF_SetDeltasFromTimestamps(track);
-    }
-
-    return result;
-}
-
-uint64_t R_NSPerStep(Emulator& emu)
-{
-    // These are best guesses.
-    if (emu.GetMCU().is_mk1)
-    {
-        return 600;
-    }
-    else
-    {
-        return 500;
-    }
-}
-
 void R_NsToTimeString(uint64_t ns, std::string& result)
 {
     // one second in nanoseconds
@@ -1040,24 +1134,24 @@ void R_NsToTimeString(uint64_t ns, std::string& result)
     result += std::to_string(fsec);
 }
 
-bool R_IsEMIDITrackLoopStart(const SMF_Data& data, const SMF_Event& ev)
+bool R_IsEMIDITrackLoopStart(const SMF_Schedule& schedule, const SMF_ScheduledEvent& ev)
 {
-    return ev.IsControlChange() && ev.GetData(data.bytes)[0] == 116;
+    return ev.IsControlChange() && schedule.GetData(ev)[0] == 116;
 }
 
-bool R_IsEMIDITrackLoopEnd(const SMF_Data& data, const SMF_Event& ev)
+bool R_IsEMIDITrackLoopEnd(const SMF_Schedule& schedule, const SMF_ScheduledEvent& ev)
 {
-    return ev.IsControlChange() && ev.GetData(data.bytes)[0] == 117;
+    return ev.IsControlChange() && schedule.GetData(ev)[0] == 117;
 }
 
-bool R_IsEMIDIGlobalLoopStart(const SMF_Data& data, const SMF_Event& ev)
+bool R_IsEMIDIGlobalLoopStart(const SMF_Schedule& schedule, const SMF_ScheduledEvent& ev)
 {
-    return ev.IsControlChange() && ev.GetData(data.bytes)[0] == 118;
+    return ev.IsControlChange() && schedule.GetData(ev)[0] == 118;
 }
 
-bool R_IsEMIDIGlobalLoopEnd(const SMF_Data& data, const SMF_Event& ev)
+bool R_IsEMIDIGlobalLoopEnd(const SMF_Schedule& schedule, const SMF_ScheduledEvent& ev)
 {
-    return ev.IsControlChange() && ev.GetData(data.bytes)[0] == 119;
+    return ev.IsControlChange() && schedule.GetData(ev)[0] == 119;
 }
 
 template <typename SilenceModel>
@@ -1093,10 +1187,10 @@ constexpr mcu_sample_callback R_PickCallback(const R_TrackRenderState& state)
     R_Panic("no valid callback for state");
 }
 
-void R_HandleLoopPoint(R_TrackRenderState& state, const SMF_Data& data, const SMF_Event& event)
+void R_HandleLoopPoint(R_TrackRenderState& state, const SMF_Schedule& schedule, const SMF_ScheduledEvent& event)
 {
     // Save loop points - they will be processed on the main thread later
-    if (R_IsEMIDITrackLoopStart(data, event))
+    if (R_IsEMIDITrackLoopStart(schedule, event))
     {
         state.loop_recorder->Record({
             .type         = R_LoopPointType::TrackStart,
@@ -1106,7 +1200,7 @@ void R_HandleLoopPoint(R_TrackRenderState& state, const SMF_Data& data, const SM
             .midi_channel = event.GetChannel(),
         });
     }
-    else if (R_IsEMIDITrackLoopEnd(data, event))
+    else if (R_IsEMIDITrackLoopEnd(schedule, event))
     {
         state.loop_recorder->Record({
             .type         = R_LoopPointType::TrackEnd,
@@ -1116,7 +1210,7 @@ void R_HandleLoopPoint(R_TrackRenderState& state, const SMF_Data& data, const SM
             .midi_channel = event.GetChannel(),
         });
     }
-    else if (R_IsEMIDIGlobalLoopStart(data, event))
+    else if (R_IsEMIDIGlobalLoopStart(schedule, event))
     {
         state.loop_recorder->Record({
             .type         = R_LoopPointType::GlobalStart,
@@ -1126,7 +1220,7 @@ void R_HandleLoopPoint(R_TrackRenderState& state, const SMF_Data& data, const SM
             .midi_channel = event.GetChannel(),
         });
     }
-    else if (R_IsEMIDIGlobalLoopEnd(data, event))
+    else if (R_IsEMIDIGlobalLoopEnd(schedule, event))
     {
         state.loop_recorder->Record({
             .type         = R_LoopPointType::GlobalEnd,
@@ -1138,42 +1232,33 @@ void R_HandleLoopPoint(R_TrackRenderState& state, const SMF_Data& data, const SM
     }
 }
 
-void R_RenderOne(const SMF_Data& data, R_TrackRenderState& state)
+void R_RenderOne(R_TrackRenderState& state)
 {
-    uint64_t division = data.header.division;
-    uint64_t us_per_qn = 500000;
+    const SMF_MappedData& data = *state.data;
 
-    const SMF_Track& track = (const SMF_Track&)*state.track;
+    R_Player player(data, state.emu, state.partition, state.queue_id, state.step_placement);
 
-    const uint64_t ns_per_step = R_NSPerStep(state.emu);
+    common::TraceSetThreadName(("instance " + std::to_string(state.queue_id)).c_str());
 
     auto t_start = std::chrono::high_resolution_clock::now();
-    for (const SMF_Event& event : track.events)
+    while (player.NextBlock())
     {
-        const uint64_t this_event_time_ns =
-            state.ns_simulated + 1000 * SMF_TicksToUS(event.delta_time, us_per_qn, division);
+        common::TraceScope trace("step batch");
 
-        while (state.ns_simulated < this_event_time_ns)
+        const SMF_Schedule& schedule = player.GetSchedule();
+        for (const SMF_ScheduledEvent& scheduled : schedule.events)
         {
-            state.emu.Step();
-            state.ns_simulated += ns_per_step;
-        }
+            player.Play(scheduled);
+            state.ns_simulated = player.GetNSSimulated();
 
-        if (event.IsTempo(data.bytes))
-        {
-            us_per_qn = event.GetTempoUS(data.bytes);
-        }
+            R_HandleLoopPoint(state, schedule, scheduled);
 
-        // Fire the event.
-        if (!event.IsMetaEvent())
-        {
-            R_PostEvent(state.emu, data, event);
+            ++state.events_processed;
         }
 
-        R_HandleLoopPoint(state, data, event);
-
-        ++state.events_processed;
+        state.bytes_processed = player.GetBytesConsumed();
     }
+    state.bytes_processed = player.GetBytesConsumed();
 
     if (state.end_behavior == R_EndBehavior::Release)
     {
@@ -1190,6 +1275,8 @@ void R_RenderOne(const SMF_Data& data, R_TrackRenderState& state)
         const uint32_t frequency = PCM_GetOutputFrequency(state.emu.GetPCM());
         // TODO: make this configurable? do we care? currently 100ms
         const size_t silence_time = frequency / 10;
+
+        common::TraceScope trace("release");
         while (state.num_silent_frames < silence_time)
         {
             state.emu.Step();
@@ -1216,6 +1303,9 @@ struct R_MixOutState
 
     // Eventually we need to abstract over this to stream to other outputs.
     WAV_Handle* output = nullptr;
+
+    // Converts the mixed audio to the output rate. Null when the emulator's rate is used as is.
+    AudioResampler* resampler = nullptr;
 };
 
 void R_Mix(int16_t* dest, int16_t* src_first, int16_t* src_last)
@@ -1234,12 +1324,28 @@ void R_Mix(float* dest, float* src_first, float* src_last)
     HorizontalAddF32(dest, src_first, src_last);
 }
 
+template <typename T>
+void R_WriteResampled(R_MixOutState& state, const std::vector<AudioFrame<float>>& resampled)
+{
+    for (const auto& frame : resampled)
+    {
+        AudioFrame<T> out;
+        ConvertFrame(frame, out);
+        state.output->Write(out);
+    }
+}
+
 template <typename T>
 void R_MixOut(R_MixOutState& state)
 {
     std::vector<AudioFrame<T>> mix_buffer;
     mix_buffer.reserve(state.mixer->GetChunkSize());
 
+    std::vector<AudioFrame<float>> resample_in;
+    std::vector<AudioFrame<float>> resample_out;
+
+    common::TraceSetThreadName("mix");
+
     while (!state.mixer->IsFinished())
     {
         state.mixer->WaitForWork();
@@ -1248,25 +1354,82 @@ void R_MixOut(R_MixOutState& state)
             R_Mix((T*)dest, (T*)src_first, (T*)src_last);
         });
 
-        for (auto& frame : mix_buffer)
+        common::TraceScope trace("write", (int64_t)mix_buffer.size());
+
+        if (state.resampler)
         {
-            state.output->Write(frame);
+            resample_in.resize(mix_buffer.size());
+            for (size_t i = 0; i < mix_buffer.size(); ++i)
+            {
+                ConvertFrame(mix_buffer[i], resample_in[i]);
+            }
+
+            resample_out.clear();
+            state.resampler->Process(resample_in, resample_out);
+            R_WriteResampled<T>(state, resample_out);
         }
+        else
+        {
+            for (auto& frame : mix_buffer)
+            {
+                state.output->Write(frame);
+            }
+        }
+    }
+
+    if (state.resampler)
+    {
+        resample_out.clear();
+        state.resampler->Flush(resample_out);
+        R_WriteResampled<T>(state, resample_out);
     }
 
     state.output->Finish();
 }
 
-bool R_RenderTrack(const SMF_Data& data, const R_Parameters& params)
+// Writes the firmware profile of every instance to one file. With multiple instances each stack is rooted at its
+// instance so they can be told apart.
+void R_WriteProfile(const R_Parameters& params, std::span<const R_TrackRenderState> render_states, size_t instances)
+{
+    FILE* output = fopen(params.profile_filename.string().c_str(), "w");
+    if (!output)
+    {
+        fprintf(stderr, "WARNING: Failed to open %s for writing\n", params.profile_filename.string().c_str());
+        return;
+    }
+
+    uint64_t samples = 0;
+    for (size_t i = 0; i < instances; ++i)
+    {
+        const EMU_Profiler* profiler = render_states[i].emu.GetProfiler();
+        const std::string   root     = instances > 1 ? "instance" + std::to_string(i) : std::string();
+
+        switch (params.profile_format)
+        {
+        case R_ProfileFormat::Folded:
+            profiler->WriteFolded(output, root);
+            break;
+        case R_ProfileFormat::Histogram:
+            profiler->WriteHistogram(output, root);
+            break;
+        }
+
+        samples += profiler->GetSampleCount();
+    }
+
+    fclose(output);
+
+    fprintf(stderr,
+            "Wrote %llu profile samples to %s\n",
+            (unsigned long long)samples,
+            params.profile_filename.string().c_str());
+}
+
+bool R_RenderTrack(const SMF_MappedData& data, const R_Parameters& params)
 {
     const size_t instances = params.instances;
     auto t_start = std::chrono::high_resolution_clock::now();
 
-    // First combine all of the events so it's easier to process
-    const SMF_Track merged_track = SMF_MergeTracks(data);
-    // Then create a track specifically for each emulator instance
-    const R_TrackList split_tracks = R_SplitTrackModulo(merged_track, instances);
-
     AllRomsetInfo romset_info;
 
     common::LoadRomsetResult load_result;
@@ -1315,6 +1478,24 @@ bool R_RenderTrack(const SMF_Data& data, const R_Parameters& params)
 
     R_LoopPointRecorder loop_recorder;
 
+    R_Partition partition;
+    if (instances > 1)
+    {
+        partition = R_PartitionChannels(R_MeasureChannelLoad(data), instances, params.partition_mode);
+        for (size_t i = 0; i < instances; ++i)
+        {
+            fprintf(stderr, "#%02zu plays channels", i);
+            for (size_t ch = 0; ch < SMF_CHANNEL_COUNT; ++ch)
+            {
+                if (partition.instance_of_channel[ch] == i)
+                {
+                    fprintf(stderr, " %zu", ch + 1);
+                }
+            }
+            fprintf(stderr, " (%.1f voice-seconds)\n", partition.instance_weight[i]);
+        }
+    }
+
     R_TrackRenderState render_states[SMF_CHANNEL_COUNT];
     for (size_t i = 0; i < instances; ++i)
     {
@@ -1328,7 +1509,8 @@ bool R_RenderTrack(const SMF_Data& data, const R_Parameters& params)
         render_states[i].emu.Init({.instance_id        = i,
                                    .rom_directory      = params.rom_directory,
                                    .lcd_backend        = nullptr,
-                                   .nvram_filename = this_nvram});
+                                   .nvram_filename = this_nvram,
+                                   .memory_mode    = params.instance_memory});
 
         RomLocationSet loaded{};
         if (!render_states[i].emu.LoadRoms(load_result.romset, romset_info, &loaded))
@@ -1343,7 +1525,9 @@ bool R_RenderTrack(const SMF_Data& data, const R_Parameters& params)
         fprintf(stderr, "Initializing emulator #%02zu...\n", i);
         R_RunReset(render_states[i].emu, reset);
 
-        render_states[i].track = &split_tracks.tracks[i];
+        render_states[i].data = &data;
+        render_states[i].partition = &partition;
+        render_states[i].step_placement = params.step_placement;
         render_states[i].mixer = &mixer;
         render_states[i].queue_id = i;
         render_states[i].end_behavior = params.end_behavior;
@@ -1353,7 +1537,17 @@ bool R_RenderTrack(const SMF_Data& data, const R_Parameters& params)
 
         render_states[i].emu.SetSampleCallback(R_PickCallback<R_SilenceModelNone>(render_states[i]), &render_states[i]);
 
-        render_states[i].thread = std::thread(R_RenderOne, std::cref(data), std::ref(render_states[i]));
+        if (params.stats)
+        {
+            render_states[i].emu.EnableStats();
+        }
+
+        if (!params.profile_filename.empty())
+        {
+            render_states[i].emu.EnableProfiler(params.profile_interval);
+        }
+
+        render_states[i].thread = std::thread(R_RenderOne, std::ref(render_states[i]));
     }
 
     romset_info.PurgeRomData();
@@ -1371,11 +1565,25 @@ bool R_RenderTrack(const SMF_Data& data, const R_Parameters& params)
     {
         render_output.Open(params.output_filename, params.output_format);
     }
-    render_output.SetSampleRate(PCM_GetOutputFrequency(render_states[0].emu.GetPCM()));
+    const uint32_t emu_rate    = PCM_GetOutputFrequency(render_states[0].emu.GetPCM());
+    const uint32_t output_rate = params.output_rate.value_or(emu_rate);
+    render_output.SetSampleRate(output_rate);
+
+    AudioResampler resampler;
 
     R_MixOutState mix_out_state;
     mix_out_state.mixer = &mixer;
     mix_out_state.output = &render_output;
+
+    if (output_rate != emu_rate)
+    {
+        if (!resampler.Init(emu_rate, output_rate))
+        {
+            R_Panic("failed to create resampler");
+        }
+        fprintf(stderr, "Resampling %u Hz -> %u Hz (%zu taps)\n", emu_rate, output_rate, resampler.GetTapCount());
+        mix_out_state.resampler = &resampler;
+    }
     std::thread mix_out_thread;
 
     switch (params.output_format)
@@ -1406,11 +1614,14 @@ bool R_RenderTrack(const SMF_Data& data, const R_Parameters& params)
                 all_done = false;
             }
 
+            // Every instance reads the whole file, so progress is measured in bytes rather than events.
             const size_t processed    = render_states[i].events_processed;
-            const size_t total        = render_states[i].track->events.size();
-            const float  percent_done = 100.f * (float)processed / (float)total;
+            const size_t total_bytes  = data.GetTrackBytes();
+            const float  percent_done = total_bytes == 0 ? 100.f
+                                                         : 100.f * (float)render_states[i].bytes_processed /
+                                                               (float)total_bytes;
 
-            fprintf(stderr, "#%02zu %6.2f%% [%zu / %zu]\n", i, percent_done, processed, total);
+            fprintf(stderr, "#%02zu %6.2f%% [%zu events]\n", i, percent_done, processed);
         }
 
         if (!all_done)
@@ -1467,13 +1678,52 @@ bool R_RenderTrack(const SMF_Data& data, const R_Parameters& params)
 
     if (params.debug)
     {
+        double total_weight = 0;
+        double total_sec    = 0;
+        for (size_t i = 0; i < instances; ++i)
+        {
+            total_weight += partition.instance_weight[i];
+            total_sec += (double)render_states[i].elapsed.count() / 1e9;
+        }
+
         for (size_t i = 0; i < instances; ++i)
         {
             auto t_instance_sec = (double)render_states[i].elapsed.count() / 1e9;
-            fprintf(stderr, "#%02zu took %.2fs\n", i, t_instance_sec);
+            if (instances > 1)
+            {
+                // Every instance steps through the whole track, so only the difference in load shows up in the
+                // shares; the closer these are, the better the partition.
+                const double predicted = total_weight == 0 ? 100.0 / (double)instances
+                                                           : 100.0 * partition.instance_weight[i] / total_weight;
+                const double actual    = total_sec == 0 ? 0 : 100.0 * t_instance_sec / total_sec;
+                fprintf(stderr,
+                        "#%02zu took %.2fs (predicted %.1f%% of load, took %.1f%% of time)\n",
+                        i,
+                        t_instance_sec,
+                        predicted,
+                        actual);
+            }
+            else
+            {
+                fprintf(stderr, "#%02zu took %.2fs\n", i, t_instance_sec);
+            }
+        }
+    }
+
+    if (params.stats)
+    {
+        for (size_t i = 0; i < instances; ++i)
+        {
+            const double t_instance_sec = (double)render_states[i].elapsed.count() / 1e9;
+            common::PrintEmulatorStats(stderr, i, render_states[i].emu.GetStats(), t_instance_sec);
         }
     }
 
+    if (!params.profile_filename.empty())
+    {
+        R_WriteProfile(params, render_states, instances);
+    }
+
     auto t_finish = std::chrono::high_resolution_clock::now();
     auto t_diff   = std::chrono::duration_cast<std::chrono::nanoseconds>(t_finish - t_start);
     auto t_sec    = (double)t_diff.count() / 1e9;
@@ -1494,10 +1744,19 @@ General options:
   -v, --version                Display version information.
   -o <filename>                Render WAVE file to filename.
   --stdout                     Render raw sample data to stdout. No header
+  --stats                      Print emulator performance counters for each instance when finished.
+  --profile <filename>         Sample the emulated firmware's call stacks and write them to filename.
+  --profile-format folded|histogram
+                               Choose the profile output:
+        folded (default)           Call stacks for flamegraph.pl or speedscope
+        histogram                  Sample counts per program counter
+  --profile-interval <cycles>  MCU cycles between profile samples (default 24000, about 1ms).
+  --trace <filename>           Record a timeline of rendering and mixing and write it to filename as Chrome trace JSON.
 
 Audio options:
   -f, --format s16|s32|f32     Set output format.
   --disable-oversampling       Halves output frequency.
+  --rate <freq>                Resample the output to freq (e.g. 44100, 48000, 96000).
   --gain <amount>              Apply gain to the output.
   --end cut|release            Choose how the end of the track is handled:
         cut (default)              Stop rendering at the last MIDI event
@@ -1507,7 +1766,15 @@ Emulator options:
   -r, --reset     none|gs|gm   Send GS or GM reset before rendering.
   -n, --instances <count>      Number of emulators to use (increases effective polyphony, but
                                takes longer to render)
+  --partition modulo|balanced  Choose how channels are split between instances:
+        modulo (default)           Deal channels out to instances in turn
+        balanced                   Balance the estimated voice load of each instance
   --nvram <filename>           Saves and loads NVRAM to/from disk. JV-880 only.
+  --instance-memory heap|arena|hugepages
+                               Choose how each instance's state is allocated:
+        heap (default)             Separate allocations
+        arena                      One block, with transparent huge pages where supported
+        hugepages                  One block of explicit huge pages, falling back to arena
 
 ROM management options:
   -d, --rom-directory <dir>    Sets the directory to load roms from. Romset will be autodetected when
@@ -1517,6 +1784,8 @@ ROM management options:
 
 MIDI options:
   --dump-emidi-loop-points     Prints any encountered EMIDI loop points to stderr when finished.
+  --legacy-timing              Round each event's time like older versions, reproducing their
+                               output exactly. Instances may drift apart by a few steps.
 
 )";
 
@@ -1553,8 +1822,13 @@ int main(int argc, char* argv[])
         return 0;
     }
 
-    SMF_Data data;
-    data = SMF_LoadEvents(params.input_filename);
+    if (!params.trace_filename.empty())
+    {
+        common::TraceStart();
+        common::TraceSetThreadName("main");
+    }
+
+    const SMF_MappedData data = SMF_MapEvents(params.input_filename);
 
     if (!R_RenderTrack(data, params))
     {
@@ -1562,5 +1836,10 @@ int main(int argc, char* argv[])
         return 1;
     }
 
+    if (!params.trace_filename.empty())
+    {
+        common::TraceWrite(params.trace_filename);
+    }
+
     return 0;
 }
@@ -0,0 +1,214 @@
+#include "partition.h"
+
+#include <algorithm>
+#include <numeric>
+
+// Voices keep sounding for a while after note off. This is a rough average release time; it mostly matters for drum
+// channels, where notes are often released right after they start.
+constexpr double R_RELEASE_SECONDS = 0.25;
+
+// Cost of the firmware parsing one channel message, expressed in voice-seconds.
+constexpr double R_EVENT_WEIGHT = 0.01;
+
+double R_ChannelLoad::GetWeight(size_t channel) const
+{
+    return voice_seconds[channel] + R_EVENT_WEIGHT * (double)events[channel];
+}
+
+namespace
+{
+
+struct R_ChannelVoices
+{
+    // Notes whose key is still down, per key.
+    std::array<uint16_t, 128> held{};
+    // Notes released while the sustain pedal was down, per key.
+    std::array<uint16_t, 128> sustained{};
+    // Total of held and sustained.
+    size_t sounding = 0;
+    bool   pedal    = false;
+
+    void NoteOn(uint8_t key)
+    {
+        ++held[key];
+        ++sounding;
+    }
+
+    void NoteOff(uint8_t key)
+    {
+        if (held[key] == 0)
+        {
+            return;
+        }
+        --held[key];
+        if (pedal)
+        {
+            ++sustained[key];
+        }
+        else
+        {
+            --sounding;
+        }
+    }
+
+    void ReleasePedal()
+    {
+        pedal = false;
+        for (uint16_t& count : sustained)
+        {
+            sounding -= count;
+            count = 0;
+        }
+    }
+
+    void Silence()
+    {
+        held.fill(0);
+        sustained.fill(0);
+        sounding = 0;
+    }
+};
+
+}
+
+R_ChannelLoad R_MeasureChannelLoad(const SMF_MappedData& data)
+{
+    const SMF_ByteSpan bytes    = data.GetBytes();
+    const double       division = (double)std::max<uint16_t>(data.header.division, 1);
+
+    R_ChannelLoad load;
+
+    std::array<R_ChannelVoices, SMF_CHANNEL_COUNT> voices;
+
+    // Same tempo map bookkeeping as SMF_StepPlacement::Exact, in floating point seconds.
+    double   us_per_qn    = 500000;
+    uint64_t segment_tick = 0;
+    double   segment_sec  = 0;
+    double   last_sec     = 0;
+
+    SMF_EventStream stream(data);
+    SMF_Event       event;
+    while (stream.Next(event))
+    {
+        const double now = segment_sec + (double)(event.timestamp - segment_tick) * us_per_qn / division / 1e6;
+        for (size_t ch = 0; ch < SMF_CHANNEL_COUNT; ++ch)
+        {
+            load.voice_seconds[ch] += (double)voices[ch].sounding * (now - last_sec);
+        }
+        last_sec = now;
+
+        if (event.IsTempo(bytes))
+        {
+            segment_tick = event.timestamp;
+            segment_sec  = now;
+            us_per_qn    = (double)event.GetTempoUS(bytes);
+            continue;
+        }
+
+        if (event.IsSystem())
+        {
+            continue;
+        }
+
+        const uint8_t      channel = event.GetChannel();
+        const SMF_ByteSpan msg     = event.GetData(bytes);
+        R_ChannelVoices&   state   = voices[channel];
+
+        ++load.events[channel];
+
+        if (msg.size() < 2)
+        {
+            continue;
+        }
+
+        const uint8_t key   = msg[0] & 0x7f;
+        const uint8_t value = msg[1];
+
+        switch (event.status & 0xf0)
+        {
+        case 0x90:
+            if (value != 0)
+            {
+                state.NoteOn(key);
+                load.voice_seconds[channel] += R_RELEASE_SECONDS;
+                break;
+            }
+            state.NoteOff(key);
+            break;
+        case 0x80:
+            state.NoteOff(key);
+            break;
+        case 0xb0:
+            switch (msg[0])
+            {
+            case 64: // Sustain
+                if (value >= 64)
+                {
+                    state.pedal = true;
+                }
+                else
+                {
+                    state.ReleasePedal();
+                }
+                break;
+            case 120: // All sound off
+            case 123: // All notes off
+                state.Silence();
+                break;
+            case 121: // Reset all controllers
+                state.ReleasePedal();
+                break;
+            }
+            break;
+        }
+    }
+
+    return load;
+}
+
+R_Partition R_PartitionChannels(const R_ChannelLoad& load, size_t instances, R_PartitionMode mode)
+{
+    R_Partition partition;
+
+    std::array<size_t, SMF_CHANNEL_COUNT> channels_per_instance{};
+
+    auto assign = [&](size_t channel, size_t instance) {
+        partition.instance_of_channel[channel] = (uint8_t)instance;
+        partition.instance_weight[instance] += load.GetWeight(channel);
+        ++channels_per_instance[instance];
+    };
+
+    if (mode == R_PartitionMode::Modulo)
+    {
+        for (size_t ch = 0; ch < SMF_CHANNEL_COUNT; ++ch)
+        {
+            assign(ch, ch % instances);
+        }
+        return partition;
+    }
+
+    std::array<size_t, SMF_CHANNEL_COUNT> order;
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return load.GetWeight(a) > load.GetWeight(b);
+    });
+
+    for (size_t ch : order)
+    {
+        // Ties go to the instance with fewer channels so that unused channels are still spread out, then to the lower
+        // index so the result is deterministic.
+        size_t best = 0;
+        for (size_t i = 1; i < instances; ++i)
+        {
+            if (partition.instance_weight[i] < partition.instance_weight[best] ||
+                (partition.instance_weight[i] == partition.instance_weight[best] &&
+                 channels_per_instance[i] < channels_per_instance[best]))
+            {
+                best = i;
+            }
+        }
+        assign(ch, best);
+    }
+
+    return partition;
+}
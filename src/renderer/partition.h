@@ -0,0 +1,49 @@
+// Assigns MIDI channels to emulator instances for multi-instance rendering.
+
+#pragma once
+
+#include "smf.h"
+#include <array>
+#include <cstdint>
+
+enum class R_PartitionMode
+{
+    // Channel c is played by instance c % n.
+    Modulo,
+    // Channels are assigned so that the estimated voice load of each instance is about equal.
+    Balanced,
+};
+
+// Estimated rendering cost of each channel of a track.
+struct R_ChannelLoad
+{
+    // Integral of the number of sounding notes over time, in seconds.
+    std::array<double, SMF_CHANNEL_COUNT> voice_seconds{};
+    // Number of channel messages.
+    std::array<size_t, SMF_CHANNEL_COUNT> events{};
+
+    // Combined cost of channel `channel` in voice-seconds.
+    double GetWeight(size_t channel) const;
+};
+
+struct R_Partition
+{
+    // Instance that plays each channel.
+    std::array<uint8_t, SMF_CHANNEL_COUNT> instance_of_channel{};
+    // Sum of R_ChannelLoad::GetWeight over the channels of each instance.
+    std::array<double, SMF_CHANNEL_COUNT> instance_weight{};
+
+    bool IsEventForInstance(const SMF_Event& event, size_t instance) const
+    {
+        // System events need to be processed by all emulators
+        return event.IsSystem() || instance_of_channel[event.GetChannel()] == instance;
+    }
+};
+
+// Scans every event in `data` and estimates how many voices each channel keeps busy over the length of the track.
+// Held notes count as sounding until note off, or until the sustain pedal is released if it was down at the time.
+R_ChannelLoad R_MeasureChannelLoad(const SMF_MappedData& data);
+
+// Splits channels between `instances` emulators. Balanced mode hands out channels heaviest first, each to the instance
+// with the least load so far.
+R_Partition R_PartitionChannels(const R_ChannelLoad& load, size_t instances, R_PartitionMode mode);
@@ -0,0 +1,102 @@
+#include "player.h"
+
+#include <cstdio>
+
+// Time to transmit one byte over MIDI: 10 bits at 31250 baud.
+constexpr uint64_t R_MIDI_BYTE_NS = 320000;
+
+// Number of events decoded and scheduled at a time. Keeps memory use independent of the length of the file.
+constexpr size_t R_SCHEDULE_BLOCK_SIZE = 4096;
+
+uint64_t R_NSPerStep(Emulator& emu)
+{
+    // These are best guesses.
+    if (emu.GetMCU().is_mk1)
+    {
+        return 600;
+    }
+    else
+    {
+        return 500;
+    }
+}
+
+uint64_t R_PostMIDI(Emulator& emu, std::span<const uint8_t> bytes, uint64_t ns_per_step)
+{
+    const uint64_t steps_per_byte = R_MIDI_BYTE_NS / ns_per_step;
+    const uint64_t max_stall      = 1'000'000'000 / ns_per_step;
+
+    uint64_t steps_run = 0;
+    uint64_t stalled   = 0;
+    size_t   posted    = emu.TryPostMIDI(bytes);
+    while (posted < bytes.size())
+    {
+        if (stalled >= max_stall)
+        {
+            fprintf(stderr, "WARNING: Emulator stopped reading MIDI; dropped %zu bytes\n", bytes.size() - posted);
+            break;
+        }
+
+        for (uint64_t i = 0; i < steps_per_byte; ++i)
+        {
+            emu.Step();
+        }
+        steps_run += steps_per_byte;
+
+        const size_t count = emu.TryPostMIDI(bytes.subspan(posted));
+        posted += count;
+        stalled = count == 0 ? stalled + steps_per_byte : 0;
+    }
+
+    return steps_run;
+}
+
+R_Player::R_Player(const SMF_MappedData& data,
+                   Emulator& emu,
+                   const R_Partition* partition,
+                   size_t instance,
+                   SMF_StepPlacement placement)
+    : m_data(data),
+      m_emu(emu),
+      m_partition(partition),
+      m_instance(instance),
+      m_ns_per_step(R_NSPerStep(emu)),
+      m_stream(data),
+      m_compiler(data.header.division, m_ns_per_step, placement)
+{
+}
+
+bool R_Player::NextBlock()
+{
+    m_schedule.Clear();
+
+    SMF_Event event;
+    while (m_schedule.events.size() < R_SCHEDULE_BLOCK_SIZE && m_more && (m_more = m_stream.Next(event)))
+    {
+        if (!m_partition || m_partition->IsEventForInstance(event, m_instance))
+        {
+            m_compiler.Add(m_data.GetBytes(), event, m_schedule);
+        }
+    }
+
+    return !m_schedule.events.empty();
+}
+
+void R_Player::Play(const SMF_ScheduledEvent& event)
+{
+    while (m_steps_run < event.step + m_delay)
+    {
+        m_emu.Step();
+        ++m_steps_run;
+    }
+
+    if (event.bytes_first != event.bytes_last)
+    {
+        const uint64_t waited = R_PostMIDI(
+            m_emu,
+            std::span(m_schedule.bytes).subspan(event.bytes_first, event.bytes_last - event.bytes_first),
+            m_ns_per_step);
+        m_steps_run += waited;
+        m_delay += waited;
+    }
+}
@@ -0,0 +1,87 @@
+// Feeds the events of a MIDI file to an emulator at the emulated time they're due. Shared by the renderer and the
+// benchmarks so that both run the same code.
+
+#pragma once
+
+#include "emu.h"
+#include "partition.h"
+#include "smf.h"
+#include <cstdint>
+#include <span>
+
+// Emulated time that passes per Emulator::Step.
+uint64_t R_NSPerStep(Emulator& emu);
+
+// Posts `bytes` to the emulator without dropping any. Messages longer than the space left in the UART receive buffer,
+// such as bulk dumps, are fed in one MIDI byte time at a time, stepping the emulator in between, so they load as fast
+// as the firmware accepts them. If the firmware stops reading MIDI for a second, the rest is dropped with a warning.
+// Returns the number of steps run.
+uint64_t R_PostMIDI(Emulator& emu, std::span<const uint8_t> bytes, uint64_t ns_per_step);
+
+// Plays the events of `data` into one emulator, a block at a time:
+//
+//     R_Player player(data, emu, partition, instance);
+//     while (player.NextBlock())
+//     {
+//         for (const SMF_ScheduledEvent& event : player.GetSchedule().events)
+//         {
+//             player.Play(event);
+//         }
+//     }
+class R_Player
+{
+public:
+    // Only events that `partition` assigns to `instance` are played; all of them if `partition` is null.
+    R_Player(const SMF_MappedData& data,
+             Emulator& emu,
+             const R_Partition* partition = nullptr,
+             size_t instance = 0,
+             SMF_StepPlacement placement = SMF_StepPlacement::Exact);
+
+    // Decodes and schedules the next block of events. Returns false once every event has been played.
+    bool NextBlock();
+
+    const SMF_Schedule& GetSchedule() const
+    {
+        return m_schedule;
+    }
+
+    // Steps the emulator until `event` is due, then posts it. Call for each event of the current block in order.
+    //
+    // If posting has to wait for room in the UART receive buffer (see R_PostMIDI), the steps run while waiting count as
+    // emulated time, and every later event is delayed by as much, like on a real MIDI cable. Events keep their spacing
+    // instead of bunching up behind a bulk dump.
+    void Play(const SMF_ScheduledEvent& event);
+
+    uint64_t GetStepsRun() const
+    {
+        return m_steps_run;
+    }
+
+    // Emulated time since playback started, including time spent waiting to post.
+    uint64_t GetNSSimulated() const
+    {
+        return m_steps_run * m_ns_per_step;
+    }
+
+    // Number of track bytes decoded so far; see SMF_EventStream::GetBytesConsumed.
+    size_t GetBytesConsumed() const
+    {
+        return m_stream.GetBytesConsumed();
+    }
+
+private:
+    const SMF_MappedData& m_data;
+    Emulator&             m_emu;
+    const R_Partition*    m_partition;
+    size_t                m_instance;
+    uint64_t              m_ns_per_step;
+
+    SMF_EventStream      m_stream;
+    SMF_ScheduleCompiler m_compiler;
+    SMF_Schedule         m_schedule;
+    bool                 m_more      = true;
+    uint64_t             m_steps_run = 0;
+    // Total steps spent waiting in R_PostMIDI; added to the step of every event scheduled after the wait.
+    uint64_t             m_delay     = 0;
+};
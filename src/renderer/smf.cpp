@@ -221,6 +221,92 @@ inline bool SMF_IsStatusByte(uint8_t byte)
     return (byte & 0x80) != 0;
 }
 
+// Decodes the event at the reader's position into `new_event`. Returns true if it was an end of track meta event.
+static bool SMF_ReadEvent(SMF_Reader& reader, uint8_t& running_status, uint64_t& total_time, SMF_Event& new_event)
+{
+    uint32_t delta_time;
+    CHECK(SMF_ReadVarint(reader, delta_time));
+
+    uint8_t event_head;
+    CHECK(reader.ReadU8(event_head));
+
+    if (SMF_IsStatusByte(event_head))
+    {
+        running_status = event_head;
+    }
+    else
+    {
+        // Put back, this is actually a data byte. No need to check if this
+        // op is valid because we only got here if we already read a status
+        // byte.
+        (void)reader.PutBack();
+    }
+
+    total_time += delta_time;
+
+    new_event.delta_time = delta_time;
+    new_event.timestamp  = total_time;
+    new_event.status     = running_status;
+
+    switch (new_event.status & 0xF0)
+    {
+        // 2 param
+        case 0x80:
+        case 0x90:
+        case 0xA0:
+        case 0xB0:
+        case 0xE0:
+            new_event.data_first = reader.GetOffset();
+            CHECK(reader.Skip(2));
+            new_event.data_last  = reader.GetOffset();
+            break;
+        // 1 param
+        case 0xC0:
+        case 0xD0:
+            new_event.data_first = reader.GetOffset();
+            CHECK(reader.Skip(1));
+            new_event.data_last  = reader.GetOffset();
+            break;
+        // variable length
+        case 0xF0:
+            {
+                if (new_event.status == 0xF0 || new_event.status == 0xF7)
+                {
+                    // Sysex events
+                    uint32_t sysex_len;
+                    CHECK(SMF_ReadVarint(reader, sysex_len));
+                    new_event.data_first = reader.GetOffset();
+                    CHECK(reader.Skip(sysex_len));
+                    new_event.data_last  = reader.GetOffset();
+                }
+                else if (new_event.status == 0xFF)
+                {
+                    // Meta events
+                    uint32_t meta_len;
+                    new_event.data_first = reader.GetOffset();
+                    uint8_t meta_type;
+                    CHECK(reader.ReadU8(meta_type));
+                    CHECK(SMF_ReadVarint(reader, meta_len));
+                    CHECK(reader.Skip(meta_len));
+                    new_event.data_last  = reader.GetOffset();
+
+                    if (meta_type == 0x2F)
+                    {
+                        return true;
+                    }
+                }
+                else
+                {
+                    fprintf(stderr, "Panic: unhandled Fx message: %x\n", new_event.status);
+                    exit(1);
+                }
+            }
+            break;
+    }
+
+    return false;
+}
+
 bool SMF_ReadTrack(SMF_Reader& reader, SMF_Data& result, uint64_t expected_end)
 {
     uint8_t running_status = 0;
@@ -233,90 +319,16 @@ bool SMF_ReadTrack(SMF_Reader& reader, SMF_Data& result, uint64_t expected_end)
 
     while (reader.GetOffset() < expected_end)
     {
-        uint32_t delta_time;
-        CHECK(SMF_ReadVarint(reader, delta_time));
-
-        uint8_t event_head;
-        CHECK(reader.ReadU8(event_head));
-
-        if (SMF_IsStatusByte(event_head))
-        {
-            running_status = event_head;
-        }
-        else
-        {
-            // Put back, this is actually a data byte. No need to check if this
-            // op is valid because we only got here if we already read a status
-            // byte.
-            (void)reader.PutBack();
-        }
-
-        total_time += delta_time;
-
         new_track.events.emplace_back();
         SMF_Event& new_event = new_track.events.back();
         new_event.seq_id     = new_track.events.size();
-        new_event.delta_time = delta_time;
-        new_event.timestamp  = total_time;
-        new_event.status     = running_status;
-	new_event.track_id   = this_track;
+        new_event.track_id   = this_track;
 
-        switch (new_event.status & 0xF0)
+        // End of track: stop reading events and skip to where the next track would be
+        if (SMF_ReadEvent(reader, running_status, total_time, new_event))
         {
-            // 2 param
-            case 0x80:
-            case 0x90:
-            case 0xA0:
-            case 0xB0:
-            case 0xE0:
-                new_event.data_first = reader.GetOffset();
-                CHECK(reader.Skip(2));
-                new_event.data_last  = reader.GetOffset();
-                break;
-            // 1 param
-            case 0xC0:
-            case 0xD0:
-                new_event.data_first = reader.GetOffset();
-                CHECK(reader.Skip(1));
-                new_event.data_last  = reader.GetOffset();
-                break;
-            // variable length
-            case 0xF0:
-                {
-                    if (new_event.status == 0xF0 || new_event.status == 0xF7)
-                    {
-                        // Sysex events
-                        uint32_t sysex_len;
-                        CHECK(SMF_ReadVarint(reader, sysex_len));
-                        new_event.data_first = reader.GetOffset();
-                        CHECK(reader.Skip(sysex_len));
-                        new_event.data_last  = reader.GetOffset();
-                    }
-                    else if (new_event.status == 0xFF)
-                    {
-                        // Meta events
-                        uint32_t meta_len;
-                        new_event.data_first = reader.GetOffset();
-                        uint8_t meta_type;
-                        CHECK(reader.ReadU8(meta_type));
-                        CHECK(SMF_ReadVarint(reader, meta_len));
-                        CHECK(reader.Skip(meta_len));
-                        new_event.data_last  = reader.GetOffset();
-
-                        // End of track: stop reading events and skip to where the next track would be
-                        if (meta_type == 0x2F)
-                        {
-                            CHECK(reader.Seek(expected_end));
-                            return true;
-                        }
-                    }
-                    else
-                    {
-                        fprintf(stderr, "Panic: unhandled Fx message: %x\n", new_event.status);
-                        exit(1);
-                    }
-                }
-                break;
+            CHECK(reader.Seek(expected_end));
+            return true;
         }
     }
 
@@ -407,3 +419,221 @@ SMF_Data SMF_LoadEvents(const std::filesystem::path& filename)
     return data;
 }
 
+
+SMF_MappedData SMF_MapEvents(const std::filesystem::path& filename)
+{
+    SMF_MappedData data{};
+
+    CHECK(data.file.Open(filename));
+
+    SMF_Reader reader(data.GetBytes());
+
+    while (!reader.AtEnd())
+    {
+        const size_t chunk_start = reader.GetOffset();
+
+        uint8_t chunk_type[4];
+        CHECK(reader.ReadBytes(chunk_type, 4));
+
+        uint32_t chunk_size = 0;
+        CHECK(reader.ReadU32BE(chunk_size));
+
+        const size_t chunk_first = reader.GetOffset();
+        CHECK(reader.Skip(chunk_size));
+
+        if (memcmp(chunk_type, "MThd", 4) == 0)
+        {
+            SMF_Reader header_reader(data.GetBytes().subspan(chunk_first, chunk_size));
+            SMF_ReadHeader(header_reader, data.header);
+        }
+        else if (memcmp(chunk_type, "MTrk", 4) == 0)
+        {
+            data.tracks.push_back({chunk_first, reader.GetOffset()});
+        }
+        else
+        {
+            fprintf(stderr, "Unexpected chunk type at %zu\n", chunk_start);
+            CHECK(false);
+        }
+    }
+
+    return data;
+}
+
+size_t SMF_MappedData::GetTrackBytes() const
+{
+    size_t total = 0;
+    for (const SMF_TrackRange& range : tracks)
+    {
+        total += range.last - range.first;
+    }
+    return total;
+}
+
+SMF_TrackCursor::SMF_TrackCursor(SMF_ByteSpan bytes, SMF_TrackRange range, uint16_t track_id)
+    : m_bytes(bytes),
+      m_range(range),
+      m_offset(range.first),
+      m_track_id(track_id)
+{
+}
+
+bool SMF_TrackCursor::Next(SMF_Event& out_event)
+{
+    if (m_done || m_offset >= m_range.last)
+    {
+        m_offset = m_range.last;
+        return false;
+    }
+
+    // Offsets in events are relative to the whole file, so read from there and check the bound ourselves.
+    SMF_Reader reader(m_bytes);
+    CHECK(reader.Seek(m_offset));
+
+    out_event.seq_id   = ++m_seq_id;
+    out_event.track_id = m_track_id;
+
+    if (SMF_ReadEvent(reader, m_running_status, m_total_time, out_event))
+    {
+        // Anything after end of track is ignored.
+        m_done = true;
+    }
+
+    m_offset = reader.GetOffset();
+    CHECK(m_offset <= m_range.last);
+
+    return true;
+}
+
+// Heap order: the event that should come first is "greater" so that it ends up at the front of a std:: max-heap.
+static bool SMF_ComesAfter(const SMF_Event& left, const SMF_Event& right)
+{
+    if (left.timestamp != right.timestamp)
+    {
+        return left.timestamp > right.timestamp;
+    }
+    if (left.seq_id != right.seq_id)
+    {
+        return left.seq_id > right.seq_id;
+    }
+    return left.track_id > right.track_id;
+}
+
+SMF_EventStream::SMF_EventStream(const SMF_MappedData& data)
+{
+    m_cursors.reserve(data.tracks.size());
+    for (size_t i = 0; i < data.tracks.size(); ++i)
+    {
+        m_cursors.emplace_back(data.GetBytes(), data.tracks[i], RangeCast<uint16_t>(i));
+    }
+
+    m_heap.reserve(m_cursors.size());
+    for (size_t i = 0; i < m_cursors.size(); ++i)
+    {
+        Pending pending{.event = {}, .cursor = i};
+        if (m_cursors[i].Next(pending.event))
+        {
+            m_heap.push_back(pending);
+        }
+    }
+
+    const auto comes_after = [](const Pending& left, const Pending& right) {
+        return SMF_ComesAfter(left.event, right.event);
+    };
+    std::make_heap(m_heap.begin(), m_heap.end(), comes_after);
+}
+
+bool SMF_EventStream::Next(SMF_Event& out_event)
+{
+    if (m_heap.empty())
+    {
+        return false;
+    }
+
+    const auto comes_after = [](const Pending& left, const Pending& right) {
+        return SMF_ComesAfter(left.event, right.event);
+    };
+
+    std::pop_heap(m_heap.begin(), m_heap.end(), comes_after);
+    Pending& front = m_heap.back();
+    out_event      = front.event;
+
+    // Refill from the same track, which is the only one whose next event could now be the earliest.
+    if (m_cursors[front.cursor].Next(front.event))
+    {
+        std::push_heap(m_heap.begin(), m_heap.end(), comes_after);
+    }
+    else
+    {
+        m_heap.pop_back();
+    }
+
+    return true;
+}
+
+size_t SMF_EventStream::GetBytesConsumed() const
+{
+    size_t total = 0;
+    for (const SMF_TrackCursor& cursor : m_cursors)
+    {
+        total += cursor.GetBytesConsumed();
+    }
+    return total;
+}
+
+SMF_ScheduleCompiler::SMF_ScheduleCompiler(uint16_t division, uint64_t ns_per_step, SMF_StepPlacement placement)
+    : m_placement(placement),
+      m_division(std::max<uint64_t>(division, 1)),
+      m_ns_per_step(ns_per_step),
+      m_time_per_step(m_division * ns_per_step)
+{
+}
+
+uint64_t SMF_ScheduleCompiler::ExactStep(const SMF_Event& event) const
+{
+    const uint64_t time = m_segment_time + (event.timestamp - m_segment_tick) * m_us_per_qn;
+
+    // ceil(time * 1000 / m_time_per_step) without overflowing the intermediate product
+    const uint64_t whole     = time / m_time_per_step;
+    const uint64_t remainder = time % m_time_per_step;
+    return whole * 1000 + (remainder * 1000 + m_time_per_step - 1) / m_time_per_step;
+}
+
+uint64_t SMF_ScheduleCompiler::LegacyStep(const SMF_Event& event)
+{
+    // The previous event was posted on a step boundary, so waiting until `delta_ns` has passed means running
+    // ceil(delta_ns / ns_per_step) more steps.
+    const uint64_t delta_ns = 1000 * SMF_TicksToUS(event.timestamp - m_last_tick, m_us_per_qn, m_division);
+    m_step += (delta_ns + m_ns_per_step - 1) / m_ns_per_step;
+    m_last_tick = event.timestamp;
+    return m_step;
+}
+
+void SMF_ScheduleCompiler::Add(SMF_ByteSpan bytes, const SMF_Event& event, SMF_Schedule& schedule)
+{
+    const uint64_t step = m_placement == SMF_StepPlacement::Exact ? ExactStep(event) : LegacyStep(event);
+
+    // A tempo event only affects the events after it.
+    if (event.IsTempo(bytes))
+    {
+        m_segment_time = m_segment_time + (event.timestamp - m_segment_tick) * m_us_per_qn;
+        m_segment_tick = event.timestamp;
+        m_us_per_qn    = event.GetTempoUS(bytes);
+    }
+
+    const uint32_t bytes_first = RangeCast<uint32_t>(schedule.bytes.size());
+    if (!event.IsMetaEvent())
+    {
+        const SMF_ByteSpan event_data = event.GetData(bytes);
+        schedule.bytes.push_back(event.status);
+        schedule.bytes.insert(schedule.bytes.end(), event_data.begin(), event_data.end());
+    }
+
+    schedule.events.push_back(SMF_ScheduledEvent{
+        .step        = step,
+        .bytes_first = bytes_first,
+        .bytes_last  = RangeCast<uint32_t>(schedule.bytes.size()),
+        .track_id    = event.track_id,
+        .status      = event.status,
+    });
+}
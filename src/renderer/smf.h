@@ -2,6 +2,7 @@
 
 #pragma once
 
+#include "mapped_file.h"
 #include <cstdint>
 #include <filesystem>
 #include <span>
@@ -87,6 +88,167 @@ struct SMF_Data
     std::vector<SMF_Track> tracks;
 };
 
+// An event scheduled to a specific emulator step.
+struct SMF_ScheduledEvent
+{
+    // Number of emulator steps that must have run before this event is posted.
+    uint64_t step;
+    // Range of SMF_Schedule::bytes to post. Empty for meta events.
+    uint32_t bytes_first, bytes_last;
+    // Copied from the source event.
+    uint16_t track_id;
+    uint8_t status;
+
+    uint8_t GetChannel() const
+    {
+        return status & 0x0f;
+    }
+
+    bool IsControlChange() const
+    {
+        return (status & 0xf0) == 0xb0;
+    }
+};
+
+// Flat, render-ready form of a run of events.
+struct SMF_Schedule
+{
+    std::vector<SMF_ScheduledEvent> events;
+    // Status byte followed by data for every non-meta event, in playback order.
+    std::vector<uint8_t> bytes;
+
+    void Clear()
+    {
+        events.clear();
+        bytes.clear();
+    }
+
+    // Returns the data bytes of `event`, excluding the status byte.
+    SMF_ByteSpan GetData(const SMF_ScheduledEvent& event) const
+    {
+        return SMF_ByteSpan(bytes).subspan(event.bytes_first + 1, event.bytes_last - event.bytes_first - 1);
+    }
+};
+
+// Location of an MTrk chunk's events within a file.
+struct SMF_TrackRange
+{
+    size_t first, last;
+};
+
+// A memory-mapped MIDI file. Only the header and the chunk layout are read up front; events are decoded on demand by
+// SMF_EventStream, so memory use doesn't depend on the length of the file.
+struct SMF_MappedData
+{
+    SMF_Header header;
+    MappedFile file;
+    std::vector<SMF_TrackRange> tracks;
+
+    SMF_ByteSpan GetBytes() const
+    {
+        return file.GetData();
+    }
+
+    // Total size of all track chunks, for progress reporting.
+    size_t GetTrackBytes() const;
+};
+
+// Decodes the events of one track in order.
+class SMF_TrackCursor
+{
+public:
+    SMF_TrackCursor(SMF_ByteSpan bytes, SMF_TrackRange range, uint16_t track_id);
+
+    // Decodes the next event into `out_event`. Returns false once the track's end has been reached.
+    bool Next(SMF_Event& out_event);
+
+    // Number of bytes of the track decoded so far.
+    size_t GetBytesConsumed() const
+    {
+        return m_offset - m_range.first;
+    }
+
+private:
+    SMF_ByteSpan   m_bytes;
+    SMF_TrackRange m_range;
+    size_t         m_offset;
+    uint64_t       m_total_time     = 0;
+    uint64_t       m_seq_id         = 0;
+    uint16_t       m_track_id;
+    uint8_t        m_running_status = 0;
+    bool           m_done           = false;
+};
+
+// Yields the events of every track merged into a single time-ordered stream. The order is the same as
+// SMF_MergeTracks: by timestamp, then position within the track, then track number. Only one decoded event per track
+// is held at a time, in a min-heap keyed on that order.
+class SMF_EventStream
+{
+public:
+    explicit SMF_EventStream(const SMF_MappedData& data);
+
+    // Writes the next event to `out_event`. Returns false when all tracks are exhausted.
+    bool Next(SMF_Event& out_event);
+
+    // Number of track bytes decoded so far; reaches SMF_MappedData::GetTrackBytes at the end of the stream.
+    size_t GetBytesConsumed() const;
+
+private:
+    struct Pending
+    {
+        SMF_Event event;
+        size_t    cursor;
+    };
+
+    std::vector<SMF_TrackCursor> m_cursors;
+    std::vector<Pending>         m_heap;
+};
+
+// How SMF_ScheduleCompiler turns event times into emulator steps.
+enum class SMF_StepPlacement
+{
+    // An event at time t is scheduled at the first step boundary at or after t, i.e. step ceil(t / ns_per_step). Times
+    // are computed from each event's absolute tick timestamp using the tempo events seen so far and exact integer
+    // arithmetic, so events with the same timestamp land on the same step for every instance compiling a subset of the
+    // same file, as long as each instance sees all the tempo events.
+    Exact,
+    // Each event is placed relative to the previous event added: the tick delta between them is converted to whole
+    // microseconds at the current tempo and rounded up to whole steps. This is how older versions placed events, so it
+    // reproduces their output exactly. Because the rounding depends on which events an instance sees, events with the
+    // same timestamp may land a few steps apart in different instances.
+    Legacy,
+};
+
+// Schedules events onto emulator steps of `ns_per_step` nanoseconds, one at a time and in stream order.
+class SMF_ScheduleCompiler
+{
+public:
+    SMF_ScheduleCompiler(uint16_t          division,
+                         uint64_t          ns_per_step,
+                         SMF_StepPlacement placement = SMF_StepPlacement::Exact);
+
+    // Appends `event` to `schedule`. `bytes` is the buffer the event's data offsets refer to.
+    void Add(SMF_ByteSpan bytes, const SMF_Event& event, SMF_Schedule& schedule);
+
+private:
+    uint64_t ExactStep(const SMF_Event& event) const;
+    uint64_t LegacyStep(const SMF_Event& event);
+
+    SMF_StepPlacement m_placement;
+    uint64_t m_division;
+    uint64_t m_ns_per_step;
+    uint64_t m_us_per_qn = 500000;
+
+    // Exact: elapsed time is tracked as microseconds * division, which is an integer for any tempo map.
+    uint64_t m_time_per_step;
+    uint64_t m_segment_tick = 0;
+    uint64_t m_segment_time = 0;
+
+    // Legacy: the previous event's tick and step.
+    uint64_t m_last_tick = 0;
+    uint64_t m_step      = 0;
+};
+
 const size_t SMF_CHANNEL_COUNT = 16;
 
 void SMF_SetDeltasFromTimestamps(SMF_Track& track);
@@ -95,6 +257,9 @@ void SMF_PrintStats(const SMF_Data& data);
 SMF_Data SMF_LoadEvents(const char* filename);
 SMF_Data SMF_LoadEvents(const std::filesystem::path& filename);
 
+// Maps `filename` and locates its tracks. Exits on malformed files, like SMF_LoadEvents.
+SMF_MappedData SMF_MapEvents(const std::filesystem::path& filename);
+
 inline uint64_t SMF_TicksToUS(uint64_t ticks, uint64_t us_per_qn, uint64_t division)
 {
     return ticks * us_per_qn / division;
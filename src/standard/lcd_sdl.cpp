@@ -243,6 +243,9 @@ bool LCD_SDL_Backend::Start(lcd_t& lcd)
             return false;
     }
 
+    m_needs_redraw      = true;
+    m_needs_full_upload = true;
+
     return true;
 }
 
@@ -446,6 +449,11 @@ void LCD_SDL_Backend::HandleEvent(const SDL_Event& sdl_event)
         }
     }
 
+    if (sc_volume.changed || jv_volume.changed || jv_encoder.changed)
+    {
+        m_needs_redraw = true;
+    }
+
     if (background_enabled) {
         LCD_Knob* volume_knob = nullptr;
         if (m_lcd->mcu->romset == Romset::MK1 || m_lcd->mcu->romset == Romset::MK2) 
@@ -487,6 +495,8 @@ void LCD_SDL_Backend::HandleEvent(const SDL_Event& sdl_event)
             {
                 m_quit_requested = true;
             }
+            // Exposed, restored, resized etc. may have discarded the window contents.
+            m_needs_redraw = true;
             break;
 
         case SDL_KEYDOWN:
@@ -615,12 +625,41 @@ void LCD_SDL_Backend::HandleEvent(const SDL_Event& sdl_event)
 
 void LCD_SDL_Backend::Render()
 {
-    SDL_Rect rect;
-    rect.x = 0;
-    rect.y = 0;
-    rect.w = (int32_t)m_lcd->width;
-    rect.h = (int32_t)m_lcd->height;
-    SDL_UpdateTexture(m_texture, &rect, m_lcd->buffer, lcd_width_max * 4);
+    // Only upload the regions of the LCD that changed. With the software renderer every upload is a CPU copy, so
+    // pushing the full framebuffer for a single changed character is wasteful.
+    if (m_needs_full_upload)
+    {
+        SDL_Rect rect;
+        rect.x = 0;
+        rect.y = 0;
+        rect.w = (int32_t)m_lcd->width;
+        rect.h = (int32_t)m_lcd->height;
+        SDL_UpdateTexture(m_texture, &rect, m_lcd->buffer, lcd_width_max * 4);
+        m_needs_full_upload = false;
+        m_needs_redraw      = true;
+    }
+    else
+    {
+        for (size_t i = 0; i < m_lcd->dirty_count; i++)
+        {
+            const LCD_Rect& dirty = m_lcd->dirty_rects[i];
+            SDL_Rect rect;
+            rect.x = dirty.x;
+            rect.y = dirty.y;
+            rect.w = dirty.w;
+            rect.h = dirty.h;
+            SDL_UpdateTexture(m_texture, &rect, &m_lcd->buffer[dirty.y][dirty.x], lcd_width_max * 4);
+        }
+    }
+
+    const uint32_t button_enable = m_lcd->button_enable;
+    if (m_lcd->dirty_count == 0 && !m_needs_redraw && button_enable == m_drawn_button_enable)
+    {
+        // Nothing visible changed; keep the previously presented frame.
+        return;
+    }
+    m_needs_redraw        = false;
+    m_drawn_button_enable = button_enable;
 
     if ((m_lcd->mcu->romset == Romset::MK1 || m_lcd->mcu->romset == Romset::MK2) && background_enabled) {
         SDL_Rect srcrect, dstrect;
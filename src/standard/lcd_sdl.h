@@ -95,4 +95,11 @@ private:
 
     // When the user closes the window this becomes true
     bool m_quit_requested = false;
+
+    // Set when something other than the LCD contents (window exposure, knobs) requires the window to be redrawn.
+    bool m_needs_redraw = true;
+    // Set when the texture contents are unknown and the whole LCD buffer must be uploaded.
+    bool m_needs_full_upload = true;
+    // Panel button lights as of the last presented frame.
+    uint32_t m_drawn_button_enable = 0;
 };
@@ -38,13 +38,17 @@
 #include "emu.h"
 #include "mcu.h"
 #include "lcd_sdl.h"
+#include "lcd_text.h"
 #include "midi.h"
+#include "midi_out.h"
 #include "output_common.h"
 #include "pcm.h"
 #include "rc.h"
+#include "resampler.h"
 #include "ringbuffer.h"
 #include "serial.h"
 #include <SDL.h>
+#include <chrono>
 #include <optional>
 #include <thread>
 
@@ -56,6 +60,9 @@
 #include "common/gain.h"
 #include "common/path_util.h"
 #include "common/rom_loader.h"
+#include "common/stats_report.h"
+#include "common/thread_util.h"
+#include "common/trace.h"
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -67,17 +74,35 @@ size_t FE_CalcRingbufferSizeBytes(uint32_t buffer_size, uint32_t buffer_count)
     return fe::bit_ceil<size_t>(1 + (size_t)buffer_size * (size_t)buffer_count * sizeof(ElemT));
 }
 
+// Controller state for --low-latency. Only accessed by the event loop.
+struct FE_AdaptiveBuffering
+{
+    // Smallest buffer count that hasn't underrun so far.
+    uint32_t floor = 0;
+    // Values of the corresponding counters at the last check.
+    uint64_t underruns = 0;
+    uint64_t busy_ns   = 0;
+    uint64_t idle_ns   = 0;
+
+    std::chrono::steady_clock::time_point last_check;
+    std::chrono::steady_clock::time_point last_change;
+};
+
 struct FE_Instance
 {
     Emulator emu;
 
     std::unique_ptr<LCD_SDL_Backend> sdl_lcd;
+    std::unique_ptr<LCD_Text_Backend> text_lcd;
 
     GenericBuffer  sample_buffer;
     RingbufferView view;
     void*          chunk_first = nullptr;
     void*          chunk_last  = nullptr;
 
+    // Position in FE_Application::instances.
+    size_t index = 0;
+
     std::thread thread;
     AudioFormat format;
 
@@ -87,8 +112,34 @@ struct FE_Instance
     uint32_t buffer_size;
     uint32_t buffer_count;
 
+    // Number of `buffer_size` buffers the instance thread keeps queued; at most `buffer_count`. Fixed unless adaptive
+    // buffering is enabled, in which case the event loop adjusts it.
+    std::atomic<uint32_t> buffer_target = 0;
+
+    // Time the instance thread spent emulating vs. waiting for the audio callback. Written by the instance thread.
+    std::atomic<uint64_t> busy_ns = 0;
+    std::atomic<uint64_t> idle_ns = 0;
+
+    // Index returned by Out_SDL_AddSource.
+    size_t output_source = 0;
+
+    FE_AdaptiveBuffering adaptive;
+
     float gain = 1.0f;
 
+    // CPU the instance thread is pinned to, if any.
+    std::optional<uint32_t> cpu;
+    common::ThreadPolicy    thread_policy = common::ThreadPolicy::Default;
+
+    // Frequency of the frames written to `view`.
+    uint32_t output_frequency = 0;
+
+    // Only set when the output frequency differs from the emulator's. Frames are collected in `resample_in` and
+    // converted a block at a time.
+    std::unique_ptr<AudioResampler> resampler;
+    std::vector<AudioFrame<float>>  resample_in;
+    std::vector<AudioFrame<float>>  resample_out;
+
 #if NUKED_ENABLE_ASIO
     // ASIO uses an SDL_AudioStream because it needs resampling to a more conventional frequency, but putting data into
     // the stream one frame at a time is *slow* so we buffer audio in `sample_buffer` and add it all at once.
@@ -130,6 +181,17 @@ struct FE_Application {
 
     AudioOutput audio_output{};
 
+    // Destination for --lcd-text snapshots. Only written to from the event loop.
+    FILE* lcd_text_output = nullptr;
+
+    bool adaptive_buffering = false;
+
+    // Print per-instance performance counters on exit.
+    bool print_stats = false;
+
+    // If not empty, the trace recorded since startup is written here on exit.
+    std::filesystem::path trace_filename;
+
     bool running = false;
 };
 
@@ -150,6 +212,7 @@ struct FE_Parameters
     std::string audio_device;
     uint32_t buffer_size  = 512;
     uint32_t buffer_count = 16;
+    bool low_latency      = false;
     std::optional<EMU_SystemReset> reset;
     size_t instances      = 1;
     std::string_view romset_name;
@@ -158,7 +221,16 @@ struct FE_Parameters
     std::optional<std::filesystem::path> rom_directory;
     AudioFormat output_format = AudioFormat::S16;
     bool no_lcd               = false;
+    bool stats                = false;
+    std::filesystem::path trace_filename;
+    std::string lcd_text_path;
     bool disable_oversampling = false;
+    std::optional<uint32_t> output_rate;
+    common::ThreadPolicy thread_policy = common::ThreadPolicy::Default;
+    std::vector<uint32_t> instance_cpus;
+    EMU_MemoryMode instance_memory = EMU_MemoryMode::Heap;
+    std::optional<uint32_t> audio_cpu;
+    std::optional<uint32_t> midi_cpu;
     std::optional<uint32_t> asio_sample_rate;
     std::string asio_left_channel;
     std::string asio_right_channel;
@@ -185,9 +257,18 @@ bool FE_AllocateInstance(FE_Application& container, FE_Instance** result)
     return true;
 }
 
+// How long FE_SendMIDI waits for an instance to make room for incoming MIDI before dropping it. Only reached if the
+// instance thread is stalled; a bulk dump arriving at MIDI speed is consumed as fast as it arrives.
+constexpr auto FE_MIDI_POST_TIMEOUT = std::chrono::milliseconds(500);
+
 void FE_SendMIDI(FE_Application& fe, size_t n, std::span<const uint8_t> bytes)
 {
-    fe.instances[n].emu.PostMIDI(bytes);
+    common::TraceInstant("midi post", (int64_t)n);
+    const size_t posted = fe.instances[n].emu.PostMIDIWait(bytes, FE_MIDI_POST_TIMEOUT);
+    if (posted != bytes.size())
+    {
+        fprintf(stderr, "WARNING: Instance %zu MIDI input overflowed; dropped %zu bytes\n", n, bytes.size() - posted);
+    }
 }
 
 void FE_BroadcastMIDI(FE_Application& fe, std::span<const uint8_t> bytes)
@@ -205,6 +286,8 @@ void FE_RouteMIDI(FE_Application& fe, std::span<const uint8_t> bytes)
         return;
     }
 
+    common::TraceInstant("midi in", (int64_t)bytes.size());
+
     uint8_t first = bytes[0];
 
     if (first < 0x80)
@@ -239,23 +322,56 @@ void FE_BroadcastSerial(FE_Application& fe, const uint8_t sbyte)
     }
 }
 
-void FE_RouteSerial(FE_Application& fe, uint8_t sbyte)
+void FE_SendSerialRun(FE_Application& fe, std::span<const uint8_t> bytes)
 {
-    if (sbyte == 0xF0)
-        fe.current_instance = 16; //Broadcast
-    else if (sbyte >= 0x80 && sbyte <= 0xDF)
+    if (bytes.empty())
     {
-        fe.current_instance = (sbyte  & 0x0F) % fe.instances_in_use;
+        return;
     }
 
     if (fe.current_instance == 16)
     {
-        FE_BroadcastSerial(fe, sbyte);
+        for (size_t i = 0; i < fe.instances_in_use; ++i)
+        {
+            fe.instances[i].emu.PostSerial(bytes);
+        }
     }
     else
     {
-        FE_SendSerial(fe, fe.current_instance, sbyte);
+        fe.instances[fe.current_instance].emu.PostSerial(bytes);
+    }
+}
+
+// Routes serial data a run at a time. Bytes keep going to the same instance until a status byte selects another, so
+// everything between two route changes is posted at once.
+void FE_RouteSerial(FE_Application& fe, std::span<const uint8_t> bytes)
+{
+    size_t run_start = 0;
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        const uint8_t sbyte = bytes[i];
+
+        size_t route = fe.current_instance;
+        if (sbyte == 0xF0)
+            route = 16; //Broadcast
+        else if (sbyte >= 0x80 && sbyte <= 0xDF)
+        {
+            route = (sbyte  & 0x0F) % fe.instances_in_use;
+        }
+
+        if (route != fe.current_instance)
+        {
+            FE_SendSerialRun(fe, bytes.subspan(run_start, i - run_start));
+            fe.current_instance = route;
+            run_start           = i;
+        }
     }
+    FE_SendSerialRun(fe, bytes.subspan(run_start));
+}
+
+void FE_RouteSerial(FE_Application& fe, uint8_t sbyte)
+{
+    FE_RouteSerial(fe, std::span<const uint8_t>(&sbyte, 1));
 }
 
 void FE_BroadcastRC(FE_Application& fe, const uint8_t sbyte)
@@ -297,6 +413,52 @@ void FE_ReceiveSampleSDL(void* userdata, const AudioFrame<int32_t>& in)
     }
 }
 
+// Number of emulator frames FE_ReceiveSampleResampledSDL collects before running the resampler. Small enough to add
+// negligible latency, large enough to amortize the cost of each call.
+constexpr size_t FE_RESAMPLE_BLOCK_SIZE = 64;
+
+template <typename SampleT, bool ApplyGain>
+void FE_ReceiveSampleResampledSDL(void* userdata, const AudioFrame<int32_t>& in)
+{
+    FE_Instance& fe = *(FE_Instance*)userdata;
+
+    // Resampling happens in float; the result is converted to the output format afterwards.
+    AudioFrame<float> frame;
+
+    if (fe.sdl_lcd == nullptr)
+        Normalize(in, frame);
+    else
+        Normalize(in, frame, fe.sdl_lcd->GetSDLVolume());
+
+    if constexpr (ApplyGain)
+    {
+        Scale(frame, fe.gain);
+    }
+
+    fe.resample_in.push_back(frame);
+    if (fe.resample_in.size() < FE_RESAMPLE_BLOCK_SIZE)
+    {
+        return;
+    }
+
+    fe.resample_out.clear();
+    fe.resampler->Process(fe.resample_in, fe.resample_out);
+    fe.resample_in.clear();
+
+    for (const AudioFrame<float>& resampled : fe.resample_out)
+    {
+        AudioFrame<SampleT>* out = (AudioFrame<SampleT>*)fe.chunk_first;
+        ConvertFrame(resampled, *out);
+        fe.chunk_first = out + 1;
+
+        if (fe.chunk_first == fe.chunk_last)
+        {
+            fe.Finish<SampleT>();
+            fe.Prepare<SampleT>();
+        }
+    }
+}
+
 #if NUKED_ENABLE_ASIO
 template <typename SampleT, bool ApplyGain>
 void FE_ReceiveSampleASIO(void* userdata, const AudioFrame<int32_t>& in)
@@ -331,7 +493,20 @@ void FE_ReceiveSampleASIO(void* userdata, const AudioFrame<int32_t>& in)
 
 constexpr mcu_sample_callback FE_PickCallback(const FE_Application& app, const FE_Instance& inst)
 {
-    if (app.audio_output.kind == AudioOutputKind::SDL)
+    if (app.audio_output.kind == AudioOutputKind::SDL && inst.resampler)
+    {
+        const bool apply_gain = inst.gain != 1.f;
+        switch (inst.format)
+        {
+        case AudioFormat::S16:
+            return apply_gain ? FE_ReceiveSampleResampledSDL<int16_t, true> : FE_ReceiveSampleResampledSDL<int16_t, false>;
+        case AudioFormat::S32:
+            return apply_gain ? FE_ReceiveSampleResampledSDL<int32_t, true> : FE_ReceiveSampleResampledSDL<int32_t, false>;
+        case AudioFormat::F32:
+            return apply_gain ? FE_ReceiveSampleResampledSDL<float, true> : FE_ReceiveSampleResampledSDL<float, false>;
+        }
+    }
+    else if (app.audio_output.kind == AudioOutputKind::SDL)
     {
         if (inst.gain != 1.f)
         {
@@ -564,6 +739,27 @@ bool FE_OpenSDLAudio(FE_Application& fe, const AudioOutputParameters& params, co
     for (size_t i = 0; i < fe.instances_in_use; ++i)
     {
         FE_Instance& inst = fe.instances[i];
+
+        const uint32_t emu_frequency = PCM_GetOutputFrequency(inst.emu.GetPCM());
+        inst.output_frequency        = params.frequency;
+        if (emu_frequency != params.frequency)
+        {
+            inst.resampler = std::make_unique<AudioResampler>();
+            if (!inst.resampler->Init(emu_frequency, params.frequency))
+            {
+                fprintf(stderr, "Failed to create resampler\n");
+                return false;
+            }
+            inst.resample_in.reserve(FE_RESAMPLE_BLOCK_SIZE);
+            inst.resample_out.reserve(FE_RESAMPLE_BLOCK_SIZE * params.frequency / emu_frequency + 2);
+            fprintf(stderr,
+                    "#%02zu: resampling %u Hz -> %u Hz (%zu taps)\n",
+                    i,
+                    emu_frequency,
+                    params.frequency,
+                    inst.resampler->GetTapCount());
+        }
+
         inst.emu.SetSampleCallback(FE_PickCallback(fe, inst), &inst);
         switch (inst.format)
         {
@@ -577,7 +773,7 @@ bool FE_OpenSDLAudio(FE_Application& fe, const AudioOutputParameters& params, co
             inst.CreateAndPrepareBuffer<float>();
             break;
         }
-        Out_SDL_AddSource(fe.instances[i].view);
+        inst.output_source = Out_SDL_AddSource(fe.instances[i].view);
         fprintf(stderr, "#%02zu: allocated %zu bytes for audio\n", i, inst.sample_buffer.GetByteLength());
     }
 
@@ -603,6 +799,7 @@ bool FE_OpenASIOAudio(FE_Application& fe, const ASIO_OutputParameters& params, c
     {
         FE_Instance& inst = fe.instances[i];
 
+        inst.output_frequency = (uint32_t)Out_ASIO_GetFrequency();
         inst.stream = SDL_NewAudioStream(AudioFormatToSDLAudioFormat(inst.format),
                                          2,
                                          (int)PCM_GetOutputFrequency(inst.emu.GetPCM()),
@@ -666,9 +863,16 @@ bool FE_OpenAudio(FE_Application& fe, const FE_Parameters& params)
     switch (output.kind)
     {
     case AudioOutputKind::SDL:
-        // explicitly do nothing
+        if (params.output_rate.has_value())
+        {
+            out_params.frequency = params.output_rate.value();
+        }
         break;
     case AudioOutputKind::ASIO:
+        if (params.output_rate.has_value())
+        {
+            fprintf(stderr, "WARNING: --rate is ignored with ASIO output; use --asio-sample-rate instead\n");
+        }
         if (params.asio_sample_rate.has_value())
         {
             out_params.frequency = params.asio_sample_rate.value();
@@ -713,11 +917,23 @@ bool FE_OpenAudio(FE_Application& fe, const FE_Parameters& params)
     return false;
 }
 
+void FE_MIDIOutCallback(void* userdata, uint8_t* message, int len)
+{
+    FE_Instance& instance = *(FE_Instance*)userdata;
+    MIDI_QueueOutput(instance.index, instance.emu.GetMCU().cycles, std::span<const uint8_t>(message, (size_t)len));
+}
+
 void FE_SetMIDIOutCallback(FE_Application& fe)
 {
+    if (!MIDI_StartOutput(fe.instances_in_use))
+    {
+        fprintf(stderr, "WARNING: Continuing without MIDI Output...\n");
+        return;
+    }
+
     for (size_t i = 0; i < fe.instances_in_use; i++)
     {
-        fe.instances[i].emu.SetMidiOutCallback(MIDI_MIDIOutCallBack);
+        fe.instances[i].emu.SetMidiOutCallback(FE_MIDIOutCallback, &fe.instances[i]);
     }
 }
 
@@ -729,16 +945,76 @@ void FE_SetSerialCallback(FE_Application& fe)
     }
 }
 
+inline uint64_t FE_ToNanoseconds(std::chrono::steady_clock::duration duration)
+{
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(duration).count();
+}
+
+// Real-time priorities used with --realtime. The audio callback can't wait on anything, so it gets the highest;
+// incoming MIDI is cheap to handle and should never queue up behind emulation.
+constexpr int FE_PRIORITY_AUDIO    = 70;
+constexpr int FE_PRIORITY_MIDI     = 65;
+constexpr int FE_PRIORITY_INSTANCE = 60;
+
+// Moves the instance's large allocations to the NUMA node of the calling thread. The emulator state and sample buffer
+// were allocated and filled by the main thread, so without this they stay on whichever node the main thread ran on.
+void FE_BindInstanceMemory(FE_Instance& instance)
+{
+    bool ok = common::BindMemoryToCurrentNode(instance.sample_buffer.DataFirst(),
+                                              instance.sample_buffer.GetByteLength());
+    for (std::span<uint8_t> block : instance.emu.GetStateMemory())
+    {
+        ok = common::BindMemoryToCurrentNode(block.data(), block.size()) && ok;
+    }
+    if (!ok)
+    {
+        fprintf(stderr, "WARNING: Couldn't move instance memory to the local NUMA node\n");
+    }
+}
+
+// Applies --instance-cpus and --realtime to the calling instance thread.
+void FE_SetupInstanceThread(FE_Instance& instance)
+{
+    common::TraceSetThreadName("instance");
+
+    if (instance.cpu && common::PinCurrentThread(*instance.cpu, "instance"))
+    {
+        FE_BindInstanceMemory(instance);
+    }
+
+    common::SetCurrentThreadPolicy(instance.thread_policy, FE_PRIORITY_INSTANCE, "instance");
+}
+
 template <typename SampleT>
 void FE_RunInstanceSDL(FE_Instance& instance)
 {
-    const size_t max_byte_count = instance.buffer_count * instance.buffer_size * sizeof(AudioFrame<SampleT>);
+    using Clock = std::chrono::steady_clock;
+
+    FE_SetupInstanceThread(instance);
+
+    const size_t buffer_bytes = instance.buffer_size * sizeof(AudioFrame<SampleT>);
+
+    Clock::time_point busy_start = Clock::now();
 
     while (instance.running)
     {
-        while (instance.view.GetReadableBytes() >= max_byte_count)
+        // Adaptive buffering may change the target at any time.
+        const size_t max_byte_count = instance.buffer_target.load(std::memory_order_relaxed) * buffer_bytes;
+
+        if (instance.view.GetReadableBytes() >= max_byte_count)
         {
-            SDL_Delay(1);
+            // Sleeps until the audio callback consumes a buffer. Afterwards go back and check `running`, since we may
+            // have been woken for shutdown.
+            const Clock::time_point wait_start = Clock::now();
+            common::TraceComplete("step batch", busy_start);
+            instance.view.WaitForReadableBelow(max_byte_count);
+            const Clock::time_point wait_end = Clock::now();
+            common::TraceComplete("wait for audio", wait_start);
+
+            instance.busy_ns.fetch_add(FE_ToNanoseconds(wait_start - busy_start), std::memory_order_relaxed);
+            instance.idle_ns.fetch_add(FE_ToNanoseconds(wait_end - wait_start), std::memory_order_relaxed);
+            busy_start = wait_end;
+            continue;
         }
 
         instance.emu.Step();
@@ -748,6 +1024,8 @@ void FE_RunInstanceSDL(FE_Instance& instance)
 #if NUKED_ENABLE_ASIO
 void FE_RunInstanceASIO(FE_Instance& instance)
 {
+    FE_SetupInstanceThread(instance);
+
     while (instance.running)
     {
         // we recalc every time because ASIO reset might change this
@@ -767,6 +1045,113 @@ void FE_RunInstanceASIO(FE_Instance& instance)
 }
 #endif
 
+// How often the adaptive buffering controller looks at each instance.
+constexpr auto FE_ADAPTIVE_CHECK_INTERVAL = std::chrono::seconds(1);
+// How long playback must be free of underruns before the buffer depth is lowered by one.
+constexpr auto FE_ADAPTIVE_SHRINK_INTERVAL = std::chrono::seconds(3);
+// Never lower the buffer depth while the instance thread is busy for more than this fraction of real time.
+constexpr double FE_ADAPTIVE_MAX_LOAD = 0.8;
+// Lowest buffer depth the controller will use.
+constexpr uint32_t FE_ADAPTIVE_MIN_BUFFERS = 2;
+
+void FE_PrintLatency(size_t instance_id, FE_Instance& instance, std::optional<double> load)
+{
+    const uint32_t target    = instance.buffer_target.load(std::memory_order_relaxed);
+    const uint32_t frequency = instance.output_frequency;
+    const uint64_t frames    = (uint64_t)target * instance.buffer_size + Out_SDL_GetDeviceBufferFrames();
+    const double   latency   = 1000.0 * (double)frames / (double)frequency;
+
+    if (load)
+    {
+        fprintf(stderr,
+                "#%02zu: buffering %u x %u frames, latency %.1f ms, emulation load %.0f%%\n",
+                instance_id,
+                target,
+                instance.buffer_size,
+                latency,
+                100.0 * *load);
+    }
+    else
+    {
+        fprintf(stderr,
+                "#%02zu: buffering %u x %u frames, latency %.1f ms\n",
+                instance_id,
+                target,
+                instance.buffer_size,
+                latency);
+    }
+}
+
+void FE_StartAdaptiveBuffering(FE_Application& fe)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < fe.instances_in_use; ++i)
+    {
+        FE_Instance& instance = fe.instances[i];
+
+        instance.adaptive             = {};
+        instance.adaptive.floor       = std::min(FE_ADAPTIVE_MIN_BUFFERS, instance.buffer_count);
+        instance.adaptive.last_check  = now;
+        instance.adaptive.last_change = now;
+
+        FE_PrintLatency(i, instance, std::nullopt);
+    }
+}
+
+// Lowers each instance's buffer depth by one after every clean interval with enough emulation headroom, until it
+// reaches the smallest depth that hasn't underrun. An underrun raises that floor to one above the depth it happened
+// at and immediately grows the buffer back to it.
+void FE_UpdateAdaptiveBuffering(FE_Application& fe)
+{
+    const auto now = std::chrono::steady_clock::now();
+
+    for (size_t i = 0; i < fe.instances_in_use; ++i)
+    {
+        FE_Instance&          instance = fe.instances[i];
+        FE_AdaptiveBuffering& state    = instance.adaptive;
+
+        if (now - state.last_check < FE_ADAPTIVE_CHECK_INTERVAL)
+        {
+            continue;
+        }
+        state.last_check = now;
+
+        const uint64_t underruns  = Out_SDL_GetUnderrunCount(instance.output_source);
+        const uint64_t busy_ns    = instance.busy_ns.load(std::memory_order_relaxed);
+        const uint64_t idle_ns    = instance.idle_ns.load(std::memory_order_relaxed);
+        const uint64_t busy_delta = busy_ns - state.busy_ns;
+        const uint64_t idle_delta = idle_ns - state.idle_ns;
+        state.busy_ns             = busy_ns;
+        state.idle_ns             = idle_ns;
+
+        const double load =
+            busy_delta + idle_delta == 0 ? 1.0 : (double)busy_delta / (double)(busy_delta + idle_delta);
+
+        const uint32_t target     = instance.buffer_target.load(std::memory_order_relaxed);
+        uint32_t       new_target = target;
+
+        if (underruns != state.underruns)
+        {
+            state.underruns = underruns;
+            state.floor     = std::min(target + 1, instance.buffer_count);
+            new_target      = std::max(target, state.floor);
+        }
+        else if (now - state.last_change >= FE_ADAPTIVE_SHRINK_INTERVAL && target > state.floor &&
+                 load < FE_ADAPTIVE_MAX_LOAD)
+        {
+            new_target = target - 1;
+        }
+
+        if (new_target != target)
+        {
+            instance.buffer_target.store(new_target, std::memory_order_relaxed);
+            state.last_change = now;
+            FE_PrintLatency(i, instance, load);
+        }
+    }
+}
+
 bool FE_HandleGlobalEvent(FE_Application& fe, const SDL_Event& ev)
 {
     switch (ev.type)
@@ -779,7 +1164,7 @@ bool FE_HandleGlobalEvent(FE_Application& fe, const SDL_Event& ev)
     }
 }
 
-void FE_EventLoop(FE_Application& fe, bool Is_Serial = false)
+void FE_EventLoop(FE_Application& fe, [[maybe_unused]] bool Is_Serial = false)
 {
     while (fe.running)
     {
@@ -802,6 +1187,11 @@ void FE_EventLoop(FE_Application& fe, bool Is_Serial = false)
             LCD_Render(fe.instances[i].emu.GetLCD());
         }
 
+        if (fe.adaptive_buffering)
+        {
+            FE_UpdateAdaptiveBuffering(fe);
+        }
+
         SDL_Event ev;
         while (SDL_PollEvent(&ev))
         {
@@ -821,10 +1211,12 @@ void FE_EventLoop(FE_Application& fe, bool Is_Serial = false)
             }
         }
 
+#ifdef _WIN32
         if (Is_Serial)
         {
             SERIAL_Update();
         }
+#endif
 
         SDL_Delay(15);
     }
@@ -862,13 +1254,23 @@ void FE_Run(FE_Application& fe, bool Is_Serial = false)
         }
     }
 
+    if (fe.adaptive_buffering)
+    {
+        FE_StartAdaptiveBuffering(fe);
+    }
+
     FE_EventLoop(fe, Is_Serial);
 
     for (size_t i = 0; i < fe.instances_in_use; ++i)
     {
         fe.instances[i].running = false;
+        // The instance thread may be waiting for the audio callback to drain its buffer.
+        fe.instances[i].view.NotifyRead();
         // Quick fix on preventing the LCD_SDL_Backend::Stop() from segfaulting (FIXME)
-        fe.instances[i].sdl_lcd->Stop();
+        if (fe.instances[i].sdl_lcd)
+        {
+            fe.instances[i].sdl_lcd->Stop();
+        }
         fe.instances[i].thread.join();
     }
 }
@@ -921,16 +1323,39 @@ bool FE_CreateInstance(FE_Application& container, const std::filesystem::path& b
         return false;
     }
 
+    fe->index        = instance_id;
     fe->format       = params.output_format;
-    fe->buffer_size  = params.buffer_size;
-    fe->buffer_count = params.buffer_count;
+    fe->buffer_size   = params.buffer_size;
+    fe->buffer_count  = params.buffer_count;
+    fe->buffer_target = params.buffer_count;
     fe->gain         = params.gain;
 
-    if (!params.no_lcd)
+    fe->thread_policy = params.thread_policy;
+    if (!params.instance_cpus.empty())
+    {
+        // Wraps around, so e.g. a single CPU is shared by every instance.
+        fe->cpu = params.instance_cpus[instance_id % params.instance_cpus.size()];
+    }
+
+    if (!params.lcd_text_path.empty())
+    {
+        FILE* output = container.lcd_text_output;
+        fe->text_lcd = std::make_unique<LCD_Text_Backend>([output, instance_id](const LCD_TextState& state) {
+            fprintf(output, "instance=%zu %s\n", instance_id, LCD_FormatText(state).c_str());
+            fflush(output);
+        });
+    }
+    else if (!params.no_lcd)
     {
         fe->sdl_lcd = std::make_unique<LCD_SDL_Backend>();
     }
 
+    LCD_Backend* lcd_backend = fe->sdl_lcd.get();
+    if (fe->text_lcd)
+    {
+        lcd_backend = fe->text_lcd.get();
+    }
+
     std::filesystem::path this_nvram = params.nvram_filename;
     if (!this_nvram.empty())
     {
@@ -940,9 +1365,10 @@ bool FE_CreateInstance(FE_Application& container, const std::filesystem::path& b
 
     if (!fe->emu.Init({.instance_id        = instance_number,
                        .rom_directory      = *params.rom_directory, 
-                       .lcd_backend        = fe->sdl_lcd.get(), 
+                       .lcd_backend        = lcd_backend, 
                        .serial_type        = params.serial_type, 
-                       .nvram_filename     = this_nvram}))
+                       .nvram_filename     = this_nvram,
+                       .memory_mode        = params.instance_memory}))
     {
         fprintf(stderr, "ERROR: Failed to init emulator.\n");
         return false;
@@ -957,6 +1383,11 @@ bool FE_CreateInstance(FE_Application& container, const std::filesystem::path& b
     fe->emu.Reset();
     fe->emu.GetPCM().disable_oversampling = params.disable_oversampling;
 
+    if (params.stats)
+    {
+        fe->emu.EnableStats();
+    }
+
     if (!fe->emu.StartLCD())
     {
         fprintf(stderr, "ERROR: Failed to start LCD.\n");
@@ -997,12 +1428,35 @@ void FE_Quit(FE_Application& container)
         break;
     }
 
+    if (container.print_stats)
+    {
+        for (size_t i = 0; i < container.instances_in_use; ++i)
+        {
+            FE_Instance& instance = container.instances[i];
+            // Only SDL output tracks busy time; otherwise this is zero and the report falls back to wall time.
+            const double busy_sec = (double)instance.busy_ns.load(std::memory_order_relaxed) / 1e9;
+            common::PrintEmulatorStats(stderr, i, instance.emu.GetStats(), busy_sec);
+        }
+    }
+
     for (size_t i = 0; i < container.instances_in_use; ++i)
     {
         FE_DestroyInstance(container.instances[i]);
     }
 
+    if (container.lcd_text_output && container.lcd_text_output != stdout)
+    {
+        fclose(container.lcd_text_output);
+        container.lcd_text_output = nullptr;
+    }
+
+    if (!container.trace_filename.empty())
+    {
+        common::TraceWrite(container.trace_filename);
+    }
+
     SERIAL_Quit();
+    MIDI_StopOutput();
     MIDI_Quit();
     REMOTE_Quit();
     SDL_Quit();
@@ -1024,6 +1478,11 @@ enum class FE_ParseError
     SerialTypeInvalid,
     ResetInvalid,
     GainInvalid,
+    RateInvalid,
+    ThreadPolicyInvalid,
+    CpuListInvalid,
+    CpuInvalid,
+    MemoryModeInvalid,
 };
 
 const char* FE_ParseErrorStr(FE_ParseError err)
@@ -1058,6 +1517,16 @@ const char* FE_ParseErrorStr(FE_ParseError err)
             return "Reset invalid (should be none, gs, or gm)";
         case FE_ParseError::GainInvalid:
             return "Gain invalid (should be a number optionally ending in 'db')";
+        case FE_ParseError::RateInvalid:
+            return "Sample rate invalid (should be 8000-192000)";
+        case FE_ParseError::ThreadPolicyInvalid:
+            return "Scheduling policy invalid (should be default, fifo, or rr)";
+        case FE_ParseError::CpuListInvalid:
+            return "CPU list invalid (should be numbers or ranges separated by commas, e.g. 0,2,4-7)";
+        case FE_ParseError::CpuInvalid:
+            return "CPU number invalid";
+        case FE_ParseError::MemoryModeInvalid:
+            return "Instance memory mode invalid (should be heap, arena, or hugepages)";
         }
     return "Unknown error";
 }
@@ -1202,6 +1671,91 @@ FE_ParseError FE_ParseCommandLine(int argc, char* argv[], FE_Parameters& result)
                 return FE_ParseError::BufferSizeInvalid;
             }
         }
+        else if (reader.Any("--low-latency"))
+        {
+            result.low_latency = true;
+        }
+        else if (reader.Any("--rate"))
+        {
+            if (!reader.Next())
+            {
+                return FE_ParseError::UnexpectedEnd;
+            }
+
+            uint32_t rate = 0;
+            if (!reader.TryParse(rate) || rate < 8000 || rate > 192000)
+            {
+                return FE_ParseError::RateInvalid;
+            }
+
+            result.output_rate = rate;
+        }
+        else if (reader.Any("--realtime"))
+        {
+            if (!reader.Next())
+            {
+                return FE_ParseError::UnexpectedEnd;
+            }
+
+            if (!common::ParseThreadPolicy(reader.Arg(), result.thread_policy))
+            {
+                return FE_ParseError::ThreadPolicyInvalid;
+            }
+        }
+        else if (reader.Any("--instance-cpus"))
+        {
+            if (!reader.Next())
+            {
+                return FE_ParseError::UnexpectedEnd;
+            }
+
+            if (!common::ParseCpuList(reader.Arg(), result.instance_cpus))
+            {
+                return FE_ParseError::CpuListInvalid;
+            }
+        }
+        else if (reader.Any("--instance-memory"))
+        {
+            if (!reader.Next())
+            {
+                return FE_ParseError::UnexpectedEnd;
+            }
+
+            if (!ParseMemoryMode(reader.Arg(), result.instance_memory))
+            {
+                return FE_ParseError::MemoryModeInvalid;
+            }
+        }
+        else if (reader.Any("--audio-cpu"))
+        {
+            if (!reader.Next())
+            {
+                return FE_ParseError::UnexpectedEnd;
+            }
+
+            uint32_t cpu = 0;
+            if (!reader.TryParse(cpu))
+            {
+                return FE_ParseError::CpuInvalid;
+            }
+
+            result.audio_cpu = cpu;
+        }
+        else if (reader.Any("--midi-cpu"))
+        {
+            if (!reader.Next())
+            {
+                return FE_ParseError::UnexpectedEnd;
+            }
+
+            uint32_t cpu = 0;
+            if (!reader.TryParse(cpu))
+            {
+                return FE_ParseError::CpuInvalid;
+            }
+
+            result.midi_cpu = cpu;
+        }
         else if (reader.Any("-r", "--reset"))
         {
             if (!reader.Next())
@@ -1247,6 +1801,28 @@ FE_ParseError FE_ParseCommandLine(int argc, char* argv[], FE_Parameters& result)
         {
             result.no_lcd = true;
         }
+        else if (reader.Any("--stats"))
+        {
+            result.stats = true;
+        }
+        else if (reader.Any("--trace"))
+        {
+            if (!reader.Next())
+            {
+                return FE_ParseError::UnexpectedEnd;
+            }
+
+            result.trace_filename = reader.Arg();
+        }
+        else if (reader.Any("--lcd-text"))
+        {
+            if (!reader.Next())
+            {
+                return FE_ParseError::UnexpectedEnd;
+            }
+
+            result.lcd_text_path = reader.Arg();
+        }
         else if (reader.Any("--disable-oversampling"))
         {
             result.disable_oversampling = true;
@@ -1426,8 +2002,11 @@ General options:
 Audio options:
   -a, --audio-device <device_name_or_number>    Set output audio device.
   -b, --buffer-size  <size>[:count]             Set buffer size, number of buffers.
+  --low-latency                                 Adapt the number of queued buffers (at most count) to the
+                                                smallest that plays without underruns.
   -f, --format       s16|s32|f32                Set output format.
   --gain <amount>                               Apply gain to the output.
+  --rate <freq>                                 Resample the output to freq (e.g. 44100, 48000, 96000).
   --disable-oversampling                        Halves output frequency.
 
 MIDI port options (default, unless set to serial):
@@ -1445,7 +2024,25 @@ Emulator options:
   -r, --reset     none|gs|gm                    Reset system in GS or GM mode. (No GM in MK1 1.00 & 1.10)
   -n, --instances <count>                       Set number of emulator instances.
   --no-lcd                                      Run without LCDs.
+  --lcd-text <filename>                         Run without LCD windows; write display contents as text to
+                                                filename (- for stdout) whenever they change.
   --nvram <filename>                            Saves and loads NVRAM to/from disk. JV-880 only.
+  --stats                                       Print emulator performance counters for each instance on exit.
+  --trace <filename>                            Record a timeline of the audio, MIDI and instance threads and write
+                                                it to filename as Chrome trace JSON on exit.
+
+Threading options:
+  --realtime default|fifo|rr                    Request real-time scheduling for the audio, MIDI and instance
+                                                threads. Falls back to default scheduling without privileges.
+  --instance-cpus <list>                        Pin instance threads to CPUs from list (e.g. 0,2,4-7), one per
+                                                instance in order, wrapping around if the list is shorter than the
+                                                instance count. Instance memory moves to the local NUMA node.
+  --instance-memory heap|arena|hugepages        Choose how each instance's state is allocated:
+        heap (default)                              Separate allocations
+        arena                                       One block, with transparent huge pages where supported
+        hugepages                                   One block of explicit huge pages, falling back to arena
+  --audio-cpu <cpu>                             Pin the audio output thread to cpu. SDL output only.
+  --midi-cpu <cpu>                              Pin the MIDI input thread to cpu.
 
 ROM management options:
   -d, --rom-directory <dir>                     Sets the directory to load roms from.
@@ -1575,6 +2172,13 @@ int main(int argc, char *argv[])
 
     FE_Application frontend;
 
+    if (!params.trace_filename.empty())
+    {
+        common::TraceStart();
+        common::TraceSetThreadName("main");
+        frontend.trace_filename = params.trace_filename;
+    }
+
     std::filesystem::path base_path = common::GetProcessPath().parent_path();
 
     if (std::filesystem::exists(base_path / "../share/nuked-sc55"))
@@ -1627,6 +2231,20 @@ int main(int argc, char *argv[])
 
     fprintf(stderr, "Gain set to %.2fdb\n", common::ScalarToDb(params.gain));
 
+    if (params.lcd_text_path == "-")
+    {
+        frontend.lcd_text_output = stdout;
+    }
+    else if (!params.lcd_text_path.empty())
+    {
+        frontend.lcd_text_output = fopen(params.lcd_text_path.c_str(), "w");
+        if (!frontend.lcd_text_output)
+        {
+            fprintf(stderr, "FATAL ERROR: Failed to open LCD text output `%s`.\n", params.lcd_text_path.c_str());
+            return 1;
+        }
+    }
+
     for (size_t i = 0; i < params.instances; ++i)
     {
         if (!FE_CreateInstance(frontend, base_path, params, i))
@@ -1638,6 +2256,15 @@ int main(int argc, char *argv[])
 
     frontend.romset_info.PurgeRomData();
 
+    Out_SDL_SetThreadInit([audio_cpu = params.audio_cpu, policy = params.thread_policy] {
+        common::TraceSetThreadName("audio");
+        if (audio_cpu)
+        {
+            common::PinCurrentThread(*audio_cpu, "audio");
+        }
+        common::SetCurrentThreadPolicy(policy, FE_PRIORITY_AUDIO, "audio");
+    });
+
     if (!FE_OpenAudio(frontend, params))
     {
         fprintf(stderr, "FATAL ERROR: Failed to open the audio stream.\n");
@@ -1645,6 +2272,25 @@ int main(int argc, char *argv[])
         return 1;
     }
 
+    frontend.print_stats = params.stats;
+
+    if (params.low_latency)
+    {
+        if (frontend.audio_output.kind == AudioOutputKind::SDL)
+        {
+            frontend.adaptive_buffering = true;
+        }
+        else
+        {
+            fprintf(stderr, "WARNING: --low-latency is only supported with SDL audio output; ignoring\n");
+        }
+    }
+
+    if (params.audio_cpu && frontend.audio_output.kind != AudioOutputKind::SDL)
+    {
+        fprintf(stderr, "WARNING: --audio-cpu is only supported with SDL audio output; ignoring\n");
+    }
+
     if ((params.serial_type != Computerswitch::MIDI && !params.serial_port.empty()) && (frontend.romset==Romset::MK2 || frontend.romset==Romset::ST))
     {
         if (!SERIAL_Init(frontend, params.serial_port))
@@ -1670,6 +2316,15 @@ int main(int argc, char *argv[])
             params.midiout_device = "";
         }
 
+        MIDI_SetThreadInit([midi_cpu = params.midi_cpu, policy = params.thread_policy] {
+            common::TraceSetThreadName("midi");
+            if (midi_cpu)
+            {
+                common::PinCurrentThread(*midi_cpu, "MIDI");
+            }
+            common::SetCurrentThreadPolicy(policy, FE_PRIORITY_MIDI, "MIDI");
+        });
+
         if (!MIDI_Init(frontend, params.midiin_device, params.midiout_device))
         {
             fprintf(stderr, "ERROR: Failed to initialize the MIDI Input.\nWARNING: Continuing without MIDI Input...\n");
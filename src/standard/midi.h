@@ -34,6 +34,7 @@
 #pragma once
 
 #include <cstdint>
+#include <functional>
 #include <string_view>
 
 struct FE_Application;
@@ -43,4 +44,7 @@ void MIDI_Quit(void);
 void MIDI_PrintDevices();
 void MIDI_PostShortMessage(uint8_t *message, int len);
 void MIDI_PostSysExMessage(uint8_t *message, int len);
-void MIDI_MIDIOutCallBack(void* userdata, uint8_t* message, int len);
+
+// `init` runs once on the thread that delivers incoming MIDI, before the first message is routed. Must be called before
+// MIDI_Init.
+void MIDI_SetThreadInit(std::function<void()> init);
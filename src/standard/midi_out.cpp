@@ -0,0 +1,280 @@
+#include "midi_out.h"
+
+#include "mcu.h"
+#include "midi.h"
+#include "ringbuffer.h"
+#include "common/trace.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using MIDI_Clock = std::chrono::steady_clock;
+
+// Messages are split into fixed-size records so that each one is published to the output thread by a single write
+// head update. Most messages fit in one record; SysEx messages span several.
+struct MIDI_OutRecord
+{
+    // mcu_t::cycles when the message was sent.
+    uint64_t cycles;
+    uint8_t  len;
+    // Nonzero in the final record of a message.
+    uint8_t  last;
+    uint8_t  data[22];
+};
+static_assert(sizeof(MIDI_OutRecord) == 32);
+
+// Must be a power of two. Holds a little over 2000 records per instance.
+constexpr size_t MIDI_OUT_QUEUE_SIZE = 1 << 16;
+
+// If a message is due further ahead than this, emulation and real time have drifted apart (or emulation was paused)
+// and the message is sent immediately instead.
+constexpr MIDI_Clock::duration MIDI_OUT_MAX_LEAD = std::chrono::milliseconds(100);
+
+// While waiting for a message to become due, the output thread wakes at least this often to pick up messages queued in
+// the meantime, which may be due sooner. Also bounds how long MIDI_StopOutput waits for a sleeping thread.
+constexpr MIDI_Clock::duration MIDI_OUT_POLL_INTERVAL = std::chrono::milliseconds(1);
+
+// If a message is due further in the past than this, the output thread has fallen behind; it is sent immediately and
+// the following messages are timed relative to it.
+constexpr MIDI_Clock::duration MIDI_OUT_MAX_LAG = std::chrono::milliseconds(20);
+
+// Written by one instance thread, read by the output thread.
+struct MIDI_OutQueue
+{
+    GenericBuffer  storage;
+    RingbufferView view;
+
+    std::atomic<uint64_t> dropped = 0;
+
+    // Only used by the output thread. The bytes of the oldest message read from the queue. Complete once `ready` is
+    // set; until then, the records of a SysEx message whose final record hasn't been written yet.
+    std::vector<uint8_t>   message;
+    bool                   ready = false;
+    uint64_t               message_cycles = 0;
+    MIDI_Clock::time_point due;
+
+    // Only used by the output thread. Maps the emulated time of this instance onto real time.
+    bool                   anchored      = false;
+    uint64_t               anchor_cycles = 0;
+    MIDI_Clock::time_point anchor_time;
+};
+
+static std::unique_ptr<MIDI_OutQueue[]> s_out_queues;
+static size_t                           s_out_queue_count = 0;
+
+static std::thread           s_out_thread;
+static std::atomic<bool>     s_out_running = false;
+// Incremented after every write to a queue and on shutdown; the output thread waits on it while the queues are empty.
+static std::atomic<uint32_t> s_out_signal  = 0;
+
+// Returns when `cycles` should be sent, given the previous messages from the same instance.
+static MIDI_Clock::time_point MIDI_ScheduleOutput(MIDI_OutQueue& queue, uint64_t cycles, MIDI_Clock::time_point now)
+{
+    // Messages more than a second apart are timed independently; this also keeps the conversion from overflowing.
+    if (queue.anchored && cycles >= queue.anchor_cycles && cycles - queue.anchor_cycles <= MCU_CYCLES_PER_SECOND)
+    {
+        const auto offset = std::chrono::nanoseconds(
+            (int64_t)((cycles - queue.anchor_cycles) * 1'000'000'000 / MCU_CYCLES_PER_SECOND));
+        const MIDI_Clock::time_point due = queue.anchor_time + offset;
+        if (due + MIDI_OUT_MAX_LAG >= now && due <= now + MIDI_OUT_MAX_LEAD)
+        {
+            return due;
+        }
+    }
+
+    queue.anchored      = true;
+    queue.anchor_cycles = cycles;
+    queue.anchor_time   = now;
+    return now;
+}
+
+static void MIDI_SendOutput(std::span<uint8_t> message)
+{
+    if (message.empty())
+    {
+        return;
+    }
+
+    common::TraceInstant("midi out", (int64_t)message.size());
+
+    if (message[0] == 0xF0)
+    {
+        MIDI_PostSysExMessage(message.data(), (int)message.size());
+    }
+    else
+    {
+        MIDI_PostShortMessage(message.data(), (int)message.size());
+    }
+}
+
+// Reads records from `queue` until `queue.message` holds a complete message. Returns false if the queue runs out
+// first; the records read so far are kept for the next call.
+static bool MIDI_FetchOutput(MIDI_OutQueue& queue)
+{
+    while (queue.view.GetReadableElements<MIDI_OutRecord>() != 0)
+    {
+        MIDI_OutRecord record;
+        queue.view.UncheckedReadOne(record);
+
+        queue.message.insert(queue.message.end(), record.data, record.data + record.len);
+        if (record.last)
+        {
+            queue.message_cycles = record.cycles;
+            return true;
+        }
+    }
+    return false;
+}
+
+static void MIDI_OutputThread()
+{
+    common::TraceSetThreadName("midi out");
+
+    while (s_out_running.load(std::memory_order_acquire))
+    {
+        // Load the signal before reading the queues so that a message queued in between is never missed.
+        const uint32_t               signal = s_out_signal.load(std::memory_order_acquire);
+        const MIDI_Clock::time_point now    = MIDI_Clock::now();
+
+        // Each queue offers its oldest message; the one due first across all instances goes next. Sending one message
+        // at a time keeps a busy instance from holding back the others.
+        MIDI_OutQueue* next = nullptr;
+        for (size_t i = 0; i < s_out_queue_count; ++i)
+        {
+            MIDI_OutQueue& queue = s_out_queues[i];
+            if (!queue.ready && MIDI_FetchOutput(queue))
+            {
+                queue.ready = true;
+                queue.due   = MIDI_ScheduleOutput(queue, queue.message_cycles, now);
+            }
+            if (queue.ready && (!next || queue.due < next->due))
+            {
+                next = &queue;
+            }
+        }
+
+        if (!next)
+        {
+            s_out_signal.wait(signal, std::memory_order_acquire);
+            continue;
+        }
+
+        if (next->due > now)
+        {
+            std::this_thread::sleep_until(std::min(next->due, now + MIDI_OUT_POLL_INTERVAL));
+            continue;
+        }
+
+        MIDI_SendOutput(next->message);
+        next->message.clear();
+        next->ready = false;
+    }
+
+    // Send whatever is left without pacing.
+    for (size_t i = 0; i < s_out_queue_count; ++i)
+    {
+        MIDI_OutQueue& queue = s_out_queues[i];
+        while (queue.ready || MIDI_FetchOutput(queue))
+        {
+            MIDI_SendOutput(queue.message);
+            queue.message.clear();
+            queue.ready = false;
+        }
+    }
+}
+
+bool MIDI_StartOutput(size_t instance_count)
+{
+    if (s_out_running)
+    {
+        fprintf(stderr, "MIDI output thread already running\n");
+        return false;
+    }
+
+    s_out_queues      = std::make_unique<MIDI_OutQueue[]>(instance_count);
+    s_out_queue_count = instance_count;
+
+    for (size_t i = 0; i < instance_count; ++i)
+    {
+        if (!s_out_queues[i].storage.Init(MIDI_OUT_QUEUE_SIZE))
+        {
+            fprintf(stderr, "Failed to allocate MIDI output queue\n");
+            s_out_queues.reset();
+            s_out_queue_count = 0;
+            return false;
+        }
+        s_out_queues[i].view = RingbufferView(s_out_queues[i].storage);
+    }
+
+    s_out_running = true;
+    s_out_thread  = std::thread(MIDI_OutputThread);
+
+    return true;
+}
+
+void MIDI_StopOutput()
+{
+    if (!s_out_thread.joinable())
+    {
+        return;
+    }
+
+    s_out_running.store(false, std::memory_order_release);
+    s_out_signal.fetch_add(1, std::memory_order_release);
+    s_out_signal.notify_one();
+    s_out_thread.join();
+
+    uint64_t dropped = 0;
+    for (size_t i = 0; i < s_out_queue_count; ++i)
+    {
+        dropped += s_out_queues[i].dropped.load(std::memory_order_relaxed);
+    }
+    if (dropped)
+    {
+        fprintf(stderr, "WARNING: MIDI output overflowed; dropped %llu messages\n", (unsigned long long)dropped);
+    }
+
+    s_out_queues.reset();
+    s_out_queue_count = 0;
+}
+
+void MIDI_QueueOutput(size_t instance, uint64_t cycles, std::span<const uint8_t> message)
+{
+    if (instance >= s_out_queue_count)
+    {
+        return;
+    }
+
+    MIDI_OutQueue& queue = s_out_queues[instance];
+
+    constexpr size_t record_data_size = sizeof(MIDI_OutRecord::data);
+    const size_t     record_count     = (message.size() + record_data_size - 1) / record_data_size;
+
+    // All records of a message are queued or none are, so the output thread never sees a truncated SysEx.
+    if (queue.view.GetWritableElements<MIDI_OutRecord>() < record_count)
+    {
+        queue.dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    for (size_t i = 0; i < record_count; ++i)
+    {
+        const std::span<const uint8_t> chunk = message.subspan(i * record_data_size).first(
+            std::min(record_data_size, message.size() - i * record_data_size));
+
+        MIDI_OutRecord record;
+        record.cycles = cycles;
+        record.len    = (uint8_t)chunk.size();
+        record.last   = i + 1 == record_count;
+        std::copy(chunk.begin(), chunk.end(), record.data);
+
+        queue.view.UncheckedWriteOne(record);
+    }
+
+    s_out_signal.fetch_add(1, std::memory_order_release);
+    s_out_signal.notify_one();
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+// Delivers the MIDI messages sent by the emulated firmware to the MIDI output device. Instance threads only copy each
+// message into a lock-free queue along with the emulated time it was sent at; a dedicated thread drains the queues and
+// passes the messages on to MIDI_PostShortMessage/MIDI_PostSysExMessage. A slow MIDI driver therefore holds up the
+// output thread instead of emulation.
+//
+// Emulation runs ahead of real time by up to the audio buffer length and produces messages in bursts, so the output
+// thread reproduces the spacing the messages had in emulated time rather than sending each burst at once.
+
+// Starts the output thread with a queue for each of `instance_count` instances. Call after MIDI_Init.
+bool MIDI_StartOutput(size_t instance_count);
+
+// Sends any messages still queued, without pacing, and stops the output thread. Call after the instance threads have
+// stopped and before MIDI_Quit.
+void MIDI_StopOutput();
+
+// Called from the thread of instance `instance`. `cycles` is the instance's mcu_t::cycles at the time the message was
+// sent. If the instance's queue is full the message is dropped.
+void MIDI_QueueOutput(size_t instance, uint64_t cycles, std::span<const uint8_t> message);
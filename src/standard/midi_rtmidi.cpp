@@ -6,6 +6,7 @@
 #include <memory>
 #include <span>
 #include <string>
+#include <utility>
 #include <vector>
 
 static RtMidiIn *s_midi_in   = nullptr;
@@ -13,10 +14,22 @@ static RtMidiOut *s_midi_out = nullptr;
 
 static FE_Application* midi_frontend = nullptr;
 
+static std::function<void()> midi_thread_init;
+static bool                  midi_thread_initialized = false;
+
 void FE_RouteMIDI(FE_Application& fe, std::span<const uint8_t> bytes);
 
 static void MidiOnReceive(double, std::vector<uint8_t> *message, void *)
 {
+    if (!midi_thread_initialized)
+    {
+        midi_thread_initialized = true;
+        if (midi_thread_init)
+        {
+            midi_thread_init();
+        }
+    }
+
     FE_RouteMIDI(*midi_frontend, *message);
 }
 
@@ -282,9 +295,8 @@ void MIDI_PostSysExMessage(uint8_t *message, int len) {
     }
 }
 
-void MIDI_MIDIOutCallBack(void* userdata, uint8_t* message, int len)
+void MIDI_SetThreadInit(std::function<void()> init)
 {
-    (void)userdata;
-    MIDI_PostSysExMessage(message, len);
-
+    midi_thread_init        = std::move(init);
+    midi_thread_initialized = false;
 }
@@ -43,6 +43,7 @@
 #include <mmsystem.h>
 #include <span>
 #include <string>
+#include <utility>
 
 static HMIDIIN  midi_in_handle;
 static HMIDIOUT midi_out_handle;
@@ -52,6 +53,9 @@ static uint8_t midi_in_buffer[1024];
 
 static FE_Application* midi_frontend = nullptr;
 
+static std::function<void()> midi_thread_init;
+static bool                  midi_thread_initialized = false;
+
 void FE_RouteMIDI(FE_Application& fe, std::span<const uint8_t> bytes);
 
 void CALLBACK MIDIIN_Callback(
@@ -66,6 +70,15 @@ void CALLBACK MIDIIN_Callback(
     (void)dwInstance;
     (void)dwParam2;
 
+    if (!midi_thread_initialized && (wMsg == MIM_DATA || wMsg == MIM_LONGDATA))
+    {
+        midi_thread_initialized = true;
+        if (midi_thread_init)
+        {
+            midi_thread_init();
+        }
+    }
+
     switch (wMsg)
     {
         case MIM_OPEN:
@@ -390,9 +403,8 @@ void MIDI_PostSysExMessage(uint8_t *message, int len) {
     }
 }
 
-void MIDI_MIDIOutCallBack(void* userdata, uint8_t* message, int len)
+void MIDI_SetThreadInit(std::function<void()> init)
 {
-    (void)userdata;
-    MIDI_PostSysExMessage(message, len);
-
+    midi_thread_init        = std::move(init);
+    midi_thread_initialized = false;
 }
@@ -625,10 +625,7 @@ inline void MixBuffer(GenericBuffer& dst, const GenericBuffer& src)
     auto dst_span = std::span<FrameT>((FrameT*)dst.DataFirst(), dst.GetByteLength() / sizeof(FrameT));
     auto src_span = std::span<FrameT>((FrameT*)src.DataFirst(), src.GetByteLength() / sizeof(FrameT));
     assert(src_span.size() == dst_span.size());
-    for (size_t samp = 0; samp < dst_span.size(); ++samp)
-    {
-        MixFrame(dst_span[samp], src_span[samp]);
-    }
+    MixFrames(dst_span.data(), src_span.data(), dst_span.size());
 }
 
 inline void MixBuffer(GenericBuffer& dst, const GenericBuffer& src, SDL_AudioFormat format)
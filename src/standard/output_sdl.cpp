@@ -2,7 +2,12 @@
 
 #include "audio_sdl.h"
 #include "cast.h"
+#include "common/trace.h"
 #include <SDL.h>
+#include <atomic>
+#include <cstring>
+#include <span>
+#include <utility>
 
 // one per instance
 const size_t MAX_STREAMS = 16;
@@ -18,8 +23,17 @@ struct SDLOutput
     RingbufferView* views[MAX_STREAMS]{};
     size_t          stream_count = 0;
 
+    // Number of callbacks where a stream that had already started producing audio didn't have a full buffer ready.
+    std::atomic<uint64_t> underruns[MAX_STREAMS]{};
+    // Only accessed by the audio callback.
+    bool started[MAX_STREAMS]{};
+
     // Parameters requested by the user
     AudioOutputParameters create_params;
+
+    std::function<void()> thread_init;
+    // Only accessed by the audio callback.
+    bool thread_initialized = false;
 };
 
 static SDLOutput g_output;
@@ -29,22 +43,59 @@ void AudioCallback(void* userdata, Uint8* stream, int len)
 {
     (void)userdata;
 
+    if (!g_output.thread_initialized)
+    {
+        g_output.thread_initialized = true;
+        if (g_output.thread_init)
+        {
+            g_output.thread_init();
+        }
+    }
+
+    common::TraceScope trace("audio callback");
+
     using Frame = AudioFrame<SampleT>;
 
-    memset(stream, 0, (size_t)len);
+    Frame*       out         = (Frame*)stream;
+    const size_t frame_count = (size_t)len / sizeof(Frame);
+    bool         out_written = false;
 
     for (size_t i = 0; i < g_output.stream_count; ++i)
     {
-        if (g_output.views[i]->GetReadableElements<Frame>() >= g_output.create_params.buffer_size)
+        if (g_output.views[i]->GetReadableElements<Frame>() >= frame_count)
         {
-            auto span = g_output.views[i]->UncheckedPrepareRead<Frame>(g_output.create_params.buffer_size);
-            for (size_t samp = 0; samp < span.size(); ++samp)
+            std::span<Frame> first, second;
+            g_output.views[i]->UncheckedPrepareReadAny<Frame>(frame_count, first, second);
+            if (!out_written)
+            {
+                // The first stream with data initializes the output instead of being mixed into silence.
+                memcpy(out, first.data(), first.size_bytes());
+                if (!second.empty())
+                {
+                    memcpy(out + first.size(), second.data(), second.size_bytes());
+                }
+                out_written = true;
+            }
+            else
             {
-                MixFrame(*((Frame*)stream + samp), span[samp]);
+                MixFrames(out, first.data(), first.size());
+                MixFrames(out + first.size(), second.data(), second.size());
             }
-            g_output.views[i]->UncheckedFinishRead<Frame>(g_output.create_params.buffer_size);
+            g_output.views[i]->UncheckedFinishReadAny<Frame>(frame_count);
+            g_output.views[i]->NotifyRead();
+            g_output.started[i] = true;
+        }
+        else if (g_output.started[i])
+        {
+            g_output.underruns[i].fetch_add(1, std::memory_order_relaxed);
+            common::TraceInstant("underrun", (int64_t)i);
         }
     }
+
+    if (!out_written)
+    {
+        memset(stream, 0, (size_t)len);
+    }
 }
 
 bool Out_SDL_QueryOutputs(AudioOutputList& list)
@@ -148,7 +199,7 @@ void Out_SDL_Stop()
     SDL_PauseAudioDevice(g_output.device, 1);
 }
 
-void Out_SDL_AddSource(RingbufferView& view)
+size_t Out_SDL_AddSource(RingbufferView& view)
 {
     if (g_output.stream_count == MAX_STREAMS)
     {
@@ -158,7 +209,17 @@ void Out_SDL_AddSource(RingbufferView& view)
 
     g_output.views[g_output.stream_count] = &view;
 
-    ++g_output.stream_count;
+    return g_output.stream_count++;
+}
+
+uint64_t Out_SDL_GetUnderrunCount(size_t source)
+{
+    return g_output.underruns[source].load(std::memory_order_relaxed);
+}
+
+uint32_t Out_SDL_GetDeviceBufferFrames()
+{
+    return g_output.actual_spec.samples;
 }
 
 void Out_SDL_SetVolume(float vol, AudioVolume &volume_control)
@@ -172,3 +233,9 @@ void Out_SDL_SetVolume(float vol, AudioVolume &volume_control)
     volume_control.volume = vol;
     volume_control.volume_fp = (uint32_t)(vol * UINT16_MAX);
 }
+
+void Out_SDL_SetThreadInit(std::function<void()> init)
+{
+    g_output.thread_init        = std::move(init);
+    g_output.thread_initialized = false;
+}
@@ -3,6 +3,7 @@
 #include "output_common.h"
 
 #include "ringbuffer.h"
+#include <functional>
 
 bool Out_SDL_QueryOutputs(AudioOutputList& list);
 
@@ -13,6 +14,17 @@ void Out_SDL_Destroy();
 bool Out_SDL_Start();
 void Out_SDL_Stop();
 
-void Out_SDL_AddSource(RingbufferView& view);
+// Returns the index of the new source, which identifies it in the functions below.
+size_t Out_SDL_AddSource(RingbufferView& view);
+
+// Number of times the audio callback found `source` without a full buffer after it had started producing audio.
+uint64_t Out_SDL_GetUnderrunCount(size_t source);
+
+// Size of the device's own buffer, which adds to the latency of queued audio.
+uint32_t Out_SDL_GetDeviceBufferFrames();
 
 void Out_SDL_SetVolume(float vol, AudioVolume &volume_control);
+
+// `init` runs once on the audio callback thread, before the first callback does any work. Must be called before
+// Out_SDL_Start.
+void Out_SDL_SetThreadInit(std::function<void()> init);
@@ -7,8 +7,13 @@ struct FE_Application;
 struct submcu_t;
 
 bool SERIAL_Init(FE_Application& fe, std::string_view serial_port);
+void SERIAL_PostUART(uint8_t data);
+void SERIAL_Quit();
+
+#ifdef _WIN32
+// The Windows backend polls the port: the event loop calls SERIAL_Update to move pending data in both directions. The
+// POSIX backend's thread waits on the port instead and needs no polling.
 void SERIAL_Update();
 bool SERIAL_HasData();
 uint8_t SERIAL_ReadUART();
-void SERIAL_PostUART(uint8_t data);
-void SERIAL_Quit();
+#endif
@@ -1,73 +1,29 @@
 
 #include "serial.h"
+#include "serial_posix.h"
+#include "ringbuffer.h"
+#include "common/trace.h"
+#include <atomic>
 #include <cstdio>
 #include <cstring>   // strerror() function
 #include <fcntl.h>   // Contains file controls like O_RDWR
 #include <errno.h>   // Error integer codes
 #include <mutex>
+#include <poll.h>    // poll()
+#include <span>
 #include <termios.h> // Contains POSIX terminal control definitions
 #include <thread>
-#include <unistd.h>  // open(), write(), read(), close()
-#include <vector>
+#include <unistd.h>  // open(), write(), read(), close(), pipe()
 
-#define INVALID_VALUE -1
-#define BUFFER_SIZE 4096
+void FE_RouteSerial(FE_Application& fe, std::span<const uint8_t> bytes);
 
-std::vector<uint8_t> read_buffer;
-std::vector<uint8_t> write_buffer;
-
-typedef void (*serial_read_callback)(FE_Application& fe, uint8_t data);
-void FE_RouteSerial(FE_Application& fe, uint8_t sbyte);
-
-std::thread serial_read_thread;
-std::mutex  serial_io_mutex;
-bool        serial_thread_run = false;
-void        SERIAL_Thread_Updater(FE_Application& fe, serial_read_callback read_callback);
-
-class Serial_Handler
-{
-    public:
-        bool SerialOpen(std::string_view serial_port);
-        void SerialClose();
-
-        bool IsSerialInit() { return serial_init; }
-
-        bool IsReadPending() { return read_pending; }
-        bool IsWritePending() { return write_pending; }
-
-        std::vector<uint8_t> Read() 
-        {   
-            auto read_data = linux_read_buffer;
-            linux_read_buffer.clear(); 
-            
-            return read_data;
-        }
-
-        void Write(std::vector<uint8_t>& write_data)
-        {
-            linux_write_buffer = write_data;
-            write_data.clear();
-        }
-
-        void SetReadPending(bool value)  {  read_pending = value; }
-        void SetWritePending(bool value) { write_pending = value; }
-
-        void ReadSerialPort();
-        void WriteSerialPort();
-    private:
-        bool serial_init = false;
-        int port_handle;
-
-        std::vector<uint8_t> linux_read_buffer;
-        std::vector<uint8_t> linux_write_buffer;
-
-        bool read_pending  = false;
-        bool write_pending = false;
-};
+std::thread       serial_read_thread;
+std::atomic<bool> serial_thread_run = false;
+void              SERIAL_Thread_Updater(FE_Application& fe);
 
 bool Serial_Handler::SerialOpen(std::string_view serial_port)
 {
-    port_handle = open(std::string(serial_port).c_str(), O_RDWR|O_NOCTTY);
+    port_handle = open(std::string(serial_port).c_str(), O_RDWR|O_NOCTTY|O_NONBLOCK);
     if(port_handle == INVALID_VALUE)
     {
         fprintf(stderr, "Failed to open serial port: %s\n", std::string(serial_port).c_str());
@@ -78,6 +34,7 @@ bool Serial_Handler::SerialOpen(std::string_view serial_port)
     // Read in existing settings, and handle any error
     if(tcgetattr(port_handle, &tty_handle) != 0) {
         fprintf(stderr, "Error %i from getting tty attributes: %s\n", errno, strerror(errno));
+        close(port_handle);
         return false;
     }
 
@@ -87,22 +44,41 @@ bool Serial_Handler::SerialOpen(std::string_view serial_port)
     tty_handle.c_cflag |= (CS8|CREAD|CLOCAL);
 
     // Disable echo, erasure, new-line echo ,interpretation of INTR, QUIT and SUSP & Turn off s/w flow ctrl
-    tty_handle.c_iflag &= ~(ICANON|ECHO|ECHOE|ECHONL|ISIG|IXON|IXOFF|IXANY);
+    tty_handle.c_lflag &= ~(ICANON|ECHO|ECHOE|ECHONL|ISIG);
+    tty_handle.c_iflag &= ~(IXON|IXOFF|IXANY);
     tty_handle.c_iflag &= ~(IGNBRK|BRKINT|PARMRK|ISTRIP|INLCR|IGNCR|ICRNL); // Disable any special handling of received bytes
 
     tty_handle.c_oflag &= ~(OPOST|ONLCR); // Prevent special interpretation of output bytes (e.g. newline chars)
     // Prevent conversion of newline to carriage return/line feed
 
-    tty_handle.c_cc[VTIME] = 0;    // Do not wait, process asap
+    tty_handle.c_cc[VTIME] = 0;    // Do not wait, process asap; poll() does the waiting
     tty_handle.c_cc[VMIN]  = 0;
 
     // Save tty settings, also checking for error
     if (tcsetattr(port_handle, TCSANOW, &tty_handle) != 0) {
         fprintf(stderr, "Error %i from getting tty attributes: %s\n", errno, strerror(errno));
+        close(port_handle);
         return false;
     }
     tcflush(port_handle, TCIFLUSH);
 
+    if (pipe(wake_pipe) != 0)
+    {
+        fprintf(stderr, "Error %i creating serial wake pipe: %s\n", errno, strerror(errno));
+        close(port_handle);
+        return false;
+    }
+    fcntl(wake_pipe[0], F_SETFL, O_NONBLOCK);
+    fcntl(wake_pipe[1], F_SETFL, O_NONBLOCK);
+
+    if (!write_storage.Init(BUFFER_SIZE))
+    {
+        fprintf(stderr, "Failed to allocate serial write buffer\n");
+        SerialClose();
+        return false;
+    }
+    write_queue = RingbufferView(write_storage);
+
     fprintf(stderr, "Opened serial port: %s\n", std::string(serial_port).c_str());
     serial_init = true;
 
@@ -111,166 +87,201 @@ bool Serial_Handler::SerialOpen(std::string_view serial_port)
 
 void Serial_Handler::SerialClose()
 {
-    if (!serial_init)
+    for (int& fd : wake_pipe)
     {
-        return;
+        if (fd != INVALID_VALUE)
+        {
+            close(fd);
+            fd = INVALID_VALUE;
+        }
     }
 
-    close(port_handle);
-    port_handle = INVALID_VALUE;
-    serial_init = false;
-}
-
-void Serial_Handler::ReadSerialPort()
-{
-    uint8_t read_linux[BUFFER_SIZE];
-    int16_t read_bytes = (int16_t)read(port_handle, read_linux, BUFFER_SIZE*sizeof(uint8_t));
-
-    if (read_bytes == INVALID_VALUE)
+    if (port_handle != INVALID_VALUE)
     {
-        fprintf(stderr, "Error %i reading from serial port: %s\n", errno, strerror(errno));
+        close(port_handle);
+        port_handle = INVALID_VALUE;
     }
 
-    if (read_bytes > 0)
+    if (dropped_writes)
     {
-        for (uint16_t i=0; i < read_bytes; i++)
-        {
-            linux_read_buffer.push_back(read_linux[i]);
-        }
+        fprintf(stderr, "WARNING: Serial output overflowed; dropped %llu bytes\n", (unsigned long long)dropped_writes.load());
     }
+
+    write_storage.Free();
+    serial_init = false;
 }
 
-void Serial_Handler::WriteSerialPort()
+void Serial_Handler::QueueWrite(uint8_t data)
 {
-    uint8_t write_linux[BUFFER_SIZE];
-    uint16_t write_size = (uint16_t)linux_write_buffer.size();
-    for (uint16_t i=0; i<write_size && i<BUFFER_SIZE; i++)
-    {
-        write_linux[i] = linux_write_buffer[i];
-    }
+    // Every instance posts from its own thread; the serial thread reads without locking.
+    std::scoped_lock lock(write_mutex);
 
-    int16_t write_bytes = (int16_t)write(port_handle, write_linux, write_size);
-
-    if (write_bytes == INVALID_VALUE)
+    const size_t queued = write_queue.GetReadableBytes();
+    if (queued == BUFFER_SIZE)
     {
-        fprintf(stderr, "Error %i writing to serial port: %s\n", errno, strerror(errno));
+        dropped_writes.fetch_add(1, std::memory_order_relaxed);
+        return;
     }
 
-    linux_write_buffer.clear();
-}
+    write_queue.UncheckedWriteOne(data);
 
-Serial_Handler *s_handler = nullptr;
+    // Wake on every byte, not just when the queue was empty: the serial thread may have emptied the queue after
+    // `queued` was read and be about to poll without POLLOUT, in which case this byte would wait for unrelated input.
+    // Wakes coalesce in the pipe, so this costs at most one write() per byte.
+    Wake();
+}
 
-bool SERIAL_Init(FE_Application& fe, std::string_view serial_port)
+void Serial_Handler::Wake()
 {
-    (void)fe;
+    const uint8_t signal = 0;
+    // A full pipe means a wake is already pending.
+    (void)!write(wake_pipe[1], &signal, 1);
+}
 
-    if (s_handler)
+void Serial_Handler::DrainWakePipe()
+{
+    uint8_t discard[64];
+    while (read(wake_pipe[0], discard, sizeof(discard)) > 0)
     {
-        fprintf(stderr, "Serial IO Already running\n");
-        return false;
     }
-    s_handler = new Serial_Handler();
-    
-    if (!s_handler->SerialOpen(serial_port))
-    {
-        delete s_handler;
-        s_handler = nullptr;
-
-        return false;
-    }
-
-    serial_thread_run  = true;
-    serial_read_thread = std::thread(&SERIAL_Thread_Updater, std::ref(fe), std::ref(FE_RouteSerial));
-
-    return true;
 }
 
-void SERIAL_Update()
+size_t Serial_Handler::Poll(std::span<uint8_t> read_data)
 {
-    std::lock_guard<std::mutex> lock(serial_io_mutex);
+    pollfd fds[2];
+    fds[0].fd      = port_handle;
+    fds[0].events  = POLLIN;
+    fds[0].revents = 0;
+    fds[1].fd      = wake_pipe[0];
+    fds[1].events  = POLLIN;
+    fds[1].revents = 0;
+
+    if (write_queue.GetReadableBytes() != 0)
+    {
+        fds[0].events |= POLLOUT;
+    }
 
-    if (!s_handler || !s_handler->IsSerialInit())
+    if (poll(fds, 2, -1) < 0)
     {
-        return;
+        if (errno != EINTR)
+        {
+            fprintf(stderr, "Error %i polling serial port: %s\n", errno, strerror(errno));
+        }
+        return 0;
     }
 
-    if (read_buffer.empty())
+    if (fds[1].revents & POLLIN)
     {
-        s_handler->SetReadPending(false);
+        DrainWakePipe();
     }
 
-    if (write_buffer.empty())
+    if (fds[0].revents & (POLLHUP | POLLERR | POLLNVAL))
     {
-        s_handler->SetWritePending(false);
+        // Nothing is connected to the other end (e.g. a pty whose peer closed). Such a port polls as ready
+        // continuously, so back off instead of spinning until something reconnects or we are woken.
+        pollfd wake = {wake_pipe[0], POLLIN, 0};
+        poll(&wake, 1, 100);
     }
 
-    if (!s_handler->IsReadPending())
+    size_t read_bytes = 0;
+    if (fds[0].revents & POLLIN)
     {
-        read_buffer = s_handler->Read();
-        s_handler->SetReadPending(true);
+        read_bytes = ReadSerialPort(read_data);
     }
 
-    if (s_handler->IsWritePending())
+    if (fds[0].revents & POLLOUT)
     {
-        s_handler->Write(write_buffer);
-        s_handler->SetWritePending(false);
+        WriteSerialPort();
     }
+
+    return read_bytes;
 }
 
-bool SERIAL_HasData()
+size_t Serial_Handler::ReadSerialPort(std::span<uint8_t> read_data)
 {
-    if (!s_handler || !s_handler->IsSerialInit())
+    const ssize_t read_bytes = read(port_handle, read_data.data(), read_data.size());
+
+    if (read_bytes == INVALID_VALUE)
     {
-        return false;
+        if (errno != EAGAIN && errno != EINTR)
+        {
+            fprintf(stderr, "Error %i reading from serial port: %s\n", errno, strerror(errno));
+        }
+        return 0;
     }
 
-    return !read_buffer.empty();
+    return (size_t)read_bytes;
 }
 
-uint8_t SERIAL_ReadUART()
+void Serial_Handler::WriteSerialPort()
 {
-    if (!s_handler || !s_handler->IsSerialInit())
+    const size_t queued = write_queue.GetReadableBytes();
+    if (queued == 0)
     {
-        return 0;
+        return;
     }
 
-    if (!read_buffer.empty())
+    std::span<uint8_t> first, second;
+    write_queue.UncheckedPrepareReadAny<uint8_t>(queued, first, second);
+
+    // Only the first run is written; if it wraps, the rest goes out on the next iteration.
+    const ssize_t write_bytes = write(port_handle, first.data(), first.size());
+
+    if (write_bytes == INVALID_VALUE)
     {
-        uint8_t read_byte = *read_buffer.cbegin();
-        read_buffer.erase(read_buffer.begin());
+        if (errno != EAGAIN && errno != EINTR)
+        {
+            fprintf(stderr, "Error %i writing to serial port: %s\n", errno, strerror(errno));
+        }
+        return;
+    }
+
+    write_queue.UncheckedFinishReadAny<uint8_t>((size_t)write_bytes);
+}
+
+Serial_Handler *s_handler = nullptr;
 
-        return read_byte;
+bool SERIAL_Init(FE_Application& fe, std::string_view serial_port)
+{
+    if (s_handler)
+    {
+        fprintf(stderr, "Serial IO Already running\n");
+        return false;
     }
-    else
+    s_handler = new Serial_Handler();
+
+    if (!s_handler->SerialOpen(serial_port))
     {
-        s_handler->SetReadPending(false);
-        return 0;
+        delete s_handler;
+        s_handler = nullptr;
+
+        return false;
     }
+
+    serial_thread_run  = true;
+    serial_read_thread = std::thread(&SERIAL_Thread_Updater, std::ref(fe));
+
+    return true;
 }
 
 void SERIAL_PostUART(uint8_t data)
 {
-    std::lock_guard<std::mutex> lock(serial_io_mutex);
-
     if (!s_handler || !s_handler->IsSerialInit())
     {
         return;
     }
 
-    if (write_buffer.size() < BUFFER_SIZE)
-    {
-        write_buffer.push_back(data);
-    }
-    else
-    {
-        s_handler->SetWritePending(true);
-    }
+    s_handler->QueueWrite(data);
 }
 
 void SERIAL_Quit()
 {
     serial_thread_run = false;
+    if (s_handler)
+    {
+        s_handler->Wake();
+    }
+
     if (serial_read_thread.joinable())
     {
         serial_read_thread.join();
@@ -286,19 +297,19 @@ void SERIAL_Quit()
     return;
 }
 
-void SERIAL_Thread_Updater(FE_Application& fe, serial_read_callback read_callback)
+void SERIAL_Thread_Updater(FE_Application& fe)
 {
-    while (serial_thread_run)
-    {
-        std::lock_guard<std::mutex> lock(serial_io_mutex);
+    common::TraceSetThreadName("serial");
 
-        s_handler->ReadSerialPort();
-        s_handler->WriteSerialPort();
+    uint8_t read_data[BUFFER_SIZE];
 
-        if (SERIAL_HasData())
+    while (serial_thread_run)
+    {
+        const size_t read_bytes = s_handler->Poll(read_data);
+        if (read_bytes != 0)
         {
-            uint8_t sbyte = SERIAL_ReadUART();
-            read_callback(fe, sbyte);        
+            common::TraceInstant("serial in", (int64_t)read_bytes);
+            FE_RouteSerial(fe, std::span<const uint8_t>(read_data, read_bytes));
         }
     }
 }
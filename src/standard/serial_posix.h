@@ -0,0 +1,51 @@
+#pragma once
+
+#include "ringbuffer.h"
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <span>
+#include <string_view>
+
+#define INVALID_VALUE -1
+#define BUFFER_SIZE 4096
+
+// Owns the serial port and the queue of bytes the emulator wants to send. The serial thread sleeps in poll() until the
+// port is readable, the port is writable while bytes are queued, or it is woken through the wake pipe.
+class Serial_Handler
+{
+    public:
+        bool SerialOpen(std::string_view serial_port);
+        void SerialClose();
+
+        bool IsSerialInit() { return serial_init; }
+
+        // Called from emulator threads. Queues a byte for the serial thread to write to the port.
+        void QueueWrite(uint8_t data);
+
+        // Wakes the serial thread, e.g. to notice shutdown or newly queued bytes.
+        void Wake();
+
+        // Runs one iteration of the serial thread: waits for the port or the wake pipe, then reads everything
+        // available into `read_data` and writes as much of the queue as the port accepts. Returns the number of bytes
+        // read.
+        size_t Poll(std::span<uint8_t> read_data);
+
+    private:
+        size_t ReadSerialPort(std::span<uint8_t> read_data);
+        void WriteSerialPort();
+        void DrainWakePipe();
+
+        bool serial_init = false;
+        int port_handle  = INVALID_VALUE;
+
+        // wake_pipe[0] is polled by the serial thread; writing to wake_pipe[1] wakes it.
+        int wake_pipe[2] = {INVALID_VALUE, INVALID_VALUE};
+
+        // Bytes written by the emulator thread and sent by the serial thread.
+        GenericBuffer  write_storage;
+        RingbufferView write_queue;
+        std::mutex     write_mutex;
+
+        std::atomic<uint64_t> dropped_writes = 0;
+};
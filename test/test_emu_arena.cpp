@@ -0,0 +1,24 @@
+#include "emu_arena.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cstdint>
+
+TEST_CASE("Arena allocation")
+{
+    EMU_Arena arena;
+    REQUIRE(arena.Init(100, EMU_MemoryMode::Arena));
+    REQUIRE(arena.GetBacking() != EMU_ArenaBacking::None);
+
+    // Rounded up to whole huge pages, and aligned to them so that they can actually be used.
+    const std::span<uint8_t> memory = arena.GetMemory();
+    REQUIRE(memory.size() == EMU_HUGE_PAGE_SIZE);
+    REQUIRE((uintptr_t)memory.data() % EMU_HUGE_PAGE_SIZE == 0);
+
+    uint8_t* a = (uint8_t*)arena.Allocate(1, 1);
+    uint8_t* b = (uint8_t*)arena.Allocate(64, 64);
+    REQUIRE(a == memory.data());
+    REQUIRE(b == memory.data() + 64);
+    REQUIRE(arena.Allocate(memory.size(), 1) == nullptr);
+
+    // A failed allocation doesn't use up the arena.
+    REQUIRE(arena.Allocate(memory.size() - 128, 1) == memory.data() + 128);
+}
@@ -0,0 +1,53 @@
+#include "lcd_text.h"
+#include <catch2/catch_test_macros.hpp>
+#include <cstring>
+
+TEST_CASE("LCD text decoding: SC-55 fields and meters")
+{
+    uint8_t data[80];
+    uint8_t cg[64]{};
+    memset(data, ' ', sizeof(data));
+
+    memcpy(&data[0], "A01", 3);
+    memcpy(&data[3], "Piano 1", 7);
+    memcpy(&data[40], "100", 3);
+
+    // Top cells use the blank CG glyph 1. Bottom cells use glyph 0, which lights the lowest 3 rows of its first column.
+    for (size_t i = 0; i < 4; i++)
+    {
+        data[20 + i] = 1;
+        data[60 + i] = 0;
+    }
+    cg[5] = cg[6] = cg[7] = 0x10;
+
+    LCD_TextState state;
+    LCD_DecodeText(data, cg, false, state);
+
+    REQUIRE(state.part == "A01");
+    REQUIRE(state.instrument == "Piano 1");
+    REQUIRE(state.level == "100");
+    REQUIRE(state.meters[0] == 3);
+    REQUIRE(state.meters[1] == 0);
+    REQUIRE(state.meters[5] == 3);
+
+    const std::string line = LCD_FormatText(state);
+    REQUIRE(line.starts_with("power=on part=\"A01\" instrument=\"Piano 1\" level=\"100\""));
+    REQUIRE(line.ends_with("meters=3,0,0,0,0,3,0,0,0,0,3,0,0,0,0,3"));
+}
+
+TEST_CASE("LCD text decoding: JV-880 lines")
+{
+    uint8_t data[80];
+    uint8_t cg[64]{};
+    memset(data, ' ', sizeof(data));
+
+    memcpy(&data[0], "Patch \"A\"", 9);
+    data[40] = 0x01;
+
+    LCD_TextState state;
+    LCD_DecodeText(data, cg, true, state);
+
+    REQUIRE(state.line1 == "Patch \"A\"");
+    REQUIRE(state.line2 == "?");
+    REQUIRE(LCD_FormatText(state) == "power=on line1=\"Patch \\\"A\\\"\" line2=\"?\"");
+}
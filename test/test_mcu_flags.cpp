@@ -0,0 +1,131 @@
+#include <catch2/catch_test_macros.hpp>
+#include "mcu.h"
+#include "mcu_opcodes.h"
+#include <memory>
+#include <random>
+
+constexpr uint16_t FLAGS_NZVC = STATUS_N | STATUS_Z | STATUS_V | STATUS_C;
+
+// Eager reference for t1 + t2 + c_bit (or t1 - t2 - c_bit), written the way the interpreter computed flags before
+// they were deferred.
+static uint16_t EagerAddSubFlags(int32_t t1, int32_t t2, int32_t c_bit, uint32_t siz, bool sub)
+{
+    const int32_t bits   = siz ? 16 : 8;
+    const int32_t mask   = (1 << bits) - 1;
+    const int32_t s_min  = -(1 << (bits - 1));
+    const int32_t s_max  = (1 << (bits - 1)) - 1;
+    const int32_t s1     = siz ? (int16_t)t1 : (int8_t)t1;
+    const int32_t s2     = siz ? (int16_t)t2 : (int8_t)t2;
+    const int32_t u1     = t1 & mask;
+    const int32_t u2     = t2 & mask;
+    const int32_t u      = sub ? u1 - u2 - c_bit : u1 + u2 + c_bit;
+    const int32_t s      = sub ? s1 - s2 - c_bit : s1 + s2 + c_bit;
+    const int32_t result = u & mask;
+
+    uint16_t flags = 0;
+    if (result & (1 << (bits - 1)))
+        flags |= STATUS_N;
+    if (result == 0)
+        flags |= STATUS_Z;
+    if (s < s_min || s > s_max)
+        flags |= STATUS_V;
+    if ((u >> bits) & 1)
+        flags |= STATUS_C;
+    return flags;
+}
+
+// Eager reference for MCU_SetStatusCommon: N and Z from the value, V cleared, C kept from `old_flags`.
+static uint16_t EagerLogicFlags(uint32_t val, uint32_t siz, uint16_t old_flags)
+{
+    const uint32_t result = siz ? (val & 0xffff) : (val & 0xff);
+    uint16_t flags = old_flags & STATUS_C;
+    if (result & (siz ? 0x8000u : 0x80u))
+        flags |= STATUS_N;
+    if (result == 0)
+        flags |= STATUS_Z;
+    return flags;
+}
+
+TEST_CASE("Lazy MCU flags match eager evaluation")
+{
+    auto mcu = std::make_unique<mcu_t>();
+    std::mt19937 rng(1);
+
+    // Flags an eager interpreter would hold in sr at this point.
+    uint16_t expected = 0;
+    mcu->sr           = 0;
+
+    for (int i = 0; i < 200000; ++i)
+    {
+        // Bias towards operands that hit the edges: zero results, sign boundaries and carries.
+        const int32_t t1    = (rng() % 4 == 0) ? (int32_t)rng() : (int32_t)(rng() & 0xffff);
+        const int32_t t2    = (rng() % 4 == 0) ? t1 : (int32_t)(rng() & 0xffff);
+        const int32_t c_bit = (int32_t)(rng() & 1);
+        const uint32_t siz  = rng() & 1;
+        const int32_t mask  = siz ? 0xffff : 0xff;
+
+        switch (rng() % 5)
+        {
+        case 0:
+            REQUIRE(MCU_ADD_Common(*mcu, t1, t2, c_bit, siz) == ((t1 + t2 + c_bit) & mask));
+            REQUIRE(mcu->flags_op == LAZY_FLAGS_ADD);
+            expected = EagerAddSubFlags(t1, t2, c_bit, siz, false);
+            break;
+        case 1:
+            REQUIRE(MCU_SUB_Common(*mcu, t1, t2, c_bit, siz) == ((t1 - t2 - c_bit) & mask));
+            REQUIRE(mcu->flags_op == LAZY_FLAGS_SUB);
+            expected = EagerAddSubFlags(t1, t2, c_bit, siz, true);
+            break;
+        case 2:
+            MCU_SetStatusCommon(*mcu, (uint32_t)t1, siz);
+            REQUIRE(mcu->flags_op == LAZY_FLAGS_LOGIC);
+            expected = EagerLogicFlags((uint32_t)t1, siz, expected);
+            break;
+        case 3:
+        {
+            // Setting a single flag directly has to resolve the pending ones first.
+            const uint16_t bit = (uint16_t)(1u << (rng() % 4));
+            const bool set     = rng() & 1;
+            MCU_SetStatus(*mcu, set, bit);
+            REQUIRE(mcu->flags_op == LAZY_FLAGS_NONE);
+            expected = set ? (uint16_t)(expected | bit) : (uint16_t)(expected & ~bit);
+            break;
+        }
+        case 4:
+            MCU_SyncFlags(*mcu);
+            REQUIRE(mcu->flags_op == LAZY_FLAGS_NONE);
+            break;
+        }
+
+        if (mcu->flags_op == LAZY_FLAGS_NONE)
+        {
+            REQUIRE((mcu->sr & FLAGS_NZVC) == expected);
+        }
+    }
+
+    MCU_SyncFlags(*mcu);
+    REQUIRE((mcu->sr & FLAGS_NZVC) == expected);
+}
+
+TEST_CASE("Lazy MCU flags leave the rest of sr alone")
+{
+    auto mcu = std::make_unique<mcu_t>();
+
+    // Interrupt mask and the other non-flag bits survive every flags_op kind.
+    const uint16_t other = (uint16_t)(STATUS_INT_MASK | 0x8000);
+    mcu->sr = other;
+
+    MCU_ADD_Common(*mcu, 0x7f, 0x01, 0, 0);
+    MCU_SyncFlags(*mcu);
+    REQUIRE(mcu->sr == (other | STATUS_N | STATUS_V));
+
+    MCU_SUB_Common(*mcu, 0x0000, 0x0001, 0, 1);
+    MCU_SyncFlags(*mcu);
+    REQUIRE(mcu->sr == (other | STATUS_N | STATUS_C));
+
+    // C from the pending subtraction is kept by the logic op, V is cleared.
+    MCU_SUB_Common(*mcu, 0x00, 0x01, 0, 0);
+    MCU_SetStatusCommon(*mcu, 0, 0);
+    MCU_SyncFlags(*mcu);
+    REQUIRE(mcu->sr == (other | STATUS_Z | STATUS_C));
+}
@@ -0,0 +1,56 @@
+#include "audio.h"
+#include <catch2/catch_test_macros.hpp>
+#include <vector>
+
+// Lengths that exercise both the vector body and the scalar tail.
+static const size_t test_lengths[] = {0, 1, 3, 4, 7, 8, 9, 17, 64};
+
+TEST_CASE("HorizontalSatAddI16 saturates like SaturatingAdd")
+{
+    for (size_t n : test_lengths)
+    {
+        std::vector<int16_t> dest(n), src(n), expected(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            dest[i] = (int16_t)(i % 2 ? INT16_MAX - (int16_t)i : INT16_MIN + (int16_t)i);
+            src[i]  = (int16_t)(i % 3 ? 1000 * (int16_t)(i % 7) : -1000 * (int16_t)(i % 5));
+            expected[i] = SaturatingAdd(dest[i], src[i]);
+        }
+        HorizontalSatAddI16(dest.data(), src.data(), src.data() + n);
+        REQUIRE(dest == expected);
+    }
+}
+
+TEST_CASE("HorizontalSatAddI32 saturates like SaturatingAdd")
+{
+    for (size_t n : test_lengths)
+    {
+        std::vector<int32_t> dest(n), src(n), expected(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            dest[i] = i % 2 ? INT32_MAX - (int32_t)i : INT32_MIN + (int32_t)i;
+            src[i]  = i % 3 ? 100000 * (int32_t)(i % 7) : -100000 * (int32_t)(i % 5);
+            expected[i] = SaturatingAdd(dest[i], src[i]);
+        }
+        HorizontalSatAddI32(dest.data(), src.data(), src.data() + n);
+        REQUIRE(dest == expected);
+    }
+}
+
+TEST_CASE("MixFrames matches MixFrame")
+{
+    std::vector<AudioFrame<int32_t>> dest(9), src(9), expected(9);
+    for (size_t i = 0; i < dest.size(); ++i)
+    {
+        dest[i] = {INT32_MAX - (int32_t)i, -(int32_t)i};
+        src[i]  = {(int32_t)i * 3, INT32_MIN + (int32_t)i};
+        expected[i] = dest[i];
+        MixFrame(expected[i], src[i]);
+    }
+    MixFrames(dest.data(), src.data(), dest.size());
+    for (size_t i = 0; i < dest.size(); ++i)
+    {
+        REQUIRE(dest[i].left == expected[i].left);
+        REQUIRE(dest[i].right == expected[i].right);
+    }
+}
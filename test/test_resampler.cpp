@@ -0,0 +1,105 @@
+#include "resampler.h"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+static std::vector<AudioFrame<float>> ResampleAll(AudioResampler& resampler,
+                                                  const std::vector<AudioFrame<float>>& in,
+                                                  size_t block_size)
+{
+    std::vector<AudioFrame<float>> out;
+    for (size_t i = 0; i < in.size(); i += block_size)
+    {
+        const size_t count = std::min(block_size, in.size() - i);
+        resampler.Process(std::span(in).subspan(i, count), out);
+    }
+    resampler.Flush(out);
+    return out;
+}
+
+TEST_CASE("AudioResampler produces one output frame per output period")
+{
+    AudioResampler resampler;
+    REQUIRE(resampler.Init(66207, 48000));
+
+    const std::vector<AudioFrame<float>> in(66207, AudioFrame<float>{});
+    const auto out = ResampleAll(resampler, in, 64);
+
+    // Output frames cover input times 0, in/out, 2*in/out, ... up to the last input frame.
+    REQUIRE(out.size() == 48000);
+}
+
+TEST_CASE("AudioResampler output doesn't depend on block size")
+{
+    std::vector<AudioFrame<float>> in(5000);
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        in[i].left  = (float)std::sin(0.01 * (double)i);
+        in[i].right = (float)std::cos(0.003 * (double)i);
+    }
+
+    AudioResampler a;
+    REQUIRE(a.Init(64000, 44100));
+    AudioResampler b;
+    REQUIRE(b.Init(64000, 44100));
+
+    const auto out_a = ResampleAll(a, in, 1);
+    const auto out_b = ResampleAll(b, in, 333);
+
+    REQUIRE(out_a.size() == out_b.size());
+    for (size_t i = 0; i < out_a.size(); ++i)
+    {
+        REQUIRE(out_a[i].left == out_b[i].left);
+        REQUIRE(out_a[i].right == out_b[i].right);
+    }
+}
+
+TEST_CASE("AudioResampler has unity gain at DC")
+{
+    AudioResampler resampler;
+    REQUIRE(resampler.Init(66207, 44100));
+
+    const std::vector<AudioFrame<float>> in(10000, AudioFrame<float>{.left = 0.5f, .right = -0.25f});
+    const auto out = ResampleAll(resampler, in, 64);
+
+    // Skip the edges where the filter overlaps the implicit silence around the input.
+    for (size_t i = 100; i + 100 < out.size(); ++i)
+    {
+        REQUIRE(std::abs(out[i].left - 0.5f) < 1e-4f);
+        REQUIRE(std::abs(out[i].right + 0.25f) < 1e-4f);
+    }
+}
+
+TEST_CASE("AudioResampler preserves passband tones and removes tones above the output Nyquist frequency")
+{
+    constexpr double pi = 3.14159265358979323846;
+
+    const auto peak_after_resample = [&](double frequency) {
+        AudioResampler resampler;
+        REQUIRE(resampler.Init(66207, 48000));
+
+        std::vector<AudioFrame<float>> in(20000);
+        for (size_t i = 0; i < in.size(); ++i)
+        {
+            const float v = (float)std::sin(2.0 * pi * frequency * (double)i / 66207.0);
+            in[i]         = {v, v};
+        }
+
+        const auto out = ResampleAll(resampler, in, 64);
+
+        float peak = 0.0f;
+        for (size_t i = 1000; i + 1000 < out.size(); ++i)
+        {
+            peak = std::max(peak, std::abs(out[i].left));
+        }
+        return peak;
+    };
+
+    const float passband = peak_after_resample(1000.0);
+    REQUIRE(passband > 0.99f);
+    REQUIRE(passband < 1.01f);
+
+    // 30 kHz would alias to 18 kHz at 48 kHz.
+    REQUIRE(peak_after_resample(30000.0) < 1e-3f);
+}
@@ -1,5 +1,6 @@
 #include <catch2/catch_test_macros.hpp>
 #include "ringbuffer.h"
+#include <thread>
 
 TEST_CASE("RingbufferView")
 {
@@ -50,3 +51,62 @@ TEST_CASE("RingbufferView")
 
     storage.Free();
 }
+
+TEST_CASE("RingbufferView wait for reader")
+{
+    GenericBuffer storage;
+    REQUIRE(storage.Init(4));
+
+    RingbufferView ringbuffer(storage);
+    ringbuffer.UncheckedWriteOne<uint8_t>(1);
+    ringbuffer.UncheckedWriteOne<uint8_t>(2);
+
+    // Enough room already; must not block.
+    REQUIRE(ringbuffer.WaitForReadableBelow(3));
+
+    std::thread reader([&ringbuffer] {
+        uint8_t x = 0;
+        ringbuffer.UncheckedReadOne<uint8_t>(x);
+        ringbuffer.NotifyRead();
+    });
+
+    // Blocks until the reader has consumed one byte.
+    while (!ringbuffer.WaitForReadableBelow(2))
+    {
+    }
+    REQUIRE(ringbuffer.GetReadableBytes() == 1);
+
+    reader.join();
+}
+
+TEST_CASE("RingbufferView wrapped read")
+{
+    GenericBuffer storage;
+    REQUIRE(storage.Init(8));
+
+    RingbufferView ringbuffer(storage);
+    for (uint8_t i = 0; i < 6; ++i)
+    {
+        ringbuffer.UncheckedWriteOne<uint8_t>(i);
+    }
+
+    std::span<uint8_t> first, second;
+    ringbuffer.UncheckedPrepareReadAny<uint8_t>(5, first, second);
+    REQUIRE(first.size() == 5);
+    REQUIRE(second.empty());
+    ringbuffer.UncheckedFinishReadAny<uint8_t>(5);
+
+    // write head wraps to index 3; a 4-byte read from index 5 is split 3 + 1
+    for (uint8_t i = 6; i < 11; ++i)
+    {
+        ringbuffer.UncheckedWriteOne<uint8_t>(i);
+    }
+    ringbuffer.UncheckedPrepareReadAny<uint8_t>(4, first, second);
+    REQUIRE(first.size() == 3);
+    REQUIRE(second.size() == 1);
+    REQUIRE(first[0] == 5);
+    REQUIRE(first[2] == 7);
+    REQUIRE(second[0] == 8);
+    ringbuffer.UncheckedFinishReadAny<uint8_t>(4);
+    REQUIRE(ringbuffer.GetReadableBytes() == 2);
+}
@@ -0,0 +1,89 @@
+#include "rom_io.h"
+#include "test_util.h"
+#include <catch2/catch_test_macros.hpp>
+#include <fstream>
+
+static void WriteFile(const std::filesystem::path& path, const char* contents)
+{
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    output << contents;
+}
+
+TEST_CASE("RomHashIndex round trips through a file")
+{
+    const auto dir = MakeScratchDirectory("nuked-sc55-test-rom-index-roundtrip");
+
+    const auto rom_path   = dir / "rom with spaces.bin";
+    const auto index_path = dir / "cache" / "rom_index.txt";
+    WriteFile(rom_path, "hello");
+
+    RomFileStamp stamp;
+    REQUIRE(GetRomFileStamp(rom_path, stamp));
+    REQUIRE(stamp.size == 5);
+
+    SHA256Digest digest{};
+    for (size_t i = 0; i < digest.size(); ++i)
+    {
+        digest[i] = (uint8_t)(i * 7);
+    }
+
+    RomHashIndex index;
+    REQUIRE(index.Load(index_path));
+    REQUIRE(index.GetEntryCount() == 0);
+    index.Insert(rom_path, stamp, digest);
+    REQUIRE(index.Save(index_path));
+
+    RomHashIndex loaded;
+    REQUIRE(loaded.Load(index_path));
+    REQUIRE(loaded.GetEntryCount() == 1);
+
+    const SHA256Digest* found = loaded.Find(rom_path, stamp);
+    REQUIRE(found);
+    REQUIRE(*found == digest);
+
+    // any change to the stamp invalidates the entry
+    RomFileStamp changed = stamp;
+    changed.size += 1;
+    REQUIRE(!loaded.Find(rom_path, changed));
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("RomHashIndex rejects malformed files")
+{
+    const auto dir        = MakeScratchDirectory("nuked-sc55-test-rom-index-malformed");
+    const auto index_path = dir / "rom_index.txt";
+
+    WriteFile(index_path, "nuked-sc55-rom-index 1\nnot a valid line\n");
+
+    RomHashIndex index;
+    REQUIRE(!index.Load(index_path));
+    REQUIRE(index.GetEntryCount() == 0);
+
+    std::filesystem::remove_all(dir);
+}
+
+TEST_CASE("RomHashIndex prunes deleted files")
+{
+    const auto dir = MakeScratchDirectory("nuked-sc55-test-rom-index-prune");
+
+    const auto kept    = dir / "kept.bin";
+    const auto deleted = dir / "deleted.bin";
+    WriteFile(kept, "a");
+    WriteFile(deleted, "b");
+
+    RomHashIndex index;
+    REQUIRE(DetectRomsetsByHash(dir, *std::make_unique<AllRomsetInfo>(), nullptr, &index));
+    REQUIRE(index.GetEntryCount() == 2);
+
+    std::filesystem::remove(deleted);
+
+    REQUIRE(DetectRomsetsByHash(dir, *std::make_unique<AllRomsetInfo>(), nullptr, &index));
+    REQUIRE(index.GetEntryCount() == 1);
+
+    RomFileStamp stamp;
+    REQUIRE(GetRomFileStamp(kept, stamp));
+    REQUIRE(index.Find(kept, stamp));
+
+    std::filesystem::remove_all(dir);
+}
@@ -0,0 +1,113 @@
+#include "rom_io.h"
+#include "test_util.h"
+#include <catch2/catch_test_macros.hpp>
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+
+// Writes a 1 MB scrambled "waverom" with a recognizable pattern.
+static void WriteWaverom(const std::filesystem::path& path, uint8_t seed = 0)
+{
+    std::vector<uint8_t> data(0x100000);
+    for (size_t i = 0; i < data.size(); ++i)
+    {
+        data[i] = (uint8_t)(i * 31 + (i >> 8) + seed);
+    }
+    std::ofstream output(path, std::ios::binary | std::ios::trunc);
+    output.write((const char*)data.data(), (std::streamsize)data.size());
+}
+
+static size_t CountCacheFiles(const std::filesystem::path& cache_dir)
+{
+    size_t count = 0;
+    for (const auto& entry : std::filesystem::directory_iterator(cache_dir))
+    {
+        REQUIRE(entry.path().extension() == ".bin");
+        ++count;
+    }
+    return count;
+}
+
+static std::vector<uint8_t> LoadWaverom2(const std::filesystem::path& rom_path, const std::filesystem::path& cache_dir)
+{
+    AllRomsetInfo all_info;
+    all_info.romsets[(size_t)Romset::MK1].rom_paths[(size_t)RomLocation::WAVEROM2] = rom_path;
+
+    RomLoadStatusSet loaded;
+    REQUIRE(LoadRomset(Romset::MK1, all_info, &loaded, cache_dir));
+    REQUIRE(loaded[(size_t)RomLocation::WAVEROM2] == RomLoadStatus::Loaded);
+
+    const auto data = all_info.romsets[(size_t)Romset::MK1].GetRomData(RomLocation::WAVEROM2);
+    return std::vector<uint8_t>(data.begin(), data.end());
+}
+
+TEST_CASE("LoadRomset maps non-waverom files directly")
+{
+    const auto dir = MakeScratchDirectory("nuked-sc55-test-rom-io-map");
+
+    const auto rom_path = dir / "rom1.bin";
+    {
+        std::ofstream output(rom_path, std::ios::binary);
+        output << "rom contents";
+    }
+
+    AllRomsetInfo all_info;
+    RomsetInfo&   info = all_info.romsets[(size_t)Romset::MK2];
+    info.rom_paths[(size_t)RomLocation::ROM1] = rom_path;
+
+    REQUIRE(LoadRomset(Romset::MK2, all_info));
+    REQUIRE(info.rom_maps[(size_t)RomLocation::ROM1] != nullptr);
+    REQUIRE(info.rom_data[(size_t)RomLocation::ROM1].empty());
+
+    const auto data = info.GetRomData(RomLocation::ROM1);
+    REQUIRE(std::string((const char*)data.data(), data.size()) == "rom contents");
+
+    info.PurgeRomData();
+    REQUIRE(!info.HasRomData(RomLocation::ROM1));
+}
+
+TEST_CASE("LoadRomset caches unscrambled waveroms padded to the slot size")
+{
+    const auto dir       = MakeScratchDirectory("nuked-sc55-test-rom-io-cache");
+    const auto rom_path  = dir / "waverom2.bin";
+    const auto cache_dir = dir / "cache";
+    WriteWaverom(rom_path);
+
+    const auto uncached = LoadWaverom2(rom_path, {});
+    REQUIRE(uncached.size() == 0x100000);
+
+    // First load writes the cache, second load maps it.
+    const auto first  = LoadWaverom2(rom_path, cache_dir);
+    const auto second = LoadWaverom2(rom_path, cache_dir);
+
+    REQUIRE(first.size() == GetWaveromCapacity(RomLocation::WAVEROM2));
+    REQUIRE(first == second);
+    REQUIRE(std::equal(uncached.begin(), uncached.end(), first.begin()));
+    REQUIRE(std::all_of(first.begin() + 0x100000, first.end(), [](uint8_t b) { return b == 0; }));
+
+    REQUIRE(CountCacheFiles(cache_dir) == 1);
+}
+
+TEST_CASE("LoadRomset replaces the cached image of a changed waverom")
+{
+    const auto dir       = MakeScratchDirectory("nuked-sc55-test-rom-io-prune");
+    const auto rom_path  = dir / "waverom2.bin";
+    const auto cache_dir = dir / "cache";
+
+    WriteWaverom(rom_path);
+    const auto old_image = LoadWaverom2(rom_path, cache_dir);
+
+    // Another rom in the same cache must survive.
+    const auto other_path = dir / "other.bin";
+    WriteWaverom(other_path);
+    LoadWaverom2(other_path, cache_dir);
+    REQUIRE(CountCacheFiles(cache_dir) == 2);
+
+    WriteWaverom(rom_path, 1);
+    // Don't rely on the filesystem's timestamp resolution to tell the two versions apart.
+    std::filesystem::last_write_time(rom_path, std::filesystem::last_write_time(rom_path) + std::chrono::hours(1));
+
+    const auto new_image = LoadWaverom2(rom_path, cache_dir);
+    REQUIRE(new_image != old_image);
+    REQUIRE(CountCacheFiles(cache_dir) == 2);
+}
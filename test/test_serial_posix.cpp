@@ -0,0 +1,90 @@
+#include <catch2/catch_test_macros.hpp>
+#include "serial.h"
+#include "serial_posix.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <fcntl.h>
+#include <poll.h>
+#include <thread>
+#include <unistd.h>
+
+// serial_posix.cpp forwards bytes read from the port to the frontend; this test only checks the write side.
+void FE_RouteSerial(FE_Application&, std::span<const uint8_t>)
+{
+}
+
+constexpr uint32_t TOTAL_BYTES = 200000;
+
+// Keeps at most this many bytes in flight so the queue never overflows, but empties often enough that the serial thread
+// keeps going back to sleep while bytes are being queued.
+constexpr uint32_t MAX_IN_FLIGHT = 256;
+
+TEST_CASE("Serial output queued during a write reaches the port")
+{
+    const int master = posix_openpt(O_RDWR | O_NOCTTY);
+    REQUIRE(master >= 0);
+    REQUIRE(grantpt(master) == 0);
+    REQUIRE(unlockpt(master) == 0);
+
+    Serial_Handler handler;
+    REQUIRE(handler.SerialOpen(ptsname(master)));
+
+    std::atomic<bool> run = true;
+    std::thread serial_thread([&] {
+        uint8_t read_data[64];
+        while (run)
+        {
+            handler.Poll(read_data);
+        }
+    });
+
+    std::atomic<uint32_t> received = 0;
+    std::atomic<bool>     give_up  = false;
+    std::thread producer([&] {
+        for (uint32_t sent = 0; sent < TOTAL_BYTES; ++sent)
+        {
+            while (sent - received.load() >= MAX_IN_FLIGHT && !give_up)
+            {
+                std::this_thread::yield();
+            }
+            handler.QueueWrite((uint8_t)(sent * 31));
+        }
+    });
+
+    // A lost wakeup leaves the remaining bytes in the queue, so give up after a generous timeout instead of hanging.
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(20);
+    bool       in_order = true;
+    uint8_t    buffer[512];
+    while (received < TOTAL_BYTES && std::chrono::steady_clock::now() < deadline)
+    {
+        pollfd fds = {master, POLLIN, 0};
+        if (poll(&fds, 1, 100) <= 0)
+        {
+            continue;
+        }
+
+        const ssize_t count = read(master, buffer, sizeof(buffer));
+        for (ssize_t i = 0; i < count; ++i)
+        {
+            in_order &= buffer[i] == (uint8_t)((received + (uint32_t)i) * 31);
+        }
+        if (count > 0)
+        {
+            received += (uint32_t)count;
+        }
+    }
+
+    const bool all_received = received == TOTAL_BYTES;
+    give_up = true;
+    producer.join();
+
+    run = false;
+    handler.Wake();
+    serial_thread.join();
+    handler.SerialClose();
+    close(master);
+
+    REQUIRE(all_received);
+    REQUIRE(in_order);
+}
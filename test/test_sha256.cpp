@@ -0,0 +1,96 @@
+#include "sha256.h"
+#include <catch2/benchmark/catch_benchmark.hpp>
+#include <catch2/catch_test_macros.hpp>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static std::string ToHex(const SHA256Digest& digest)
+{
+    std::string hex;
+    for (uint8_t b : digest)
+    {
+        char buf[3];
+        snprintf(buf, sizeof(buf), "%02x", b);
+        hex += buf;
+    }
+    return hex;
+}
+
+static std::string Hash(SHA256Backend backend, std::string_view str)
+{
+    SHA256Digest digest{};
+    HashSHA256(backend, std::span((const uint8_t*)str.data(), str.size()), digest);
+    return ToHex(digest);
+}
+
+static std::vector<SHA256Backend> GetSupportedBackends()
+{
+    std::vector<SHA256Backend> backends;
+    for (SHA256Backend backend : {SHA256Backend::Portable, SHA256Backend::X86ShaNi, SHA256Backend::ArmSha2})
+    {
+        if (IsSHA256BackendSupported(backend))
+        {
+            backends.push_back(backend);
+        }
+    }
+    return backends;
+}
+
+static std::vector<uint8_t> MakeTestData(size_t size)
+{
+    std::vector<uint8_t> data(size);
+    uint32_t             x = 12345;
+    for (auto& b : data)
+    {
+        x = x * 1664525 + 1013904223;
+        b = (uint8_t)(x >> 24);
+    }
+    return data;
+}
+
+TEST_CASE("All supported SHA-256 backends match the FIPS 180-2 test vectors")
+{
+    for (SHA256Backend backend : GetSupportedBackends())
+    {
+        REQUIRE(Hash(backend, "") == "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855");
+        REQUIRE(Hash(backend, "abc") == "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad");
+        REQUIRE(Hash(backend, "abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq") ==
+                "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1");
+    }
+}
+
+TEST_CASE("All supported SHA-256 backends agree with the portable one around block boundaries")
+{
+    const std::vector<uint8_t> data = MakeTestData(1000);
+
+    for (SHA256Backend backend : GetSupportedBackends())
+    {
+        for (size_t size = 0; size <= 200; ++size)
+        {
+            SHA256Digest expected{};
+            SHA256Digest actual{};
+            HashSHA256(SHA256Backend::Portable, std::span(data).first(size), expected);
+            HashSHA256(backend, std::span(data).first(size), actual);
+            REQUIRE(expected == actual);
+        }
+    }
+}
+
+// Hidden; run with `tests [benchmark]`.
+TEST_CASE("SHA-256 backend throughput", "[.][benchmark]")
+{
+    // About the size of a large waverom.
+    const std::vector<uint8_t> data = MakeTestData(8 * 1024 * 1024);
+
+    for (SHA256Backend backend : GetSupportedBackends())
+    {
+        const std::string name = std::string("SHA-256 8 MiB ") + ToCString(backend);
+        BENCHMARK(name.c_str())
+        {
+            SHA256Digest digest{};
+            HashSHA256(backend, data, digest);
+            return digest[0];
+        };
+    }
+}
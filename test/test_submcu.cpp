@@ -0,0 +1,203 @@
+#include <catch2/catch_test_macros.hpp>
+#include "mcu.h"
+#include "submcu.h"
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <random>
+
+constexpr uint16_t PROGRAM_START = 0x1100;
+constexpr uint16_t PROGRAM_END   = 0x1f00;
+
+// Runs exactly one instruction; each one takes 48 sub-MCU cycles and SM_Update counts in units of 5.
+static void StepOne(submcu_t& sm)
+{
+    SM_Update(sm, sm.cycles / 5 + 1);
+}
+
+static uint8_t VisibleFlags(const submcu_t& sm)
+{
+    uint8_t sr = sm.sr;
+    if (sm.nz_pending)
+    {
+        sr &= (uint8_t)~(SM_STATUS_N | SM_STATUS_Z);
+        if (sm.nz_result == 0)
+            sr |= SM_STATUS_Z;
+        if (sm.nz_result & 0x80)
+            sr |= SM_STATUS_N;
+    }
+    return sr;
+}
+
+// Register and immediate instructions whose N/Z result is easy to compute eagerly, plus the branches that read them.
+// BMI is left out: SM_Opcode_BPL_BMI compares the N bit with a bool, so it never branches. Renders depend on that, so
+// it is kept as is. Opcode, length.
+static const uint8_t TEST_OPCODES[][2] = {
+    {0xa9, 2}, // LDA #
+    {0xa2, 2}, // LDX #
+    {0xa0, 2}, // LDY #
+    {0x09, 2}, // ORA #
+    {0x29, 2}, // AND #
+    {0xc9, 2}, // CMP #
+    {0xe0, 2}, // CPX #
+    {0xc0, 2}, // CPY #
+    {0x8a, 1}, // TXA
+    {0xaa, 1}, // TAX
+    {0xe8, 1}, // INX
+    {0xc8, 1}, // INY
+    {0x1a, 1}, // DEC A
+    {0x3a, 1}, // INC A
+    {0xf0, 2}, // BEQ
+    {0xd0, 2}, // BNE
+    {0x10, 2}, // BPL
+};
+
+// Returns 0 for opcodes outside TEST_OPCODES.
+static uint8_t TestOpcodeLength(uint8_t opcode)
+{
+    for (const auto& entry : TEST_OPCODES)
+    {
+        if (entry[0] == opcode)
+            return entry[1];
+    }
+    return 0;
+}
+
+TEST_CASE("Sub-MCU N and Z flags match eager evaluation")
+{
+    std::mt19937 rng(1);
+
+    auto mcu  = std::make_unique<mcu_t>();
+    auto fast = std::make_unique<submcu_t>();
+    auto slow = std::make_unique<submcu_t>();
+    SM_Init(*fast, *mcu);
+    SM_Init(*slow, *mcu);
+
+    for (uint32_t address = PROGRAM_START; address < PROGRAM_END;)
+    {
+        const auto& entry = TEST_OPCODES[rng() % std::size(TEST_OPCODES)];
+        fast->rom[address & 0xfff] = entry[0];
+        // Favor operands that produce zero and negative results.
+        if (entry[1] == 2 && address + 1 < PROGRAM_END)
+            fast->rom[(address + 1) & 0xfff] = (rng() % 4 == 0) ? 0 : (uint8_t)rng();
+        address += entry[1];
+    }
+    fast->rom[0xffe] = PROGRAM_START & 0xff;
+    fast->rom[0xfff] = PROGRAM_START >> 8;
+    std::copy(std::begin(fast->rom), std::end(fast->rom), slow->rom);
+
+    // Give `slow` a decoded image without handlers so every instruction goes through the decode-as-executed path.
+    auto undecoded = std::make_shared<SM_DecodedRom>();
+    std::copy(std::begin(slow->rom), std::end(slow->rom), undecoded->rom);
+    slow->rom_code = undecoded;
+
+    SM_Reset(*fast);
+    SM_Reset(*slow);
+    REQUIRE(slow->rom_code == undecoded);
+
+    // Flags an eager interpreter would hold.
+    bool n = false;
+    bool z = false;
+
+    for (int step = 0; step < 200000; ++step)
+    {
+        // Branches can land inside an instruction; start over instead of running its operand.
+        if (fast->pc < PROGRAM_START || fast->pc + 2 > PROGRAM_END || !TestOpcodeLength(fast->rom[fast->pc & 0xfff]))
+        {
+            fast->pc = PROGRAM_START;
+            slow->pc = PROGRAM_START;
+        }
+
+        const uint16_t pc      = fast->pc;
+        const uint8_t  opcode  = fast->rom[pc & 0xfff];
+        const uint8_t  operand = fast->rom[(pc + 1) & 0xfff];
+        const uint8_t  length  = TestOpcodeLength(opcode);
+        const uint8_t  a       = fast->a;
+        const uint8_t  x       = fast->x;
+        const uint8_t  y       = fast->y;
+
+        StepOne(*fast);
+        StepOne(*slow);
+
+        int result = -1;
+        bool taken = false;
+        switch (opcode)
+        {
+        case 0xa9: case 0x09: case 0x29: case 0x8a: case 0x1a: case 0x3a:
+            result = fast->a;
+            break;
+        case 0xa2: case 0xaa: case 0xe8:
+            result = fast->x;
+            break;
+        case 0xa0: case 0xc8:
+            result = fast->y;
+            break;
+        case 0xc9:
+            result = (a - operand) & 0xff;
+            break;
+        case 0xe0:
+            result = (x - operand) & 0xff;
+            break;
+        case 0xc0:
+            result = (y - operand) & 0xff;
+            break;
+        case 0xf0:
+            taken = z;
+            break;
+        case 0xd0:
+            taken = !z;
+            break;
+        case 0x10:
+            taken = !n;
+            break;
+        }
+
+        if (result >= 0)
+        {
+            n = (result & 0x80) != 0;
+            z = result == 0;
+            REQUIRE(fast->pc == (uint16_t)(pc + length));
+        }
+        else
+        {
+            REQUIRE(fast->pc == (uint16_t)(pc + length + (taken ? (int8_t)operand : 0)));
+        }
+
+        const uint8_t flags = VisibleFlags(*fast);
+        REQUIRE(((flags & SM_STATUS_N) != 0) == n);
+        REQUIRE(((flags & SM_STATUS_Z) != 0) == z);
+
+        REQUIRE(slow->pc == fast->pc);
+        REQUIRE(slow->a == fast->a);
+        REQUIRE(slow->x == fast->x);
+        REQUIRE(slow->y == fast->y);
+        REQUIRE(VisibleFlags(*slow) == flags);
+    }
+}
+
+TEST_CASE("Sub-MCU instances share the decoded rom")
+{
+    auto mcu = std::make_unique<mcu_t>();
+    auto sm1 = std::make_unique<submcu_t>();
+    auto sm2 = std::make_unique<submcu_t>();
+    SM_Init(*sm1, *mcu);
+    SM_Init(*sm2, *mcu);
+
+    for (size_t i = 0; i < sizeof(sm1->rom); ++i)
+    {
+        sm1->rom[i] = (uint8_t)(i * 7);
+        sm2->rom[i] = (uint8_t)(i * 7);
+    }
+
+    SM_Reset(*sm1);
+    SM_Reset(*sm2);
+    REQUIRE(sm1->rom_code);
+    REQUIRE(sm1->rom_code == sm2->rom_code);
+
+    // A different rom gets its own image, and the other instance keeps the old one.
+    sm2->rom[0x123] ^= 0xff;
+    SM_Reset(*sm2);
+    REQUIRE(sm1->rom_code != sm2->rom_code);
+    REQUIRE(sm2->rom_code->rom[0x123] == sm2->rom[0x123]);
+    REQUIRE(sm1->rom_code->rom[0x123] == sm1->rom[0x123]);
+}
@@ -0,0 +1,35 @@
+#include "common/thread_util.h"
+#include <catch2/catch_test_macros.hpp>
+
+TEST_CASE("CPU list parsing")
+{
+    using namespace common;
+
+    std::vector<uint32_t> cpus;
+
+    // Invalid parses
+    REQUIRE(!ParseCpuList("", cpus));
+    REQUIRE(!ParseCpuList(",", cpus));
+    REQUIRE(!ParseCpuList("1,", cpus));
+    REQUIRE(!ParseCpuList(",1", cpus));
+    REQUIRE(!ParseCpuList("1,,2", cpus));
+    REQUIRE(!ParseCpuList("a", cpus));
+    REQUIRE(!ParseCpuList("-1", cpus));
+    REQUIRE(!ParseCpuList("1-", cpus));
+    REQUIRE(!ParseCpuList("3-1", cpus));
+    REQUIRE(!ParseCpuList("0-4000000000", cpus));
+
+    // Valid parses
+    const std::vector<uint32_t> single{3};
+    REQUIRE(ParseCpuList("3", cpus));
+    REQUIRE(cpus == single);
+
+    const std::vector<uint32_t> mixed{0, 2, 4, 5, 6, 7};
+    REQUIRE(ParseCpuList("0,2,4-7", cpus));
+    REQUIRE(cpus == mixed);
+
+    // order is preserved
+    const std::vector<uint32_t> unordered{5, 1};
+    REQUIRE(ParseCpuList("5,1", cpus));
+    REQUIRE(cpus == unordered);
+}
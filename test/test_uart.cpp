@@ -0,0 +1,49 @@
+#include <catch2/catch_test_macros.hpp>
+#include "emu_stats.h"
+#include "mcu.h"
+#include <memory>
+#include <vector>
+
+TEST_CASE("UART receive buffer")
+{
+    auto mcu = std::make_unique<mcu_t>();
+
+    // One byte is kept free to tell a full buffer from an empty one.
+    REQUIRE(MCU_GetUARTWritable(*mcu) == uart_buffer_size - 1);
+    REQUIRE(!MCU_UART_HasByte(*mcu));
+
+    std::vector<uint8_t> dump(uart_buffer_size + 100);
+    for (size_t i = 0; i < dump.size(); ++i)
+    {
+        dump[i] = (uint8_t)i;
+    }
+
+    // Only what fits is posted.
+    REQUIRE(MCU_TryPostUART(*mcu, dump) == uart_buffer_size - 1);
+    REQUIRE(MCU_GetUARTWritable(*mcu) == 0);
+    REQUIRE(MCU_TryPostUART(*mcu, dump) == 0);
+
+    // Reading frees space, and the rest of the dump can follow in order, wrapping around the end of the buffer.
+    for (size_t i = 0; i < 200; ++i)
+    {
+        REQUIRE(MCU_UART_HasByte(*mcu));
+        REQUIRE(MCU_UART_ReadByte(*mcu) == dump[i]);
+    }
+    REQUIRE(MCU_GetUARTWritable(*mcu) == 200);
+    REQUIRE(MCU_TryPostUART(*mcu, std::span(dump).subspan(uart_buffer_size - 1)) == 101);
+
+    for (size_t i = 200; i < dump.size(); ++i)
+    {
+        REQUIRE(MCU_UART_HasByte(*mcu));
+        REQUIRE(MCU_UART_ReadByte(*mcu) == dump[i]);
+    }
+    REQUIRE(!MCU_UART_HasByte(*mcu));
+
+    // MCU_PostUART drops instead of overwriting unread bytes.
+    EMU_Counters counters;
+    mcu->stats = &counters;
+    MCU_PostUART(*mcu, dump);
+    REQUIRE(counters.uart_rx_bytes.Get() == uart_buffer_size - 1);
+    REQUIRE(counters.uart_rx_dropped.Get() == 101);
+    REQUIRE(MCU_UART_ReadByte(*mcu) == dump[0]);
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+#include <filesystem>
+
+// Creates an empty scratch directory under the system temp directory.
+inline std::filesystem::path MakeScratchDirectory(const char* name)
+{
+    const std::filesystem::path dir = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir;
+}